@@ -0,0 +1,727 @@
+#include "aabbtree.h"
+#include "collision.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include <string.h>
+
+/* takes a node from the free list, doubling the pool when it is empty */
+long aabbtree_alloc_node(AabbtreeObject* self)
+{
+	AabbNode* pNode;
+	void* tmp;
+	long n, i;
+
+	if (self->nFree == AABB_NULL)
+	{
+		n = self->nNodeAlloc ? self->nNodeAlloc * 2 : 16;
+		tmp = realloc(self->pNodes, n * sizeof(AabbNode));
+		if (!tmp)
+			return AABB_NULL;
+		self->pNodes = (AabbNode*)tmp;
+		for (i = self->nNodeAlloc; i < n; i++)
+		{
+			self->pNodes[i].nParent = (i + 1 < n) ? i + 1 : AABB_NULL;
+			self->pNodes[i].nHeight = -1;
+			self->pNodes[i].pObj = NULL;
+		}
+		self->nFree = self->nNodeAlloc;
+		self->nNodeAlloc = n;
+	}
+
+	i = self->nFree;
+	pNode = &self->pNodes[i];
+	self->nFree = pNode->nParent;
+	pNode->nParent = AABB_NULL;
+	pNode->nChild1 = AABB_NULL;
+	pNode->nChild2 = AABB_NULL;
+	pNode->nHeight = 0;
+	pNode->pObj = NULL;
+	return i;
+}
+
+void aabbtree_free_node(AabbtreeObject* self, long i)
+{
+	self->pNodes[i].nParent = self->nFree;
+	self->pNodes[i].nHeight = -1;
+	self->pNodes[i].pObj = NULL;
+	self->nFree = i;
+}
+
+/* surface area, the cost measure of the insertion heuristic */
+double aabbtree_area(double* min, double* max)
+{
+	double dx = max[0] - min[0];
+	double dy = max[1] - min[1];
+	double dz = max[2] - min[2];
+
+	return 2.0 * ((dx * dy) + (dy * dz) + (dz * dx));
+}
+
+void aabbtree_union(AabbNode* a, AabbNode* b, double* min, double* max)
+{
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		min[k] = a->min[k] < b->min[k] ? a->min[k] : b->min[k];
+		max[k] = a->max[k] > b->max[k] ? a->max[k] : b->max[k];
+	}
+}
+
+int aabbtree_overlap(double* amin, double* amax, double* bmin, double* bmax)
+{
+	return (amin[0] <= bmax[0] && bmin[0] <= amax[0] &&
+		amin[1] <= bmax[1] && bmin[1] <= amax[1] &&
+		amin[2] <= bmax[2] && bmin[2] <= amax[2]);
+}
+
+int aabbtree_push(AabbtreeObject* self, long* pnTop, long i)
+{
+	void* tmp;
+
+	if (*pnTop == self->nStackAlloc)
+	{
+		tmp = realloc(self->pStack, (self->nStackAlloc + 64) * sizeof(long));
+		if (!tmp)
+			return 0;
+		self->pStack = (long*)tmp;
+		self->nStackAlloc += 64;
+	}
+	self->pStack[(*pnTop)++] = i;
+	return 1;
+}
+
+/* recomputes the height and box of an internal node from its children */
+void aabbtree_refit(AabbtreeObject* self, long i)
+{
+	AabbNode* pNode = &self->pNodes[i];
+	AabbNode* p1 = &self->pNodes[pNode->nChild1];
+	AabbNode* p2 = &self->pNodes[pNode->nChild2];
+
+	pNode->nHeight = 1 + (p1->nHeight > p2->nHeight ? p1->nHeight : p2->nHeight);
+	aabbtree_union(p1, p2, pNode->min, pNode->max);
+}
+
+/* rotates the taller grandchild up if the subtree at iA is out of balance */
+/* by more than one level, returns the new subtree root */
+long aabbtree_balance(AabbtreeObject* self, long iA)
+{
+	AabbNode* N = self->pNodes;
+	AabbNode* A = &N[iA];
+	long iB, iC, iX, iY, iUp, nBalance;
+
+	if (AABB_IS_LEAF(A) || A->nHeight < 2)
+		return iA;
+
+	iB = A->nChild1;
+	iC = A->nChild2;
+	nBalance = N[iC].nHeight - N[iB].nHeight;
+	if (nBalance > 1)
+		iUp = iC;
+	else if (nBalance < -1)
+		iUp = iB;
+	else
+		return iA;
+
+	/* iUp takes A's place.  It keeps its taller child, and A takes the */
+	/* shorter one into the slot iUp leaves. */
+	iX = N[iUp].nChild1;
+	iY = N[iUp].nChild2;
+	if (N[iX].nHeight < N[iY].nHeight)
+	{
+		iX = N[iUp].nChild2;
+		iY = N[iUp].nChild1;
+	}
+	N[iUp].nChild1 = iA;
+	N[iUp].nChild2 = iX;
+	N[iUp].nParent = A->nParent;
+	A->nParent = iUp;
+	if (N[iUp].nParent != AABB_NULL)
+	{
+		if (N[N[iUp].nParent].nChild1 == iA)
+			N[N[iUp].nParent].nChild1 = iUp;
+		else
+			N[N[iUp].nParent].nChild2 = iUp;
+	}
+	else
+		self->nRoot = iUp;
+	if (iUp == iC)
+		A->nChild2 = iY;
+	else
+		A->nChild1 = iY;
+	N[iY].nParent = iA;
+
+	aabbtree_refit(self, iA);
+	aabbtree_refit(self, iUp);
+	return iUp;
+}
+
+/* walks from a node to the root, rebalancing and refitting on the way */
+void aabbtree_fix_upwards(AabbtreeObject* self, long i)
+{
+	while (i != AABB_NULL)
+	{
+		i = aabbtree_balance(self, i);
+		aabbtree_refit(self, i);
+		i = self->pNodes[i].nParent;
+	}
+}
+
+/* descends from the root towards the sibling whose union with the leaf adds */
+/* the least surface area, counting the growth of every ancestor on the way */
+void aabbtree_insert_leaf(AabbtreeObject* self, long nLeaf)
+{
+	AabbNode *N, *pLeaf, *pNode, *pChild;
+	double min[3], max[3];
+	double dArea, dCombined, dCost, dInherit, d;
+	double dCost1 = 0.0, dCost2 = 0.0;
+	long i, nSibling, nOldParent, nNewParent, nChild;
+	int c;
+
+	if (self->nRoot == AABB_NULL)
+	{
+		self->nRoot = nLeaf;
+		self->pNodes[nLeaf].nParent = AABB_NULL;
+		return;
+	}
+
+	/* allocate first, the pool may move */
+	nNewParent = aabbtree_alloc_node(self);
+	N = self->pNodes;
+	pLeaf = &N[nLeaf];
+
+	i = self->nRoot;
+	while (!AABB_IS_LEAF(&N[i]))
+	{
+		pNode = &N[i];
+		dArea = aabbtree_area(pNode->min, pNode->max);
+		aabbtree_union(pNode, pLeaf, min, max);
+		dCombined = aabbtree_area(min, max);
+
+		/* cost of making the leaf a sibling of this node */
+		dCost = 2.0 * dCombined;
+		/* minimum cost of pushing the leaf further down */
+		dInherit = 2.0 * (dCombined - dArea);
+
+		for (c = 0; c < 2; c++)
+		{
+			nChild = c ? pNode->nChild2 : pNode->nChild1;
+			pChild = &N[nChild];
+			aabbtree_union(pChild, pLeaf, min, max);
+			d = aabbtree_area(min, max) + dInherit;
+			if (!AABB_IS_LEAF(pChild))
+				d -= aabbtree_area(pChild->min, pChild->max);
+			if (c)
+				dCost2 = d;
+			else
+				dCost1 = d;
+		}
+
+		if (dCost < dCost1 && dCost < dCost2)
+			break;
+		i = (dCost1 < dCost2) ? pNode->nChild1 : pNode->nChild2;
+	}
+	nSibling = i;
+
+	nOldParent = N[nSibling].nParent;
+	N[nNewParent].nParent = nOldParent;
+	N[nNewParent].nChild1 = nSibling;
+	N[nNewParent].nChild2 = nLeaf;
+	aabbtree_refit(self, nNewParent);
+	N[nSibling].nParent = nNewParent;
+	pLeaf->nParent = nNewParent;
+	if (nOldParent != AABB_NULL)
+	{
+		if (N[nOldParent].nChild1 == nSibling)
+			N[nOldParent].nChild1 = nNewParent;
+		else
+			N[nOldParent].nChild2 = nNewParent;
+	}
+	else
+		self->nRoot = nNewParent;
+
+	aabbtree_fix_upwards(self, nOldParent);
+}
+
+void aabbtree_remove_leaf(AabbtreeObject* self, long nLeaf)
+{
+	AabbNode* N = self->pNodes;
+	long nParent, nGrand, nSibling;
+
+	if (nLeaf == self->nRoot)
+	{
+		self->nRoot = AABB_NULL;
+		return;
+	}
+
+	nParent = N[nLeaf].nParent;
+	nGrand = N[nParent].nParent;
+	nSibling = (N[nParent].nChild1 == nLeaf) ? N[nParent].nChild2 : N[nParent].nChild1;
+
+	N[nSibling].nParent = nGrand;
+	if (nGrand != AABB_NULL)
+	{
+		if (N[nGrand].nChild1 == nParent)
+			N[nGrand].nChild1 = nSibling;
+		else
+			N[nGrand].nChild2 = nSibling;
+	}
+	else
+		self->nRoot = nSibling;
+	aabbtree_free_node(self, nParent);
+	N[nLeaf].nParent = AABB_NULL;
+
+	aabbtree_fix_upwards(self, nGrand);
+}
+
+void aabbtree_set_fat(AabbtreeObject* self, long nLeaf, double* min, double* max)
+{
+	AabbNode* pLeaf = &self->pNodes[nLeaf];
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		pLeaf->min[k] = min[k] - self->dMargin;
+		pLeaf->max[k] = max[k] + self->dMargin;
+	}
+}
+
+long aabbtree_find(AabbtreeObject* self, PyObject* other)
+{
+	long i = ptrmap_find(&self->leaves, other, NULL);
+
+	if (i < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument not found in tree");
+		return AABB_NULL;
+	}
+	return self->leaves.pSlots[i].value;
+}
+
+/* appends the objects of the leaves whose fat box overlaps the box, skipping */
+/* leaves at or below index nSkipBelow.  pFirst, if given, is appended */
+/* before each one, building a flat array of pairs. */
+int aabbtree_query(AabbtreeObject* self, double* min, double* max, long nSkipBelow, ObarrObject* pOut, PyObject* pFirst)
+{
+	AabbNode* pNode;
+	long nTop = 0;
+	long i;
+
+	if (self->nRoot == AABB_NULL)
+		return 1;
+	if (!aabbtree_push(self, &nTop, self->nRoot))
+		return 0;
+	while (nTop > 0)
+	{
+		i = self->pStack[--nTop];
+		pNode = &self->pNodes[i];
+		if (!aabbtree_overlap(pNode->min, pNode->max, min, max))
+			continue;
+		if (AABB_IS_LEAF(pNode))
+		{
+			if (i <= nSkipBelow)
+				continue;
+			if (pFirst && !obarr_append(pOut, pFirst))
+				return 0;
+			if (!obarr_append(pOut, pNode->pObj))
+				return 0;
+		}
+		else if (!aabbtree_push(self, &nTop, pNode->nChild1) || !aabbtree_push(self, &nTop, pNode->nChild2))
+			return 0;
+	}
+	return 1;
+}
+
+int Aabbtree_init(AabbtreeObject *self, PyObject *args, PyObject *kwds)
+{
+	double dMargin = 0.1;
+
+    if (!PyArg_ParseTuple(args, "|d", &dMargin))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (dMargin < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "margin must not be negative");
+		return -1;
+	}
+
+	self->pNodes = NULL;
+	self->nNodeAlloc = 0;
+	self->nFree = AABB_NULL;
+	self->nRoot = AABB_NULL;
+	self->nLeaves = 0;
+	self->dMargin = dMargin;
+	ptrmap_init(&self->leaves);
+	self->pStack = NULL;
+	self->nStackAlloc = 0;
+
+	return 0;
+}
+
+void Aabbtree_dealloc(PyObject* self_in)
+{
+	AabbtreeObject* self = (AabbtreeObject*)self_in;
+	long i;
+
+	for (i = 0; i < self->nNodeAlloc; i++)
+		Py_XDECREF(self->pNodes[i].pObj);
+	if (self->pNodes)
+		free(self->pNodes);
+	if (self->pStack)
+		free(self->pStack);
+	ptrmap_free(&self->leaves);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Aabbtree_repr(PyObject *self_in)
+{
+	AabbtreeObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Aabbtree_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (AabbtreeObject*)self_in;
+	tuple = Py_BuildValue("(ll)", self->nLeaves, self->nRoot == AABB_NULL ? 0 : self->pNodes[self->nRoot].nHeight);
+	fmtstring = PyString_FromString("<aabbtree of %d objects, height %d>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Aabbtree_len(PyObject *self_in)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+
+	return self->nLeaves;
+}
+
+int Aabbtree_contains(PyObject* self_in, PyObject* other_in)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+
+	return ptrmap_find(&self->leaves, other_in, NULL) >= 0;
+}
+
+/* adds an object with its box, given as min and max vects or else taken */
+/* from its pos and radius, fattened by the tree's margin */
+PyObject* Aabbtree_insert(PyObject *self_in, PyObject *args)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	PyObject *other, *pMin = NULL, *pMax = NULL;
+	double min[3], max[3];
+	long n, p;
+
+    if (!PyArg_ParseTuple(args, "O|OO", &other, &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (ptrmap_find(&self->leaves, other, NULL) >= 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "object is already in the tree");
+		return NULL;
+	}
+	if (!collider_read_bounds(other, pMin, pMax, min, max))
+		return NULL;
+
+	/* take the leaf and its future parent now, so that inserting it cannot */
+	/* fail halfway: the parent goes back on the free list for insert_leaf */
+	n = aabbtree_alloc_node(self);
+	if (n != AABB_NULL)
+	{
+		p = aabbtree_alloc_node(self);
+		if (p == AABB_NULL || ptrmap_set(&self->leaves, other, NULL, n) < 0)
+		{
+			if (p != AABB_NULL)
+				aabbtree_free_node(self, p);
+			aabbtree_free_node(self, n);
+			n = AABB_NULL;
+		}
+		else
+			aabbtree_free_node(self, p);
+	}
+	if (n == AABB_NULL)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	Py_INCREF(other);
+	self->pNodes[n].pObj = other;
+	aabbtree_set_fat(self, n, min, max);
+	aabbtree_insert_leaf(self, n);
+	self->nLeaves++;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Aabbtree_remove(PyObject *self_in, PyObject *args)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	PyObject *other;
+	long n;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	n = aabbtree_find(self, other);
+	if (n == AABB_NULL)
+		return NULL;
+
+	ptrmap_del(&self->leaves, other, NULL);
+	aabbtree_remove_leaf(self, n);
+	Py_DECREF(self->pNodes[n].pObj);
+	aabbtree_free_node(self, n);
+	self->nLeaves--;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* re-reads an object's box.  The leaf is only reinserted if the new box */
+/* has left its fat box; returns True if it was. */
+PyObject* Aabbtree_move(PyObject *self_in, PyObject *args)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	AabbNode *pLeaf;
+	PyObject *other, *pMin = NULL, *pMax = NULL;
+	double min[3], max[3];
+	long n;
+
+    if (!PyArg_ParseTuple(args, "O|OO", &other, &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	n = aabbtree_find(self, other);
+	if (n == AABB_NULL)
+		return NULL;
+	if (!collider_read_bounds(other, pMin, pMax, min, max))
+		return NULL;
+
+	pLeaf = &self->pNodes[n];
+	if (pLeaf->min[0] <= min[0] && pLeaf->min[1] <= min[1] && pLeaf->min[2] <= min[2] &&
+		pLeaf->max[0] >= max[0] && pLeaf->max[1] >= max[1] && pLeaf->max[2] >= max[2])
+	{
+		Py_INCREF(Py_False);
+		return Py_False;
+	}
+
+	/* removing frees the leaf's parent, which reinsertion takes back */
+	aabbtree_remove_leaf(self, n);
+	aabbtree_set_fat(self, n, min, max);
+	aabbtree_insert_leaf(self, n);
+
+	Py_INCREF(Py_True);
+	return Py_True;
+}
+
+/* finds the objects whose fat boxes overlap a box given as min and max vects */
+PyObject* Aabbtree_query_box(PyObject *self_in, PyObject *args)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	PyObject *pMin, *pMax;
+	ObarrObject *rv;
+	double min[3], max[3];
+
+    if (!PyArg_ParseTuple(args, "OO", &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pMin, min) || !cgrid_read_pos(pMax, max))
+		return NULL;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!aabbtree_query(self, min, max, AABB_NULL - 1, rv, NULL))
+	{
+		Py_DECREF(rv);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+/* casts a segment from start to end against the fat boxes and returns a */
+/* list of (object, t) tuples sorted by the fraction t where it enters them */
+PyObject* Aabbtree_raycast(PyObject *self_in, PyObject *args)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	PyObject *pStart, *pEnd;
+	PyObject *rv = NULL;
+	AabbNode *pNode;
+	sortkey *pKeys = NULL;
+	double start[3], delta[3], end[3];
+	double t0, t1;
+	long nTop, nKeys, nKeyAlloc, i;
+	void *tmp;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "OO", &pStart, &pEnd))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pStart, start) || !cgrid_read_pos(pEnd, end))
+		return NULL;
+	for (k = 0; k < 3; k++)
+		delta[k] = end[k] - start[k];
+
+	nTop = 0;
+	nKeys = 0;
+	nKeyAlloc = 0;
+	if (self->nRoot != AABB_NULL && !aabbtree_push(self, &nTop, self->nRoot))
+		goto nomem;
+	while (nTop > 0)
+	{
+		i = self->pStack[--nTop];
+		pNode = &self->pNodes[i];
+		t0 = 0.0;
+		t1 = 1.0;
+		if (!cgrid_clip_slab(start[0], delta[0], pNode->min[0], pNode->max[0], &t0, &t1) ||
+			!cgrid_clip_slab(start[1], delta[1], pNode->min[1], pNode->max[1], &t0, &t1) ||
+			!cgrid_clip_slab(start[2], delta[2], pNode->min[2], pNode->max[2], &t0, &t1))
+			continue;
+		if (!AABB_IS_LEAF(pNode))
+		{
+			if (!aabbtree_push(self, &nTop, pNode->nChild1) || !aabbtree_push(self, &nTop, pNode->nChild2))
+				goto nomem;
+			continue;
+		}
+		if (nKeys == nKeyAlloc)
+		{
+			tmp = realloc(pKeys, (nKeyAlloc + 64) * sizeof(sortkey));
+			if (!tmp)
+				goto nomem;
+			pKeys = (sortkey*)tmp;
+			nKeyAlloc += 64;
+		}
+		pKeys[nKeys].d = t0;
+		pKeys[nKeys].i = i;
+		nKeys++;
+	}
+
+	qsort(pKeys, nKeys, sizeof(sortkey), compare_doubles);
+	rv = PyList_New(nKeys);
+	if (!rv)
+		goto done;
+	for (i = 0; i < nKeys; i++)
+		PyList_SET_ITEM(rv, i, Py_BuildValue("(Od)", self->pNodes[pKeys[i].i].pObj, pKeys[i].d));
+	goto done;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+done:
+	if (pKeys)
+		free(pKeys);
+	return rv;
+}
+
+/* returns every pair of objects whose fat boxes overlap as a flat array */
+/* (a0, b0, a1, b1, ...) */
+PyObject* Aabbtree_find_pairs(PyObject *self_in, PyObject *unused)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+	ObarrObject *rv;
+	AabbNode *pNode;
+	long i;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	for (i = 0; i < self->nNodeAlloc; i++)
+	{
+		pNode = &self->pNodes[i];
+		if (pNode->nHeight != 0)
+			continue;
+		if (!aabbtree_query(self, pNode->min, pNode->max, i, rv, pNode->pObj))
+		{
+			Py_DECREF(rv);
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return NULL;
+		}
+	}
+	return (PyObject*)rv;
+}
+
+PyObject* Aabbtree_height(PyObject *self_in, PyObject *unused)
+{
+	AabbtreeObject *self = (AabbtreeObject*)self_in;
+
+	return PyInt_FromLong(self->nRoot == AABB_NULL ? 0 : self->pNodes[self->nRoot].nHeight);
+}
+
+
+
+PySequenceMethods Aabbtree_as_seq[] = {
+	Aabbtree_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	Aabbtree_contains,		/* sq_contains */
+};
+
+PyMethodDef Aabbtree_methods[] = {
+	{"insert", (PyCFunction)Aabbtree_insert, METH_VARARGS, "add an object, with its box given as min and max vects or taken from its pos and radius"},
+	{"remove", (PyCFunction)Aabbtree_remove, METH_VARARGS, "remove an object"},
+	{"move", (PyCFunction)Aabbtree_move, METH_VARARGS, "update an object's box, reinserting it only if it left its fat box"},
+	{"query_box", (PyCFunction)Aabbtree_query_box, METH_VARARGS, "find the objects whose fat boxes overlap a box (min, max)"},
+	{"raycast", (PyCFunction)Aabbtree_raycast, METH_VARARGS, "cast a segment (start, end), returning (object, t) hits in order"},
+	{"find_pairs", (PyCFunction)Aabbtree_find_pairs, METH_NOARGS, "get every pair of objects whose fat boxes overlap as a flat array"},
+	{"height", (PyCFunction)Aabbtree_height, METH_NOARGS, "get the height of the tree"},
+	{NULL}
+};
+
+struct PyMemberDef Aabbtree_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject AabbtreeObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.aabbtree",		/* tp_name        */
+	sizeof(AabbtreeObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Aabbtree_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Aabbtree_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Aabbtree_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Dynamic bounding volume tree of fattened axis-aligned boxes.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Aabbtree_methods,   /* tp_methods        */
+	Aabbtree_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Aabbtree_init,		/* tp_init           */
+};
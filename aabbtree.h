@@ -0,0 +1,81 @@
+#ifndef AABBTREE_H_INCLUDED
+#define AABBTREE_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+#include "ptrmap.h"
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+#define AABB_NULL (-1)
+
+/* tree node, stored in a pool and referred to by index.  Leaves hold an */
+/* object and its fattened box, internal nodes the union of their children. */
+typedef struct AabbNode {
+	double			min[3];
+	double			max[3];
+	PyObject*		pObj;
+	long			nParent;	/* next free node while on the free list */
+	long			nChild1;
+	long			nChild2;
+	long			nHeight;	/* 0 for a leaf, -1 while free */
+} AabbNode;
+
+typedef struct AabbtreeObject {
+	PyObject_HEAD
+	AabbNode*		pNodes;
+	long			nNodeAlloc;
+	long			nFree;
+	long			nRoot;
+	long			nLeaves;
+	double			dMargin;
+	Ptrmap			leaves;
+	long*			pStack;
+	long			nStackAlloc;
+} AabbtreeObject;
+
+#define Aabbtree_Check(op) PyObject_TypeCheck(op, &AabbtreeObjectType)
+#define AABB_IS_LEAF(p) ((p)->nChild1 == AABB_NULL)
+
+/* internal functions */
+long aabbtree_alloc_node(AabbtreeObject* self);
+void aabbtree_free_node(AabbtreeObject* self, long i);
+double aabbtree_area(double* min, double* max);
+void aabbtree_union(AabbNode* a, AabbNode* b, double* min, double* max);
+int aabbtree_overlap(double* amin, double* amax, double* bmin, double* bmax);
+int aabbtree_push(AabbtreeObject* self, long* pnTop, long i);
+long aabbtree_balance(AabbtreeObject* self, long iA);
+void aabbtree_refit(AabbtreeObject* self, long i);
+void aabbtree_fix_upwards(AabbtreeObject* self, long i);
+void aabbtree_insert_leaf(AabbtreeObject* self, long nLeaf);
+void aabbtree_remove_leaf(AabbtreeObject* self, long nLeaf);
+void aabbtree_set_fat(AabbtreeObject* self, long nLeaf, double* min, double* max);
+long aabbtree_find(AabbtreeObject* self, PyObject* other);
+int aabbtree_query(AabbtreeObject* self, double* min, double* max, long nSkipBelow, ObarrObject* pOut, PyObject* pFirst);
+
+/* exported API functions */
+int Aabbtree_init(AabbtreeObject *self, PyObject *args, PyObject *kwds);
+void Aabbtree_dealloc(PyObject* self_in);
+PyObject* Aabbtree_repr(PyObject *self_in);
+Py_ssize_t Aabbtree_len(PyObject *self_in);
+int Aabbtree_contains(PyObject* self_in, PyObject* other_in);
+PyObject* Aabbtree_insert(PyObject *self_in, PyObject *args);
+PyObject* Aabbtree_remove(PyObject *self_in, PyObject *args);
+PyObject* Aabbtree_move(PyObject *self_in, PyObject *args);
+PyObject* Aabbtree_query_box(PyObject *self_in, PyObject *args);
+PyObject* Aabbtree_raycast(PyObject *self_in, PyObject *args);
+PyObject* Aabbtree_find_pairs(PyObject *self_in, PyObject *unused);
+PyObject* Aabbtree_height(PyObject *self_in, PyObject *unused);
+
+extern PySequenceMethods Aabbtree_as_seq[];
+extern PyMethodDef Aabbtree_methods[];
+extern struct PyMemberDef Aabbtree_members[];
+extern PyTypeObject AabbtreeObjectType;
+
+#endif
@@ -0,0 +1,603 @@
+#include "aoi.h"
+#include "obarr.h"
+#include "red_black_tree.h"
+#include <math.h>
+
+int aoi_in_range(CgridKey* a, CgridKey* b, long nRange)
+{
+	return (labs(a->x - b->x) <= nRange && labs(a->y - b->y) <= nRange && labs(a->z - b->z) <= nRange);
+}
+
+void aoi_observer_clear(AoiObserver* pObs)
+{
+	long i;
+
+	for (i = 0; i < pObs->visible.nAllocSize; i++)
+	{
+		if (!PTRMAP_EMPTY(&pObs->visible, i))
+			Py_DECREF((PyObject*)pObs->visible.pSlots[i].a);
+	}
+	ptrmap_free(&pObs->visible);
+	Py_XDECREF(pObs->pEnter);
+	Py_XDECREF(pObs->pLeave);
+	pObs->pEnter = NULL;
+	pObs->pLeave = NULL;
+	Py_XDECREF(pObs->pObj);
+	pObs->pObj = NULL;
+}
+
+/* records an enter or leave delta for this tick */
+int aoi_observer_note(AoiObserver* pObs, PyObject* other, int bEnter)
+{
+	ObarrObject** ppList = bEnter ? &pObs->pEnter : &pObs->pLeave;
+
+	if (!*ppList)
+	{
+		*ppList = PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init(*ppList, NULL, NULL);
+	}
+	return obarr_append(*ppList, other);
+}
+
+/* recomputes an observer's visibility set from scratch and diffs it with */
+/* the previous one.  Only done for observers that changed cells. */
+int aoi_observer_refresh(AoiObject* self, AoiObserver* pObs)
+{
+	CgridObject* pGrid = self->pGrid;
+	CgridStatic* pStatic = pGrid->pStatic;
+	CgridInfo* pV;
+	PyObject* other;
+	Ptrmap fresh;
+	CgridKey k;
+	long i, c;
+
+	ptrmap_init(&fresh);
+	if (pObs->bInGrid)
+	{
+		for (k.x = pObs->k.x - pObs->nRange; k.x <= pObs->k.x + pObs->nRange; k.x++)
+		{
+			for (k.y = pObs->k.y - pObs->nRange; k.y <= pObs->k.y + pObs->nRange; k.y++)
+			{
+				for (k.z = pObs->k.z - pObs->nRange; k.z <= pObs->k.z + pObs->nRange; k.z++)
+				{
+					if (pStatic && (c = cgrid_static_find_cell(pStatic, &k)) >= 0)
+					{
+						for (i = pStatic->pStart[c]; i < pStatic->pStart[c + 1]; i++)
+						{
+							other = pStatic->pObjects[i];
+							if (ptrmap_find(&fresh, other, NULL) >= 0)
+								continue;
+							if (ptrmap_set(&fresh, other, NULL, 1) < 0)
+								goto nomem;
+							Py_INCREF(other);
+						}
+					}
+					pV = cgrid_get_cell(pGrid, &k);
+					if (!pV)
+						continue;
+					for (i = 0; i < pV->pContents->nSize; i++)
+					{
+						other = obarr_get_element(pV->pContents, i);
+						if (other == pObs->pObj || ptrmap_find(&fresh, other, NULL) >= 0)
+							continue;
+						if (ptrmap_set(&fresh, other, NULL, 1) < 0)
+							goto nomem;
+						Py_INCREF(other);
+					}
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < fresh.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&fresh, i))
+			continue;
+		other = (PyObject*)fresh.pSlots[i].a;
+		if (ptrmap_find(&pObs->visible, other, NULL) < 0 && !aoi_observer_note(pObs, other, 1))
+			goto nomem;
+	}
+	for (i = 0; i < pObs->visible.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&pObs->visible, i))
+			continue;
+		other = (PyObject*)pObs->visible.pSlots[i].a;
+		if (ptrmap_find(&fresh, other, NULL) < 0 && !aoi_observer_note(pObs, other, 0))
+			goto nomem;
+		Py_DECREF(other);
+	}
+	ptrmap_free(&pObs->visible);
+	pObs->visible = fresh;
+	return 1;
+
+nomem:
+	for (i = 0; i < fresh.nAllocSize; i++)
+	{
+		if (!PTRMAP_EMPTY(&fresh, i))
+			Py_DECREF((PyObject*)fresh.pSlots[i].a);
+	}
+	ptrmap_free(&fresh);
+	return 0;
+}
+
+/* applies one entity's cell crossing to the observers that could see its */
+/* old or new cell, found through the grid cells around both */
+int aoi_entity_moved(AoiObject* self, AoiMove* pMove)
+{
+	CgridObject* pGrid = self->pGrid;
+	AoiObserver* pObs;
+	CgridInfo* pV;
+	CgridKey* pCenter;
+	CgridKey k;
+	PyObject* other;
+	long nPass, nSlot, i;
+	int bNow;
+
+	for (nPass = 0; nPass < 2; nPass++)
+	{
+		if (nPass == 0 && !pMove->bOld)
+			continue;
+		if (nPass == 1 && !pMove->bNew)
+			continue;
+		pCenter = (nPass == 0) ? &pMove->kOld : &pMove->kNew;
+
+		for (k.x = pCenter->x - self->nMaxRange; k.x <= pCenter->x + self->nMaxRange; k.x++)
+		{
+			for (k.y = pCenter->y - self->nMaxRange; k.y <= pCenter->y + self->nMaxRange; k.y++)
+			{
+				for (k.z = pCenter->z - self->nMaxRange; k.z <= pCenter->z + self->nMaxRange; k.z++)
+				{
+					/* cells around both ends were already seen in the first pass */
+					if (nPass == 1 && pMove->bOld && aoi_in_range(&k, &pMove->kOld, self->nMaxRange))
+						continue;
+					pV = cgrid_get_cell(pGrid, &k);
+					if (!pV)
+						continue;
+					for (i = 0; i < pV->pContents->nSize; i++)
+					{
+						other = obarr_get_element(pV->pContents, i);
+						if (other == pMove->pObj)
+							continue;
+						nSlot = ptrmap_find(&self->observers, other, NULL);
+						if (nSlot < 0)
+							continue;
+						pObs = &self->pObservers[self->observers.pSlots[nSlot].value];
+						if (pObs->bDirty)
+							continue;
+
+						bNow = pMove->bNew && aoi_in_range(&pObs->k, &pMove->kNew, pObs->nRange);
+						nSlot = ptrmap_find(&pObs->visible, pMove->pObj, NULL);
+						if (bNow && nSlot < 0)
+						{
+							if (ptrmap_set(&pObs->visible, pMove->pObj, NULL, 1) < 0)
+								return 0;
+							Py_INCREF(pMove->pObj);
+							if (!aoi_observer_note(pObs, pMove->pObj, 1))
+								return 0;
+						}
+						else if (!bNow && nSlot >= 0)
+						{
+							ptrmap_del_slot(&pObs->visible, nSlot);
+							if (!aoi_observer_note(pObs, pMove->pObj, 0))
+								return 0;
+							Py_DECREF(pMove->pObj);
+						}
+					}
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+void aoi_update_max_range(AoiObject* self)
+{
+	long i;
+
+	self->nMaxRange = 0;
+	for (i = 0; i < self->nObservers; i++)
+	{
+		if (self->pObservers[i].nRange > self->nMaxRange)
+			self->nMaxRange = self->pObservers[i].nRange;
+	}
+}
+
+int Aoi_init(AoiObject *self, PyObject *args, PyObject *kwds)
+{
+	CgridObject* pGrid;
+
+    if (!PyArg_ParseTuple(args, "O!", &CgridObjectType, &pGrid))
+	{
+		PyErr_SetString(PyExc_TypeError, "argument must be a cgrid");
+		return -1;
+	}
+	if (pGrid->bLogMoves)
+	{
+		PyErr_SetString(PyExc_ValueError, "cgrid already has an aoi attached");
+		return -1;
+	}
+
+	Py_INCREF(pGrid);
+	self->pGrid = pGrid;
+	self->pObservers = NULL;
+	self->nObservers = 0;
+	self->nObserverAlloc = 0;
+	self->nMaxRange = 0;
+	ptrmap_init(&self->observers);
+
+	cgrid_clear_moves(pGrid);
+	pGrid->bLogMoves = 1;
+	return 0;
+}
+
+void Aoi_dealloc(PyObject* self_in)
+{
+	AoiObject* self = (AoiObject*)self_in;
+	long i;
+
+	for (i = 0; i < self->nObservers; i++)
+		aoi_observer_clear(&self->pObservers[i]);
+	if (self->pObservers)
+		free(self->pObservers);
+	ptrmap_free(&self->observers);
+	if (self->pGrid)
+	{
+		self->pGrid->bLogMoves = 0;
+		cgrid_clear_moves(self->pGrid);
+		Py_DECREF(self->pGrid);
+	}
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Aoi_repr(PyObject *self_in)
+{
+	AoiObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Aoi_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (AoiObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->nObservers);
+	fmtstring = PyString_FromString("<aoi of %d observers>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Aoi_len(PyObject *self_in)
+{
+	AoiObject* self = (AoiObject*)self_in;
+
+	return self->nObservers;
+}
+
+/* observers must be members of the grid's dynamic layer; everything they */
+/* can see is reported as entering on the next tick */
+PyObject* Aoi_add_observer(PyObject *self_in, PyObject *args)
+{
+	AoiObject* self = (AoiObject*)self_in;
+	AoiObserver* pObs;
+	CgridInfo* pV;
+	PyObject* other;
+	double dRadius;
+	long i;
+	void* tmp;
+
+    if (!PyArg_ParseTuple(args, "Od", &other, &dRadius))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (ptrmap_find(&self->observers, other, NULL) >= 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "object is already an observer");
+		return NULL;
+	}
+	pV = cgrid_find_member(self->pGrid, other, NULL, &i);
+	if (!pV)
+		return NULL;
+
+	if (self->nObservers == self->nObserverAlloc)
+	{
+		tmp = realloc(self->pObservers, (self->nObserverAlloc + 64) * sizeof(AoiObserver));
+		if (!tmp)
+		{
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return NULL;
+		}
+		self->pObservers = (AoiObserver*)tmp;
+		self->nObserverAlloc += 64;
+	}
+	if (ptrmap_set(&self->observers, other, NULL, self->nObservers) < 0)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+
+	pObs = &self->pObservers[self->nObservers++];
+	Py_INCREF(other);
+	pObs->pObj = other;
+	pObs->dRadius = dRadius;
+	pObs->nRange = (long)ceil(dRadius / self->pGrid->dCellSize);
+	COPY_KEY(&pV->k, &pObs->k);
+	pObs->bInGrid = 1;
+	pObs->bDirty = 1;
+	pObs->pEnter = NULL;
+	pObs->pLeave = NULL;
+	ptrmap_init(&pObs->visible);
+	if (pObs->nRange > self->nMaxRange)
+		self->nMaxRange = pObs->nRange;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Aoi_remove_observer(PyObject *self_in, PyObject *args)
+{
+	AoiObject* self = (AoiObject*)self_in;
+	PyObject* other;
+	long nSlot, i, last;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	nSlot = ptrmap_find(&self->observers, other, NULL);
+	if (nSlot < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument is not an observer");
+		return NULL;
+	}
+	i = self->observers.pSlots[nSlot].value;
+	ptrmap_del_slot(&self->observers, nSlot);
+	aoi_observer_clear(&self->pObservers[i]);
+
+	last = self->nObservers - 1;
+	if (i < last)
+	{
+		self->pObservers[i] = self->pObservers[last];
+		nSlot = ptrmap_find(&self->observers, self->pObservers[i].pObj, NULL);
+		self->observers.pSlots[nSlot].value = i;
+	}
+	self->nObservers--;
+	aoi_update_max_range(self);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Aoi_visible(PyObject *self_in, PyObject *args)
+{
+	AoiObject* self = (AoiObject*)self_in;
+	AoiObserver* pObs;
+	ObarrObject* rv;
+	PyObject* other;
+	long nSlot, i;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	nSlot = ptrmap_find(&self->observers, other, NULL);
+	if (nSlot < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument is not an observer");
+		return NULL;
+	}
+	pObs = &self->pObservers[self->observers.pSlots[nSlot].value];
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	for (i = 0; i < pObs->visible.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&pObs->visible, i))
+			continue;
+		if (!obarr_append(rv, (PyObject*)pObs->visible.pSlots[i].a))
+		{
+			Py_DECREF(rv);
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return NULL;
+		}
+	}
+	return (PyObject*)rv;
+}
+
+/* consumes the grid's cell crossings since the last tick and returns a list */
+/* of (observer, entered, left) for every observer whose view changed */
+PyObject* Aoi_tick(PyObject *self_in, PyObject *unused)
+{
+	AoiObject* self = (AoiObject*)self_in;
+	CgridObject* pGrid = self->pGrid;
+	CgridMove* pGridMove;
+	AoiObserver* pObs;
+	AoiMove* pMoves = NULL;
+	AoiMove* pMove;
+	Ptrmap coalesce;
+	PyObject* rv = NULL;
+	PyObject* pEnter;
+	PyObject* pLeave;
+	PyObject* pItem;
+	long nMoves = 0;
+	long nSlot, i;
+
+	ptrmap_init(&coalesce);
+	if (pGrid->nMoves > 0)
+	{
+		pMoves = (AoiMove*)malloc(pGrid->nMoves * sizeof(AoiMove));
+		if (!pMoves)
+			goto nomem;
+	}
+
+	/* observers that changed cells are recomputed in full, everything */
+	/* else is merged into one move per object, first old to last new cell */
+	for (i = 0; i < pGrid->nMoves; i++)
+	{
+		pGridMove = &pGrid->pMoves[i];
+		if (!pGridMove->pObj)
+		{
+			for (nSlot = 0; nSlot < self->nObservers; nSlot++)
+				self->pObservers[nSlot].bDirty = 1;
+			continue;
+		}
+		nSlot = ptrmap_find(&self->observers, pGridMove->pObj, NULL);
+		if (nSlot >= 0)
+		{
+			pObs = &self->pObservers[self->observers.pSlots[nSlot].value];
+			pObs->bDirty = 1;
+			pObs->bInGrid = pGridMove->bNew;
+			if (pGridMove->bNew)
+			{
+				COPY_KEY(&pGridMove->kNew, &pObs->k);
+			}
+		}
+
+		nSlot = ptrmap_find(&coalesce, pGridMove->pObj, NULL);
+		if (nSlot < 0)
+		{
+			if (ptrmap_set(&coalesce, pGridMove->pObj, NULL, nMoves) < 0)
+				goto nomem;
+			pMove = &pMoves[nMoves++];
+			pMove->pObj = pGridMove->pObj;
+			pMove->bOld = pGridMove->bOld;
+			COPY_KEY(&pGridMove->kOld, &pMove->kOld);
+		}
+		else
+			pMove = &pMoves[coalesce.pSlots[nSlot].value];
+		pMove->bNew = pGridMove->bNew;
+		COPY_KEY(&pGridMove->kNew, &pMove->kNew);
+	}
+
+	for (i = 0; i < nMoves; i++)
+	{
+		pMove = &pMoves[i];
+		if (!pMove->bOld && !pMove->bNew)
+			continue;
+		if (pMove->bOld && pMove->bNew && cgrid_compare(&pMove->kOld, &pMove->kNew) == 0)
+			continue;
+		if (!aoi_entity_moved(self, pMove))
+			goto nomem;
+	}
+
+	for (i = 0; i < self->nObservers; i++)
+	{
+		pObs = &self->pObservers[i];
+		if (!pObs->bDirty)
+			continue;
+		if (!aoi_observer_refresh(self, pObs))
+			goto nomem;
+		pObs->bDirty = 0;
+	}
+
+	rv = PyList_New(0);
+	if (!rv)
+		goto done;
+	for (i = 0; i < self->nObservers; i++)
+	{
+		pObs = &self->pObservers[i];
+		if (!pObs->pEnter && !pObs->pLeave)
+			continue;
+		if (!pObs->pEnter)
+		{
+			pObs->pEnter = PyObject_New(ObarrObject, &ObarrObjectType);
+			Obarr_init(pObs->pEnter, NULL, NULL);
+		}
+		if (!pObs->pLeave)
+		{
+			pObs->pLeave = PyObject_New(ObarrObject, &ObarrObjectType);
+			Obarr_init(pObs->pLeave, NULL, NULL);
+		}
+		pEnter = (PyObject*)pObs->pEnter;
+		pLeave = (PyObject*)pObs->pLeave;
+		pObs->pEnter = NULL;
+		pObs->pLeave = NULL;
+		pItem = Py_BuildValue("(ONN)", pObs->pObj, pEnter, pLeave);
+		if (!pItem || PyList_Append(rv, pItem) < 0)
+		{
+			Py_XDECREF(pItem);
+			Py_DECREF(rv);
+			rv = NULL;
+			goto done;
+		}
+		Py_DECREF(pItem);
+	}
+	goto done;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+done:
+	cgrid_clear_moves(pGrid);
+	ptrmap_free(&coalesce);
+	if (pMoves)
+		free(pMoves);
+	return rv;
+}
+
+
+
+PySequenceMethods Aoi_as_seq[] = {
+	Aoi_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Aoi_methods[] = {
+	{"add_observer", (PyCFunction)Aoi_add_observer, METH_VARARGS, "watch the area around a grid member (object, view radius)"},
+	{"remove_observer", (PyCFunction)Aoi_remove_observer, METH_VARARGS, "stop watching for an object"},
+	{"visible", (PyCFunction)Aoi_visible, METH_VARARGS, "get the objects an observer can currently see"},
+	{"tick", (PyCFunction)Aoi_tick, METH_NOARGS, "process the grid's cell crossings and return (observer, entered, left) deltas"},
+	{NULL}
+};
+
+struct PyMemberDef Aoi_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject AoiObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.aoi",		/* tp_name        */
+	sizeof(AoiObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Aoi_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Aoi_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Aoi_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Area of interest tracking over a cgrid.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Aoi_methods,   /* tp_methods        */
+	Aoi_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Aoi_init,		/* tp_init           */
+};
@@ -0,0 +1,73 @@
+#ifndef AOI_H_INCLUDED
+#define AOI_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+#include "cgrid.h"
+#include "ptrmap.h"
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+/* an observer sees every member of the cells within nRange cells of its */
+/* own cell on each axis, nRange being its view radius in whole cells */
+typedef struct AoiObserver {
+	PyObject*		pObj;
+	double			dRadius;
+	long			nRange;
+	CgridKey		k;
+	int				bInGrid;
+	int				bDirty;
+	Ptrmap			visible;
+	ObarrObject*	pEnter;
+	ObarrObject*	pLeave;
+} AoiObserver;
+
+/* coalesced cell crossings of one object since the last tick */
+typedef struct AoiMove {
+	PyObject*		pObj;
+	CgridKey		kOld;
+	CgridKey		kNew;
+	int				bOld;
+	int				bNew;
+} AoiMove;
+
+typedef struct AoiObject {
+	PyObject_HEAD
+	CgridObject*	pGrid;
+	AoiObserver*	pObservers;
+	long			nObservers;
+	long			nObserverAlloc;
+	Ptrmap			observers;
+	long			nMaxRange;
+} AoiObject;
+
+#define Aoi_Check(op) PyObject_TypeCheck(op, &AoiObjectType)
+
+/* internal functions */
+int aoi_in_range(CgridKey* a, CgridKey* b, long nRange);
+void aoi_observer_clear(AoiObserver* pObs);
+int aoi_observer_note(AoiObserver* pObs, PyObject* other, int bEnter);
+int aoi_observer_refresh(AoiObject* self, AoiObserver* pObs);
+int aoi_entity_moved(AoiObject* self, AoiMove* pMove);
+void aoi_update_max_range(AoiObject* self);
+
+/* exported API functions */
+int Aoi_init(AoiObject *self, PyObject *args, PyObject *kwds);
+void Aoi_dealloc(PyObject* self_in);
+PyObject* Aoi_repr(PyObject *self_in);
+Py_ssize_t Aoi_len(PyObject *self_in);
+PyObject* Aoi_add_observer(PyObject *self_in, PyObject *args);
+PyObject* Aoi_remove_observer(PyObject *self_in, PyObject *args);
+PyObject* Aoi_visible(PyObject *self_in, PyObject *args);
+PyObject* Aoi_tick(PyObject *self_in, PyObject *unused);
+
+extern PySequenceMethods Aoi_as_seq[];
+extern PyMethodDef Aoi_methods[];
+extern struct PyMemberDef Aoi_members[];
+extern PyTypeObject AoiObjectType;
+
+#endif
@@ -0,0 +1,634 @@
+#include "bodies.h"
+#include "obarr.h"
+#include "vect.h"
+#include "quat.h"
+#include <math.h>
+#include <string.h>
+
+/* regrows every row of the store to nAlloc bodies */
+int bodies_reserve(BodiesObject* self, long nAlloc)
+{
+	double* pData;
+	int f;
+
+	if (nAlloc <= self->nAlloc)
+		return 1;
+	pData = (double*)malloc(nAlloc * BODIES_FIELDS * sizeof(double));
+	if (!pData)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return 0;
+	}
+	if (self->pData)
+	{
+		for (f = 0; f < BODIES_FIELDS; f++)
+			memcpy(pData + (f * nAlloc), BODIES_ROW(self, f), self->nCount * sizeof(double));
+		free(self->pData);
+	}
+	self->pData = pData;
+	self->nAlloc = nAlloc;
+	return 1;
+}
+
+int bodies_index(BodiesObject* self, long i)
+{
+	if (i < 0 || i >= self->nCount)
+	{
+		PyErr_SetString(PyExc_IndexError, "body index out of range");
+		return 0;
+	}
+	return 1;
+}
+
+/* a vect or 3-tuple, or a quat when bQuat */
+int bodies_read_arg(PyObject* other, int bQuat, double* v)
+{
+	if (bQuat)
+	{
+		if (!Quat_Check(other))
+		{
+			PyErr_SetString(PyExc_TypeError, "expected a quat");
+			return 0;
+		}
+		memcpy(v, ((QuatObject*)other)->elements, 4 * sizeof(double));
+		return 1;
+	}
+	if (Vect_Check(other))
+	{
+		memcpy(v, ((VectObject*)other)->elements, 3 * sizeof(double));
+		return 1;
+	}
+	if (!PyArg_Parse(other, "(ddd)", &v[0], &v[1], &v[2]))
+	{
+		PyErr_SetString(PyExc_TypeError, "expected a vect");
+		return 0;
+	}
+	return 1;
+}
+
+void bodies_read(BodiesObject* self, long i, int nField, int nWidth, double* v)
+{
+	int k;
+
+	for (k = 0; k < nWidth; k++)
+		v[k] = BODIES_ROW(self, nField + k)[i];
+}
+
+void bodies_write(BodiesObject* self, long i, int nField, int nWidth, double* v)
+{
+	int k;
+
+	for (k = 0; k < nWidth; k++)
+		BODIES_ROW(self, nField + k)[i] = v[k];
+}
+
+/* shared body of the get_* methods */
+PyObject* bodies_get(PyObject* self_in, PyObject* args, int nField, int bQuat)
+{
+	BodiesObject* self = (BodiesObject*)self_in;
+	VectObject* v;
+	QuatObject* q;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i))
+		return NULL;
+	if (bQuat)
+	{
+		q = PyObject_New(QuatObject, &QuatObjectType);
+		if (q)
+			bodies_read(self, i, nField, 4, q->elements);
+		return (PyObject*)q;
+	}
+	v = PyObject_New(VectObject, &VectObjectType);
+	if (v)
+		bodies_read(self, i, nField, 3, v->elements);
+	return (PyObject*)v;
+}
+
+/* shared body of the set_* methods */
+PyObject* bodies_set(PyObject* self_in, PyObject* args, int nField, int bQuat)
+{
+	BodiesObject* self = (BodiesObject*)self_in;
+	PyObject* other;
+	double v[4];
+	long i;
+
+    if (!PyArg_ParseTuple(args, "lO", &i, &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i) || !bodies_read_arg(other, bQuat, v))
+		return NULL;
+	bodies_write(self, i, nField, bQuat ? 4 : 3, v);
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* applies the world space inverse inertia of body i to t: rotates into */
+/* the body axes, scales by the principal inverse inertia and back */
+void bodies_inv_inertia(BodiesObject* self, long i, double* t, double* rv)
+{
+	double q[4], m[9], l[3];
+	int k;
+
+	bodies_read(self, i, BODIES_QX, 4, q);
+	quat_matrix3_internal(q, m);
+	for (k = 0; k < 3; k++)
+		l[k] = ((m[k] * t[0]) + (m[3 + k] * t[1]) + (m[6 + k] * t[2])) * BODIES_ROW(self, BODIES_II + k)[i];
+	for (k = 0; k < 3; k++)
+		rv[k] = (m[k * 3] * l[0]) + (m[(k * 3) + 1] * l[1]) + (m[(k * 3) + 2] * l[2]);
+}
+
+/* semi-implicit Euler: velocities take the accumulated force, torque and */
+/* gravity first, then positions and orientations move by the new ones. */
+/* Damping scales velocities by 1 / (1 + dt * c), which stays stable for */
+/* any step.  Forces and torques are cleared afterwards. */
+void bodies_step(BodiesObject* self, double dt, double* g, double dLinDamp, double dAngDamp)
+{
+	double *px, *py, *pz, *vx, *vy, *vz, *fx, *fy, *fz, *im;
+	double *qx, *qy, *qz, *qw, *wx, *wy, *wz;
+	double lin = 1.0 / (1.0 + (dt * dLinDamp));
+	double ang = 1.0 / (1.0 + (dt * dAngDamp));
+	double t[3], dw[3], x, y, z, w, s, h;
+	long n = self->nCount, i;
+	int k;
+
+	px = BODIES_ROW(self, BODIES_PX); py = BODIES_ROW(self, BODIES_PX + 1); pz = BODIES_ROW(self, BODIES_PX + 2);
+	vx = BODIES_ROW(self, BODIES_VX); vy = BODIES_ROW(self, BODIES_VX + 1); vz = BODIES_ROW(self, BODIES_VX + 2);
+	fx = BODIES_ROW(self, BODIES_FX); fy = BODIES_ROW(self, BODIES_FX + 1); fz = BODIES_ROW(self, BODIES_FX + 2);
+	qx = BODIES_ROW(self, BODIES_QX); qy = BODIES_ROW(self, BODIES_QX + 1);
+	qz = BODIES_ROW(self, BODIES_QX + 2); qw = BODIES_ROW(self, BODIES_QX + 3);
+	wx = BODIES_ROW(self, BODIES_WX); wy = BODIES_ROW(self, BODIES_WX + 1); wz = BODIES_ROW(self, BODIES_WX + 2);
+	im = BODIES_ROW(self, BODIES_IM);
+
+	/* linear state, straight down the rows; static bodies skip gravity */
+	for (i = 0; i < n; i++)
+	{
+		s = (im[i] > 0.0) ? 1.0 : 0.0;
+		vx[i] = (vx[i] + (((fx[i] * im[i]) + (g[0] * s)) * dt)) * lin;
+		vy[i] = (vy[i] + (((fy[i] * im[i]) + (g[1] * s)) * dt)) * lin;
+		vz[i] = (vz[i] + (((fz[i] * im[i]) + (g[2] * s)) * dt)) * lin;
+		px[i] += vx[i] * dt;
+		py[i] += vy[i] * dt;
+		pz[i] += vz[i] * dt;
+	}
+
+	/* angular state: dq = 0.5 * dt * (w, 0) * q, then renormalize */
+	h = 0.5 * dt;
+	for (i = 0; i < n; i++)
+	{
+		for (k = 0; k < 3; k++)
+			t[k] = BODIES_ROW(self, BODIES_TX + k)[i];
+		if (t[0] != 0.0 || t[1] != 0.0 || t[2] != 0.0)
+		{
+			bodies_inv_inertia(self, i, t, dw);
+			wx[i] += dw[0] * dt;
+			wy[i] += dw[1] * dt;
+			wz[i] += dw[2] * dt;
+		}
+		wx[i] *= ang;
+		wy[i] *= ang;
+		wz[i] *= ang;
+
+		x = qx[i]; y = qy[i]; z = qz[i]; w = qw[i];
+		x += h * ((wx[i] * qw[i]) + (wy[i] * qz[i]) - (wz[i] * qy[i]));
+		y += h * ((wy[i] * qw[i]) + (wz[i] * qx[i]) - (wx[i] * qz[i]));
+		z += h * ((wz[i] * qw[i]) + (wx[i] * qy[i]) - (wy[i] * qx[i]));
+		w -= h * ((wx[i] * qx[i]) + (wy[i] * qy[i]) + (wz[i] * qz[i]));
+		s = sqrt((x * x) + (y * y) + (z * z) + (w * w));
+		s = (s > 0.0) ? 1.0 / s : 0.0;
+		qx[i] = x * s; qy[i] = y * s; qz[i] = z * s; qw[i] = w * s;
+	}
+
+	for (k = 0; k < 6; k++)
+		memset(BODIES_ROW(self, BODIES_FX + k), 0, n * sizeof(double));
+}
+
+
+int Bodies_init(BodiesObject *self, PyObject *args, PyObject *kwds)
+{
+	long nAlloc = 16;
+
+    if (!PyArg_ParseTuple(args, "|l", &nAlloc))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (self->pData)
+		free(self->pData);
+	self->pData = NULL;
+	self->nCount = 0;
+	self->nAlloc = 0;
+	return bodies_reserve(self, nAlloc > 0 ? nAlloc : 1) ? 0 : -1;
+}
+
+void Bodies_dealloc(PyObject* self_in)
+{
+	BodiesObject* self = (BodiesObject*)self_in;
+
+	if (self->pData)
+		free(self->pData);
+	self->pData = NULL;
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Bodies_repr(PyObject *self_in)
+{
+	BodiesObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Bodies_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (BodiesObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->nCount);
+	fmtstring = PyString_FromString("<bodies of %d>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Bodies_len(PyObject *self_in)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+
+	return self->nCount;
+}
+
+/* add(pos[, vel[, rot[, angvel[, mass[, inertia]]]]]) returns the new */
+/* body's index.  A mass of 0 makes a static body; the inertia is the */
+/* principal moments in body axes, by default those of a solid sphere */
+/* of radius 1. */
+PyObject* Bodies_add(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	PyObject *pPos, *pVel = NULL, *pRot = NULL, *pAngVel = NULL, *pInertia = NULL;
+	double v[BODIES_FIELDS], inertia[3];
+	double dMass = 1.0;
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "O|OOOdO", &pPos, &pVel, &pRot, &pAngVel, &dMass, &pInertia))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	memset(v, 0, sizeof(v));
+	v[BODIES_QX + 3] = 1.0;
+	inertia[0] = inertia[1] = inertia[2] = 0.4 * dMass;
+	if (!bodies_read_arg(pPos, 0, &v[BODIES_PX]) ||
+		(pVel && pVel != Py_None && !bodies_read_arg(pVel, 0, &v[BODIES_VX])) ||
+		(pRot && pRot != Py_None && !bodies_read_arg(pRot, 1, &v[BODIES_QX])) ||
+		(pAngVel && pAngVel != Py_None && !bodies_read_arg(pAngVel, 0, &v[BODIES_WX])) ||
+		(pInertia && pInertia != Py_None && !bodies_read_arg(pInertia, 0, inertia)))
+		return NULL;
+	if (dMass < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "mass must not be negative");
+		return NULL;
+	}
+	v[BODIES_IM] = (dMass > 0.0) ? 1.0 / dMass : 0.0;
+	for (k = 0; k < 3; k++)
+		v[BODIES_II + k] = (dMass > 0.0 && inertia[k] > 0.0) ? 1.0 / inertia[k] : 0.0;
+
+	if (self->nCount == self->nAlloc && !bodies_reserve(self, self->nAlloc * 2))
+		return NULL;
+	i = self->nCount++;
+	bodies_write(self, i, 0, BODIES_FIELDS, v);
+	return PyInt_FromLong(i);
+}
+
+/* removes body i; the last body moves into its place */
+PyObject* Bodies_remove(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	double v[BODIES_FIELDS];
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i))
+		return NULL;
+	self->nCount--;
+	if (i != self->nCount)
+	{
+		bodies_read(self, self->nCount, 0, BODIES_FIELDS, v);
+		bodies_write(self, i, 0, BODIES_FIELDS, v);
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Bodies_get_pos(PyObject *self_in, PyObject *args)
+{
+	return bodies_get(self_in, args, BODIES_PX, 0);
+}
+
+PyObject* Bodies_set_pos(PyObject *self_in, PyObject *args)
+{
+	return bodies_set(self_in, args, BODIES_PX, 0);
+}
+
+PyObject* Bodies_get_vel(PyObject *self_in, PyObject *args)
+{
+	return bodies_get(self_in, args, BODIES_VX, 0);
+}
+
+PyObject* Bodies_set_vel(PyObject *self_in, PyObject *args)
+{
+	return bodies_set(self_in, args, BODIES_VX, 0);
+}
+
+PyObject* Bodies_get_rot(PyObject *self_in, PyObject *args)
+{
+	return bodies_get(self_in, args, BODIES_QX, 1);
+}
+
+PyObject* Bodies_set_rot(PyObject *self_in, PyObject *args)
+{
+	return bodies_set(self_in, args, BODIES_QX, 1);
+}
+
+PyObject* Bodies_get_angvel(PyObject *self_in, PyObject *args)
+{
+	return bodies_get(self_in, args, BODIES_WX, 0);
+}
+
+PyObject* Bodies_set_angvel(PyObject *self_in, PyObject *args)
+{
+	return bodies_set(self_in, args, BODIES_WX, 0);
+}
+
+/* set_mass(i, mass[, inertia]); a mass of 0 makes the body static */
+PyObject* Bodies_set_mass(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	PyObject *pInertia = NULL;
+	double dMass, inertia[3];
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "ld|O", &i, &dMass, &pInertia))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i))
+		return NULL;
+	if (dMass < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "mass must not be negative");
+		return NULL;
+	}
+	inertia[0] = inertia[1] = inertia[2] = 0.4 * dMass;
+	if (pInertia && pInertia != Py_None && !bodies_read_arg(pInertia, 0, inertia))
+		return NULL;
+	BODIES_ROW(self, BODIES_IM)[i] = (dMass > 0.0) ? 1.0 / dMass : 0.0;
+	for (k = 0; k < 3; k++)
+		BODIES_ROW(self, BODIES_II + k)[i] = (dMass > 0.0 && inertia[k] > 0.0) ? 1.0 / inertia[k] : 0.0;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* apply_force(i, force[, point]) adds to the force for the next step, */
+/* and a torque if it acts at a world point off the body's center */
+PyObject* Bodies_apply_force(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	PyObject *pForce, *pPoint = NULL;
+	double f[3], p[3], r[3];
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "lO|O", &i, &pForce, &pPoint))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i) || !bodies_read_arg(pForce, 0, f) ||
+		(pPoint && pPoint != Py_None && !bodies_read_arg(pPoint, 0, p)))
+		return NULL;
+	for (k = 0; k < 3; k++)
+		BODIES_ROW(self, BODIES_FX + k)[i] += f[k];
+	if (pPoint && pPoint != Py_None)
+	{
+		for (k = 0; k < 3; k++)
+			r[k] = p[k] - BODIES_ROW(self, BODIES_PX + k)[i];
+		BODIES_ROW(self, BODIES_TX)[i] += (r[1] * f[2]) - (r[2] * f[1]);
+		BODIES_ROW(self, BODIES_TX + 1)[i] += (r[2] * f[0]) - (r[0] * f[2]);
+		BODIES_ROW(self, BODIES_TX + 2)[i] += (r[0] * f[1]) - (r[1] * f[0]);
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* apply_impulse(i, impulse[, point]) changes the velocities at once */
+PyObject* Bodies_apply_impulse(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	PyObject *pImpulse, *pPoint = NULL;
+	double j[3], p[3], r[3], t[3], dw[3];
+	double im;
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "lO|O", &i, &pImpulse, &pPoint))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_index(self, i) || !bodies_read_arg(pImpulse, 0, j) ||
+		(pPoint && pPoint != Py_None && !bodies_read_arg(pPoint, 0, p)))
+		return NULL;
+	im = BODIES_ROW(self, BODIES_IM)[i];
+	for (k = 0; k < 3; k++)
+		BODIES_ROW(self, BODIES_VX + k)[i] += j[k] * im;
+	if (pPoint && pPoint != Py_None)
+	{
+		for (k = 0; k < 3; k++)
+			r[k] = p[k] - BODIES_ROW(self, BODIES_PX + k)[i];
+		t[0] = (r[1] * j[2]) - (r[2] * j[1]);
+		t[1] = (r[2] * j[0]) - (r[0] * j[2]);
+		t[2] = (r[0] * j[1]) - (r[1] * j[0]);
+		bodies_inv_inertia(self, i, t, dw);
+		for (k = 0; k < 3; k++)
+			BODIES_ROW(self, BODIES_WX + k)[i] += dw[k];
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* every position as an obarr of vects, in body order */
+PyObject* Bodies_get_positions(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	ObarrObject *rv;
+	VectObject *v;
+	long i;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, self->nCount))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		Py_DECREF(rv);
+		return NULL;
+	}
+	for (i = 0; i < self->nCount; i++)
+	{
+		v = PyObject_New(VectObject, &VectObjectType);
+		if (!v)
+		{
+			Py_DECREF(rv);
+			return NULL;
+		}
+		bodies_read(self, i, BODIES_PX, 3, v->elements);
+		obarr_set_element(rv, i, (PyObject*)v);
+		Py_DECREF(v);
+	}
+	return (PyObject*)rv;
+}
+
+/* every orientation as an obarr of quats, in body order */
+PyObject* Bodies_get_rotations(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	ObarrObject *rv;
+	QuatObject *q;
+	long i;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, self->nCount))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		Py_DECREF(rv);
+		return NULL;
+	}
+	for (i = 0; i < self->nCount; i++)
+	{
+		q = PyObject_New(QuatObject, &QuatObjectType);
+		if (!q)
+		{
+			Py_DECREF(rv);
+			return NULL;
+		}
+		bodies_read(self, i, BODIES_QX, 4, q->elements);
+		obarr_set_element(rv, i, (PyObject*)q);
+		Py_DECREF(q);
+	}
+	return (PyObject*)rv;
+}
+
+/* step(dt[, gravity[, linear_damping[, angular_damping]]]) */
+PyObject* Bodies_step(PyObject *self_in, PyObject *args)
+{
+	BodiesObject *self = (BodiesObject*)self_in;
+	PyObject *pGravity = NULL;
+	double dt, g[3] = {0.0, 0.0, 0.0};
+	double dLinDamp = 0.0, dAngDamp = 0.0;
+
+    if (!PyArg_ParseTuple(args, "d|Odd", &dt, &pGravity, &dLinDamp, &dAngDamp))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (pGravity && pGravity != Py_None && !bodies_read_arg(pGravity, 0, g))
+		return NULL;
+	if (dLinDamp < 0.0 || dAngDamp < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "damping must not be negative");
+		return NULL;
+	}
+	bodies_step(self, dt, g, dLinDamp, dAngDamp);
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+
+
+PySequenceMethods Bodies_as_seq[] = {
+	Bodies_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Bodies_methods[] = {
+	{"add", (PyCFunction)Bodies_add, METH_VARARGS, "add a body (pos[, vel[, rot[, angvel[, mass[, inertia]]]]]), returning its index"},
+	{"remove", (PyCFunction)Bodies_remove, METH_VARARGS, "remove a body by index; the last body takes its place"},
+	{"get_pos", (PyCFunction)Bodies_get_pos, METH_VARARGS, "position of a body"},
+	{"set_pos", (PyCFunction)Bodies_set_pos, METH_VARARGS, "set the position of a body"},
+	{"get_vel", (PyCFunction)Bodies_get_vel, METH_VARARGS, "linear velocity of a body"},
+	{"set_vel", (PyCFunction)Bodies_set_vel, METH_VARARGS, "set the linear velocity of a body"},
+	{"get_rot", (PyCFunction)Bodies_get_rot, METH_VARARGS, "orientation of a body"},
+	{"set_rot", (PyCFunction)Bodies_set_rot, METH_VARARGS, "set the orientation of a body"},
+	{"get_angvel", (PyCFunction)Bodies_get_angvel, METH_VARARGS, "angular velocity of a body, world axes"},
+	{"set_angvel", (PyCFunction)Bodies_set_angvel, METH_VARARGS, "set the angular velocity of a body"},
+	{"set_mass", (PyCFunction)Bodies_set_mass, METH_VARARGS, "set the mass (0 for static) and optionally the principal inertia of a body"},
+	{"apply_force", (PyCFunction)Bodies_apply_force, METH_VARARGS, "add a force for the next step, optionally at a world point"},
+	{"apply_impulse", (PyCFunction)Bodies_apply_impulse, METH_VARARGS, "apply an impulse now, optionally at a world point"},
+	{"get_positions", (PyCFunction)Bodies_get_positions, METH_NOARGS, "every position as an obarr of vects"},
+	{"get_rotations", (PyCFunction)Bodies_get_rotations, METH_NOARGS, "every orientation as an obarr of quats"},
+	{"step", (PyCFunction)Bodies_step, METH_VARARGS, "integrate every body by dt with optional gravity and damping"},
+	{NULL}
+};
+
+struct PyMemberDef Bodies_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject BodiesObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.bodies",		/* tp_name        */
+	sizeof(BodiesObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Bodies_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Bodies_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Bodies_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Rigid body state store with a batched integrator.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Bodies_methods,   /* tp_methods        */
+	Bodies_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Bodies_init,		/* tp_init           */
+};
@@ -0,0 +1,75 @@
+#ifndef BODIES_H_INCLUDED
+#define BODIES_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+/* rigid body state kept field by field: pData holds BODIES_FIELDS rows */
+/* of nAlloc doubles, one row per component, so the integrator runs down */
+/* contiguous arrays.  Bodies are numbered 0 .. nCount - 1. */
+typedef struct BodiesObject {
+	PyObject_HEAD
+	double*			pData;
+	long			nCount;
+	long			nAlloc;
+} BodiesObject;
+
+#define BODIES_PX		0		/* position */
+#define BODIES_VX		3		/* linear velocity */
+#define BODIES_QX		6		/* orientation quat x, y, z, w */
+#define BODIES_WX		10		/* angular velocity, world axes */
+#define BODIES_FX		13		/* force accumulated for the next step */
+#define BODIES_TX		16		/* torque accumulated for the next step */
+#define BODIES_IM		19		/* inverse mass, 0 for static bodies */
+#define BODIES_II		20		/* inverse principal inertia, body axes */
+#define BODIES_FIELDS	23
+
+#define BODIES_ROW(self, f) ((self)->pData + ((f) * (self)->nAlloc))
+
+#define Bodies_Check(op) PyObject_TypeCheck(op, &BodiesObjectType)
+
+/* internal functions */
+int bodies_reserve(BodiesObject* self, long nAlloc);
+int bodies_index(BodiesObject* self, long i);
+int bodies_read_arg(PyObject* other, int bQuat, double* v);
+void bodies_read(BodiesObject* self, long i, int nField, int nWidth, double* v);
+void bodies_write(BodiesObject* self, long i, int nField, int nWidth, double* v);
+PyObject* bodies_get(PyObject* self_in, PyObject* args, int nField, int bQuat);
+PyObject* bodies_set(PyObject* self_in, PyObject* args, int nField, int bQuat);
+void bodies_inv_inertia(BodiesObject* self, long i, double* t, double* rv);
+void bodies_step(BodiesObject* self, double dt, double* g, double dLinDamp, double dAngDamp);
+
+/* exported API functions */
+int Bodies_init(BodiesObject *self, PyObject *args, PyObject *kwds);
+void Bodies_dealloc(PyObject* self_in);
+PyObject* Bodies_repr(PyObject *self_in);
+Py_ssize_t Bodies_len(PyObject *self_in);
+PyObject* Bodies_add(PyObject *self_in, PyObject *args);
+PyObject* Bodies_remove(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_pos(PyObject *self_in, PyObject *args);
+PyObject* Bodies_set_pos(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_vel(PyObject *self_in, PyObject *args);
+PyObject* Bodies_set_vel(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_rot(PyObject *self_in, PyObject *args);
+PyObject* Bodies_set_rot(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_angvel(PyObject *self_in, PyObject *args);
+PyObject* Bodies_set_angvel(PyObject *self_in, PyObject *args);
+PyObject* Bodies_set_mass(PyObject *self_in, PyObject *args);
+PyObject* Bodies_apply_force(PyObject *self_in, PyObject *args);
+PyObject* Bodies_apply_impulse(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_positions(PyObject *self_in, PyObject *args);
+PyObject* Bodies_get_rotations(PyObject *self_in, PyObject *args);
+PyObject* Bodies_step(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Bodies_as_seq[];
+extern PyMethodDef Bodies_methods[];
+extern struct PyMemberDef Bodies_members[];
+extern PyTypeObject BodiesObjectType;
+
+#endif
@@ -0,0 +1,547 @@
+#include "bounds.h"
+#include "cgrid.h"
+#include "vect.h"
+#include "quat.h"
+#include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* EPOS directions of Larsson: the axes, then the cube diagonals, then */
+/* the edge diagonals.  EPOS-k uses the first k / 2 of them. */
+static const double bounds_dirs[BOUNDS_EPOS_MAX][3] = {
+	{1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+	{1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1},
+	{1, 1, 0}, {1, -1, 0}, {1, 0, 1}, {1, 0, -1}, {0, 1, 1}, {0, 1, -1}
+};
+
+int bounds_read_points(PyObject* points, BoundsPoints* pPts)
+{
+	PyObject* pFast;
+	double pos[3];
+	long n, i;
+
+	memset(pPts, 0, sizeof(BoundsPoints));
+	pFast = PySequence_Fast(points, "points must be a sequence of vects");
+	if (!pFast)
+		return 0;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	if (n == 0)
+	{
+		Py_DECREF(pFast);
+		PyErr_SetString(PyExc_ValueError, "no points");
+		return 0;
+	}
+	pPts->pX = (double*)malloc(n * 3 * sizeof(double));
+	if (!pPts->pX)
+	{
+		Py_DECREF(pFast);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return 0;
+	}
+	pPts->pY = pPts->pX + n;
+	pPts->pZ = pPts->pY + n;
+	for (i = 0; i < n; i++)
+	{
+		if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFast, i), pos))
+		{
+			bounds_free_points(pPts);
+			Py_DECREF(pFast);
+			return 0;
+		}
+		pPts->pX[i] = pos[0];
+		pPts->pY[i] = pos[1];
+		pPts->pZ[i] = pos[2];
+	}
+	Py_DECREF(pFast);
+	pPts->nCount = n;
+	return 1;
+}
+
+void bounds_free_points(BoundsPoints* pPts)
+{
+	if (pPts->pX)
+		free(pPts->pX);
+	memset(pPts, 0, sizeof(BoundsPoints));
+}
+
+/* the SSE2 paths keep two lanes of running bounds and fold them at the */
+/* end.  gcc will not vectorize the scalar loops itself without */
+/* -ffinite-math-only -fno-signed-zeros; minpd and maxpd pick the same */
+/* operand as the scalar compares, NaNs and equal zeros included. */
+void bounds_minmax(const double* a, long n, double* pMin, double* pMax)
+{
+	double lo = a[0], hi = a[0];
+	long i = 1;
+#ifdef __SSE2__
+	__m128d vlo, vhi, x;
+	double l[2], h[2];
+
+	vlo = vhi = _mm_set1_pd(a[0]);
+	for (; i + 1 < n; i += 2)
+	{
+		x = _mm_loadu_pd(&a[i]);
+		vlo = _mm_min_pd(x, vlo);
+		vhi = _mm_max_pd(x, vhi);
+	}
+	_mm_storeu_pd(l, vlo);
+	_mm_storeu_pd(h, vhi);
+	lo = (l[1] < l[0]) ? l[1] : l[0];
+	hi = (h[1] > h[0]) ? h[1] : h[0];
+#endif
+
+	for (; i < n; i++)
+	{
+		lo = (a[i] < lo) ? a[i] : lo;
+		hi = (a[i] > hi) ? a[i] : hi;
+	}
+	*pMin = lo;
+	*pMax = hi;
+}
+
+/* the points furthest back and forward along dir, the first of any tie */
+void bounds_extremes(BoundsPoints* pPts, const double* dir, long* pMin, long* pMax)
+{
+	double d, lo, hi;
+	long i = 1;
+#ifdef __SSE2__
+	__m128d vd[3], vlo, vhi, ilo, ihi, idx, m, x;
+	double l[2], h[2], il[2], ih[2];
+	int k;
+#endif
+
+	lo = hi = (pPts->pX[0] * dir[0]) + (pPts->pY[0] * dir[1]) + (pPts->pZ[0] * dir[2]);
+	*pMin = *pMax = 0;
+#ifdef __SSE2__
+	for (k = 0; k < 3; k++)
+		vd[k] = _mm_set1_pd(dir[k]);
+	vlo = vhi = _mm_set1_pd(lo);
+	ilo = ihi = _mm_setzero_pd();
+	idx = _mm_set_pd(2.0, 1.0);
+	for (; i + 1 < pPts->nCount; i += 2)
+	{
+		x = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&pPts->pX[i]), vd[0]), _mm_mul_pd(_mm_loadu_pd(&pPts->pY[i]), vd[1]));
+		x = _mm_add_pd(x, _mm_mul_pd(_mm_loadu_pd(&pPts->pZ[i]), vd[2]));
+		m = _mm_cmplt_pd(x, vlo);
+		vlo = _mm_min_pd(x, vlo);
+		ilo = _mm_or_pd(_mm_and_pd(m, idx), _mm_andnot_pd(m, ilo));
+		m = _mm_cmpgt_pd(x, vhi);
+		vhi = _mm_max_pd(x, vhi);
+		ihi = _mm_or_pd(_mm_and_pd(m, idx), _mm_andnot_pd(m, ihi));
+		idx = _mm_add_pd(idx, _mm_set1_pd(2.0));
+	}
+	_mm_storeu_pd(l, vlo); _mm_storeu_pd(il, ilo);
+	_mm_storeu_pd(h, vhi); _mm_storeu_pd(ih, ihi);
+	k = (l[1] < l[0] || (l[1] == l[0] && il[1] < il[0])) ? 1 : 0;
+	lo = l[k];
+	*pMin = (long)il[k];
+	k = (h[1] > h[0] || (h[1] == h[0] && ih[1] < ih[0])) ? 1 : 0;
+	hi = h[k];
+	*pMax = (long)ih[k];
+#endif
+
+	for (; i < pPts->nCount; i++)
+	{
+		d = (pPts->pX[i] * dir[0]) + (pPts->pY[i] * dir[1]) + (pPts->pZ[i] * dir[2]);
+		if (d < lo)
+		{
+			lo = d;
+			*pMin = i;
+		}
+		if (d > hi)
+		{
+			hi = d;
+			*pMax = i;
+		}
+	}
+}
+
+/* Ritter's second pass: moves and widens the sphere just enough to take */
+/* in each point left outside */
+void bounds_grow_sphere(BoundsPoints* pPts, double* c, double* pRadius)
+{
+	double r = *pRadius, dx, dy, dz, d2, d, nr, s;
+	long i;
+
+	for (i = 0; i < pPts->nCount; i++)
+	{
+		dx = pPts->pX[i] - c[0];
+		dy = pPts->pY[i] - c[1];
+		dz = pPts->pZ[i] - c[2];
+		d2 = (dx * dx) + (dy * dy) + (dz * dz);
+		if (d2 <= r * r)
+			continue;
+		d = sqrt(d2);
+		nr = (r + d) * 0.5;
+		s = (nr - r) / d;
+		c[0] += dx * s;
+		c[1] += dy * s;
+		c[2] += dz * s;
+		r = nr;
+	}
+	*pRadius = r;
+}
+
+/* Ritter: a sphere on the most distant pair of axis extremes, then grown */
+void bounds_ritter(BoundsPoints* pPts, double* c, double* pRadius)
+{
+	long lo, hi, a = 0, b = 0;
+	double d2, dBest = -1.0;
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		bounds_extremes(pPts, bounds_dirs[k], &lo, &hi);
+		d2 = SQR(pPts->pX[hi] - pPts->pX[lo]) + SQR(pPts->pY[hi] - pPts->pY[lo]) + SQR(pPts->pZ[hi] - pPts->pZ[lo]);
+		if (d2 > dBest)
+		{
+			dBest = d2;
+			a = lo;
+			b = hi;
+		}
+	}
+	c[0] = (pPts->pX[a] + pPts->pX[b]) * 0.5;
+	c[1] = (pPts->pY[a] + pPts->pY[b]) * 0.5;
+	c[2] = (pPts->pZ[a] + pPts->pZ[b]) * 0.5;
+	*pRadius = sqrt(dBest) * 0.5;
+	bounds_grow_sphere(pPts, c, pRadius);
+}
+
+/* the smallest sphere with up to four points on its surface; a radius */
+/* of -1 for none.  Degenerate sets fall back to their widest pair. */
+void bounds_sphere_of(double (*p)[3], int n, double* c, double* pRadius)
+{
+	double a[3], b[3], e[3], axb[3], m[9], rhs[3], det, d2, dBest;
+	int i, j, k;
+
+	if (n == 0)
+	{
+		c[0] = c[1] = c[2] = 0.0;
+		*pRadius = -1.0;
+		return;
+	}
+	if (n == 1)
+	{
+		memcpy(c, p[0], 3 * sizeof(double));
+		*pRadius = 0.0;
+		return;
+	}
+	if (n == 3)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			a[k] = p[1][k] - p[0][k];
+			b[k] = p[2][k] - p[0][k];
+		}
+		axb[0] = (a[1] * b[2]) - (a[2] * b[1]);
+		axb[1] = (a[2] * b[0]) - (a[0] * b[2]);
+		axb[2] = (a[0] * b[1]) - (a[1] * b[0]);
+		det = 2.0 * (SQR(axb[0]) + SQR(axb[1]) + SQR(axb[2]));
+		if (det > 1e-300)
+		{
+			/* p0 + (|a|^2 b - |b|^2 a) x (a x b) / (2 |a x b|^2) */
+			d2 = SQR(a[0]) + SQR(a[1]) + SQR(a[2]);
+			dBest = SQR(b[0]) + SQR(b[1]) + SQR(b[2]);
+			for (k = 0; k < 3; k++)
+				e[k] = (d2 * b[k]) - (dBest * a[k]);
+			c[0] = p[0][0] + (((e[1] * axb[2]) - (e[2] * axb[1])) / det);
+			c[1] = p[0][1] + (((e[2] * axb[0]) - (e[0] * axb[2])) / det);
+			c[2] = p[0][2] + (((e[0] * axb[1]) - (e[1] * axb[0])) / det);
+			*pRadius = sqrt(SQR(c[0] - p[0][0]) + SQR(c[1] - p[0][1]) + SQR(c[2] - p[0][2]));
+			return;
+		}
+	}
+	if (n == 4)
+	{
+		/* 2 (pi - p0) . x = |pi - p0|^2 for the offset x of the center */
+		for (i = 0; i < 3; i++)
+		{
+			rhs[i] = 0.0;
+			for (k = 0; k < 3; k++)
+			{
+				m[(i * 3) + k] = 2.0 * (p[i + 1][k] - p[0][k]);
+				rhs[i] += SQR(p[i + 1][k] - p[0][k]);
+			}
+		}
+		det = (m[0] * ((m[4] * m[8]) - (m[5] * m[7]))) - (m[1] * ((m[3] * m[8]) - (m[5] * m[6]))) + (m[2] * ((m[3] * m[7]) - (m[4] * m[6])));
+		if (fabs(det) > 1e-300)
+		{
+			e[0] = ((rhs[0] * ((m[4] * m[8]) - (m[5] * m[7]))) - (m[1] * ((rhs[1] * m[8]) - (m[5] * rhs[2]))) + (m[2] * ((rhs[1] * m[7]) - (m[4] * rhs[2])))) / det;
+			e[1] = ((m[0] * ((rhs[1] * m[8]) - (m[5] * rhs[2]))) - (rhs[0] * ((m[3] * m[8]) - (m[5] * m[6]))) + (m[2] * ((m[3] * rhs[2]) - (rhs[1] * m[6])))) / det;
+			e[2] = ((m[0] * ((m[4] * rhs[2]) - (rhs[1] * m[7]))) - (m[1] * ((m[3] * rhs[2]) - (rhs[1] * m[6]))) + (rhs[0] * ((m[3] * m[7]) - (m[4] * m[6])))) / det;
+			for (k = 0; k < 3; k++)
+				c[k] = p[0][k] + e[k];
+			*pRadius = sqrt(SQR(e[0]) + SQR(e[1]) + SQR(e[2]));
+			return;
+		}
+	}
+
+	dBest = -1.0;
+	for (i = 0; i < n; i++)
+	{
+		for (j = i + 1; j < n; j++)
+		{
+			d2 = SQR(p[i][0] - p[j][0]) + SQR(p[i][1] - p[j][1]) + SQR(p[i][2] - p[j][2]);
+			if (d2 > dBest)
+			{
+				dBest = d2;
+				for (k = 0; k < 3; k++)
+					c[k] = (p[i][k] + p[j][k]) * 0.5;
+			}
+		}
+	}
+	*pRadius = sqrt(dBest) * 0.5;
+}
+
+/* Welzl's minimum sphere of the n points p with the nr points r on its */
+/* surface; only ever run over the few EPOS extremes */
+void bounds_welzl(double (*p)[3], int n, double (*r)[3], int nr, double* c, double* pRadius)
+{
+	double d2;
+
+	if (n == 0 || nr == 4)
+	{
+		bounds_sphere_of(r, nr, c, pRadius);
+		return;
+	}
+	bounds_welzl(p, n - 1, r, nr, c, pRadius);
+	d2 = SQR(p[n - 1][0] - c[0]) + SQR(p[n - 1][1] - c[1]) + SQR(p[n - 1][2] - c[2]);
+	if (*pRadius >= 0.0 && d2 <= SQR(*pRadius) * (1.0 + 1e-12))
+		return;
+	memcpy(r[nr], p[n - 1], 3 * sizeof(double));
+	bounds_welzl(p, n - 1, r, nr + 1, c, pRadius);
+}
+
+/* EPOS: the exact sphere of the extreme points along nDirs directions, */
+/* then grown over the rest as in Ritter */
+void bounds_epos(BoundsPoints* pPts, int nDirs, double* c, double* pRadius)
+{
+	double ext[2 * BOUNDS_EPOS_MAX][3], r[4][3];
+	long lo, hi;
+	int k, n = 0;
+
+	for (k = 0; k < nDirs; k++)
+	{
+		bounds_extremes(pPts, bounds_dirs[k], &lo, &hi);
+		ext[n][0] = pPts->pX[lo]; ext[n][1] = pPts->pY[lo]; ext[n][2] = pPts->pZ[lo];
+		n++;
+		ext[n][0] = pPts->pX[hi]; ext[n][1] = pPts->pY[hi]; ext[n][2] = pPts->pZ[hi];
+		n++;
+	}
+	bounds_welzl(ext, n, r, 0, c, pRadius);
+	bounds_grow_sphere(pPts, c, pRadius);
+}
+
+/* cyclic Jacobi rotations diagonalizing the symmetric 3x3 a in place; */
+/* v gets the eigenvectors as its columns */
+void bounds_jacobi(double* a, double* v)
+{
+	double theta, t, cs, sn, tau, apq, app, aqq, arp, arq, vrp, vrq, off;
+	int sweep, p, q, r;
+
+	memset(v, 0, 9 * sizeof(double));
+	v[0] = v[4] = v[8] = 1.0;
+	for (sweep = 0; sweep < 50; sweep++)
+	{
+		off = SQR(a[1]) + SQR(a[2]) + SQR(a[5]);
+		if (off < 1e-30 * (SQR(a[0]) + SQR(a[4]) + SQR(a[8]) + 1e-300))
+			break;
+		for (p = 0; p < 2; p++)
+		{
+			for (q = p + 1; q < 3; q++)
+			{
+				apq = a[(p * 3) + q];
+				if (apq == 0.0)
+					continue;
+				app = a[(p * 3) + p];
+				aqq = a[(q * 3) + q];
+				theta = (aqq - app) / (2.0 * apq);
+				t = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt((theta * theta) + 1.0));
+				cs = 1.0 / sqrt((t * t) + 1.0);
+				sn = t * cs;
+				tau = sn / (1.0 + cs);
+				a[(p * 3) + p] = app - (t * apq);
+				a[(q * 3) + q] = aqq + (t * apq);
+				a[(p * 3) + q] = a[(q * 3) + p] = 0.0;
+				for (r = 0; r < 3; r++)
+				{
+					if (r != p && r != q)
+					{
+						arp = a[(r * 3) + p];
+						arq = a[(r * 3) + q];
+						a[(r * 3) + p] = a[(p * 3) + r] = arp - (sn * (arq + (tau * arp)));
+						a[(r * 3) + q] = a[(q * 3) + r] = arq + (sn * (arp - (tau * arq)));
+					}
+					vrp = v[(r * 3) + p];
+					vrq = v[(r * 3) + q];
+					v[(r * 3) + p] = vrp - (sn * (vrq + (tau * vrp)));
+					v[(r * 3) + q] = vrq + (sn * (vrp - (tau * vrq)));
+				}
+			}
+		}
+	}
+}
+
+/* a box on the principal axes of the point covariance: rot is row-major */
+/* with the box axes as its columns, ext the half extents */
+void bounds_pca(BoundsPoints* pPts, double* c, double* rot, double* ext)
+{
+	double mean[3] = {0.0, 0.0, 0.0}, cov[9], s[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+	double dx, dy, dz, lo, hi, dLo, dHi, mid[3], inv, proj[BOUNDS_CHUNK];
+	long n = pPts->nCount, nChunk, i, j;
+	int k;
+
+	for (i = 0; i < n; i++)
+	{
+		mean[0] += pPts->pX[i];
+		mean[1] += pPts->pY[i];
+		mean[2] += pPts->pZ[i];
+	}
+	inv = 1.0 / n;
+	for (k = 0; k < 3; k++)
+		mean[k] *= inv;
+	for (i = 0; i < n; i++)
+	{
+		dx = pPts->pX[i] - mean[0];
+		dy = pPts->pY[i] - mean[1];
+		dz = pPts->pZ[i] - mean[2];
+		s[0] += dx * dx;
+		s[1] += dx * dy;
+		s[2] += dx * dz;
+		s[3] += dy * dy;
+		s[4] += dy * dz;
+		s[5] += dz * dz;
+	}
+	cov[0] = s[0] * inv; cov[1] = s[1] * inv; cov[2] = s[2] * inv;
+	cov[3] = cov[1]; cov[4] = s[3] * inv; cov[5] = s[4] * inv;
+	cov[6] = cov[2]; cov[7] = cov[5]; cov[8] = s[5] * inv;
+	bounds_jacobi(cov, rot);
+
+	/* keep the axes right handed so they make a proper rotation */
+	if ((rot[0] * ((rot[4] * rot[8]) - (rot[5] * rot[7]))) - (rot[1] * ((rot[3] * rot[8]) - (rot[5] * rot[6]))) + (rot[2] * ((rot[3] * rot[7]) - (rot[4] * rot[6]))) < 0.0)
+	{
+		rot[2] = -rot[2];
+		rot[5] = -rot[5];
+		rot[8] = -rot[8];
+	}
+
+	/* project on each axis a chunk at a time through a scratch row */
+	for (k = 0; k < 3; k++)
+	{
+		lo = hi = (pPts->pX[0] * rot[k]) + (pPts->pY[0] * rot[3 + k]) + (pPts->pZ[0] * rot[6 + k]);
+		for (i = 0; i < n; i += nChunk)
+		{
+			nChunk = (n - i < BOUNDS_CHUNK) ? n - i : BOUNDS_CHUNK;
+			for (j = 0; j < nChunk; j++)
+				proj[j] = (pPts->pX[i + j] * rot[k]) + (pPts->pY[i + j] * rot[3 + k]) + (pPts->pZ[i + j] * rot[6 + k]);
+			bounds_minmax(proj, nChunk, &dLo, &dHi);
+			lo = (dLo < lo) ? dLo : lo;
+			hi = (dHi > hi) ? dHi : hi;
+		}
+		mid[k] = (lo + hi) * 0.5;
+		ext[k] = (hi - lo) * 0.5;
+	}
+	for (k = 0; k < 3; k++)
+		c[k] = (rot[k * 3] * mid[0]) + (rot[(k * 3) + 1] * mid[1]) + (rot[(k * 3) + 2] * mid[2]);
+}
+
+static PyObject* bounds_vect(double* v)
+{
+	VectObject* rv;
+
+	rv = PyObject_New(VectObject, &VectObjectType);
+	if (rv)
+		memcpy(rv->elements, v, 3 * sizeof(double));
+	return (PyObject*)rv;
+}
+
+
+/* (min, max) corners of the points */
+PyObject* Bounds_aabb(PyObject *self_in, PyObject *args)
+{
+	PyObject* points;
+	BoundsPoints pts;
+	double lo[3], hi[3];
+
+    if (!PyArg_ParseTuple(args, "O", &points))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bounds_read_points(points, &pts))
+		return NULL;
+	bounds_minmax(pts.pX, pts.nCount, &lo[0], &hi[0]);
+	bounds_minmax(pts.pY, pts.nCount, &lo[1], &hi[1]);
+	bounds_minmax(pts.pZ, pts.nCount, &lo[2], &hi[2]);
+	bounds_free_points(&pts);
+	return Py_BuildValue("(NN)", bounds_vect(lo), bounds_vect(hi));
+}
+
+/* (center, radius) of a Ritter sphere of the points */
+PyObject* Bounds_ritter(PyObject *self_in, PyObject *args)
+{
+	PyObject* points;
+	BoundsPoints pts;
+	double c[3], r;
+
+    if (!PyArg_ParseTuple(args, "O", &points))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bounds_read_points(points, &pts))
+		return NULL;
+	bounds_ritter(&pts, c, &r);
+	bounds_free_points(&pts);
+	return Py_BuildValue("(Nd)", bounds_vect(c), r);
+}
+
+/* (center, radius) of an EPOS-k sphere of the points, k 6, 14 or 26 */
+PyObject* Bounds_epos(PyObject *self_in, PyObject *args)
+{
+	PyObject* points;
+	BoundsPoints pts;
+	double c[3], r;
+	int k = 14;
+
+    if (!PyArg_ParseTuple(args, "O|i", &points, &k))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (k != 6 && k != 14 && k != 26)
+	{
+		PyErr_SetString(PyExc_ValueError, "k must be 6, 14 or 26");
+		return NULL;
+	}
+	if (!bounds_read_points(points, &pts))
+		return NULL;
+	bounds_epos(&pts, k / 2, c, &r);
+	bounds_free_points(&pts);
+	return Py_BuildValue("(Nd)", bounds_vect(c), r);
+}
+
+/* (center, rot, half_extents) of a box on the principal axes */
+PyObject* Bounds_pca_obb(PyObject *self_in, PyObject *args)
+{
+	PyObject* points;
+	QuatObject* q;
+	BoundsPoints pts;
+	double c[3], rot[9], ext[3];
+
+    if (!PyArg_ParseTuple(args, "O", &points))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bounds_read_points(points, &pts))
+		return NULL;
+	bounds_pca(&pts, c, rot, ext);
+	bounds_free_points(&pts);
+
+	q = PyObject_New(QuatObject, &QuatObjectType);
+	if (q)
+		quat_from_matrix3_internal(rot, q->elements);
+	return Py_BuildValue("(NNN)", bounds_vect(c), q, bounds_vect(ext));
+}
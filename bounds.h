@@ -0,0 +1,38 @@
+#ifndef BOUNDS_H_INCLUDED
+#define BOUNDS_H_INCLUDED
+
+#include <Python.h>
+
+/* points split into one array per axis, so every pass over them runs */
+/* down contiguous doubles; the min / max passes use SSE2 where it is */
+/* available, as gcc only vectorizes them with finite math. */
+typedef struct BoundsPoints {
+	double*			pX;
+	double*			pY;
+	double*			pZ;
+	long			nCount;
+} BoundsPoints;
+
+#define BOUNDS_EPOS_MAX 13		/* directions of EPOS-26 */
+#define BOUNDS_CHUNK 256		/* points projected at a time by pca */
+
+/* internal functions */
+int bounds_read_points(PyObject* points, BoundsPoints* pPts);
+void bounds_free_points(BoundsPoints* pPts);
+void bounds_minmax(const double* a, long n, double* pMin, double* pMax);
+void bounds_extremes(BoundsPoints* pPts, const double* dir, long* pMin, long* pMax);
+void bounds_grow_sphere(BoundsPoints* pPts, double* c, double* pRadius);
+void bounds_ritter(BoundsPoints* pPts, double* c, double* pRadius);
+void bounds_sphere_of(double (*p)[3], int n, double* c, double* pRadius);
+void bounds_welzl(double (*p)[3], int n, double (*r)[3], int nr, double* c, double* pRadius);
+void bounds_epos(BoundsPoints* pPts, int nDirs, double* c, double* pRadius);
+void bounds_jacobi(double* a, double* v);
+void bounds_pca(BoundsPoints* pPts, double* c, double* rot, double* ext);
+
+/* exported API functions */
+PyObject* Bounds_aabb(PyObject *self_in, PyObject *args);
+PyObject* Bounds_ritter(PyObject *self_in, PyObject *args);
+PyObject* Bounds_epos(PyObject *self_in, PyObject *args);
+PyObject* Bounds_pca_obb(PyObject *self_in, PyObject *args);
+
+#endif
@@ -1,7 +1,15 @@
 #include "cgrid.h"
 #include "obarr.h"
+#include "vect.h"
 #include "red_black_tree.h"
+#include "snapshot.h"
 #include <math.h>
+#include <time.h>
+
+typedef struct CgridSortkey {
+	CgridKey k;
+	long i;
+} CgridSortkey;
 
 void cgrid_unroll(CgridObject* self)
 {
@@ -9,17 +17,18 @@ void cgrid_unroll(CgridObject* self)
 	rb_red_blk_node* nil = self->pTree->nil;
 	rb_red_blk_node* x = self->pTree->root->left;
 	rb_red_blk_node* last = nil;
-	
+
 	if (!self->bUnrollDirty)
 		return;
-		
+
 	if (self->pUnrolled)
 	{
 		Py_DECREF(self->pUnrolled);
 	}
 	self->pUnrolled = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(self->pUnrolled, NULL, NULL);
 	obarr_set_size(self->pUnrolled, self->nCells);
-	
+
 	while(nil != x) {
 		last = x;
 		x = x->right;
@@ -30,7 +39,7 @@ void cgrid_unroll(CgridObject* self)
 			printf("SizeError in Unroll!\n");
 			break;
 		}
-		obarr_set_element(self->pUnrolled, i++, (PyObject*)last->info);
+		obarr_set_element(self->pUnrolled, i++, (PyObject*)((CgridInfo*)last->info)->pContents);
 		last = TreePredecessor(self->pTree,last);
 	}
 	self->bUnrollDirty = 0;
@@ -41,7 +50,7 @@ int cgrid_compare(const void* a, const void* b)
 	const CgridKey* sa = (const CgridKey*)a;
 	const CgridKey* sb = (const CgridKey*)b;
 	int rv;
-	
+
 	rv = (sa->x > sb->x) - (sa->x < sb->x);
 	if (rv != 0)
 	{
@@ -67,14 +76,14 @@ int cgrid_compare(const void* a, const void* b)
 CgridKey* cgrid_newkey()
 {
 	CgridKey* ptr;
-	
+
 	ptr = (CgridKey*)malloc(sizeof(CgridKey));
 	return ptr;
 }
 CgridInfo* cgrid_newinfo()
 {
 	CgridInfo* ptr;
-	
+
 	ptr = (CgridInfo*)malloc(sizeof(CgridInfo));
 	return ptr;
 }
@@ -85,49 +94,702 @@ void cgrid_destroykey(void* a)
 	free(a);
 }
 
+void cgrid_del_key_attrs(PyObject* other)
+{
+	PyObject_DelAttrString(other, "_cgrid_internal_key_x");
+	PyObject_DelAttrString(other, "_cgrid_internal_key_y");
+	PyObject_DelAttrString(other, "_cgrid_internal_key_z");
+	PyErr_Clear();
+}
+
+void cgrid_set_key_attrs(PyObject* other, CgridKey* k)
+{
+	PyObject* pInt;
+
+	pInt = PyInt_FromLong(k->x);
+	PyObject_SetAttrString(other, "_cgrid_internal_key_x", pInt);
+	Py_DECREF(pInt);
+	pInt = PyInt_FromLong(k->y);
+	PyObject_SetAttrString(other, "_cgrid_internal_key_y", pInt);
+	Py_DECREF(pInt);
+	pInt = PyInt_FromLong(k->z);
+	PyObject_SetAttrString(other, "_cgrid_internal_key_z", pInt);
+	Py_DECREF(pInt);
+}
+
 void cgrid_destroyinfo(void* a)
 {
-	const CgridInfo* sa = (const CgridInfo*)a;
-	PyObject** other = sa->pContents->pData;	
-	
+	CgridInfo* sa = (CgridInfo*)a;
+	PyObject** other = sa->pContents->pData;
+
 	for (;other - sa->pContents->pData < sa->pContents->nSize; other++)
 	{
 		if (*other == Py_None)
 			continue;
-		PyObject_DelAttrString(*other, "_cgrid_internal_key_x");
-		PyObject_DelAttrString(*other, "_cgrid_internal_key_y");
-		PyObject_DelAttrString(*other, "_cgrid_internal_key_z");
+		cgrid_del_key_attrs(*other);
 	}
 
 	obarr_empty(sa->pContents);
 	Py_DECREF(sa->pContents);
+	if (sa->pEntries)
+		free(sa->pEntries);
 	free(a);
 }
 
 void cgrid_printkey(const void* a)
 {
 	const CgridKey* sa = (const CgridKey*)a;
-	
-	printf("<GridKey(%d, %d, %d)>", sa->x, sa->y, sa->z);
+
+	printf("<GridKey(%ld, %ld, %ld)>", sa->x, sa->y, sa->z);
 }
 
 void cgrid_printinfo(void* a)
 {
-	ObarrObject* arr = (ObarrObject*)a;
-	
-	printf("<Obarr size %d>", arr->nSize);
+	CgridInfo* sa = (CgridInfo*)a;
+
+	printf("<Obarr size %ld>", sa->pContents->nSize);
 }
 
 long cgrid_coord_to_gridcoord(CgridObject* self, double coord)
 {
-	return long(floor(coord / self->dCellSize));
+	return (long)floor(coord / self->dCellSize);
 }
 
-ObarrObject* cgrid_get_radius(CgridObject *self, PyObject *other, double dRadius)
+void cgrid_pos_to_key(CgridObject* self, double* pos, CgridKey* k)
+{
+	k->x = cgrid_coord_to_gridcoord(self, pos[0]);
+	k->y = cgrid_coord_to_gridcoord(self, pos[1]);
+	k->z = cgrid_coord_to_gridcoord(self, pos[2]);
+}
+
+/* reads the position of a vect, or of an object with a 'pos' attribute */
+int cgrid_read_pos(PyObject* other, double* pos)
+{
+	PyObject* pAttr;
+	VectObject* v;
+
+	if (Vect_Check(other))
+	{
+		v = (VectObject*)other;
+		pos[0] = v->elements[0]; pos[1] = v->elements[1]; pos[2] = v->elements[2];
+		return 1;
+	}
+
+	pAttr = PyObject_GetAttrString(other, "pos");
+	if (!pAttr)
+	{
+		PyErr_SetString(PyExc_TypeError, "missing 'pos' attribute of object");
+		return 0;
+	}
+	if (Vect_Check(pAttr))
+	{
+		v = (VectObject*)pAttr;
+		pos[0] = v->elements[0]; pos[1] = v->elements[1]; pos[2] = v->elements[2];
+	}
+	else if (!PyArg_Parse(pAttr, "(ddd)", &pos[0], &pos[1], &pos[2]))
+	{
+		Py_DECREF(pAttr);
+		PyErr_SetString(PyExc_TypeError, "invalid 'pos' attribute of object");
+		return 0;
+	}
+	Py_DECREF(pAttr);
+	return 1;
+}
+
+/* reads an optional layer bit attribute, keeping *pnBits if it is missing */
+int cgrid_read_layer(PyObject* other, const char* name, unsigned int* pnBits)
+{
+	PyObject* pAttr;
+
+	pAttr = PyObject_GetAttrString(other, name);
+	if (!pAttr)
+	{
+		PyErr_Clear();
+		return 1;
+	}
+	if (PyInt_Check(pAttr))
+		*pnBits = (unsigned int)PyInt_AsUnsignedLongMask(pAttr);
+	else if (PyLong_Check(pAttr))
+		*pnBits = (unsigned int)PyLong_AsUnsignedLongMask(pAttr);
+	else
+	{
+		Py_DECREF(pAttr);
+		PyErr_Format(PyExc_TypeError, "invalid '%s' attribute of object", name);
+		return 0;
+	}
+	Py_DECREF(pAttr);
+	return 1;
+}
+
+/* reads the bounding sphere and layer of an object; a missing 'radius' */
+/* means a point */
+int cgrid_read_entry(PyObject* other, CgridEntry* pEntry)
+{
+	PyObject* pAttr;
+
+	if (!cgrid_read_pos(other, pEntry->pos))
+		return 0;
+
+	pEntry->dRadius = 0.0;
+	pEntry->nNbr = -1;
+	pEntry->nCategory = CGRID_ALL_LAYERS;
+	pEntry->nMask = CGRID_ALL_LAYERS;
+	if (Vect_Check(other))
+		return 1;
+	if (!cgrid_read_layer(other, "category", &pEntry->nCategory) || !cgrid_read_layer(other, "mask", &pEntry->nMask))
+		return 0;
+	pAttr = PyObject_GetAttrString(other, "radius");
+	if (!pAttr)
+	{
+		PyErr_Clear();
+		return 1;
+	}
+	if (!PyFloat_Check(pAttr) && !PyInt_Check(pAttr))
+	{
+		Py_DECREF(pAttr);
+		PyErr_SetString(PyExc_TypeError, "invalid 'radius' attribute of object");
+		return 0;
+	}
+	pEntry->dRadius = PyFloat_AsDouble(pAttr);
+	Py_DECREF(pAttr);
+	return 1;
+}
+
+int cgrid_info_append(CgridInfo* pV, PyObject* other, CgridEntry* pEntry)
+{
+	long n = pV->pContents->nSize;
+	void* tmp;
+
+	if (n + 1 > pV->nEntryAlloc)
+	{
+		tmp = realloc(pV->pEntries, (pV->nEntryAlloc + 8) * sizeof(CgridEntry));
+		if (tmp == NULL)
+			return 0;
+		pV->pEntries = (CgridEntry*)tmp;
+		pV->nEntryAlloc += 8;
+	}
+	if (!obarr_append(pV->pContents, other))
+		return 0;
+	pV->pEntries[n] = *pEntry;
+	if (pEntry->dRadius > pV->pSelf->dMaxRadius)
+		pV->pSelf->dMaxRadius = pEntry->dRadius;
+	return 1;
+}
+
+/* mirrors obarr_del_index, which moves the last element into the hole */
+void cgrid_info_del_index(CgridInfo* pV, long i)
+{
+	long last = pV->pContents->nSize - 1;
+
+	obarr_del_index(pV->pContents, i);
+	if (i < last)
+		pV->pEntries[i] = pV->pEntries[last];
+}
+
+CgridInfo* cgrid_get_cell(CgridObject* self, CgridKey* k)
+{
+	rb_red_blk_node* pNode;
+
+	pNode = RBExactQuery(self->pTree, k);
+	if (!pNode)
+		return NULL;
+	return (CgridInfo*)pNode->info;
+}
+
+/* locates a member of the dynamic layer through its internal key attributes */
+CgridInfo* cgrid_find_member(CgridObject* self, PyObject* other, rb_red_blk_node** ppNode, long* pIndex)
+{
+	PyObject *pX, *pY, *pZ;
+	rb_red_blk_node* pNode;
+	CgridInfo* pV;
+	CgridKey k;
+	long i;
+
+	pX = PyObject_GetAttrString(other, "_cgrid_internal_key_x");
+	pY = PyObject_GetAttrString(other, "_cgrid_internal_key_y");
+	pZ = PyObject_GetAttrString(other, "_cgrid_internal_key_z");
+	if (!pX || !pY || !pZ)
+	{
+		Py_XDECREF(pX);
+		Py_XDECREF(pY);
+		Py_XDECREF(pZ);
+		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (missing _cgrid_internal_key attributes)");
+		return NULL;
+	}
+	k.x = PyInt_AsLong(pX);
+	k.y = PyInt_AsLong(pY);
+	k.z = PyInt_AsLong(pZ);
+	Py_DECREF(pX);
+	Py_DECREF(pY);
+	Py_DECREF(pZ);
+
+	pNode = RBExactQuery(self->pTree, &k);
+	if (!pNode)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (no such cell)");
+		return NULL;
+	}
+	pV = (CgridInfo*)pNode->info;
+	i = obarr_find(pV->pContents, other);
+	if (i == -1)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (not in cell)");
+		return NULL;
+	}
+	if (ppNode)
+		*ppNode = pNode;
+	*pIndex = i;
+	return pV;
+}
+
+/* binary search of the sorted static cell keys, returns -1 if the cell is empty */
+long cgrid_static_find_cell(CgridStatic* pStatic, CgridKey* k)
+{
+	long lo = 0;
+	long hi = pStatic->nCells - 1;
+	long mid;
+	int c;
+
+	while (lo <= hi)
+	{
+		mid = (lo + hi) / 2;
+		c = cgrid_compare(&pStatic->pKeys[mid], k);
+		if (c == 0)
+			return mid;
+		if (c > 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return -1;
+}
+
+void cgrid_static_free(CgridStatic* pStatic)
+{
+	long i;
+
+	if (!pStatic)
+		return;
+	if (pStatic->pObjects)
+	{
+		for (i = 0; i < pStatic->nMembers; i++)
+			Py_XDECREF(pStatic->pObjects[i]);
+		free(pStatic->pObjects);
+	}
+	free(pStatic->pEntries);
+	if (pStatic->pMap)
+		snapshot_unmap(pStatic->pMap, pStatic->nMapSize);
+	else
+	{
+		free(pStatic->pKeys);
+		free(pStatic->pStart);
+		free(pStatic->pOrder);
+	}
+	free(pStatic);
+}
+
+CgridStatic* cgrid_static_build(CgridObject* self, PyObject* seq)
+{
+	CgridStatic* pStatic = NULL;
+	CgridSortkey* pSort = NULL;
+	CgridEntry* pTmp = NULL;
+	PyObject* pFast;
+	PyObject* other;
+	long n, i, c;
+
+	pFast = PySequence_Fast(seq, "freeze() requires a sequence of objects");
+	if (!pFast)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+
+	pStatic = (CgridStatic*)calloc(1, sizeof(CgridStatic));
+	pSort = (CgridSortkey*)malloc((n + 1) * sizeof(CgridSortkey));
+	pTmp = (CgridEntry*)malloc((n + 1) * sizeof(CgridEntry));
+	if (!pStatic || !pSort || !pTmp)
+		goto nomem;
+	pStatic->pEntries = (CgridEntry*)malloc((n + 1) * sizeof(CgridEntry));
+	pStatic->pObjects = (PyObject**)calloc(n + 1, sizeof(PyObject*));
+	pStatic->pKeys = (CgridKey*)malloc((n + 1) * sizeof(CgridKey));
+	pStatic->pStart = (long*)malloc((n + 2) * sizeof(long));
+	pStatic->pOrder = (long*)malloc((n + 1) * sizeof(long));
+	if (!pStatic->pEntries || !pStatic->pObjects || !pStatic->pKeys || !pStatic->pStart || !pStatic->pOrder)
+		goto nomem;
+
+	for (i = 0; i < n; i++)
+	{
+		if (!cgrid_read_entry(PySequence_Fast_GET_ITEM(pFast, i), &pTmp[i]))
+			goto fail;
+		cgrid_pos_to_key(self, pTmp[i].pos, &pSort[i].k);
+		pSort[i].i = i;
+	}
+	qsort(pSort, n, sizeof(CgridSortkey), cgrid_compare);
+
+	/* lay the members out cell by cell, in key order */
+	c = -1;
+	for (i = 0; i < n; i++)
+	{
+		if (c < 0 || cgrid_compare(&pStatic->pKeys[c], &pSort[i].k) != 0)
+		{
+			c++;
+			COPY_KEY(&pSort[i].k, &pStatic->pKeys[c]);
+			pStatic->pStart[c] = i;
+		}
+		other = PySequence_Fast_GET_ITEM(pFast, pSort[i].i);
+		Py_INCREF(other);
+		pStatic->pObjects[i] = other;
+		pStatic->pOrder[i] = pSort[i].i;
+		pStatic->pEntries[i] = pTmp[pSort[i].i];
+		if (pStatic->pEntries[i].dRadius > pStatic->dMaxRadius)
+			pStatic->dMaxRadius = pStatic->pEntries[i].dRadius;
+	}
+	pStatic->nCells = c + 1;
+	pStatic->pStart[pStatic->nCells] = n;
+	pStatic->nMembers = n;
+
+	free(pSort);
+	free(pTmp);
+	Py_DECREF(pFast);
+	return pStatic;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+fail:
+	if (pStatic)
+	{
+		free(pStatic->pEntries);
+		free(pStatic->pObjects);
+		free(pStatic->pKeys);
+		free(pStatic->pStart);
+		free(pStatic->pOrder);
+		free(pStatic);
+	}
+	free(pSort);
+	free(pTmp);
+	Py_DECREF(pFast);
+	return NULL;
+}
+
+/* writes the static layer and a sequence of vector arrays (each a sequence */
+/* of vects or objects with a position) to a snapshot file */
+int cgrid_static_save(CgridObject* self, const char* path, PyObject* arrays)
+{
+	CgridStatic* pStatic = self->pStatic;
+	SnapshotHeader h;
+	SnapshotEntry* pRecords = NULL;
+	PyObject* pFast = NULL;
+	PyObject* pItems = NULL;
+	long* pDir = NULL;
+	double pos[3];
+	FILE* f = NULL;
+	long nPos, nOff, i, j;
+	int rv = 0;
+
+	if (arrays && arrays != Py_None)
+	{
+		pFast = PySequence_Fast(arrays, "save() requires a sequence of vector arrays");
+		if (!pFast)
+			return 0;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	h.nFormat = SNAPSHOT_FORMAT;
+	h.nByteOrder = SNAPSHOT_BYTE_ORDER;
+	h.nLongSize = sizeof(long);
+	h.nEntrySize = sizeof(SnapshotEntry);
+	h.dCellSize = self->dCellSize;
+	h.nCells = pStatic ? pStatic->nCells : 0;
+	h.nMembers = pStatic ? pStatic->nMembers : 0;
+	h.dMaxRadius = pStatic ? pStatic->dMaxRadius : 0.0;
+	h.nArrays = pFast ? PySequence_Fast_GET_SIZE(pFast) : 0;
+
+	nOff = SNAPSHOT_ALIGN((long)sizeof(h));
+	h.offKeys = nOff;
+	nOff = SNAPSHOT_ALIGN(nOff + h.nCells * (long)sizeof(CgridKey));
+	h.offStart = nOff;
+	nOff = SNAPSHOT_ALIGN(nOff + (h.nCells + 1) * (long)sizeof(long));
+	h.offEntries = nOff;
+	nOff = SNAPSHOT_ALIGN(nOff + h.nMembers * (long)sizeof(SnapshotEntry));
+	h.offOrder = nOff;
+	nOff = SNAPSHOT_ALIGN(nOff + h.nMembers * (long)sizeof(long));
+	h.offArrays = nOff;
+	nOff = SNAPSHOT_ALIGN(nOff + h.nArrays * 2 * (long)sizeof(long));
+
+	pDir = (long*)malloc((h.nArrays + 1) * 2 * sizeof(long));
+	pRecords = (SnapshotEntry*)calloc(h.nMembers + 1, sizeof(SnapshotEntry));
+	if (!pDir || !pRecords)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto done;
+	}
+	for (i = 0; i < h.nArrays; i++)
+	{
+		j = PySequence_Size(PySequence_Fast_GET_ITEM(pFast, i));
+		if (j < 0)
+			goto done;
+		pDir[i * 2] = j;
+		pDir[(i * 2) + 1] = nOff;
+		nOff = SNAPSHOT_ALIGN(nOff + j * 3 * (long)sizeof(double));
+	}
+	h.nFileSize = nOff;
+	for (i = 0; i < h.nMembers; i++)
+	{
+		memcpy(pRecords[i].pos, pStatic->pEntries[i].pos, 3 * sizeof(double));
+		pRecords[i].dRadius = pStatic->pEntries[i].dRadius;
+		pRecords[i].nCategory = pStatic->pEntries[i].nCategory;
+		pRecords[i].nMask = pStatic->pEntries[i].nMask;
+	}
+
+	f = fopen(path, "wb");
+	if (!f)
+	{
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+		goto done;
+	}
+	nPos = 0;
+	if (!snapshot_write_at(f, &nPos, 0, &h, sizeof(h)))
+		goto ioerror;
+	if (pStatic)
+	{
+		if (!snapshot_write_at(f, &nPos, h.offKeys, pStatic->pKeys, h.nCells * sizeof(CgridKey)) ||
+			!snapshot_write_at(f, &nPos, h.offStart, pStatic->pStart, (h.nCells + 1) * sizeof(long)) ||
+			!snapshot_write_at(f, &nPos, h.offEntries, pRecords, h.nMembers * sizeof(SnapshotEntry)) ||
+			!snapshot_write_at(f, &nPos, h.offOrder, pStatic->pOrder, h.nMembers * sizeof(long)))
+			goto ioerror;
+	}
+	else
+	{
+		i = 0;
+		if (!snapshot_write_at(f, &nPos, h.offStart, &i, sizeof(long)))
+			goto ioerror;
+	}
+	if (!snapshot_write_at(f, &nPos, h.offArrays, pDir, h.nArrays * 2 * sizeof(long)))
+		goto ioerror;
+	for (i = 0; i < h.nArrays; i++)
+	{
+		pItems = PySequence_Fast(PySequence_Fast_GET_ITEM(pFast, i), "save() requires a sequence of vector arrays");
+		if (!pItems)
+			goto done;
+		if (PySequence_Fast_GET_SIZE(pItems) != pDir[i * 2])
+		{
+			PyErr_SetString(PyExc_ValueError, "vector array changed size while saving");
+			goto done;
+		}
+		for (j = 0; j < pDir[i * 2]; j++)
+		{
+			if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pItems, j), pos))
+				goto done;
+			if (!snapshot_write_at(f, &nPos, j ? nPos : pDir[(i * 2) + 1], pos, sizeof(pos)))
+				goto ioerror;
+		}
+		Py_CLEAR(pItems);
+	}
+	if (!snapshot_write_at(f, &nPos, h.nFileSize, NULL, 0))
+		goto ioerror;
+	if (fclose(f) != 0)
+	{
+		f = NULL;
+		goto ioerror;
+	}
+	f = NULL;
+	rv = 1;
+	goto done;
+
+ioerror:
+	PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+done:
+	if (f)
+		fclose(f);
+	Py_XDECREF(pItems);
+	Py_XDECREF(pFast);
+	if (pDir)
+		free(pDir);
+	free(pRecords);
+	return rv;
+}
+
+/* maps a snapshot as a new static layer without copying it.  Members are */
+/* objects[pOrder[i]] if objects is given, otherwise their index in the */
+/* frozen sequence as an int.  The vector arrays are returned as a list of */
+/* obarrs of vects in *ppArrays. */
+CgridStatic* cgrid_static_load(CgridObject* self, const char* path, PyObject* objects, PyObject** ppArrays)
+{
+	CgridStatic* pStatic = NULL;
+	SnapshotHeader* h;
+	SnapshotEntry* pRecords;
+	PyObject* pFast = NULL;
+	PyObject* pList = NULL;
+	ObarrObject* pArr;
+	VectObject* pVect;
+	char* pMap;
+	double* pData;
+	long* pDir;
+	long* pStart;
+	long nSize, i, j;
+	long n = 0;
+	int bValid;
+
+	pMap = (char*)snapshot_map(path, &nSize);
+	if (!pMap)
+	{
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+		return NULL;
+	}
+	h = (SnapshotHeader*)pMap;
+	if (nSize < (long)sizeof(SnapshotHeader) || memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "not a snapshot file");
+		goto fail;
+	}
+	if (h->nFormat != SNAPSHOT_FORMAT)
+	{
+		PyErr_SetString(PyExc_ValueError, "unsupported snapshot format version");
+		goto fail;
+	}
+	if (h->nByteOrder != SNAPSHOT_BYTE_ORDER || h->nLongSize != sizeof(long) || h->nEntrySize != sizeof(SnapshotEntry))
+	{
+		PyErr_SetString(PyExc_ValueError, "snapshot was written on an incompatible platform");
+		goto fail;
+	}
+	/* the keys fit in the file, so nCells + 1 cannot overflow */
+	if (h->nFileSize != nSize ||
+		!snapshot_section_ok(h->offKeys, h->nCells, sizeof(CgridKey), nSize) ||
+		!snapshot_section_ok(h->offStart, h->nCells + 1, sizeof(long), nSize) ||
+		!snapshot_section_ok(h->offEntries, h->nMembers, sizeof(SnapshotEntry), nSize) ||
+		!snapshot_section_ok(h->offOrder, h->nMembers, sizeof(long), nSize) ||
+		!snapshot_section_ok(h->offArrays, h->nArrays, 2 * sizeof(long), nSize))
+	{
+		PyErr_SetString(PyExc_ValueError, "snapshot file is truncated or corrupt");
+		goto fail;
+	}
+	/* the cell starts index the entries directly, so they must run from */
+	/* 0 to nMembers without going back */
+	pStart = (long*)(pMap + h->offStart);
+	bValid = (pStart[0] == 0 && pStart[h->nCells] == h->nMembers);
+	for (i = 0; bValid && i < h->nCells; i++)
+		bValid = (pStart[i] <= pStart[i + 1]);
+	if (!bValid)
+	{
+		PyErr_SetString(PyExc_ValueError, "snapshot file is truncated or corrupt");
+		goto fail;
+	}
+	if (h->dCellSize != self->dCellSize)
+	{
+		PyErr_SetString(PyExc_ValueError, "snapshot cell size does not match the grid");
+		goto fail;
+	}
+	pDir = (long*)(pMap + h->offArrays);
+	for (i = 0; i < h->nArrays; i++)
+	{
+		if (!snapshot_section_ok(pDir[(i * 2) + 1], pDir[i * 2], 3 * sizeof(double), nSize))
+		{
+			PyErr_SetString(PyExc_ValueError, "snapshot file is truncated or corrupt");
+			goto fail;
+		}
+	}
+
+	pStatic = (CgridStatic*)calloc(1, sizeof(CgridStatic));
+	if (!pStatic)
+		goto nomem;
+	pStatic->pMap = pMap;
+	pStatic->nMapSize = nSize;
+	pStatic->nCells = h->nCells;
+	pStatic->dMaxRadius = h->dMaxRadius;
+	pStatic->pKeys = (CgridKey*)(pMap + h->offKeys);
+	pStatic->pStart = (long*)(pMap + h->offStart);
+	pStatic->pOrder = (long*)(pMap + h->offOrder);
+	pStatic->pEntries = (CgridEntry*)malloc((h->nMembers + 1) * sizeof(CgridEntry));
+	pStatic->pObjects = (PyObject**)calloc(h->nMembers + 1, sizeof(PyObject*));
+	if (!pStatic->pEntries || !pStatic->pObjects)
+		goto nomem;
+	pStatic->nMembers = h->nMembers;
+	pRecords = (SnapshotEntry*)(pMap + h->offEntries);
+	for (i = 0; i < h->nMembers; i++)
+	{
+		memcpy(pStatic->pEntries[i].pos, pRecords[i].pos, 3 * sizeof(double));
+		pStatic->pEntries[i].dRadius = pRecords[i].dRadius;
+		pStatic->pEntries[i].nNbr = -1;
+		pStatic->pEntries[i].nCategory = pRecords[i].nCategory;
+		pStatic->pEntries[i].nMask = pRecords[i].nMask;
+	}
+
+	if (objects && objects != Py_None)
+	{
+		pFast = PySequence_Fast(objects, "load() requires a sequence of objects");
+		if (!pFast)
+			goto fail;
+		n = PySequence_Fast_GET_SIZE(pFast);
+	}
+	for (i = 0; i < h->nMembers; i++)
+	{
+		j = pStatic->pOrder[i];
+		if (pFast)
+		{
+			if (j < 0 || j >= n)
+			{
+				PyErr_SetString(PyExc_IndexError, "snapshot refers past the end of the objects sequence");
+				goto fail;
+			}
+			pStatic->pObjects[i] = PySequence_Fast_GET_ITEM(pFast, j);
+			Py_INCREF(pStatic->pObjects[i]);
+		}
+		else
+		{
+			pStatic->pObjects[i] = PyInt_FromLong(j);
+			if (!pStatic->pObjects[i])
+				goto fail;
+		}
+	}
+
+	pList = PyList_New(h->nArrays);
+	if (!pList)
+		goto fail;
+	for (i = 0; i < h->nArrays; i++)
+	{
+		pArr = PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init(pArr, NULL, NULL);
+		PyList_SET_ITEM(pList, i, (PyObject*)pArr);
+		if (!obarr_set_size(pArr, pDir[i * 2]))
+			goto nomem;
+		pData = (double*)(pMap + pDir[(i * 2) + 1]);
+		for (j = 0; j < pDir[i * 2]; j++)
+		{
+			pVect = PyObject_New(VectObject, &VectObjectType);
+			if (!pVect)
+				goto fail;
+			memcpy(pVect->elements, &pData[j * 3], 3 * sizeof(double));
+			obarr_set_element(pArr, j, (PyObject*)pVect);
+			Py_DECREF(pVect);
+		}
+	}
+
+	Py_XDECREF(pFast);
+	*ppArrays = pList;
+	return pStatic;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+fail:
+	Py_XDECREF(pFast);
+	Py_XDECREF(pList);
+	if (pStatic)
+		cgrid_static_free(pStatic);
+	else
+		snapshot_unmap(pMap, nSize);
+	return NULL;
+}
+
+ObarrObject* cgrid_get_radius(CgridObject *self, PyObject *other, double dRadius, unsigned int nMask)
 {
 	ObarrObject *pNeighbors;
+	double pos[3];
+
+	if (!cgrid_read_pos(other, pos))
+		return NULL;
+
 	pNeighbors = PyObject_New(ObarrObject, &ObarrObjectType);
-	if (!cgrid_get_radius_append(pNeighbors))
+	Obarr_init(pNeighbors, NULL, NULL);
+	if (!cgrid_get_radius_append(self, pos, dRadius, nMask, pNeighbors))
 	{
 		Py_DECREF(pNeighbors);
 		return NULL;
@@ -135,122 +797,537 @@ ObarrObject* cgrid_get_radius(CgridObject *self, PyObject *other, double dRadius
 	return pNeighbors;
 
 }
-void* cgrid_get_radius_append(CgridObject *self, PyObject *other, double dRadius, ObarrObject *pNeighbors)
+
+/* appends every member of both layers whose sphere reaches within dRadius */
+/* of pos and whose category shares a bit with nMask */
+int cgrid_get_radius_append(CgridObject *self, double *pos, double dRadius, unsigned int nMask, ObarrObject *pNeighbors)
 {
-	PyObject *el = NULL;
-	rb_red_blk_node* pNode = NULL;
-	PyObject *pAttr;
+	CgridStatic* pStatic = self->pStatic;
 	CgridInfo *pV;
-	CgridKey k;
-	double dRe;
-	double dX, dY, dZ;
-	double dXi, dYi, dZi;
-	double dXs, dYs, dZs;
-	double dXe, dYe, dZe;
-	long x, y, r, i;
-	
-    if (!PyArg_ParseTuple(args, "Od", &other, &dRadius))
-	{
-		PyErr_SetString(PyExc_TypeError, "wrong arguments");
-		return NULL;
-	}
-	
-	pAttr = PyObject_GetAttrString(other, "pos")
-    if (!pAttr)
-    {
-		PyErr_SetString(PyExc_TypeError, "missing 'pos' attribute of input object");
-		return NULL;
-    }
-    
-    if (!PyArg_ParseTuple(pAttr, "ddd", &dX, &dY, &dZ))
-	{
-		Py_DECREF(pAttr);
-		PyErr_SetString(PyExc_TypeError, "invalid 'pos' attribute of input object");
-		return NULL;
-	}
-	Py_DECREF(pAttr);
-
-	dXs = dX + dRadius + (self->dCellSize * 0.1);
-	dYs = dY + dRadius + (self->dCellSize * 0.1);
-	dZs = dZ + dRadius + (self->dCellSize * 0.1);
-	
-	for (dXi = (dX - dRadius); dXi <= dXs; dXi += self->dCellSize)
+	CgridEntry *pE;
+	CgridKey k, kMin, kMax;
+	double dReach;
+	long i, c;
+
+	self->nQueries++;
+	if (pStatic && pStatic->nMembers > 0)
 	{
-		for (dYi = (dY - dRadius); dYi <= dYs; dYi += self->dCellSize)
+		dReach = dRadius + pStatic->dMaxRadius;
+		kMin.x = cgrid_coord_to_gridcoord(self, pos[0] - dReach);
+		kMin.y = cgrid_coord_to_gridcoord(self, pos[1] - dReach);
+		kMin.z = cgrid_coord_to_gridcoord(self, pos[2] - dReach);
+		kMax.x = cgrid_coord_to_gridcoord(self, pos[0] + dReach);
+		kMax.y = cgrid_coord_to_gridcoord(self, pos[1] + dReach);
+		kMax.z = cgrid_coord_to_gridcoord(self, pos[2] + dReach);
+		for (k.x = kMin.x; k.x <= kMax.x; k.x++)
 		{
-			for (dZi = (dZ - dRadius); dZi <= dZs; dZi += self->dCellSize)
+			for (k.y = kMin.y; k.y <= kMax.y; k.y++)
 			{
-				k.x = cgrid_coord_to_gridcoord(dXi);
-				k.y = cgrid_coord_to_gridcoord(dYi);
-				k.z = cgrid_coord_to_gridcoord(dZi);
-				pNode = RBExactQuery(self->pTree, &k);
-				if (pNode)
+				for (k.z = kMin.z; k.z <= kMax.z; k.z++)
 				{
-					pV = (CgridInfo*)pNode->info;
-					for (i = 0; i < pV->pContents->nSize; i++)
+					self->nCellsVisited++;
+					c = cgrid_static_find_cell(pStatic, &k);
+					if (c < 0)
+						continue;
+					self->nCandidates += pStatic->pStart[c + 1] - pStatic->pStart[c];
+					for (i = pStatic->pStart[c]; i < pStatic->pStart[c + 1]; i++)
 					{
-						el = obarr_get_element(pV->pContents, i);
-						pAttr = PyObject_GetAttrString(other, "pos");
-					    if (!pAttr)
-						{
-							PyErr_SetString(PyExc_TypeError, "missing 'pos' attribute of object in grid");
-							return NULL;
-						}
-					    if (!PyArg_ParseTuple(pAttr, "ddd", &dXe, &dYe, &dZe))
-						{
-							Py_DECREF(pAttr);
-							PyErr_SetString(PyExc_TypeError, "invalid 'pos' attribute of object in grid");
-							return NULL;
-						}
-						Py_DECREF(pAttr);
-
-						pAttr = PyObject_GetAttrString(other, "radius");
-					    if (!pAttr)
-							dRe = 0.0;
-					    else if (!PyFloat_Check(pAttr))
-						{
-							Py_DECREF(pAttr);
-							PyErr_SetString(PyExc_TypeError, "invalid 'radius' attribute of object in grid");
-							return NULL;
-						}
-						else
-							dRe = PyFloat_AsDouble(pAttr);
-						Py_DECREF(pAttr);
-						
-						dDist = sqrt(SQR(dXe - dX) + SQR(dYe - dY) + SQR(dZe - dZ)) - dRe;
-						if (dDist > dRadius)
+						pE = &pStatic->pEntries[i];
+						if (!(pE->nCategory & nMask))
 							continue;
-						if (!obarr_append(pNeighbors, el))
+						if (SQR(pE->pos[0] - pos[0]) + SQR(pE->pos[1] - pos[1]) + SQR(pE->pos[2] - pos[2]) > SQR(dRadius + pE->dRadius))
+							continue;
+						self->nHits++;
+						if (!obarr_append(pNeighbors, pStatic->pObjects[i]))
 						{
 							PyErr_SetString(PyExc_MemoryError, "out of memory");
-							return NULL;
+							return 0;
 						}
 					}
 				}
 			}
 		}
 	}
-	
-	return pNeighbors;
+
+	if (self->nSize > 0)
+	{
+		dReach = dRadius + self->dMaxRadius;
+		kMin.x = cgrid_coord_to_gridcoord(self, pos[0] - dReach);
+		kMin.y = cgrid_coord_to_gridcoord(self, pos[1] - dReach);
+		kMin.z = cgrid_coord_to_gridcoord(self, pos[2] - dReach);
+		kMax.x = cgrid_coord_to_gridcoord(self, pos[0] + dReach);
+		kMax.y = cgrid_coord_to_gridcoord(self, pos[1] + dReach);
+		kMax.z = cgrid_coord_to_gridcoord(self, pos[2] + dReach);
+		for (k.x = kMin.x; k.x <= kMax.x; k.x++)
+		{
+			for (k.y = kMin.y; k.y <= kMax.y; k.y++)
+			{
+				for (k.z = kMin.z; k.z <= kMax.z; k.z++)
+				{
+					self->nCellsVisited++;
+					pV = cgrid_get_cell(self, &k);
+					if (!pV)
+						continue;
+					self->nCandidates += pV->pContents->nSize;
+					for (i = 0; i < pV->pContents->nSize; i++)
+					{
+						pE = &pV->pEntries[i];
+						if (!(pE->nCategory & nMask))
+							continue;
+						if (SQR(pE->pos[0] - pos[0]) + SQR(pE->pos[1] - pos[1]) + SQR(pE->pos[2] - pos[2]) > SQR(dRadius + pE->dRadius))
+							continue;
+						self->nHits++;
+						if (!obarr_append(pNeighbors, obarr_get_element(pV->pContents, i)))
+						{
+							PyErr_SetString(PyExc_MemoryError, "out of memory");
+							return 0;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+/* records a cell crossing for the attached aoi, if there is one */
+int cgrid_log_move(CgridObject* self, PyObject* other, CgridKey* pOld, CgridKey* pNew)
+{
+	CgridMove* pMove;
+	void* tmp;
+
+	if (!self->bLogMoves)
+		return 1;
+	if (self->nMoves == self->nMoveAlloc)
+	{
+		tmp = realloc(self->pMoves, (self->nMoveAlloc + 256) * sizeof(CgridMove));
+		if (!tmp)
+			return 0;
+		self->pMoves = (CgridMove*)tmp;
+		self->nMoveAlloc += 256;
+	}
+	pMove = &self->pMoves[self->nMoves++];
+	memset(pMove, 0, sizeof(CgridMove));
+	pMove->pObj = other;
+	Py_XINCREF(other);
+	pMove->bOld = (pOld != NULL);
+	pMove->bNew = (pNew != NULL);
+	if (pOld)
+	{
+		COPY_KEY(pOld, &pMove->kOld);
+	}
+	if (pNew)
+	{
+		COPY_KEY(pNew, &pMove->kNew);
+	}
+	return 1;
+}
+
+void cgrid_clear_moves(CgridObject* self)
+{
+	long i;
+
+	for (i = 0; i < self->nMoves; i++)
+		Py_XDECREF(self->pMoves[i].pObj);
+	self->nMoves = 0;
+}
+
+rb_red_blk_node* cgrid_first_node(CgridObject* self)
+{
+	rb_red_blk_node* nil = self->pTree->nil;
+	rb_red_blk_node* x = self->pTree->root->left;
+
+	if (x == nil)
+		return nil;
+	while (x->left != nil)
+		x = x->left;
+	return x;
+}
+
+/* appends every overlapping pair of a dynamic member with a member of */
+/* either layer to a flat array, lower address first.  Pairs within the */
+/* static layer are left out.  Both members must have a category bit in */
+/* nMask and in each other's mask. */
+int cgrid_find_pairs(CgridObject* self, unsigned int nMask, ObarrObject* pOut)
+{
+	CgridStatic* pStatic = self->pStatic;
+	rb_red_blk_node* nil = self->pTree->nil;
+	rb_red_blk_node* pNode;
+	CgridInfo *pV, *pW;
+	CgridEntry *pE, *pF;
+	CgridKey k, kMin, kMax;
+	PyObject *a, *b;
+	double dReach;
+	long i, j, c, nLayer;
+
+	for (pNode = cgrid_first_node(self); pNode != nil; pNode = TreeSuccessor(self->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		for (i = 0; i < pV->pContents->nSize; i++)
+		{
+			pE = &pV->pEntries[i];
+			if (!(pE->nCategory & nMask))
+				continue;
+			a = obarr_get_element(pV->pContents, i);
+			for (nLayer = 0; nLayer < 2; nLayer++)
+			{
+				if (nLayer == 0 && (!pStatic || pStatic->nMembers == 0))
+					continue;
+				dReach = pE->dRadius + (nLayer == 0 ? pStatic->dMaxRadius : self->dMaxRadius);
+				kMin.x = cgrid_coord_to_gridcoord(self, pE->pos[0] - dReach);
+				kMin.y = cgrid_coord_to_gridcoord(self, pE->pos[1] - dReach);
+				kMin.z = cgrid_coord_to_gridcoord(self, pE->pos[2] - dReach);
+				kMax.x = cgrid_coord_to_gridcoord(self, pE->pos[0] + dReach);
+				kMax.y = cgrid_coord_to_gridcoord(self, pE->pos[1] + dReach);
+				kMax.z = cgrid_coord_to_gridcoord(self, pE->pos[2] + dReach);
+				for (k.x = kMin.x; k.x <= kMax.x; k.x++)
+				{
+					for (k.y = kMin.y; k.y <= kMax.y; k.y++)
+					{
+						for (k.z = kMin.z; k.z <= kMax.z; k.z++)
+						{
+							if (nLayer == 0)
+							{
+								c = cgrid_static_find_cell(pStatic, &k);
+								if (c < 0)
+									continue;
+								for (j = pStatic->pStart[c]; j < pStatic->pStart[c + 1]; j++)
+								{
+									pF = &pStatic->pEntries[j];
+									if (!(pF->nCategory & nMask) || !(pF->nCategory & pE->nMask) || !(pE->nCategory & pF->nMask))
+										continue;
+									if (SQR(pF->pos[0] - pE->pos[0]) + SQR(pF->pos[1] - pE->pos[1]) + SQR(pF->pos[2] - pE->pos[2]) > SQR(pE->dRadius + pF->dRadius))
+										continue;
+									b = pStatic->pObjects[j];
+									if (!obarr_append(pOut, a < b ? a : b) || !obarr_append(pOut, a < b ? b : a))
+										return 0;
+								}
+								continue;
+							}
+
+							/* each dynamic pair is seen from both ends, keep it once */
+							pW = cgrid_get_cell(self, &k);
+							if (!pW)
+								continue;
+							for (j = 0; j < pW->pContents->nSize; j++)
+							{
+								b = obarr_get_element(pW->pContents, j);
+								if (b <= a)
+									continue;
+								pF = &pW->pEntries[j];
+								if (!(pF->nCategory & nMask) || !(pF->nCategory & pE->nMask) || !(pE->nCategory & pF->nMask))
+									continue;
+								if (SQR(pF->pos[0] - pE->pos[0]) + SQR(pF->pos[1] - pE->pos[1]) + SQR(pF->pos[2] - pE->pos[2]) > SQR(pE->dRadius + pF->dRadius))
+									continue;
+								if (!obarr_append(pOut, a) || !obarr_append(pOut, b))
+									return 0;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/* sums and maxes the depth of every node below x, the tree root being depth 1 */
+void cgrid_tree_depths(rb_red_blk_tree* pTree, rb_red_blk_node* x, long nDepth, long* pnSum, long* pnMax)
+{
+	while (x != pTree->nil)
+	{
+		*pnSum += nDepth;
+		if (nDepth > *pnMax)
+			*pnMax = nDepth;
+		cgrid_tree_depths(pTree, x->left, nDepth + 1, pnSum, pnMax);
+		x = x->right;
+		nDepth++;
+	}
+}
+
+/* appends the pair (i, j) to a growable array of index pairs */
+int cgrid_pairs_add(long** ppPairs, long* pnPairs, long* pnAlloc, long i, long j)
+{
+	void* tmp;
+
+	if (*pnPairs == *pnAlloc)
+	{
+		tmp = realloc(*ppPairs, (*pnAlloc + 1024) * 2 * sizeof(long));
+		if (!tmp)
+			return 0;
+		*ppPairs = (long*)tmp;
+		*pnAlloc += 1024;
+	}
+	(*ppPairs)[*pnPairs * 2] = i;
+	(*ppPairs)[(*pnPairs * 2) + 1] = j;
+	(*pnPairs)++;
+	return 1;
+}
+
+void cgrid_neighbors_free(CgridNeighbors* pNbrs)
+{
+	long i;
+
+	if (!pNbrs)
+		return;
+	if (pNbrs->pObjects)
+	{
+		for (i = 0; i < pNbrs->nMembers; i++)
+			Py_XDECREF(pNbrs->pObjects[i]);
+		free(pNbrs->pObjects);
+	}
+	free(pNbrs->pPos);
+	free(pNbrs->pStart);
+	free(pNbrs->pIndex);
+	free(pNbrs);
+}
+
+/* the lists must be rebuilt if the membership or parameters changed, or if */
+/* any dynamic member has moved more than half the skin since the last build */
+int cgrid_neighbors_stale(CgridObject* self, double dCutoff, double dSkin)
+{
+	CgridNeighbors* pNbrs = self->pNbrs;
+	rb_red_blk_node* nil = self->pTree->nil;
+	rb_red_blk_node* pNode;
+	CgridInfo* pV;
+	CgridEntry* pE;
+	double* p;
+	double dLimit;
+	long i;
+
+	if (!pNbrs || pNbrs->nVersion != self->nVersion)
+		return 1;
+	if (pNbrs->dCutoff != dCutoff || pNbrs->dSkin != dSkin)
+		return 1;
+
+	dLimit = SQR(dSkin * 0.5);
+	for (pNode = cgrid_first_node(self); pNode != nil; pNode = TreeSuccessor(self->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		for (i = 0; i < pV->pContents->nSize; i++)
+		{
+			pE = &pV->pEntries[i];
+			if (pE->nNbr < 0)
+				return 1;
+			p = &pNbrs->pPos[pE->nNbr * 3];
+			if (SQR(pE->pos[0] - p[0]) + SQR(pE->pos[1] - p[1]) + SQR(pE->pos[2] - p[2]) > dLimit)
+				return 1;
+		}
+	}
+	return 0;
+}
+
+CgridNeighbors* cgrid_neighbors_build(CgridObject* self, double dCutoff, double dSkin)
+{
+	CgridStatic* pStatic = self->pStatic;
+	CgridNeighbors* pNbrs;
+	rb_red_blk_node* nil = self->pTree->nil;
+	rb_red_blk_node* pNode;
+	CgridInfo* pV;
+	CgridKey k, kMin, kMax;
+	long* pPairs = NULL;
+	long* pFill = NULL;
+	long nPairs = 0, nPairAlloc = 0;
+	long nStatic, n, i, j, m, c;
+	double dReach, dReach2;
+	double* p;
+	double* q;
+
+	nStatic = pStatic ? pStatic->nMembers : 0;
+	n = nStatic + self->nSize;
+
+	pNbrs = (CgridNeighbors*)calloc(1, sizeof(CgridNeighbors));
+	if (!pNbrs)
+		goto nomem;
+	pNbrs->pObjects = (PyObject**)calloc(n + 1, sizeof(PyObject*));
+	pNbrs->pPos = (double*)malloc((n + 1) * 3 * sizeof(double));
+	pNbrs->pStart = (long*)calloc(n + 2, sizeof(long));
+	if (!pNbrs->pObjects || !pNbrs->pPos || !pNbrs->pStart)
+		goto nomem;
+
+	/* snapshot: the static layer first, then the dynamic cells in key order */
+	for (i = 0; i < nStatic; i++)
+	{
+		pNbrs->pObjects[i] = pStatic->pObjects[i];
+		memcpy(&pNbrs->pPos[i * 3], pStatic->pEntries[i].pos, 3 * sizeof(double));
+	}
+	j = nStatic;
+	for (pNode = cgrid_first_node(self); pNode != nil; pNode = TreeSuccessor(self->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		for (i = 0; i < pV->pContents->nSize; i++)
+		{
+			pV->pEntries[i].nNbr = j;
+			pNbrs->pObjects[j] = obarr_get_element(pV->pContents, i);
+			memcpy(&pNbrs->pPos[j * 3], pV->pEntries[i].pos, 3 * sizeof(double));
+			j++;
+		}
+	}
+	for (i = 0; i < n; i++)
+		Py_INCREF(pNbrs->pObjects[i]);
+	pNbrs->nMembers = n;
+	pNbrs->nStatic = nStatic;
+	pNbrs->dCutoff = dCutoff;
+	pNbrs->dSkin = dSkin;
+	pNbrs->nVersion = self->nVersion;
+
+	/* collect each pair once, from its lower index */
+	dReach = dCutoff + dSkin;
+	dReach2 = SQR(dReach);
+	for (i = 0; i < n; i++)
+	{
+		p = &pNbrs->pPos[i * 3];
+		kMin.x = cgrid_coord_to_gridcoord(self, p[0] - dReach);
+		kMin.y = cgrid_coord_to_gridcoord(self, p[1] - dReach);
+		kMin.z = cgrid_coord_to_gridcoord(self, p[2] - dReach);
+		kMax.x = cgrid_coord_to_gridcoord(self, p[0] + dReach);
+		kMax.y = cgrid_coord_to_gridcoord(self, p[1] + dReach);
+		kMax.z = cgrid_coord_to_gridcoord(self, p[2] + dReach);
+		for (k.x = kMin.x; k.x <= kMax.x; k.x++)
+		{
+			for (k.y = kMin.y; k.y <= kMax.y; k.y++)
+			{
+				for (k.z = kMin.z; k.z <= kMax.z; k.z++)
+				{
+					if (nStatic > 0 && (c = cgrid_static_find_cell(pStatic, &k)) >= 0)
+					{
+						for (j = pStatic->pStart[c]; j < pStatic->pStart[c + 1]; j++)
+						{
+							q = &pNbrs->pPos[j * 3];
+							if (j <= i || SQR(q[0] - p[0]) + SQR(q[1] - p[1]) + SQR(q[2] - p[2]) > dReach2)
+								continue;
+							if (!cgrid_pairs_add(&pPairs, &nPairs, &nPairAlloc, i, j))
+								goto nomem;
+						}
+					}
+					pV = (self->nSize > 0) ? cgrid_get_cell(self, &k) : NULL;
+					if (!pV)
+						continue;
+					for (m = 0; m < pV->pContents->nSize; m++)
+					{
+						j = pV->pEntries[m].nNbr;
+						q = &pNbrs->pPos[j * 3];
+						if (j <= i || SQR(q[0] - p[0]) + SQR(q[1] - p[1]) + SQR(q[2] - p[2]) > dReach2)
+							continue;
+						if (!cgrid_pairs_add(&pPairs, &nPairs, &nPairAlloc, i, j))
+							goto nomem;
+					}
+				}
+			}
+		}
+	}
+
+	/* compressed rows: count, prefix sum, then scatter both directions */
+	pNbrs->pIndex = (long*)malloc((nPairs + 1) * 2 * sizeof(long));
+	pFill = (long*)malloc((n + 1) * sizeof(long));
+	if (!pNbrs->pIndex || !pFill)
+		goto nomem;
+	for (i = 0; i < nPairs * 2; i++)
+		pNbrs->pStart[pPairs[i] + 1]++;
+	for (i = 0; i < n; i++)
+		pNbrs->pStart[i + 1] += pNbrs->pStart[i];
+	memcpy(pFill, pNbrs->pStart, n * sizeof(long));
+	for (i = 0; i < nPairs; i++)
+	{
+		pNbrs->pIndex[pFill[pPairs[i * 2]]++] = pPairs[(i * 2) + 1];
+		pNbrs->pIndex[pFill[pPairs[(i * 2) + 1]]++] = pPairs[i * 2];
+	}
+
+	free(pPairs);
+	free(pFill);
+	return pNbrs;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+	free(pPairs);
+	free(pFill);
+	cgrid_neighbors_free(pNbrs);
+	return NULL;
+}
+
+/* narrows [t0, t1] to the part of the segment s + t * d lying inside [lo, hi] */
+int cgrid_clip_slab(double s, double d, double lo, double hi, double* t0, double* t1)
+{
+	double ta, tb, tmp;
+
+	if (d == 0.0)
+		return (s >= lo && s <= hi);
+
+	ta = (lo - s) / d;
+	tb = (hi - s) / d;
+	if (ta > tb)
+	{
+		tmp = ta; ta = tb; tb = tmp;
+	}
+	if (ta > *t0)
+		*t0 = ta;
+	if (tb < *t1)
+		*t1 = tb;
+	return (*t0 <= *t1);
+}
+
+/* time of impact in [0, 1] of a sphere swept along start + t * delta against */
+/* a cached member sphere, or -1.0 if they never touch */
+double cgrid_sweep_entry(double* start, double* delta, double dRadius, CgridEntry* pE)
+{
+	double m[3];
+	double a, b, c, disc, t;
+	long i;
+
+	for (i = 0; i < 3; i++)
+		m[i] = start[i] - pE->pos[i];
+	c = SQR(m[0]) + SQR(m[1]) + SQR(m[2]) - SQR(dRadius + pE->dRadius);
+	if (c <= 0.0)
+		return 0.0;
+
+	a = SQR(delta[0]) + SQR(delta[1]) + SQR(delta[2]);
+	b = (m[0] * delta[0]) + (m[1] * delta[1]) + (m[2] * delta[2]);
+	if (a == 0.0 || b >= 0.0)
+		return -1.0;
+	disc = SQR(b) - (a * c);
+	if (disc < 0.0)
+		return -1.0;
+	t = (-b - sqrt(disc)) / a;
+	if (t > 1.0)
+		return -1.0;
+	return t;
 }
 
 
 int Cgrid_init(CgridObject *self, PyObject *args, PyObject *kwds)
 {
 	double dCell;
-	
+
     if (!PyArg_ParseTuple(args, "d", &dCell))
 	{
 		PyErr_SetString(PyExc_TypeError, "wrong arguments");
-		return 1;
+		return -1;
 	}
-	
+	if (dCell <= 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "cell size must be positive");
+		return -1;
+	}
+
 	self->pTree = RBTreeCreate(cgrid_compare, cgrid_destroykey, cgrid_destroyinfo, cgrid_printkey, cgrid_printinfo);
 	self->nSize = 0;
 	self->nCells = 0;
 	self->dCellSize = dCell;
+	self->dMaxRadius = 0.0;
 	self->pUnrolled = NULL;
 	self->bUnrollDirty = 1;
+	self->pStatic = NULL;
+	self->pNbrs = NULL;
+	self->nVersion = 0;
+	self->pMoves = NULL;
+	self->nMoves = 0;
+	self->nMoveAlloc = 0;
+	self->bLogMoves = 0;
+	self->nQueries = 0;
+	self->nCellsVisited = 0;
+	self->nCandidates = 0;
+	self->nHits = 0;
 
 	return 0;
 }
@@ -258,21 +1335,35 @@ int Cgrid_init(CgridObject *self, PyObject *args, PyObject *kwds)
 void Cgrid_dealloc(PyObject* self_in)
 {
 	CgridObject* self = (CgridObject*)self_in;
-	
-	RBTreeDestroy(self->pTree);
+
+	if (self->pTree)
+		RBTreeDestroy(self->pTree);
+	Py_XDECREF(self->pUnrolled);
+	cgrid_static_free(self->pStatic);
+	cgrid_neighbors_free(self->pNbrs);
+	cgrid_clear_moves(self);
+	if (self->pMoves)
+		free(self->pMoves);
+	self_in->ob_type->tp_free(self_in);
 }
 
 PyObject* Cgrid_repr(PyObject *self_in)
 {
 	CgridObject *self;
 	PyObject *tuple, *fmtstring, *reprstring;
-	
+	long nStaticCells = 0, nStaticSize = 0;
+
 	if (!Cgrid_Check(self_in))
 		return PyString_FromString("<unknown object type>");
-	
+
 	self = (CgridObject*)self_in;
-	tuple = Py_BuildValue("(ii)", self->nCells, self->nSize);
-	fmtstring = PyString_FromString("<cgrid of %d cells, %d objects>");
+	if (self->pStatic)
+	{
+		nStaticCells = self->pStatic->nCells;
+		nStaticSize = self->pStatic->nMembers;
+	}
+	tuple = Py_BuildValue("(llll)", self->nCells, self->nSize, nStaticCells, nStaticSize);
+	fmtstring = PyString_FromString("<cgrid of %d cells, %d objects (static: %d cells, %d objects)>");
 	reprstring = PyString_Format(fmtstring, tuple);
 	Py_DECREF(tuple);
 	Py_DECREF(fmtstring);
@@ -283,7 +1374,7 @@ PyObject* Cgrid_repr(PyObject *self_in)
 PyObject *
 Cgrid_copy(PyObject *self_in, PyObject *unused)
 {
-	if (!Cgrid_Check(self_in))	
+	if (!Cgrid_Check(self_in))
 	{
 		PyErr_SetString(PyExc_TypeError, "not a vector");
 		return NULL;
@@ -301,21 +1392,24 @@ Cgrid_copy(PyObject *self_in, PyObject *unused)
 Py_ssize_t Cgrid_len(PyObject *self_in)
 {
 	CgridObject* self = (CgridObject*)self_in;
-	
+
 	return self->nCells;
 }
 
 PyObject* Cgrid_item(PyObject *self_in, Py_ssize_t index)
 {
 	CgridObject* self = (CgridObject*)self_in;
-	
+	PyObject* ob;
+
 	cgrid_unroll(self);
 	if (!obarr_valid_index(self->pUnrolled, index))
 	{
 		PyErr_SetString(PyExc_IndexError, "invalid index");
 		return NULL;
 	}
-	return obarr_get_element(self->pUnrolled, index);
+	ob = obarr_get_element(self->pUnrolled, index);
+	Py_INCREF(ob);
+	return ob;
 }
 
 int Cgrid_contains(PyObject* self_in, PyObject* other_in)
@@ -323,11 +1417,11 @@ int Cgrid_contains(PyObject* self_in, PyObject* other_in)
 	CgridObject* self = (CgridObject*)self_in;
 	rb_red_blk_node* pNode = NULL;
 	CgridKey k;
-	
+
     if (!PyArg_ParseTuple(other_in, "lll", &k.x, &k.y, &k.z))
 	{
 		PyErr_SetString(PyExc_TypeError, "wrong arguments");
-		return 0;
+		return -1;
 	}
 
 	pNode = RBExactQuery(self->pTree, &k);
@@ -340,20 +1434,35 @@ PyObject* Cgrid_insert(PyObject *self_in, PyObject *args)
 	PyObject* other = NULL;
 	CgridKey* pK = NULL;
 	CgridInfo* pV = NULL;
+	CgridEntry e;
 	rb_red_blk_node* pNode = NULL;
-	
+
 	pK = cgrid_newkey();
-    if (!PyArg_ParseTuple(args, "(lll)O", &pK->x, &pK->y, &pK->z, &other))
+	if (PyTuple_GET_SIZE(args) == 1)
 	{
-		free(pK);
-		PyErr_SetString(PyExc_TypeError, "wrong arguments");
-		return NULL;
+		/* no cell given, so it is taken from the object's position */
+		if (!PyArg_ParseTuple(args, "O", &other) || !cgrid_read_entry(other, &e))
+		{
+			free(pK);
+			return NULL;
+		}
+		cgrid_pos_to_key(self, e.pos, pK);
 	}
-	
-	PyObject_SetAttrString(other, "_cgrid_internal_key_x", PyInt_FromLong(pK->x));
-	PyObject_SetAttrString(other, "_cgrid_internal_key_y", PyInt_FromLong(pK->y));
-	PyObject_SetAttrString(other, "_cgrid_internal_key_z", PyInt_FromLong(pK->z));
-	
+	else
+	{
+		if (!PyArg_ParseTuple(args, "(lll)O", &pK->x, &pK->y, &pK->z, &other))
+		{
+			free(pK);
+			PyErr_SetString(PyExc_TypeError, "wrong arguments");
+			return NULL;
+		}
+		if (!cgrid_read_entry(other, &e))
+		{
+			free(pK);
+			return NULL;
+		}
+	}
+
 	pNode = RBExactQuery(self->pTree, pK);
 	if (pNode)
 	{
@@ -364,16 +1473,34 @@ PyObject* Cgrid_insert(PyObject *self_in, PyObject *args)
 		pV = cgrid_newinfo();
 		pV->pSelf = self;
 		pV->pContents = PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init(pV->pContents, NULL, NULL);
+		pV->pEntries = NULL;
+		pV->nEntryAlloc = 0;
 		COPY_KEY(pK, &(pV->k));
 
 		RBTreeInsert(self->pTree, pK, pV);
 		self->nCells++;
+		pK = NULL;
 	}
-	obarr_set_size(pV->pContents, pV->pContents->nSize + 1);
-	obarr_set_element(pV->pContents, pV->pContents->nSize - 1, other);
-	
+	if (!cgrid_info_append(pV, other, &e))
+	{
+		if (pK)
+			free(pK);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	cgrid_set_key_attrs(other, &pV->k);
+	if (pK)
+		free(pK);
+
 	self->nSize++;
+	self->nVersion++;
 	self->bUnrollDirty = 1;
+	if (!cgrid_log_move(self, other, NULL, &pV->k))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
 	Py_INCREF(Py_None);
 	return Py_None;
 
@@ -385,7 +1512,8 @@ PyObject* Cgrid_delete(PyObject *self_in, PyObject *args)
 	rb_red_blk_node* pNode = NULL;
 	CgridInfo* pV;
 	CgridKey k;
-	
+	long i;
+
     if (!PyArg_ParseTuple(args, "(lll)", &k.x, &k.y, &k.z))
 	{
 		PyErr_SetString(PyExc_TypeError, "wrong arguments");
@@ -399,12 +1527,21 @@ PyObject* Cgrid_delete(PyObject *self_in, PyObject *args)
 		return NULL;
 	}
 	pV = (CgridInfo*)pNode->info;
+	for (i = 0; i < pV->pContents->nSize; i++)
+	{
+		if (!cgrid_log_move(self, obarr_get_element(pV->pContents, i), &k, NULL))
+		{
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return NULL;
+		}
+	}
 	self->nSize = self->nSize - pV->pContents->nSize;
 	RBDelete(self->pTree, pNode);
 	self->nCells--;
 
+	self->nVersion++;
 	self->bUnrollDirty = 1;
-	
+
 	Py_INCREF(Py_None);
 	return Py_None;
 
@@ -413,10 +1550,8 @@ PyObject* Cgrid_delete(PyObject *self_in, PyObject *args)
 PyObject* Cgrid_remove(PyObject *self_in, PyObject *args)
 {
 	CgridObject* self = (CgridObject*)self_in;
-	PyObject *other, *element;
-	CgridKey k;
+	PyObject *other;
 	CgridInfo* pV;
-	PyObject *pX, *pY, *pZ;
 	rb_red_blk_node* pNode = NULL;
 	long i;
 
@@ -425,43 +1560,22 @@ PyObject* Cgrid_remove(PyObject *self_in, PyObject *args)
 		PyErr_SetString(PyExc_TypeError, "wrong arguments");
 		return NULL;
 	}
-	
-	pX = PyObject_GetAttrString(other, "_cgrid_internal_key_x");
-	pY = PyObject_GetAttrString(other, "_cgrid_internal_key_y");
-	pZ = PyObject_GetAttrString(other, "_cgrid_internal_key_z");
-	if (!pX || !pY || !pZ)
-	{
-		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (missing _cgrid_internal_key attributes)");
-		return NULL;
-	}
-	k.x = PyInt_AsLong(pX);
-	k.y = PyInt_AsLong(pY);
-	k.z = PyInt_AsLong(pZ);
-	
-	pNode = RBExactQuery(self->pTree, &k);
-	if (!pNode)
-	{
-		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (no such cell)");
-		return NULL;
-	}
-	pV = (CgridInfo*)pNode->info;
-	i = obarr_find(pV->pContents, other);
-	if (i == -1)
+
+	pV = cgrid_find_member(self, other, &pNode, &i);
+	if (!pV)
+		return NULL;
+	if (!cgrid_log_move(self, other, &pV->k, NULL))
 	{
-		PyErr_SetString(PyExc_ValueError, "supplied argument not found in grid (not in cell)");
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
 		return NULL;
 	}
-	
-	element = obarr_get_element(pV->pContents, i);
-	
-	PyObject_DelAttrString(element, "_cgrid_internal_key_x");
-	PyObject_DelAttrString(element, "_cgrid_internal_key_y");
-	PyObject_DelAttrString(element, "_cgrid_internal_key_z");
-	
-	obarr_del_index(pV->pContents, i);
+
+	cgrid_del_key_attrs(other);
+	cgrid_info_del_index(pV, i);
 	self->nSize--;
+	self->nVersion++;
 	self->bUnrollDirty = 1;
-		
+
 	if (pV->pContents->nSize == 0)
 	{
 		RBDelete(self->pTree, pNode);
@@ -472,21 +1586,650 @@ PyObject* Cgrid_remove(PyObject *self_in, PyObject *args)
 
 }
 
+/* re-reads the cached sphere of a dynamic member and moves it to its new */
+/* cell if it has crossed a cell boundary.  Returns True if it changed cells. */
+PyObject* Cgrid_update(PyObject *self_in, PyObject *args)
+{
+	CgridObject* self = (CgridObject*)self_in;
+	PyObject *other;
+	CgridInfo *pV, *pNew;
+	CgridEntry e;
+	CgridKey k;
+	CgridKey* pK;
+	rb_red_blk_node* pNode = NULL;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	pV = cgrid_find_member(self, other, &pNode, &i);
+	if (!pV)
+		return NULL;
+	if (!cgrid_read_entry(other, &e))
+		return NULL;
+	e.nNbr = pV->pEntries[i].nNbr;
+
+	cgrid_pos_to_key(self, e.pos, &k);
+	if (cgrid_compare(&k, &pV->k) == 0)
+	{
+		pV->pEntries[i] = e;
+		if (e.dRadius > self->dMaxRadius)
+			self->dMaxRadius = e.dRadius;
+		Py_INCREF(Py_False);
+		return Py_False;
+	}
+
+	pNew = cgrid_get_cell(self, &k);
+	if (!pNew)
+	{
+		pK = cgrid_newkey();
+		COPY_KEY(&k, pK);
+		pNew = cgrid_newinfo();
+		pNew->pSelf = self;
+		pNew->pContents = PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init(pNew->pContents, NULL, NULL);
+		pNew->pEntries = NULL;
+		pNew->nEntryAlloc = 0;
+		COPY_KEY(&k, &(pNew->k));
+		RBTreeInsert(self->pTree, pK, pNew);
+		self->nCells++;
+	}
+	if (!cgrid_info_append(pNew, other, &e) || !cgrid_log_move(self, other, &pV->k, &k))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	cgrid_set_key_attrs(other, &k);
+
+	cgrid_info_del_index(pV, i);
+	if (pV->pContents->nSize == 0)
+	{
+		RBDelete(self->pTree, pNode);
+		self->nCells--;
+	}
+	self->bUnrollDirty = 1;
+
+	Py_INCREF(Py_True);
+	return Py_True;
+}
+
+/* builds the static layer from a sequence of objects, replacing any previous one */
+PyObject* Cgrid_freeze(PyObject *self_in, PyObject *args)
+{
+	CgridObject* self = (CgridObject*)self_in;
+	CgridStatic* pStatic;
+	PyObject* seq;
+	clock_t tStart;
+
+    if (!PyArg_ParseTuple(args, "O", &seq))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	tStart = clock();
+	pStatic = cgrid_static_build(self, seq);
+	if (!pStatic)
+		return NULL;
+	pStatic->dBuildTime = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+	cgrid_static_free(self->pStatic);
+	self->pStatic = pStatic;
+	self->nVersion++;
+	if (!cgrid_log_move(self, NULL, NULL, NULL))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Cgrid_thaw(PyObject *self_in, PyObject *unused)
+{
+	CgridObject* self = (CgridObject*)self_in;
+
+	cgrid_static_free(self->pStatic);
+	self->pStatic = NULL;
+	self->nVersion++;
+	if (!cgrid_log_move(self, NULL, NULL, NULL))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
 PyObject* Cgrid_get_radius(PyObject *self_in, PyObject *args)
 {
 	CgridObject *self = (CgridObject*)self_in;
 	PyObject *other = NULL;
 	double dRadius;
-		
-    if (!PyArg_ParseTuple(args, "Od", &other, &dRadius))
+	unsigned int nMask = CGRID_ALL_LAYERS;
+
+    if (!PyArg_ParseTuple(args, "Od|I", &other, &dRadius, &nMask))
 	{
 		PyErr_SetString(PyExc_TypeError, "wrong arguments");
 		return NULL;
 	}
-	
-	return cgrid_get_radius(self, other, dRadius);	
+
+	return (PyObject*)cgrid_get_radius(self, other, dRadius, nMask);
 }
-	
+
+
+/* sweeps a sphere from start to end and returns a list of (object, toi) */
+/* tuples sorted by time of impact, toi being the fraction of the segment */
+PyObject* Cgrid_sphere_cast(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridStatic *pStatic = self->pStatic;
+	PyObject *pStart, *pEnd;
+	PyObject *rv = NULL;
+	PyObject **ppObjects;
+	ObarrObject *pHits;
+	sortkey *pKeys = NULL;
+	CgridInfo *pV;
+	CgridEntry *pEntries;
+	CgridKey k, kMin, kMax;
+	double start[3], end[3], delta[3];
+	double dRadius, dReach, dMax, dCs, t;
+	double tx0, tx1, ty0, ty1, tz0, tz1, lo, hi;
+	unsigned int nMask = CGRID_ALL_LAYERS;
+	long nLayer, nKeys, nKeyAlloc, n, i, c;
+	void* tmp;
+
+    if (!PyArg_ParseTuple(args, "OOd|I", &pStart, &pEnd, &dRadius, &nMask))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pStart, start) || !cgrid_read_pos(pEnd, end))
+		return NULL;
+	for (i = 0; i < 3; i++)
+		delta[i] = end[i] - start[i];
+
+	pHits = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pHits, NULL, NULL);
+	self->nQueries++;
+	nKeys = 0;
+	nKeyAlloc = 0;
+	dCs = self->dCellSize;
+
+	for (nLayer = 0; nLayer < 2; nLayer++)
+	{
+		if (nLayer == 0)
+		{
+			if (!pStatic || pStatic->nMembers == 0)
+				continue;
+			dMax = pStatic->dMaxRadius;
+		}
+		else
+		{
+			if (self->nSize == 0)
+				continue;
+			dMax = self->dMaxRadius;
+		}
+		dReach = dRadius + dMax;
+
+		/* visit only the cells whose box, grown by the reach, the segment */
+		/* passes through: clip the segment to each slab in turn and take */
+		/* the next axis' cell range from the clipped part */
+		lo = (start[0] < end[0] ? start[0] : end[0]) - dReach;
+		hi = (start[0] > end[0] ? start[0] : end[0]) + dReach;
+		kMin.x = cgrid_coord_to_gridcoord(self, lo);
+		kMax.x = cgrid_coord_to_gridcoord(self, hi);
+		for (k.x = kMin.x; k.x <= kMax.x; k.x++)
+		{
+			tx0 = 0.0; tx1 = 1.0;
+			if (!cgrid_clip_slab(start[0], delta[0], (k.x * dCs) - dReach, ((k.x + 1) * dCs) + dReach, &tx0, &tx1))
+				continue;
+			lo = start[1] + (delta[1] * (delta[1] < 0.0 ? tx1 : tx0)) - dReach;
+			hi = start[1] + (delta[1] * (delta[1] < 0.0 ? tx0 : tx1)) + dReach;
+			kMin.y = cgrid_coord_to_gridcoord(self, lo);
+			kMax.y = cgrid_coord_to_gridcoord(self, hi);
+			for (k.y = kMin.y; k.y <= kMax.y; k.y++)
+			{
+				ty0 = tx0; ty1 = tx1;
+				if (!cgrid_clip_slab(start[1], delta[1], (k.y * dCs) - dReach, ((k.y + 1) * dCs) + dReach, &ty0, &ty1))
+					continue;
+				lo = start[2] + (delta[2] * (delta[2] < 0.0 ? ty1 : ty0)) - dReach;
+				hi = start[2] + (delta[2] * (delta[2] < 0.0 ? ty0 : ty1)) + dReach;
+				kMin.z = cgrid_coord_to_gridcoord(self, lo);
+				kMax.z = cgrid_coord_to_gridcoord(self, hi);
+				for (k.z = kMin.z; k.z <= kMax.z; k.z++)
+				{
+					tz0 = ty0; tz1 = ty1;
+					if (!cgrid_clip_slab(start[2], delta[2], (k.z * dCs) - dReach, ((k.z + 1) * dCs) + dReach, &tz0, &tz1))
+						continue;
+
+					self->nCellsVisited++;
+					if (nLayer == 0)
+					{
+						c = cgrid_static_find_cell(pStatic, &k);
+						if (c < 0)
+							continue;
+						pEntries = &pStatic->pEntries[pStatic->pStart[c]];
+						ppObjects = &pStatic->pObjects[pStatic->pStart[c]];
+						n = pStatic->pStart[c + 1] - pStatic->pStart[c];
+					}
+					else
+					{
+						pV = cgrid_get_cell(self, &k);
+						if (!pV)
+							continue;
+						pEntries = pV->pEntries;
+						ppObjects = pV->pContents->pData;
+						n = pV->pContents->nSize;
+					}
+
+					self->nCandidates += n;
+					for (i = 0; i < n; i++)
+					{
+						if (!(pEntries[i].nCategory & nMask))
+							continue;
+						t = cgrid_sweep_entry(start, delta, dRadius, &pEntries[i]);
+						if (t < 0.0)
+							continue;
+						self->nHits++;
+						if (nKeys == nKeyAlloc)
+						{
+							tmp = realloc(pKeys, (nKeyAlloc + 64) * sizeof(sortkey));
+							if (!tmp)
+								goto nomem;
+							pKeys = (sortkey*)tmp;
+							nKeyAlloc += 64;
+						}
+						if (!obarr_append(pHits, ppObjects[i]))
+							goto nomem;
+						pKeys[nKeys].d = t;
+						pKeys[nKeys].i = nKeys;
+						nKeys++;
+					}
+				}
+			}
+		}
+	}
+
+	qsort(pKeys, nKeys, sizeof(sortkey), compare_doubles);
+	rv = PyList_New(nKeys);
+	if (!rv)
+		goto done;
+	for (i = 0; i < nKeys; i++)
+		PyList_SET_ITEM(rv, i, Py_BuildValue("(Od)", obarr_get_element(pHits, pKeys[i].i), pKeys[i].d));
+	goto done;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+done:
+	if (pKeys)
+		free(pKeys);
+	Py_DECREF(pHits);
+	return rv;
+}
+
+/* writes the static layer and any vector arrays to a snapshot file */
+PyObject* Cgrid_save(PyObject *self_in, PyObject *args)
+{
+	CgridObject* self = (CgridObject*)self_in;
+	PyObject* arrays = NULL;
+	const char* path;
+
+    if (!PyArg_ParseTuple(args, "s|O", &path, &arrays))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_static_save(self, path, arrays))
+		return NULL;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* replaces the static layer with a memory-mapped snapshot and returns the */
+/* list of vector arrays saved with it */
+PyObject* Cgrid_load(PyObject *self_in, PyObject *args)
+{
+	CgridObject* self = (CgridObject*)self_in;
+	CgridStatic* pStatic;
+	PyObject* objects = NULL;
+	PyObject* pArrays = NULL;
+	const char* path;
+	clock_t tStart;
+
+    if (!PyArg_ParseTuple(args, "s|O", &path, &objects))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	tStart = clock();
+	pStatic = cgrid_static_load(self, path, objects, &pArrays);
+	if (!pStatic)
+		return NULL;
+	pStatic->dBuildTime = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+	cgrid_static_free(self->pStatic);
+	self->pStatic = pStatic;
+	self->nVersion++;
+	if (!cgrid_log_move(self, NULL, NULL, NULL))
+	{
+		Py_DECREF(pArrays);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return pArrays;
+}
+
+/* rebuilds the neighbour lists if they are stale, returns True if it did */
+PyObject* Cgrid_build_neighbor_lists(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridNeighbors *pNbrs;
+	double dCutoff, dSkin;
+
+    if (!PyArg_ParseTuple(args, "dd", &dCutoff, &dSkin))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (dCutoff < 0.0 || dSkin < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "cutoff and skin must not be negative");
+		return NULL;
+	}
+
+	if (!cgrid_neighbors_stale(self, dCutoff, dSkin))
+	{
+		Py_INCREF(Py_False);
+		return Py_False;
+	}
+	pNbrs = cgrid_neighbors_build(self, dCutoff, dSkin);
+	if (!pNbrs)
+		return NULL;
+	if (self->pNbrs)
+		pNbrs->nBuilds = self->pNbrs->nBuilds;
+	pNbrs->nBuilds++;
+	cgrid_neighbors_free(self->pNbrs);
+	self->pNbrs = pNbrs;
+
+	Py_INCREF(Py_True);
+	return Py_True;
+}
+
+/* returns the neighbour list of an object, or of an index into neighbor_objects() */
+PyObject* Cgrid_neighbors(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridNeighbors *pNbrs = self->pNbrs;
+	PyObject *other;
+	ObarrObject *rv;
+	CgridInfo *pV;
+	long i, j, n;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!pNbrs)
+	{
+		PyErr_SetString(PyExc_ValueError, "neighbour lists have not been built");
+		return NULL;
+	}
+
+	n = -1;
+	if (PyInt_Check(other))
+	{
+		n = PyInt_AsLong(other);
+		if (n < 0 || n >= pNbrs->nMembers)
+		{
+			PyErr_SetString(PyExc_IndexError, "index not in range");
+			return NULL;
+		}
+	}
+	else
+	{
+		pV = cgrid_find_member(self, other, NULL, &i);
+		if (pV)
+			n = pV->pEntries[i].nNbr;
+		else
+		{
+			/* not a dynamic member, look through the static part of the snapshot */
+			PyErr_Clear();
+			for (i = 0; i < pNbrs->nStatic; i++)
+			{
+				if (pNbrs->pObjects[i] == other)
+				{
+					n = i;
+					break;
+				}
+			}
+		}
+		if (n < 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "supplied argument not found in neighbour lists");
+			return NULL;
+		}
+	}
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, pNbrs->pStart[n + 1] - pNbrs->pStart[n]))
+	{
+		Py_DECREF(rv);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	for (j = pNbrs->pStart[n]; j < pNbrs->pStart[n + 1]; j++)
+		obarr_set_element(rv, j - pNbrs->pStart[n], pNbrs->pObjects[pNbrs->pIndex[j]]);
+	return (PyObject*)rv;
+}
+
+PyObject* Cgrid_neighbor_objects(PyObject *self_in, PyObject *unused)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridNeighbors *pNbrs = self->pNbrs;
+	ObarrObject *rv;
+	long i;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!pNbrs)
+		return (PyObject*)rv;
+	if (!obarr_set_size(rv, pNbrs->nMembers))
+	{
+		Py_DECREF(rv);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	for (i = 0; i < pNbrs->nMembers; i++)
+		obarr_set_element(rv, i, pNbrs->pObjects[i]);
+	return (PyObject*)rv;
+}
+
+/* returns the overlapping pairs of bounding spheres as a flat array */
+/* (a0, b0, a1, b1, ...), each pair involving at least one dynamic member */
+PyObject* Cgrid_find_pairs(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	ObarrObject *rv;
+	unsigned int nMask = CGRID_ALL_LAYERS;
+
+    if (!PyArg_ParseTuple(args, "|I", &nMask))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!cgrid_find_pairs(self, nMask, rv))
+	{
+		Py_DECREF(rv);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+/* reports the occupancy of both layers and the query counters, which are */
+/* cleared afterwards if reset is true.  histogram[n] is the number of */
+/* cells holding n members.  The cell lookup cost is given as the depth of */
+/* the dynamic layer's tree and the step count of the static binary search. */
+PyObject* Cgrid_stats(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridStatic *pStatic = self->pStatic;
+	PyObject *pHist, *rv;
+	rb_red_blk_node *pNode;
+	CgridInfo *pV;
+	long *pCounts;
+	long nCells, nMembers, nMax, nDepthSum, nDepthMax, nSearch, nStaticBytes, n, i;
+	int bReset = 0;
+
+    if (!PyArg_ParseTuple(args, "|i", &bReset))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	nCells = self->nCells;
+	nMembers = self->nSize;
+	nMax = 0;
+	for (pNode = cgrid_first_node(self); pNode != self->pTree->nil; pNode = TreeSuccessor(self->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		if (pV->pContents->nSize > nMax)
+			nMax = pV->pContents->nSize;
+	}
+	nSearch = 0;
+	nStaticBytes = 0;
+	if (pStatic)
+	{
+		nStaticBytes = (pStatic->nCells * (sizeof(CgridKey) + sizeof(long))) + sizeof(long) +
+			(pStatic->nMembers * (sizeof(CgridEntry) + sizeof(PyObject*) + sizeof(long)));
+		nCells += pStatic->nCells;
+		nMembers += pStatic->nMembers;
+		for (i = 0; i < pStatic->nCells; i++)
+		{
+			if (pStatic->pStart[i + 1] - pStatic->pStart[i] > nMax)
+				nMax = pStatic->pStart[i + 1] - pStatic->pStart[i];
+		}
+		for (n = pStatic->nCells; n > 0; n /= 2)
+			nSearch++;
+	}
+
+	pCounts = (long*)calloc(nMax + 1, sizeof(long));
+	if (!pCounts)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	for (pNode = cgrid_first_node(self); pNode != self->pTree->nil; pNode = TreeSuccessor(self->pTree, pNode))
+		pCounts[((CgridInfo*)pNode->info)->pContents->nSize]++;
+	if (pStatic)
+	{
+		for (i = 0; i < pStatic->nCells; i++)
+			pCounts[pStatic->pStart[i + 1] - pStatic->pStart[i]]++;
+	}
+	pHist = PyList_New(nMax + 1);
+	if (!pHist)
+	{
+		free(pCounts);
+		return NULL;
+	}
+	for (i = 0; i <= nMax; i++)
+		PyList_SET_ITEM(pHist, i, PyInt_FromLong(pCounts[i]));
+	free(pCounts);
+
+	nDepthSum = 0;
+	nDepthMax = 0;
+	cgrid_tree_depths(self->pTree, self->pTree->root->left, 1, &nDepthSum, &nDepthMax);
+
+	rv = Py_BuildValue("{s:l,s:l,s:l,s:l,s:l,s:d,s:N,s:l,s:d,s:l,s:l,s:l,s:l,s:d,s:d,s:d,s:l,s:l}",
+		"cells", nCells,
+		"members", nMembers,
+		"static_cells", pStatic ? pStatic->nCells : 0,
+		"static_members", pStatic ? pStatic->nMembers : 0,
+		"static_bytes", nStaticBytes,
+		"static_build_time", pStatic ? pStatic->dBuildTime : 0.0,
+		"histogram", pHist,
+		"max_per_cell", nMax,
+		"mean_per_cell", nCells ? (double)nMembers / nCells : 0.0,
+		"queries", self->nQueries,
+		"cells_visited", self->nCellsVisited,
+		"candidates", self->nCandidates,
+		"hits", self->nHits,
+		"cells_per_query", self->nQueries ? (double)self->nCellsVisited / self->nQueries : 0.0,
+		"hit_ratio", self->nCandidates ? (double)self->nHits / self->nCandidates : 0.0,
+		"mean_tree_depth", self->nCells ? (double)nDepthSum / self->nCells : 0.0,
+		"max_tree_depth", nDepthMax,
+		"static_search_steps", nSearch);
+
+	if (rv && bReset)
+	{
+		self->nQueries = 0;
+		self->nCellsVisited = 0;
+		self->nCandidates = 0;
+		self->nHits = 0;
+	}
+	return rv;
+}
+
+/* recommends a cell size from the current distribution: the size that */
+/* would bring the mean occupancy of the occupied cells to the target */
+/* (default 2) if members are spread evenly in 3d, but no smaller than the */
+/* mean member diameter */
+PyObject* Cgrid_suggest_cell_size(PyObject *self_in, PyObject *args)
+{
+	CgridObject *self = (CgridObject*)self_in;
+	CgridStatic *pStatic = self->pStatic;
+	rb_red_blk_node *pNode;
+	CgridInfo *pV;
+	double dTarget = 2.0;
+	double dRadiusSum, dSize;
+	long nCells, nMembers, i;
+
+    if (!PyArg_ParseTuple(args, "|d", &dTarget))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (dTarget <= 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "target occupancy must be positive");
+		return NULL;
+	}
+
+	nCells = self->nCells;
+	nMembers = self->nSize;
+	dRadiusSum = 0.0;
+	for (pNode = cgrid_first_node(self); pNode != self->pTree->nil; pNode = TreeSuccessor(self->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		for (i = 0; i < pV->pContents->nSize; i++)
+			dRadiusSum += pV->pEntries[i].dRadius;
+	}
+	if (pStatic)
+	{
+		nCells += pStatic->nCells;
+		nMembers += pStatic->nMembers;
+		for (i = 0; i < pStatic->nMembers; i++)
+			dRadiusSum += pStatic->pEntries[i].dRadius;
+	}
+	if (nMembers == 0)
+		return PyFloat_FromDouble(self->dCellSize);
+
+	dSize = self->dCellSize * pow(dTarget * nCells / nMembers, 1.0 / 3.0);
+	if (dSize < 2.0 * dRadiusSum / nMembers)
+		dSize = 2.0 * dRadiusSum / nMembers;
+	return PyFloat_FromDouble(dSize);
+}
 
 
 
@@ -502,9 +2245,22 @@ PySequenceMethods Cgrid_as_seq[] = {
 };
 
 PyMethodDef Cgrid_methods[] = {
-	{"insert", (PyCFunction)Cgrid_insert, METH_VARARGS, "allocate the array to a new size"},
+	{"insert", (PyCFunction)Cgrid_insert, METH_VARARGS, "insert an object into a grid cell (taken from its position if not given)"},
 	{"delete", (PyCFunction)Cgrid_delete, METH_VARARGS, "remove a grid cell"},
 	{"remove", (PyCFunction)Cgrid_remove, METH_VARARGS, "remove an object from its grid cell"},
+	{"update", (PyCFunction)Cgrid_update, METH_VARARGS, "refresh an object's cached position, moving it between cells if needed"},
+	{"freeze", (PyCFunction)Cgrid_freeze, METH_VARARGS, "build the read-only static layer from a sequence of objects"},
+	{"thaw", (PyCFunction)Cgrid_thaw, METH_NOARGS, "discard the static layer"},
+	{"save", (PyCFunction)Cgrid_save, METH_VARARGS, "write the static layer and a sequence of vector arrays to a snapshot file"},
+	{"load", (PyCFunction)Cgrid_load, METH_VARARGS, "map a snapshot file as the static layer, returning its vector arrays"},
+	{"get_radius", (PyCFunction)Cgrid_get_radius, METH_VARARGS, "find all objects of both layers within a radius of an object or vect, optionally filtered by a category mask"},
+	{"sphere_cast", (PyCFunction)Cgrid_sphere_cast, METH_VARARGS, "sweep a sphere from start to end, returning (object, toi) hits in order, optionally filtered by a category mask"},
+	{"build_neighbor_lists", (PyCFunction)Cgrid_build_neighbor_lists, METH_VARARGS, "rebuild the Verlet neighbour lists (cutoff, skin) if any object moved more than skin/2"},
+	{"neighbors", (PyCFunction)Cgrid_neighbors, METH_VARARGS, "get the objects within cutoff + skin of an object at the last neighbour list build"},
+	{"neighbor_objects", (PyCFunction)Cgrid_neighbor_objects, METH_NOARGS, "get the objects of the neighbour lists in index order"},
+	{"find_pairs", (PyCFunction)Cgrid_find_pairs, METH_VARARGS, "get the overlapping pairs involving a dynamic member as a flat array, optionally filtered by a category mask"},
+	{"stats", (PyCFunction)Cgrid_stats, METH_VARARGS, "get occupancy and query statistics as a dict, optionally resetting the query counters"},
+	{"suggest_cell_size", (PyCFunction)Cgrid_suggest_cell_size, METH_VARARGS, "recommend a cell size for a target mean occupancy of the occupied cells"},
 	{NULL}
 };
 
@@ -538,7 +2294,7 @@ PyTypeObject CgridObjectType = {
 	0,				/* tp_setattro    */
 	0,				/* tp_as_buffer   */
 	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
-	"Vector objects are simple.",	/* tp_doc         */
+	"Collision grid of objects, with a frozen static layer and a dynamic layer.",	/* tp_doc         */
 	0,				/* tp_traverse       */
 	0,				/* tp_clear          */
 	0,				/* tp_richcompare    */
@@ -1,3 +1,6 @@
+#ifndef CGRID_H_INCLUDED
+#define CGRID_H_INCLUDED
+
 #include <Python.h>
 #include <structmember.h>
 
@@ -8,40 +11,115 @@ typedef int Py_ssize_t;
 #endif
 
 typedef struct rb_red_blk_tree rb_red_blk_tree;
+typedef struct rb_red_blk_node rb_red_blk_node;
 typedef struct ObarrObject ObarrObject;
 
+typedef struct CgridKey {
+	long x;
+	long y;
+	long z;
+} CgridKey;
+
+/* cached bounding sphere and collision layer of a grid member, read from */
+/* its 'pos', 'radius', 'category' and 'mask' attributes when it is */
+/* inserted or updated.  Missing layer bits default to all set. */
+typedef struct CgridEntry {
+	double pos[3];
+	double dRadius;
+	long nNbr;		/* index in the neighbour lists, -1 if not in them */
+	unsigned int nCategory;
+	unsigned int nMask;
+} CgridEntry;
+
+#define CGRID_ALL_LAYERS 0xFFFFFFFFu
+
+/* static layer: built once by freeze() into flat arrays sorted by cell key */
+/* and read-only afterwards.  The members of cell pKeys[i] are stored at */
+/* pStart[i] up to (but not including) pStart[i + 1].  pOrder[i] is the */
+/* index of member i in the frozen sequence.  A layer loaded from a */
+/* snapshot points into the mapping pMap instead of owning its arrays, */
+/* all but pEntries, which is always its own. */
+typedef struct CgridStatic {
+	long				nCells;
+	long				nMembers;
+	CgridKey*			pKeys;
+	long*				pStart;
+	CgridEntry*			pEntries;
+	PyObject**			pObjects;
+	long*				pOrder;
+	double				dMaxRadius;
+	void*				pMap;
+	long				nMapSize;
+	double				dBuildTime;		/* seconds taken by freeze() or load() */
+} CgridStatic;
+
+/* Verlet neighbour lists in CSR form over a snapshot of both layers.  The */
+/* neighbours of pObjects[i] are pObjects[pIndex[j]] for j from pStart[i] up */
+/* to pStart[i + 1], every pair closer than cutoff + skin at build time. */
+typedef struct CgridNeighbors {
+	double				dCutoff;
+	double				dSkin;
+	long				nVersion;
+	long				nMembers;
+	long				nStatic;
+	PyObject**			pObjects;
+	double*				pPos;
+	long*				pStart;
+	long*				pIndex;
+	long				nBuilds;
+} CgridNeighbors;
+
+/* a cell crossing, logged while an aoi is attached to the grid.  bOld is 0 */
+/* for an insert, bNew is 0 for a removal, and pObj is NULL when the static */
+/* layer was replaced. */
+typedef struct CgridMove {
+	PyObject*			pObj;
+	CgridKey			kOld;
+	CgridKey			kNew;
+	int					bOld;
+	int					bNew;
+} CgridMove;
+
 typedef struct CgridObject {
 	PyObject_HEAD
 	rb_red_blk_tree*	pTree;
 	long				nSize;
 	long				nCells;
 	double				dCellSize;
+	double				dMaxRadius;
 	ObarrObject*		pUnrolled;
 	int					bUnrollDirty;
+	CgridStatic*		pStatic;
+	CgridNeighbors*		pNbrs;
+	long				nVersion;
+	CgridMove*			pMoves;
+	long				nMoves;
+	long				nMoveAlloc;
+	int					bLogMoves;
+	long				nQueries;
+	long				nCellsVisited;
+	long				nCandidates;
+	long				nHits;
 } CgridObject;
 
-staticforward PyTypeObject CgridObjectType;
-
 #define Cgrid_Check(op) PyObject_TypeCheck(op, &CgridObjectType)
 #define COPY_KEY(a, b) (b)->x = (a)->x; (b)->y = (a)->y; (b)->z = (a)->z;
 
-typedef struct CgridKey {
-	long x;
-	long y;
-	long z;
-} CgridKey;
+/* dynamic layer cell, stored as the info of a red-black tree node. */
+/* pEntries[i] is the cached sphere of pContents[i]. */
 typedef struct CgridInfo {
 	CgridObject* pSelf;
 	CgridKey k;
 	ObarrObject* pContents;
-	
+	CgridEntry* pEntries;
+	long nEntryAlloc;
 } CgridInfo;
 
 #define SQR(x) ((x) * (x))
 
 /* internal functions */
 void cgrid_unroll(CgridObject* self);
-int cgrid_compare(const void* a, const void* b); 
+int cgrid_compare(const void* a, const void* b);
 CgridKey* cgrid_newkey();
 CgridInfo* cgrid_newinfo();
 void cgrid_destroykey(void* a);
@@ -49,8 +127,32 @@ void cgrid_destroyinfo(void* a);
 void cgrid_printkey(const void* a);
 void cgrid_printinfo(void* a);
 long cgrid_coord_to_gridcoord(CgridObject* self, double coord);
-ObarrObject* cgrid_get_radius(CgridObject* self, PyObject* other, double dRadius);
-void cgrid_get_radius_append(CgridObject* self, PyObject* other, double dRadius, ObarrObject* pNeighbors);
+void cgrid_pos_to_key(CgridObject* self, double* pos, CgridKey* k);
+int cgrid_read_pos(PyObject* other, double* pos);
+int cgrid_read_entry(PyObject* other, CgridEntry* pEntry);
+int cgrid_info_append(CgridInfo* pV, PyObject* other, CgridEntry* pEntry);
+void cgrid_info_del_index(CgridInfo* pV, long i);
+CgridInfo* cgrid_find_member(CgridObject* self, PyObject* other, rb_red_blk_node** ppNode, long* pIndex);
+CgridInfo* cgrid_get_cell(CgridObject* self, CgridKey* k);
+long cgrid_static_find_cell(CgridStatic* pStatic, CgridKey* k);
+void cgrid_static_free(CgridStatic* pStatic);
+CgridStatic* cgrid_static_build(CgridObject* self, PyObject* seq);
+int cgrid_static_save(CgridObject* self, const char* path, PyObject* arrays);
+CgridStatic* cgrid_static_load(CgridObject* self, const char* path, PyObject* objects, PyObject** ppArrays);
+ObarrObject* cgrid_get_radius(CgridObject* self, PyObject* other, double dRadius, unsigned int nMask);
+int cgrid_get_radius_append(CgridObject* self, double* pos, double dRadius, unsigned int nMask, ObarrObject* pNeighbors);
+rb_red_blk_node* cgrid_first_node(CgridObject* self);
+int cgrid_log_move(CgridObject* self, PyObject* other, CgridKey* pOld, CgridKey* pNew);
+void cgrid_clear_moves(CgridObject* self);
+int cgrid_pairs_add(long** ppPairs, long* pnPairs, long* pnAlloc, long i, long j);
+void cgrid_neighbors_free(CgridNeighbors* pNbrs);
+int cgrid_neighbors_stale(CgridObject* self, double dCutoff, double dSkin);
+CgridNeighbors* cgrid_neighbors_build(CgridObject* self, double dCutoff, double dSkin);
+int cgrid_clip_slab(double s, double d, double lo, double hi, double* t0, double* t1);
+double cgrid_sweep_entry(double* start, double* delta, double dRadius, CgridEntry* pE);
+int cgrid_read_layer(PyObject* other, const char* name, unsigned int* pnBits);
+int cgrid_find_pairs(CgridObject* self, unsigned int nMask, ObarrObject* pOut);
+void cgrid_tree_depths(rb_red_blk_tree* pTree, rb_red_blk_node* x, long nDepth, long* pnSum, long* pnMax);
 
 /* exported API functions */
 int Cgrid_init(CgridObject *self, PyObject *args, PyObject *kwds);
@@ -62,10 +164,24 @@ PyObject* Cgrid_repr(PyObject *self_in);
 PyObject* Cgrid_insert(PyObject *self_in, PyObject *args);
 PyObject* Cgrid_delete(PyObject *self_in, PyObject *args);
 PyObject* Cgrid_remove(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_update(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_freeze(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_thaw(PyObject *self_in, PyObject *unused);
+PyObject* Cgrid_save(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_load(PyObject *self_in, PyObject *args);
 PyObject* Cgrid_get_radius(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_sphere_cast(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_build_neighbor_lists(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_neighbors(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_neighbor_objects(PyObject *self_in, PyObject *unused);
+PyObject* Cgrid_find_pairs(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_stats(PyObject *self_in, PyObject *args);
+PyObject* Cgrid_suggest_cell_size(PyObject *self_in, PyObject *args);
 /*PyObject* Cgrid_remove(PyObject *self_in, PyObject *args);*/
 
 extern PySequenceMethods Cgrid_as_seq[];
 extern PyMethodDef Cgrid_methods[];
 extern struct PyMemberDef Cgrid_members[];
-extern PyTypeObject CgridObjectType;
\ No newline at end of file
+extern PyTypeObject CgridObjectType;
+
+#endif
@@ -0,0 +1,453 @@
+#include "clip.h"
+#include "obarr.h"
+#include "vect.h"
+#include "quat.h"
+#include <math.h>
+#include <string.h>
+
+#define CLIP_SCAN 4		/* keys stepped forward from the cache before bisecting */
+
+void clip_clear(ClipObject* self)
+{
+	if (self->pTracks)
+		free(self->pTracks);
+	if (self->pTimes)
+		free(self->pTimes);
+	if (self->pRot)
+		free(self->pRot);
+	if (self->pPos)
+		free(self->pPos);
+	self->pTracks = NULL;
+	self->pTimes = NULL;
+	self->pRot = NULL;
+	self->pPos = NULL;
+	self->nTracks = 0;
+	self->nTrackAlloc = 0;
+	self->nKeys = 0;
+	self->nKeyAlloc = 0;
+}
+
+/* room for nTracks tracks and nKeys keys in all */
+int clip_reserve(ClipObject* self, long nTracks, long nKeys)
+{
+	ClipTrack* pTracks;
+	double *pTimes, *pRot, *pPos;
+	long n;
+
+	if (nTracks > self->nTrackAlloc)
+	{
+		n = (self->nTrackAlloc * 2 > nTracks) ? self->nTrackAlloc * 2 : nTracks;
+		pTracks = (ClipTrack*)realloc(self->pTracks, n * sizeof(ClipTrack));
+		if (!pTracks)
+			goto nomem;
+		self->pTracks = pTracks;
+		self->nTrackAlloc = n;
+	}
+	if (nKeys > self->nKeyAlloc)
+	{
+		n = (self->nKeyAlloc * 2 > nKeys) ? self->nKeyAlloc * 2 : nKeys;
+		pTimes = (double*)realloc(self->pTimes, n * sizeof(double));
+		if (pTimes)
+			self->pTimes = pTimes;
+		pRot = (double*)realloc(self->pRot, n * 4 * sizeof(double));
+		if (pRot)
+			self->pRot = pRot;
+		pPos = (double*)realloc(self->pPos, n * 3 * sizeof(double));
+		if (pPos)
+			self->pPos = pPos;
+		if (!pTimes || !pRot || !pPos)
+			goto nomem;
+		self->nKeyAlloc = n;
+	}
+	return 1;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+	return 0;
+}
+
+/* a looping clip repeats over its duration */
+double clip_wrap(ClipObject* self, double t)
+{
+	if (!self->bLoop || self->dDuration <= 0.0)
+		return t;
+	t = fmod(t, self->dDuration);
+	if (t < 0.0)
+		t += self->dDuration;
+	return t;
+}
+
+/* the last key of the track at or before t, or 0 before the first.  A */
+/* short forward scan from the previous result covers normal playback; */
+/* anything else is bisected. */
+long clip_find_key(ClipObject* self, ClipTrack* pTrack, double t)
+{
+	double* pTimes = self->pTimes + pTrack->nFirst;
+	long n = pTrack->nKeys, k = pTrack->nLast, lo, hi, mid;
+	int i;
+
+	if (t <= pTimes[0])
+		return pTrack->nLast = 0;
+	if (k >= 0 && k < n && pTimes[k] <= t)
+	{
+		for (i = 0; i < CLIP_SCAN; i++)
+		{
+			if (k + 1 >= n || pTimes[k + 1] > t)
+				return pTrack->nLast = k;
+			k++;
+		}
+	}
+	lo = 0;
+	hi = n - 1;
+	while (lo < hi)
+	{
+		mid = (lo + hi + 1) / 2;
+		if (pTimes[mid] <= t)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return pTrack->nLast = lo;
+}
+
+/* the rotation and translation of a track at t, slerping and lerping */
+/* between the keys either side and holding the end keys outside them */
+void clip_sample_track(ClipObject* self, long nTrack, double t, double* q, double* p)
+{
+	ClipTrack* pTrack = &self->pTracks[nTrack];
+	double *t0, *q0, *p0;
+	double amt;
+	long k;
+	int i;
+
+	k = clip_find_key(self, pTrack, t);
+	t0 = self->pTimes + pTrack->nFirst + k;
+	q0 = self->pRot + ((pTrack->nFirst + k) * 4);
+	p0 = self->pPos + ((pTrack->nFirst + k) * 3);
+	if (k + 1 >= pTrack->nKeys || t <= t0[0] || t0[1] <= t0[0])
+	{
+		memcpy(q, q0, 4 * sizeof(double));
+		memcpy(p, p0, 3 * sizeof(double));
+		return;
+	}
+	amt = (t - t0[0]) / (t0[1] - t0[0]);
+	quat_slerp_internal(q0, q0 + 4, amt, q);
+	for (i = 0; i < 3; i++)
+		p[i] = p0[i] + ((p0[3 + i] - p0[i]) * amt);
+}
+
+/* the pose to write: a (rotations, translations) pair from an earlier */
+/* sample to fill in place, or new arrays when pOut is NULL or None */
+int clip_prepare_out(PyObject* pOut, long nTracks, ObarrObject** ppRot, ObarrObject** ppPos)
+{
+	ObarrObject *pRot, *pPos;
+	PyObject *pItem;
+	long i;
+
+	if (pOut && pOut != Py_None)
+	{
+		if (!PyArg_Parse(pOut, "(O!O!)", &ObarrObjectType, &pRot, &ObarrObjectType, &pPos) ||
+			pRot->nSize != nTracks || pPos->nSize != nTracks)
+		{
+			PyErr_SetString(PyExc_TypeError, "out must be a (rotations, translations) pose of the same clip shape");
+			return 0;
+		}
+		for (i = 0; i < nTracks; i++)
+		{
+			if (!Quat_Check(pRot->pData[i]) || !Vect_Check(pPos->pData[i]))
+			{
+				PyErr_SetString(PyExc_TypeError, "out must hold quats and vects");
+				return 0;
+			}
+		}
+		Py_INCREF(pRot);
+		Py_INCREF(pPos);
+		*ppRot = pRot;
+		*ppPos = pPos;
+		return 1;
+	}
+
+	pRot = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pRot, NULL, NULL);
+	pPos = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pPos, NULL, NULL);
+	if (!obarr_set_size(pRot, nTracks) || !obarr_set_size(pPos, nTracks))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	for (i = 0; i < nTracks; i++)
+	{
+		pItem = (PyObject*)PyObject_New(QuatObject, &QuatObjectType);
+		if (!pItem)
+			goto error;
+		obarr_set_element(pRot, i, pItem);
+		Py_DECREF(pItem);
+		pItem = (PyObject*)PyObject_New(VectObject, &VectObjectType);
+		if (!pItem)
+			goto error;
+		obarr_set_element(pPos, i, pItem);
+		Py_DECREF(pItem);
+	}
+	*ppRot = pRot;
+	*ppPos = pPos;
+	return 1;
+
+error:
+	Py_DECREF(pRot);
+	Py_DECREF(pPos);
+	return 0;
+}
+
+
+int Clip_init(ClipObject *self, PyObject *args, PyObject *kwds)
+{
+	double dDuration;
+	int bLoop = 0;
+
+    if (!PyArg_ParseTuple(args, "d|i", &dDuration, &bLoop))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	clip_clear(self);
+	self->dDuration = dDuration;
+	self->bLoop = bLoop;
+	return 0;
+}
+
+void Clip_dealloc(PyObject* self_in)
+{
+	clip_clear((ClipObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Clip_repr(PyObject *self_in)
+{
+	ClipObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Clip_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (ClipObject*)self_in;
+	tuple = Py_BuildValue("(ll)", self->nTracks, self->nKeys);
+	fmtstring = PyString_FromString("<clip of %d tracks, %d keys>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Clip_len(PyObject *self_in)
+{
+	ClipObject *self = (ClipObject*)self_in;
+
+	return self->nTracks;
+}
+
+/* add_track(times, rotations[, translations]) appends a bone's keys, */
+/* returning its track number.  Times must not decrease; missing */
+/* translations are zero. */
+PyObject* Clip_add_track(PyObject *self_in, PyObject *args)
+{
+	ClipObject *self = (ClipObject*)self_in;
+	PyObject *pTimes, *pRots, *pPoss = NULL, *pItem;
+	PyObject *pFastT = NULL, *pFastR = NULL, *pFastP = NULL;
+	ClipTrack *pTrack;
+	double t;
+	long n, i, j;
+
+    if (!PyArg_ParseTuple(args, "OO|O", &pTimes, &pRots, &pPoss))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!(pFastT = PySequence_Fast(pTimes, "times must be a sequence of floats")) ||
+		!(pFastR = PySequence_Fast(pRots, "rotations must be a sequence of quats")) ||
+		(pPoss && pPoss != Py_None && !(pFastP = PySequence_Fast(pPoss, "translations must be a sequence of vects"))))
+		goto error;
+	n = PySequence_Fast_GET_SIZE(pFastT);
+	if (n < 1 || PySequence_Fast_GET_SIZE(pFastR) != n || (pFastP && PySequence_Fast_GET_SIZE(pFastP) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "a track needs one rotation (and translation) per key time, and at least one key");
+		goto error;
+	}
+	if (!clip_reserve(self, self->nTracks + 1, self->nKeys + n))
+		goto error;
+
+	for (i = 0; i < n; i++)
+	{
+		j = self->nKeys + i;
+		t = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pFastT, i));
+		if (t == -1.0 && PyErr_Occurred())
+			goto error;
+		if (i > 0 && t < self->pTimes[j - 1])
+		{
+			PyErr_SetString(PyExc_ValueError, "key times must not decrease");
+			goto error;
+		}
+		self->pTimes[j] = t;
+		pItem = PySequence_Fast_GET_ITEM(pFastR, i);
+		if (!Quat_Check(pItem))
+		{
+			PyErr_SetString(PyExc_TypeError, "rotations must be a sequence of quats");
+			goto error;
+		}
+		memcpy(&self->pRot[j * 4], ((QuatObject*)pItem)->elements, 4 * sizeof(double));
+		memset(&self->pPos[j * 3], 0, 3 * sizeof(double));
+		if (pFastP)
+		{
+			pItem = PySequence_Fast_GET_ITEM(pFastP, i);
+			if (!Vect_Check(pItem))
+			{
+				PyErr_SetString(PyExc_TypeError, "translations must be a sequence of vects");
+				goto error;
+			}
+			memcpy(&self->pPos[j * 3], ((VectObject*)pItem)->elements, 3 * sizeof(double));
+		}
+	}
+
+	pTrack = &self->pTracks[self->nTracks];
+	pTrack->nFirst = self->nKeys;
+	pTrack->nKeys = n;
+	pTrack->nLast = 0;
+	self->nKeys += n;
+	Py_DECREF(pFastT);
+	Py_DECREF(pFastR);
+	Py_XDECREF(pFastP);
+	return PyInt_FromLong(self->nTracks++);
+
+error:
+	Py_XDECREF(pFastT);
+	Py_XDECREF(pFastR);
+	Py_XDECREF(pFastP);
+	return NULL;
+}
+
+PyObject* Clip_get_duration(PyObject *self_in, PyObject *args)
+{
+	ClipObject *self = (ClipObject*)self_in;
+
+	return PyFloat_FromDouble(self->dDuration);
+}
+
+/* sample(t[, other, other_t, weight[, out]]) returns the pose of every */
+/* track at t as (rotations, translations).  With other, each track is */
+/* blended toward the same track of the other clip at other_t by weight. */
+/* Passing a previous pose as out refills its quats and vects in place. */
+PyObject* Clip_sample(PyObject *self_in, PyObject *args)
+{
+	ClipObject *self = (ClipObject*)self_in;
+	ClipObject *other = NULL;
+	PyObject *pOther = NULL, *pOut = NULL;
+	ObarrObject *pRot, *pPos;
+	double t, t2 = 0.0, dWeight = 0.0;
+	double q[4], p[3], q2[4], p2[3];
+	double *rq, *rp;
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "d|OddO", &t, &pOther, &t2, &dWeight, &pOut))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (pOther && pOther != Py_None)
+	{
+		if (!Clip_Check(pOther) || ((ClipObject*)pOther)->nTracks != self->nTracks)
+		{
+			PyErr_SetString(PyExc_TypeError, "blend source must be a clip with as many tracks");
+			return NULL;
+		}
+		other = (ClipObject*)pOther;
+	}
+	if (!clip_prepare_out(pOut, self->nTracks, &pRot, &pPos))
+		return NULL;
+
+	t = clip_wrap(self, t);
+	if (other)
+		t2 = clip_wrap(other, t2);
+	for (i = 0; i < self->nTracks; i++)
+	{
+		rq = ((QuatObject*)pRot->pData[i])->elements;
+		rp = ((VectObject*)pPos->pData[i])->elements;
+		clip_sample_track(self, i, t, q, p);
+		if (!other)
+		{
+			memcpy(rq, q, sizeof(q));
+			memcpy(rp, p, sizeof(p));
+			continue;
+		}
+		clip_sample_track(other, i, t2, q2, p2);
+		quat_slerp_internal(q, q2, dWeight, rq);
+		for (k = 0; k < 3; k++)
+			rp[k] = p[k] + ((p2[k] - p[k]) * dWeight);
+	}
+	return Py_BuildValue("(NN)", pRot, pPos);
+}
+
+
+
+PySequenceMethods Clip_as_seq[] = {
+	Clip_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Clip_methods[] = {
+	{"add_track", (PyCFunction)Clip_add_track, METH_VARARGS, "append a bone's keys (times, rotations[, translations]), returning the track number"},
+	{"get_duration", (PyCFunction)Clip_get_duration, METH_NOARGS, "length of the clip"},
+	{"sample", (PyCFunction)Clip_sample, METH_VARARGS, "pose of every track at t as (rotations, translations), optionally blended with another clip (t[, other, other_t, weight[, out]])"},
+	{NULL}
+};
+
+struct PyMemberDef Clip_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject ClipObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.clip",		/* tp_name        */
+	sizeof(ClipObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Clip_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Clip_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Clip_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Animation clip of per-bone rotation and translation keys.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Clip_methods,   /* tp_methods        */
+	Clip_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Clip_init,		/* tp_init           */
+};
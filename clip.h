@@ -0,0 +1,64 @@
+#ifndef CLIP_H_INCLUDED
+#define CLIP_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+/* one bone's keys: nKeys entries from nFirst in the clip's key arrays. */
+/* nLast is the key found by the previous sample, where the next search */
+/* starts since playback mostly moves forward. */
+typedef struct ClipTrack {
+	long			nFirst;
+	long			nKeys;
+	long			nLast;
+} ClipTrack;
+
+/* key times, rotations (x, y, z, w) and translations of every track, */
+/* each track's keys contiguous and in time order */
+typedef struct ClipObject {
+	PyObject_HEAD
+	double			dDuration;
+	int				bLoop;
+	ClipTrack*		pTracks;
+	long			nTracks;
+	long			nTrackAlloc;
+	double*			pTimes;
+	double*			pRot;
+	double*			pPos;
+	long			nKeys;
+	long			nKeyAlloc;
+} ClipObject;
+
+#define Clip_Check(op) PyObject_TypeCheck(op, &ClipObjectType)
+
+/* internal functions */
+void clip_clear(ClipObject* self);
+int clip_reserve(ClipObject* self, long nTracks, long nKeys);
+double clip_wrap(ClipObject* self, double t);
+long clip_find_key(ClipObject* self, ClipTrack* pTrack, double t);
+void clip_sample_track(ClipObject* self, long nTrack, double t, double* q, double* p);
+int clip_prepare_out(PyObject* pOut, long nTracks, ObarrObject** ppRot, ObarrObject** ppPos);
+
+/* exported API functions */
+int Clip_init(ClipObject *self, PyObject *args, PyObject *kwds);
+void Clip_dealloc(PyObject* self_in);
+PyObject* Clip_repr(PyObject *self_in);
+Py_ssize_t Clip_len(PyObject *self_in);
+PyObject* Clip_add_track(PyObject *self_in, PyObject *args);
+PyObject* Clip_get_duration(PyObject *self_in, PyObject *args);
+PyObject* Clip_sample(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Clip_as_seq[];
+extern PyMethodDef Clip_methods[];
+extern struct PyMemberDef Clip_members[];
+extern PyTypeObject ClipObjectType;
+
+#endif
@@ -1,19 +1,538 @@
 #include "collision.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include <string.h>
 
-double sizes[] = {100.0, 10000.0, 1000000.0}
+/* reads a box from explicit min and max vects, or else from the object's */
+/* position and radius */
+int collider_read_bounds(PyObject* other, PyObject* pMin, PyObject* pMax, double* min, double* max)
+{
+	CgridEntry e;
+	int i;
 
-PyObject* py3dutil_collide(PyObject* self_in, PyObject* args)
-{
-	ColliderObject* grid;
-    if (!PyArg_ParseTuple(args, "O!", &Collider))
-    	return NULL;
+	if (pMin)
+	{
+		if (!pMax || !cgrid_read_pos(pMin, min) || !cgrid_read_pos(pMax, max))
+		{
+			if (!PyErr_Occurred())
+				PyErr_SetString(PyExc_TypeError, "both min and max are required");
+			return 0;
+		}
+		for (i = 0; i < 3; i++)
+		{
+			if (min[i] > max[i])
+			{
+				PyErr_SetString(PyExc_ValueError, "box min is greater than its max");
+				return 0;
+			}
+		}
+		return 1;
+	}
 
-	
-	Collider_unroll(grid);
+	if (!cgrid_read_entry(other, &e))
+		return 0;
+	for (i = 0; i < 3; i++)
+	{
+		min[i] = e.pos[i] - e.dRadius;
+		max[i] = e.pos[i] + e.dRadius;
+	}
+	return 1;
 }
 
+/* takes a box from the free list, or appends one.  Its endpoints are added */
+/* at the end of each axis, where the next collide() sorts them into place. */
+long collider_new_box(ColliderObject* self)
+{
+	ColliderBox* pBox;
+	void* tmp;
+	long n, k;
 
+	if (self->nEndpoints + 2 > self->nEndpointAlloc)
+	{
+		n = self->nEndpointAlloc ? self->nEndpointAlloc * 2 : 64;
+		for (k = 0; k < 3; k++)
+		{
+			tmp = realloc(self->pAxes[k], n * sizeof(ColliderEndpoint));
+			if (!tmp)
+				return -1;
+			self->pAxes[k] = (ColliderEndpoint*)tmp;
+		}
+		self->nEndpointAlloc = n;
+	}
+	if (self->nFree >= 0)
+	{
+		n = self->nFree;
+		self->nFree = self->pBoxes[n].nNextFree;
+	}
+	else
+	{
+		if (self->nBoxes == self->nBoxAlloc)
+		{
+			tmp = realloc(self->pBoxes, (self->nBoxAlloc + 64) * sizeof(ColliderBox));
+			if (!tmp)
+				return -1;
+			self->pBoxes = (ColliderBox*)tmp;
+			self->nBoxAlloc += 64;
+		}
+		n = self->nBoxes++;
+	}
 
+	pBox = &self->pBoxes[n];
+	memset(pBox, 0, sizeof(ColliderBox));
+	pBox->nNextFree = -1;
+	for (k = 0; k < 3; k++)
+	{
+		pBox->nMin[k] = self->nEndpoints;
+		pBox->nMax[k] = self->nEndpoints + 1;
+		self->pAxes[k][self->nEndpoints].d = 0.0;
+		self->pAxes[k][self->nEndpoints].nRef = n * 2;
+		self->pAxes[k][self->nEndpoints + 1].d = 0.0;
+		self->pAxes[k][self->nEndpoints + 1].nRef = (n * 2) + 1;
+	}
+	self->nEndpoints += 2;
+	return n;
+}
+
+void collider_set_bounds(ColliderObject* self, long nBox, double* min, double* max)
+{
+	ColliderBox* pBox = &self->pBoxes[nBox];
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		pBox->min[k] = min[k];
+		pBox->max[k] = max[k];
+		self->pAxes[k][pBox->nMin[k]].d = min[k];
+		self->pAxes[k][pBox->nMax[k]].d = max[k];
+	}
+}
+
+int collider_overlap(ColliderBox* a, ColliderBox* b)
+{
+	return (a->min[0] <= b->max[0] && b->min[0] <= a->max[0] &&
+		a->min[1] <= b->max[1] && b->min[1] <= a->max[1] &&
+		a->min[2] <= b->max[2] && b->min[2] <= a->max[2]);
+}
+
+/* pairs are keyed by their two objects, lower address first */
+int collider_pair_begin(ColliderObject* self, ColliderBox* a, ColliderBox* b)
+{
+	PyObject* pA = a->pObj < b->pObj ? a->pObj : b->pObj;
+	PyObject* pB = a->pObj < b->pObj ? b->pObj : a->pObj;
+
+	if (ptrmap_find(&self->pairs, pA, pB) >= 0)
+		return 1;
+	if (ptrmap_set(&self->pairs, pA, pB, 0) < 0)
+		return 0;
+	return obarr_append(self->pBegin, pA) && obarr_append(self->pBegin, pB);
+}
+
+int collider_pair_end(ColliderObject* self, ColliderBox* a, ColliderBox* b)
+{
+	PyObject* pA = a->pObj < b->pObj ? a->pObj : b->pObj;
+	PyObject* pB = a->pObj < b->pObj ? b->pObj : a->pObj;
+
+	if (!ptrmap_del(&self->pairs, pA, pB))
+		return 1;
+	return obarr_append(self->pEnd, pA) && obarr_append(self->pEnd, pB);
+}
+
+/* insertion sort of one axis.  Ties put min endpoints first, so touching */
+/* boxes count as overlapping, as they do in collider_overlap. */
+int collider_sort_axis(ColliderObject* self, int nAxis)
+{
+	ColliderEndpoint* pEnds = self->pAxes[nAxis];
+	ColliderEndpoint e, *f;
+	ColliderBox* pBox;
+	long i, j;
+
+	for (i = 1; i < self->nEndpoints; i++)
+	{
+		e = pEnds[i];
+		j = i;
+		while (j > 0)
+		{
+			f = &pEnds[j - 1];
+			if (f->d < e.d || (f->d == e.d && (!COLLIDER_IS_MAX(f) || COLLIDER_IS_MAX(&e))))
+				break;
+
+			/* e passes f on its way down */
+			if (!COLLIDER_IS_MAX(&e) && COLLIDER_IS_MAX(f))
+			{
+				if (collider_overlap(&self->pBoxes[COLLIDER_BOX(&e)], &self->pBoxes[COLLIDER_BOX(f)]) &&
+					!collider_pair_begin(self, &self->pBoxes[COLLIDER_BOX(&e)], &self->pBoxes[COLLIDER_BOX(f)]))
+					return 0;
+			}
+			else if (COLLIDER_IS_MAX(&e) && !COLLIDER_IS_MAX(f))
+			{
+				if (!collider_pair_end(self, &self->pBoxes[COLLIDER_BOX(&e)], &self->pBoxes[COLLIDER_BOX(f)]))
+					return 0;
+			}
+
+			pBox = &self->pBoxes[COLLIDER_BOX(f)];
+			if (COLLIDER_IS_MAX(f))
+				pBox->nMax[nAxis] = j;
+			else
+				pBox->nMin[nAxis] = j;
+			pEnds[j] = *f;
+			j--;
+		}
+		pBox = &self->pBoxes[COLLIDER_BOX(&e)];
+		if (COLLIDER_IS_MAX(&e))
+			pBox->nMax[nAxis] = j;
+		else
+			pBox->nMin[nAxis] = j;
+		pEnds[j] = e;
+	}
+	return 1;
+}
+
+/* ends the pairs of removed boxes and drops them from the endpoint arrays */
+int collider_purge(ColliderObject* self)
+{
+	Ptrmap dead;
+	PtrmapSlot* pEnded = NULL;
+	ColliderBox* pBox;
+	ColliderEndpoint* pEnds;
+	long nEnded, i, j, w;
+	int k, rv = 0;
+
+	if (self->nDead == 0)
+		return 1;
+
+	ptrmap_init(&dead);
+	for (i = 0; i < self->nBoxes; i++)
+	{
+		if (self->pBoxes[i].bDead && ptrmap_set(&dead, self->pBoxes[i].pObj, NULL, i) < 0)
+			goto done;
+	}
+
+	/* collect first, deleting from the map reorders its slots */
+	pEnded = (PtrmapSlot*)malloc((self->pairs.nSize + 1) * sizeof(PtrmapSlot));
+	if (!pEnded)
+		goto done;
+	nEnded = 0;
+	for (i = 0; i < self->pairs.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&self->pairs, i))
+			continue;
+		if (ptrmap_find(&dead, self->pairs.pSlots[i].a, NULL) >= 0 || ptrmap_find(&dead, self->pairs.pSlots[i].b, NULL) >= 0)
+			pEnded[nEnded++] = self->pairs.pSlots[i];
+	}
+	for (i = 0; i < nEnded; i++)
+	{
+		ptrmap_del(&self->pairs, pEnded[i].a, pEnded[i].b);
+		if (!obarr_append(self->pEnd, (PyObject*)pEnded[i].a) || !obarr_append(self->pEnd, (PyObject*)pEnded[i].b))
+			goto done;
+	}
+
+	for (k = 0; k < 3; k++)
+	{
+		pEnds = self->pAxes[k];
+		w = 0;
+		for (j = 0; j < self->nEndpoints; j++)
+		{
+			pBox = &self->pBoxes[COLLIDER_BOX(&pEnds[j])];
+			if (pBox->bDead)
+				continue;
+			if (COLLIDER_IS_MAX(&pEnds[j]))
+				pBox->nMax[k] = w;
+			else
+				pBox->nMin[k] = w;
+			pEnds[w++] = pEnds[j];
+		}
+	}
+	self->nEndpoints -= self->nDead * 2;
+
+	for (i = 0; i < self->nBoxes; i++)
+	{
+		pBox = &self->pBoxes[i];
+		if (!pBox->bDead)
+			continue;
+		Py_CLEAR(pBox->pObj);
+		pBox->bDead = 0;
+		pBox->nNextFree = self->nFree;
+		self->nFree = i;
+	}
+	self->nDead = 0;
+	rv = 1;
+
+done:
+	if (pEnded)
+		free(pEnded);
+	ptrmap_free(&dead);
+	return rv;
+}
+
+ColliderBox* collider_find(ColliderObject* self, PyObject* other)
+{
+	long i = ptrmap_find(&self->boxes, other, NULL);
+
+	if (i < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "supplied argument not found in collider");
+		return NULL;
+	}
+	return &self->pBoxes[self->boxes.pSlots[i].value];
+}
+
+int Collider_init(ColliderObject *self, PyObject *args, PyObject *kwds)
+{
+	int k;
+
+    if (!PyArg_ParseTuple(args, ""))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+
+	self->pBoxes = NULL;
+	self->nBoxes = 0;
+	self->nBoxAlloc = 0;
+	self->nFree = -1;
+	self->nLive = 0;
+	self->nDead = 0;
+	for (k = 0; k < 3; k++)
+		self->pAxes[k] = NULL;
+	self->nEndpoints = 0;
+	self->nEndpointAlloc = 0;
+	ptrmap_init(&self->boxes);
+	ptrmap_init(&self->pairs);
+	self->pBegin = NULL;
+	self->pEnd = NULL;
+
+	return 0;
+}
+
+void Collider_dealloc(PyObject* self_in)
+{
+	ColliderObject* self = (ColliderObject*)self_in;
+	long i;
+	int k;
+
+	for (i = 0; i < self->nBoxes; i++)
+		Py_XDECREF(self->pBoxes[i].pObj);
+	if (self->pBoxes)
+		free(self->pBoxes);
+	for (k = 0; k < 3; k++)
+	{
+		if (self->pAxes[k])
+			free(self->pAxes[k]);
+	}
+	ptrmap_free(&self->boxes);
+	ptrmap_free(&self->pairs);
+	Py_XDECREF(self->pBegin);
+	Py_XDECREF(self->pEnd);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Collider_repr(PyObject *self_in)
+{
+	ColliderObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Collider_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (ColliderObject*)self_in;
+	tuple = Py_BuildValue("(ll)", self->nLive, self->pairs.nSize);
+	fmtstring = PyString_FromString("<Collider of %d objects, %d pairs>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Collider_len(PyObject *self_in)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+
+	return self->nLive;
+}
+
+int Collider_contains(PyObject* self_in, PyObject* other_in)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+
+	return ptrmap_find(&self->boxes, other_in, NULL) >= 0;
+}
+
+/* adds an object with its box, given as min and max vects or else taken */
+/* from its pos and radius.  Its pairs are reported by the next collide(). */
+PyObject* Collider_insert(PyObject *self_in, PyObject *args)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	PyObject *other, *pMin = NULL, *pMax = NULL;
+	double min[3], max[3];
+	long n;
+
+    if (!PyArg_ParseTuple(args, "O|OO", &other, &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (ptrmap_find(&self->boxes, other, NULL) >= 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "object is already in the collider");
+		return NULL;
+	}
+	if (!collider_read_bounds(other, pMin, pMax, min, max))
+		return NULL;
+
+	n = collider_new_box(self);
+	if (n < 0 || ptrmap_set(&self->boxes, other, NULL, n) < 0)
+	{
+		if (n >= 0)
+		{
+			/* leave the unused box for the next purge */
+			self->pBoxes[n].bDead = 1;
+			self->nDead++;
+			Py_INCREF(other);
+			self->pBoxes[n].pObj = other;
+		}
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	Py_INCREF(other);
+	self->pBoxes[n].pObj = other;
+	self->pBoxes[n].bAuto = (pMin == NULL);
+	collider_set_bounds(self, n, min, max);
+	self->nLive++;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* sets an object's new box; the endpoints are re-sorted by collide() */
+PyObject* Collider_update(PyObject *self_in, PyObject *args)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	ColliderBox *pBox;
+	PyObject *other, *pMin = NULL, *pMax = NULL;
+	double min[3], max[3];
+
+    if (!PyArg_ParseTuple(args, "O|OO", &other, &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	pBox = collider_find(self, other);
+	if (!pBox)
+		return NULL;
+	if (!collider_read_bounds(other, pMin, pMax, min, max))
+		return NULL;
+	pBox->bAuto = (pMin == NULL);
+	collider_set_bounds(self, pBox - self->pBoxes, min, max);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* re-reads the box of every object inserted without explicit bounds */
+PyObject* Collider_update_all(PyObject *self_in, PyObject *unused)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	ColliderBox *pBox;
+	double min[3], max[3];
+	long i;
+
+	for (i = 0; i < self->nBoxes; i++)
+	{
+		pBox = &self->pBoxes[i];
+		if (!pBox->pObj || pBox->bDead || !pBox->bAuto)
+			continue;
+		if (!collider_read_bounds(pBox->pObj, NULL, NULL, min, max))
+			return NULL;
+		collider_set_bounds(self, i, min, max);
+	}
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* removes an object; the end of its pairs is reported by the next collide() */
+PyObject* Collider_remove(PyObject *self_in, PyObject *args)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	ColliderBox *pBox;
+	PyObject *other;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	pBox = collider_find(self, other);
+	if (!pBox)
+		return NULL;
+	ptrmap_del(&self->boxes, other, NULL);
+	pBox->bDead = 1;
+	self->nDead++;
+	self->nLive--;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* brings the sorted axes up to date and returns (begin, end), two flat */
+/* arrays of object pairs (a0, b0, a1, b1, ...) whose boxes started or */
+/* stopped overlapping since the last call */
+PyObject* Collider_collide(PyObject *self_in, PyObject *unused)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	PyObject *rv;
+	int k;
+
+	self->pBegin = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(self->pBegin, NULL, NULL);
+	self->pEnd = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(self->pEnd, NULL, NULL);
+
+	if (!collider_purge(self))
+		goto nomem;
+	for (k = 0; k < 3; k++)
+	{
+		if (!collider_sort_axis(self, k))
+			goto nomem;
+	}
+
+	rv = Py_BuildValue("(NN)", self->pBegin, self->pEnd);
+	self->pBegin = NULL;
+	self->pEnd = NULL;
+	return rv;
+
+nomem:
+	Py_CLEAR(self->pBegin);
+	Py_CLEAR(self->pEnd);
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+	return NULL;
+}
+
+/* returns the overlapping pairs as of the last collide() as a flat array */
+PyObject* Collider_pairs(PyObject *self_in, PyObject *unused)
+{
+	ColliderObject *self = (ColliderObject*)self_in;
+	ObarrObject *rv;
+	long i, n;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, self->pairs.nSize * 2))
+	{
+		Py_DECREF(rv);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	n = 0;
+	for (i = 0; i < self->pairs.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&self->pairs, i))
+			continue;
+		obarr_set_element(rv, n++, (PyObject*)self->pairs.pSlots[i].a);
+		obarr_set_element(rv, n++, (PyObject*)self->pairs.pSlots[i].b);
+	}
+	return (PyObject*)rv;
+}
 
 
 
@@ -21,7 +540,7 @@ PySequenceMethods Collider_as_seq[] = {
 	Collider_len,			/* sq_length */
 	0,					/* sq_concat */
 	0,					/* sq_repeat */
-	Collider_item,			/* sq_item */
+	0,					/* sq_item */
 	0,					/* sq_slice */
 	0,					/* sq_ass_item */
 	0,					/* sq_ass_slice */
@@ -29,9 +548,12 @@ PySequenceMethods Collider_as_seq[] = {
 };
 
 PyMethodDef Collider_methods[] = {
-	{"insert", (PyCFunction)Collider_insert, METH_VARARGS, "allocate the array to a new size"},
-	{"delete", (PyCFunction)Collider_delete, METH_VARARGS, "remove a grid cell"},
-	{"remove", (PyCFunction)Collider_remove, METH_VARARGS, "remove an object from its grid cell"},
+	{"insert", (PyCFunction)Collider_insert, METH_VARARGS, "add an object, with its box given as min and max vects or taken from its pos and radius"},
+	{"update", (PyCFunction)Collider_update, METH_VARARGS, "set an object's new box, as min and max vects or from its pos and radius"},
+	{"update_all", (PyCFunction)Collider_update_all, METH_NOARGS, "re-read the box of every object inserted without explicit bounds"},
+	{"remove", (PyCFunction)Collider_remove, METH_VARARGS, "remove an object"},
+	{"collide", (PyCFunction)Collider_collide, METH_NOARGS, "sort the axes and return (begin, end) flat arrays of pairs that started or stopped overlapping"},
+	{"pairs", (PyCFunction)Collider_pairs, METH_NOARGS, "get the overlapping pairs as a flat array"},
 	{NULL}
 };
 
@@ -65,7 +587,7 @@ PyTypeObject ColliderObjectType = {
 	0,				/* tp_setattro    */
 	0,				/* tp_as_buffer   */
 	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
-	"Vector objects are simple.",	/* tp_doc         */
+	"Sweep and prune broadphase over axis-aligned boxes.",	/* tp_doc         */
 	0,				/* tp_traverse       */
 	0,				/* tp_clear          */
 	0,				/* tp_richcompare    */
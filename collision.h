@@ -1,5 +1,9 @@
+#ifndef COLLISION_H_INCLUDED
+#define COLLISION_H_INCLUDED
+
 #include <Python.h>
 #include <structmember.h>
+#include "ptrmap.h"
 
 #if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
 typedef int Py_ssize_t;
@@ -7,32 +11,80 @@ typedef int Py_ssize_t;
 #define PY_SSIZE_T_MIN INT_MIN
 #endif
 
-typedef struct rb_red_blk_tree rb_red_blk_tree;
 typedef struct ObarrObject ObarrObject;
 
+/* axis-aligned box of one object.  nMin[k] and nMax[k] are the positions */
+/* of its endpoints in the sorted endpoint array of axis k. */
+typedef struct ColliderBox {
+	PyObject*		pObj;
+	double			min[3];
+	double			max[3];
+	long			nMin[3];
+	long			nMax[3];
+	int				bAuto;		/* bounds read from the object's pos and radius */
+	int				bDead;		/* removed, dropped at the next collide() */
+	long			nNextFree;
+} ColliderBox;
+
+/* nRef is the box index times two, plus one for a max endpoint */
+typedef struct ColliderEndpoint {
+	double			d;
+	long			nRef;
+} ColliderEndpoint;
+
+/* sweep and prune broadphase: the box endpoints are kept sorted on each */
+/* axis by insertion sort, which is close to linear when objects move */
+/* coherently.  A swap that makes two boxes overlap on an axis tests them on */
+/* all three, a swap that separates them ends their pair. */
 typedef struct ColliderObject {
 	PyObject_HEAD
-	ObarrObject*	pGrids;
+	ColliderBox*		pBoxes;
+	long				nBoxes;
+	long				nBoxAlloc;
+	long				nFree;
+	long				nLive;
+	long				nDead;
+	ColliderEndpoint*	pAxes[3];
+	long				nEndpoints;
+	long				nEndpointAlloc;
+	Ptrmap				boxes;
+	Ptrmap				pairs;
+	ObarrObject*		pBegin;
+	ObarrObject*		pEnd;
 } ColliderObject;
 
 extern PyTypeObject ColliderObjectType;
 
 #define Collider_Check(op) PyObject_TypeCheck(op, &ColliderObjectType)
-
-
-double sizes[];
-
-#define SQR(x) ((x) * (x))
+#define COLLIDER_IS_MAX(e) ((e)->nRef & 1)
+#define COLLIDER_BOX(e) ((e)->nRef >> 1)
 
 /* internal functions */
-
+int collider_read_bounds(PyObject* other, PyObject* pMin, PyObject* pMax, double* min, double* max);
+long collider_new_box(ColliderObject* self);
+void collider_set_bounds(ColliderObject* self, long nBox, double* min, double* max);
+int collider_overlap(ColliderBox* a, ColliderBox* b);
+int collider_pair_begin(ColliderObject* self, ColliderBox* a, ColliderBox* b);
+int collider_pair_end(ColliderObject* self, ColliderBox* a, ColliderBox* b);
+int collider_sort_axis(ColliderObject* self, int nAxis);
+int collider_purge(ColliderObject* self);
+ColliderBox* collider_find(ColliderObject* self, PyObject* other);
 
 /* exported API functions */
 int Collider_init(ColliderObject *self, PyObject *args, PyObject *kwds);
 void Collider_dealloc(PyObject* self_in);
-PyObject* Collider_begin(PyObject *self_in, PyObject *args);
+PyObject* Collider_repr(PyObject *self_in);
+Py_ssize_t Collider_len(PyObject *self_in);
+int Collider_contains(PyObject* self_in, PyObject* other_in);
+PyObject* Collider_insert(PyObject *self_in, PyObject *args);
+PyObject* Collider_update(PyObject *self_in, PyObject *args);
+PyObject* Collider_update_all(PyObject *self_in, PyObject *unused);
 PyObject* Collider_remove(PyObject *self_in, PyObject *args);
+PyObject* Collider_collide(PyObject *self_in, PyObject *unused);
+PyObject* Collider_pairs(PyObject *self_in, PyObject *unused);
 
 extern PySequenceMethods Collider_as_seq[];
 extern PyMethodDef Collider_methods[];
 extern struct PyMemberDef Collider_members[];
+
+#endif
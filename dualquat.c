@@ -0,0 +1,593 @@
+#include "dualquat.h"
+#include "quat.h"
+#include "vect.h"
+#include "obarr.h"
+#include "bodies.h"
+#include "threads.h"
+#include <math.h>
+#include <string.h>
+
+/* r = a * b as plain quaternions, no normalizing; r not aliasing either */
+void dualquat_qmul(const double* a, const double* b, double* r)
+{
+	r[0] = (a[3] * b[0]) + (a[0] * b[3]) + (a[1] * b[2]) - (a[2] * b[1]);
+	r[1] = (a[3] * b[1]) + (a[1] * b[3]) + (a[2] * b[0]) - (a[0] * b[2]);
+	r[2] = (a[3] * b[2]) + (a[2] * b[3]) + (a[0] * b[1]) - (a[1] * b[0]);
+	r[3] = (a[3] * b[3]) - (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]);
+}
+
+/* rotation q followed by translation t; dual = t * q / 2 */
+void dualquat_from_rt(const double* q, const double* t, double* dq)
+{
+	double tq[4];
+
+	tq[0] = t[0];
+	tq[1] = t[1];
+	tq[2] = t[2];
+	tq[3] = 0.0;
+	memcpy(dq, q, 4 * sizeof(double));
+	dualquat_qmul(tq, q, &dq[4]);
+	dq[4] *= 0.5;
+	dq[5] *= 0.5;
+	dq[6] *= 0.5;
+	dq[7] *= 0.5;
+}
+
+/* r = a * b, applying b first: (ra rb, ra db + da rb) */
+void dualquat_multiply_internal(const double* a, const double* b, double* r)
+{
+	double t[4];
+	int k;
+
+	dualquat_qmul(a, b, r);
+	dualquat_qmul(a, &b[4], &r[4]);
+	dualquat_qmul(&a[4], b, t);
+	for (k = 0; k < 4; k++)
+		r[4 + k] += t[k];
+}
+
+/* scales to a unit real part and takes out the part of the dual that */
+/* is not perpendicular to it, so the result is a rigid transform again. */
+/* Returns 0 for a zero real part. */
+int dualquat_normalize_internal(double* dq)
+{
+	double d, inv;
+	int k;
+
+	d = (dq[0] * dq[0]) + (dq[1] * dq[1]) + (dq[2] * dq[2]) + (dq[3] * dq[3]);
+	if (!(d > 0.0))
+		return 0;
+	inv = 1.0 / sqrt(d);
+	for (k = 0; k < 8; k++)
+		dq[k] *= inv;
+	d = (dq[0] * dq[4]) + (dq[1] * dq[5]) + (dq[2] * dq[6]) + (dq[3] * dq[7]);
+	for (k = 0; k < 4; k++)
+		dq[4 + k] -= dq[k] * d;
+	return 1;
+}
+
+/* t = 2 * dual * conj(real), for a unit dual quat */
+void dualquat_translation_internal(const double* dq, double* t)
+{
+	t[0] = 2.0 * ((dq[3] * dq[4]) - (dq[7] * dq[0]) + (dq[1] * dq[6]) - (dq[2] * dq[5]));
+	t[1] = 2.0 * ((dq[3] * dq[5]) - (dq[7] * dq[1]) + (dq[2] * dq[4]) - (dq[0] * dq[6]));
+	t[2] = 2.0 * ((dq[3] * dq[6]) - (dq[7] * dq[2]) + (dq[0] * dq[5]) - (dq[1] * dq[4]));
+}
+
+/* rotates v by the real part, v + 2 r x (r x v + w v), and for a point */
+/* adds the translation.  dq must be unit. */
+void dualquat_transform_internal(const double* dq, const double* v, int bPoint, double* r)
+{
+	double c[3], t[3];
+
+	c[0] = (dq[1] * v[2]) - (dq[2] * v[1]) + (dq[3] * v[0]);
+	c[1] = (dq[2] * v[0]) - (dq[0] * v[2]) + (dq[3] * v[1]);
+	c[2] = (dq[0] * v[1]) - (dq[1] * v[0]) + (dq[3] * v[2]);
+	r[0] = v[0] + 2.0 * ((dq[1] * c[2]) - (dq[2] * c[1]));
+	r[1] = v[1] + 2.0 * ((dq[2] * c[0]) - (dq[0] * c[2]));
+	r[2] = v[2] + 2.0 * ((dq[0] * c[1]) - (dq[1] * c[0]));
+	if (!bPoint)
+		return;
+	dualquat_translation_internal(dq, t);
+	r[0] += t[0];
+	r[1] += t[1];
+	r[2] += t[2];
+}
+
+DualquatObject* dualquat_new(const double* dq)
+{
+	DualquatObject* rv = PyObject_New(DualquatObject, &DualquatObjectType);
+
+	if (rv)
+		memcpy(rv->elements, dq, 8 * sizeof(double));
+	return rv;
+}
+
+/* dual quaternion linear blending for one vertex: the bones' dual */
+/* quats are summed by weight, each flipped onto the same hemisphere as */
+/* the first so that q and -q blend alike, then normalized. */
+void dualquat_skin_vertex(SkinBatch* pBatch, long i)
+{
+	double b[8], *pBone, *pFirst = NULL, w;
+	long nBone;
+	int j, k;
+
+	memset(b, 0, sizeof(b));
+	for (j = 0; j < SKIN_BONES; j++)
+	{
+		nBone = pBatch->pIndex[(i * SKIN_BONES) + j];
+		if (nBone < 0)
+			continue;
+		pBone = &pBatch->pBones[nBone * 8];
+		w = pBatch->pWeight[(i * SKIN_BONES) + j];
+		if (!pFirst)
+			pFirst = pBone;
+		else if ((pBone[0] * pFirst[0]) + (pBone[1] * pFirst[1]) + (pBone[2] * pFirst[2]) + (pBone[3] * pFirst[3]) < 0.0)
+			w = -w;
+		for (k = 0; k < 8; k++)
+			b[k] += pBone[k] * w;
+	}
+
+	if (!dualquat_normalize_internal(b))
+	{
+		memcpy(&pBatch->pOutPos[i * 3], &pBatch->pPos[i * 3], 3 * sizeof(double));
+		if (pBatch->pNormal)
+			memcpy(&pBatch->pOutNormal[i * 3], &pBatch->pNormal[i * 3], 3 * sizeof(double));
+		return;
+	}
+	dualquat_transform_internal(b, &pBatch->pPos[i * 3], 1, &pBatch->pOutPos[i * 3]);
+	if (pBatch->pNormal)
+		dualquat_transform_internal(b, &pBatch->pNormal[i * 3], 0, &pBatch->pOutNormal[i * 3]);
+}
+
+/* thread body of skin */
+void dualquat_skin_batch(void* pArg, long nStart, long nEnd, int nThread)
+{
+	SkinBatch* pBatch = (SkinBatch*)pArg;
+	long i;
+
+	for (i = nStart; i < nEnd; i++)
+		dualquat_skin_vertex(pBatch, i);
+}
+
+
+/* dualquat() is the identity, dualquat(rot[, pos]) rotates by the quat */
+/* rot and then translates by pos. */
+int Dualquat_init(DualquatObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *pRot = NULL, *pPos = NULL;
+	double q[4] = {0.0, 0.0, 0.0, 1.0}, t[3] = {0.0, 0.0, 0.0};
+
+    if (!PyArg_ParseTuple(args, "|OO", &pRot, &pPos))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if ((pRot && !bodies_read_arg(pRot, 1, q)) ||
+		(pPos && !bodies_read_arg(pPos, 0, t)))
+		return -1;
+	dualquat_from_rt(q, t, self->elements);
+	return 0;
+}
+
+PyObject* Dualquat_getreal(PyObject* self_in, void* closure)
+{
+	QuatObject* rv = PyObject_New(QuatObject, &QuatObjectType);
+
+	if (rv)
+		memcpy(rv->elements, ((DualquatObject*)self_in)->elements, 4 * sizeof(double));
+	return (PyObject*)rv;
+}
+
+PyObject* Dualquat_getdual(PyObject* self_in, void* closure)
+{
+	QuatObject* rv = PyObject_New(QuatObject, &QuatObjectType);
+
+	if (rv)
+		memcpy(rv->elements, &((DualquatObject*)self_in)->elements[4], 4 * sizeof(double));
+	return (PyObject*)rv;
+}
+
+int Dualquat_set_notallowed(PyObject* self_in, PyObject* value, void* closure)
+{
+	PyErr_SetString(PyExc_TypeError, "dualquat parts cannot be set directly");
+	return -1;
+}
+
+PyObject* Dualquat_repr(PyObject *self_in)
+{
+	DualquatObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+	double *e;
+
+	if (!Dualquat_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (DualquatObject*)self_in;
+	e = self->elements;
+	tuple = Py_BuildValue("(dddddddd)", e[0], e[1], e[2], e[3], e[4], e[5], e[6], e[7]);
+	fmtstring = PyString_FromString("dualquat((%f, %f, %f, %f), (%f, %f, %f, %f))");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+/* dualquat * dualquat composes, dualquat * vect transforms a point */
+PyObject* Dualquat_mul(PyObject *self_in, PyObject *other_in)
+{
+	DualquatObject *self;
+	VectObject *rv;
+	double dq[8];
+
+	if (!Dualquat_Check(self_in))
+	{
+		PyErr_SetString(PyExc_TypeError, "incorrect object type received");
+		return NULL;
+	}
+	self = (DualquatObject*)self_in;
+
+	if (Dualquat_Check(other_in))
+	{
+		dualquat_multiply_internal(self->elements, ((DualquatObject*)other_in)->elements, dq);
+		return (PyObject*)dualquat_new(dq);
+	}
+	else if (Vect_Check(other_in))
+	{
+		rv = PyObject_New(VectObject, &VectObjectType);
+		if (rv)
+			dualquat_transform_internal(self->elements, ((VectObject*)other_in)->elements, 1, rv->elements);
+		return (PyObject*)rv;
+	}
+	PyErr_SetString(PyExc_TypeError, "dualquat can only be multiplied by a dualquat or vector");
+	return NULL;
+}
+
+PyObject* Dualquat_ip_normalize(PyObject *self_in, PyObject *unused)
+{
+	if (!dualquat_normalize_internal(((DualquatObject*)self_in)->elements))
+	{
+		PyErr_SetString(PyExc_ValueError, "cannot normalize a dualquat with a zero real part");
+		return NULL;
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Dualquat_get_rot(PyObject *self_in, PyObject *unused)
+{
+	return Dualquat_getreal(self_in, NULL);
+}
+
+PyObject* Dualquat_get_pos(PyObject *self_in, PyObject *unused)
+{
+	VectObject* rv = PyObject_New(VectObject, &VectObjectType);
+
+	if (rv)
+		dualquat_translation_internal(((DualquatObject*)self_in)->elements, rv->elements);
+	return (PyObject*)rv;
+}
+
+/* one vect gives one vect back, a sequence of them an obarr */
+PyObject* Dualquat_transform(PyObject *self_in, PyObject *args)
+{
+	DualquatObject *self = (DualquatObject*)self_in;
+	PyObject *pIn, *pFast;
+	ObarrObject *rv;
+	VectObject *pVect;
+	double v[3];
+	long n, i;
+
+    if (!PyArg_ParseTuple(args, "O", &pIn))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (Vect_Check(pIn))
+		return Dualquat_mul(self_in, pIn);
+
+	if (!(pFast = PySequence_Fast(pIn, "expected a vect or a sequence of vects")))
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, n))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (!bodies_read_arg(PySequence_Fast_GET_ITEM(pFast, i), 0, v))
+			goto error;
+		pVect = PyObject_New(VectObject, &VectObjectType);
+		if (!pVect)
+			goto error;
+		dualquat_transform_internal(self->elements, v, 1, pVect->elements);
+		obarr_set_element(rv, i, (PyObject*)pVect);
+		Py_DECREF(pVect);
+	}
+	Py_DECREF(pFast);
+	return (PyObject*)rv;
+
+error:
+	Py_DECREF(pFast);
+	Py_DECREF(rv);
+	return NULL;
+}
+
+/* an obarr of n vects made from v */
+ObarrObject* dualquat_make_vects(double* v, long n)
+{
+	ObarrObject *rv;
+	VectObject *pVect;
+	long i;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, n))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		Py_DECREF(rv);
+		return NULL;
+	}
+	for (i = 0; i < n; i++)
+	{
+		pVect = PyObject_New(VectObject, &VectObjectType);
+		if (!pVect)
+		{
+			Py_DECREF(rv);
+			return NULL;
+		}
+		memcpy(pVect->elements, &v[i * 3], 3 * sizeof(double));
+		obarr_set_element(rv, i, (PyObject*)pVect);
+		Py_DECREF(pVect);
+	}
+	return rv;
+}
+
+/* skin(bones, positions, indices, weights[, normals[, threads]]) */
+/* bones is a sequence of dualquats.  For each vertex indices[i] and */
+/* weights[i] are sequences of up to four bone numbers and their weights. */
+/* Returns an obarr of skinned positions, or (positions, normals) when */
+/* normals are given. */
+PyObject* Dualquat_skin(PyObject *self_in, PyObject *args)
+{
+	PyObject *pBones, *pPositions, *pIndices, *pWeights, *pNormals = Py_None;
+	PyObject *pFastB = NULL, *pFastP = NULL, *pFastI = NULL, *pFastW = NULL, *pFastN = NULL;
+	PyObject *pIdx = NULL, *pW = NULL, *pItem;
+	ObarrObject *pOutPos = NULL, *pOutNormal = NULL;
+	SkinBatch batch;
+	long nBones, n, i, nBone;
+	int nThreads = 0, j, nInf;
+
+    if (!PyArg_ParseTuple(args, "OOOO|Oi", &pBones, &pPositions, &pIndices, &pWeights, &pNormals, &nThreads))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	memset(&batch, 0, sizeof(batch));
+	if (!(pFastB = PySequence_Fast(pBones, "bones must be a sequence of dualquats")) ||
+		!(pFastP = PySequence_Fast(pPositions, "positions must be a sequence of vects")) ||
+		!(pFastI = PySequence_Fast(pIndices, "indices must be a sequence")) ||
+		!(pFastW = PySequence_Fast(pWeights, "weights must be a sequence")) ||
+		(pNormals != Py_None && !(pFastN = PySequence_Fast(pNormals, "normals must be None or a sequence of vects"))))
+		goto error;
+	nBones = PySequence_Fast_GET_SIZE(pFastB);
+	n = PySequence_Fast_GET_SIZE(pFastP);
+	if (PySequence_Fast_GET_SIZE(pFastI) != n || PySequence_Fast_GET_SIZE(pFastW) != n ||
+		(pFastN && PySequence_Fast_GET_SIZE(pFastN) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "positions, indices, weights and normals differ in length");
+		goto error;
+	}
+
+	batch.pBones = (double*)malloc((nBones + 1) * 8 * sizeof(double));
+	batch.pPos = (double*)malloc((n + 1) * 3 * sizeof(double));
+	batch.pIndex = (long*)malloc((n + 1) * SKIN_BONES * sizeof(long));
+	batch.pWeight = (double*)malloc((n + 1) * SKIN_BONES * sizeof(double));
+	batch.pOutPos = (double*)malloc((n + 1) * 3 * sizeof(double));
+	if (pFastN)
+	{
+		batch.pNormal = (double*)malloc((n + 1) * 3 * sizeof(double));
+		batch.pOutNormal = (double*)malloc((n + 1) * 3 * sizeof(double));
+	}
+	if (!batch.pBones || !batch.pPos || !batch.pIndex || !batch.pWeight || !batch.pOutPos ||
+		(pFastN && (!batch.pNormal || !batch.pOutNormal)))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+
+	for (i = 0; i < nBones; i++)
+	{
+		pItem = PySequence_Fast_GET_ITEM(pFastB, i);
+		if (!Dualquat_Check(pItem))
+		{
+			PyErr_SetString(PyExc_TypeError, "bones must be a sequence of dualquats");
+			goto error;
+		}
+		memcpy(&batch.pBones[i * 8], ((DualquatObject*)pItem)->elements, 8 * sizeof(double));
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (!bodies_read_arg(PySequence_Fast_GET_ITEM(pFastP, i), 0, &batch.pPos[i * 3]) ||
+			(pFastN && !bodies_read_arg(PySequence_Fast_GET_ITEM(pFastN, i), 0, &batch.pNormal[i * 3])))
+			goto error;
+		if (!(pIdx = PySequence_Fast(PySequence_Fast_GET_ITEM(pFastI, i), "indices must be sequences of bone numbers")) ||
+			!(pW = PySequence_Fast(PySequence_Fast_GET_ITEM(pFastW, i), "weights must be sequences of numbers")))
+			goto error;
+		nInf = (int)PySequence_Fast_GET_SIZE(pIdx);
+		if (nInf > SKIN_BONES || PySequence_Fast_GET_SIZE(pW) != nInf)
+		{
+			PyErr_SetString(PyExc_ValueError, "each vertex takes up to four bone indices and as many weights");
+			goto error;
+		}
+		for (j = 0; j < SKIN_BONES; j++)
+		{
+			batch.pIndex[(i * SKIN_BONES) + j] = -1;
+			batch.pWeight[(i * SKIN_BONES) + j] = 0.0;
+			if (j >= nInf)
+				continue;
+			nBone = PyInt_AsLong(PySequence_Fast_GET_ITEM(pIdx, j));
+			batch.pWeight[(i * SKIN_BONES) + j] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pW, j));
+			if (PyErr_Occurred())
+				goto error;
+			if (nBone < 0 || nBone >= nBones)
+			{
+				PyErr_SetString(PyExc_IndexError, "bone index out of range");
+				goto error;
+			}
+			batch.pIndex[(i * SKIN_BONES) + j] = nBone;
+		}
+		Py_DECREF(pIdx);
+		Py_DECREF(pW);
+		pIdx = pW = NULL;
+	}
+
+	nThreads = threads_pick(nThreads, n, SKIN_MIN_BATCH);
+	Py_BEGIN_ALLOW_THREADS
+	threads_run(dualquat_skin_batch, &batch, n, nThreads);
+	Py_END_ALLOW_THREADS
+
+	if (!(pOutPos = dualquat_make_vects(batch.pOutPos, n)) ||
+		(pFastN && !(pOutNormal = dualquat_make_vects(batch.pOutNormal, n))))
+		goto error;
+
+	free(batch.pBones);
+	free(batch.pPos);
+	free(batch.pNormal);
+	free(batch.pIndex);
+	free(batch.pWeight);
+	free(batch.pOutPos);
+	free(batch.pOutNormal);
+	Py_DECREF(pFastB);
+	Py_DECREF(pFastP);
+	Py_DECREF(pFastI);
+	Py_DECREF(pFastW);
+	Py_XDECREF(pFastN);
+	if (pOutNormal)
+		return Py_BuildValue("(NN)", pOutPos, pOutNormal);
+	return (PyObject*)pOutPos;
+
+error:
+	free(batch.pBones);
+	free(batch.pPos);
+	free(batch.pNormal);
+	free(batch.pIndex);
+	free(batch.pWeight);
+	free(batch.pOutPos);
+	free(batch.pOutNormal);
+	Py_XDECREF(pFastB);
+	Py_XDECREF(pFastP);
+	Py_XDECREF(pFastI);
+	Py_XDECREF(pFastW);
+	Py_XDECREF(pFastN);
+	Py_XDECREF(pIdx);
+	Py_XDECREF(pW);
+	Py_XDECREF(pOutPos);
+	return NULL;
+}
+
+
+
+PyNumberMethods Dualquat_as_number[] = {
+    0,                  /* nb_add */
+    0,                  /* nb_subtract */
+    Dualquat_mul,       /* nb_multiply */
+    0,                  /* nb_divide */
+    0,                  /* nb_remainder */
+    0,                  /* nb_divmod */
+    0,                  /* nb_power */
+    0,                  /* nb_negative */
+    0,                  /* nb_positive */
+    0,                  /* nb_absolute */
+    0,                  /* nb_nonzero */
+    0,                  /* nb_invert */
+    0,                  /* nb_lshift */
+    0,                  /* nb_rshift */
+    0,                  /* nb_and */
+    0,                  /* nb_xor */
+    0,                  /* nb_or */
+    0,                  /* nb_coerce */
+    0,                  /* nb_int */
+    0,                  /* nb_long */
+    0,                  /* nb_float */
+    0,                  /* nb_oct */
+    0,                  /* nb_hex */
+    0,                  /* nb_inplace_add */
+    0,                  /* nb_inplace_subtract */
+    0,                  /* nb_inplace_multiply */
+    0,                  /* nb_inplace_divide */
+    0,                  /* nb_inplace_remainder */
+    0,                  /* nb_inplace_power */
+    0,                  /* nb_inplace_lshift */
+    0,                  /* nb_inplace_rshift */
+    0,                  /* nb_inplace_and */
+    0,                  /* nb_inplace_xor */
+    0,                  /* nb_inplace_or */
+    0,                  /* nb_floordiv */
+    0,                  /* nb_truediv */
+    0,                  /* nb_inplace_floordiv */
+    0,                  /* nb_inplace_truediv */
+
+};
+
+PyGetSetDef Dualquat_getset[] = {
+	{"real", Dualquat_getreal, Dualquat_set_notallowed, "real part, the rotation", NULL},
+	{"dual", Dualquat_getdual, Dualquat_set_notallowed, "dual part", NULL},
+	{NULL}
+};
+
+PyMethodDef Dualquat_methods[] = {
+	{"normalize", (PyCFunction)Dualquat_ip_normalize, METH_NOARGS, "normalize a dualquat in place"},
+	{"get_rot", (PyCFunction)Dualquat_get_rot, METH_NOARGS, "rotation as a quat"},
+	{"get_pos", (PyCFunction)Dualquat_get_pos, METH_NOARGS, "translation as a vect"},
+	{"transform", (PyCFunction)Dualquat_transform, METH_VARARGS, "transform a point, or a sequence of points into an obarr"},
+	{NULL}
+};
+
+struct PyMemberDef Dualquat_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject DualquatObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.dualquat",		/* tp_name        */
+	sizeof(DualquatObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	0,				/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Dualquat_repr,	    /* tp_repr        */
+	Dualquat_as_number,	/* tp_as_number   */
+	0,				/* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Dual quaternion rigid transform",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Dualquat_methods,   /* tp_methods        */
+	Dualquat_members,   /* tp_members        */
+	Dualquat_getset,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Dualquat_init,		/* tp_init           */
+};
@@ -0,0 +1,70 @@
+#ifndef DUALQUAT_H_INCLUDED
+#define DUALQUAT_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+/* a rigid transform as a dual quaternion: elements 0 .. 3 are the real */
+/* part, the rotation quat in x, y, z, w order; 4 .. 7 the dual part, */
+/* half the translation times the rotation. */
+typedef struct DualquatObject {
+	PyObject_HEAD
+	double elements[8];
+} DualquatObject;
+
+/* one skin() call, shared by its threads.  Per vertex, up to */
+/* SKIN_BONES bone indices (-1 for unused) and weights. */
+typedef struct SkinBatch {
+	double*			pBones;		/* 8 doubles per bone */
+	double*			pPos;
+	double*			pNormal;	/* NULL when no normals were given */
+	long*			pIndex;
+	double*			pWeight;
+	double*			pOutPos;
+	double*			pOutNormal;
+} SkinBatch;
+
+#define Dualquat_Check(op) PyObject_TypeCheck(op, &DualquatObjectType)
+#define SKIN_BONES 4
+#define SKIN_MIN_BATCH 1024		/* fewest vertices worth a thread */
+
+/* internal functions */
+void dualquat_qmul(const double* a, const double* b, double* r);
+void dualquat_from_rt(const double* q, const double* t, double* dq);
+void dualquat_multiply_internal(const double* a, const double* b, double* r);
+int dualquat_normalize_internal(double* dq);
+void dualquat_translation_internal(const double* dq, double* t);
+void dualquat_transform_internal(const double* dq, const double* v, int bPoint, double* r);
+DualquatObject* dualquat_new(const double* dq);
+ObarrObject* dualquat_make_vects(double* v, long n);
+void dualquat_skin_vertex(SkinBatch* pBatch, long i);
+void dualquat_skin_batch(void* pArg, long nStart, long nEnd, int nThread);
+
+/* exported API functions */
+int Dualquat_init(DualquatObject *self, PyObject *args, PyObject *kwds);
+PyObject* Dualquat_getreal(PyObject* self_in, void* closure);
+PyObject* Dualquat_getdual(PyObject* self_in, void* closure);
+int Dualquat_set_notallowed(PyObject* self_in, PyObject* value, void* closure);
+PyObject* Dualquat_repr(PyObject *self_in);
+PyObject* Dualquat_mul(PyObject *self_in, PyObject *other_in);
+PyObject* Dualquat_ip_normalize(PyObject *self_in, PyObject *unused);
+PyObject* Dualquat_get_rot(PyObject *self_in, PyObject *unused);
+PyObject* Dualquat_get_pos(PyObject *self_in, PyObject *unused);
+PyObject* Dualquat_transform(PyObject *self_in, PyObject *args);
+PyObject* Dualquat_skin(PyObject *self_in, PyObject *args);
+
+extern PyNumberMethods Dualquat_as_number[];
+extern PyGetSetDef Dualquat_getset[];
+extern PyMethodDef Dualquat_methods[];
+extern struct PyMemberDef Dualquat_members[];
+extern PyTypeObject DualquatObjectType;
+
+#endif
@@ -0,0 +1,490 @@
+#include "hierarchy.h"
+#include "mat4.h"
+#include "bodies.h"
+#include "vect.h"
+#include "quat.h"
+#include <string.h>
+
+void hierarchy_clear(HierarchyObject* self)
+{
+	free(self->pData);
+	free(self->pParent);
+	free(self->pDirty);
+	free(self->pWorld);
+	free(self->pWorldF);
+	self->pData = NULL;
+	self->pParent = NULL;
+	self->pDirty = NULL;
+	self->pWorld = NULL;
+	self->pWorldF = NULL;
+	self->nCount = 0;
+	self->nAlloc = 0;
+}
+
+/* regrows every array of the store to nAlloc nodes */
+int hierarchy_reserve(HierarchyObject* self, long nAlloc)
+{
+	double *pData, *pWorld;
+	float *pWorldF;
+	long *pParent;
+	char *pDirty;
+	int f;
+
+	if (nAlloc <= self->nAlloc)
+		return 1;
+	if (self->nExports > 0)
+	{
+		PyErr_SetString(PyExc_BufferError, "world matrices are exported to a buffer");
+		return 0;
+	}
+	pData = (double*)malloc(nAlloc * HIERARCHY_FIELDS * sizeof(double));
+	pParent = (long*)malloc(nAlloc * sizeof(long));
+	pDirty = (char*)malloc(nAlloc * sizeof(char));
+	pWorld = (double*)malloc(nAlloc * 16 * sizeof(double));
+	pWorldF = (float*)malloc(nAlloc * 16 * sizeof(float));
+	if (!pData || !pParent || !pDirty || !pWorld || !pWorldF)
+	{
+		free(pData);
+		free(pParent);
+		free(pDirty);
+		free(pWorld);
+		free(pWorldF);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return 0;
+	}
+	if (self->nCount)
+	{
+		for (f = 0; f < HIERARCHY_FIELDS; f++)
+			memcpy(pData + (f * nAlloc), HIERARCHY_ROW(self, f), self->nCount * sizeof(double));
+		memcpy(pParent, self->pParent, self->nCount * sizeof(long));
+		memcpy(pDirty, self->pDirty, self->nCount * sizeof(char));
+		memcpy(pWorld, self->pWorld, self->nCount * 16 * sizeof(double));
+		memcpy(pWorldF, self->pWorldF, self->nCount * 16 * sizeof(float));
+	}
+	free(self->pData);
+	free(self->pParent);
+	free(self->pDirty);
+	free(self->pWorld);
+	free(self->pWorldF);
+	self->pData = pData;
+	self->pParent = pParent;
+	self->pDirty = pDirty;
+	self->pWorld = pWorld;
+	self->pWorldF = pWorldF;
+	self->nAlloc = nAlloc;
+	return 1;
+}
+
+int hierarchy_index(HierarchyObject* self, long i)
+{
+	if (i < 0 || i >= self->nCount)
+	{
+		PyErr_SetString(PyExc_IndexError, "node index out of range");
+		return 0;
+	}
+	return 1;
+}
+
+/* a vect or 3-tuple, or one number for a uniform scale */
+int hierarchy_read_scale(PyObject* other, double* v)
+{
+	if (PyNumber_Check(other) && !Vect_Check(other))
+	{
+		v[0] = v[1] = v[2] = PyFloat_AsDouble(other);
+		return !PyErr_Occurred();
+	}
+	return bodies_read_arg(other, 0, v);
+}
+
+void hierarchy_read(HierarchyObject* self, long i, int nField, int nWidth, double* v)
+{
+	int k;
+
+	for (k = 0; k < nWidth; k++)
+		v[k] = HIERARCHY_ROW(self, nField + k)[i];
+}
+
+void hierarchy_write(HierarchyObject* self, long i, int nField, int nWidth, double* v)
+{
+	int k;
+
+	for (k = 0; k < nWidth; k++)
+		HIERARCHY_ROW(self, nField + k)[i] = v[k];
+}
+
+/* shared body of the get_* methods */
+PyObject* hierarchy_get(PyObject* self_in, PyObject* args, int nField, int nWidth)
+{
+	HierarchyObject* self = (HierarchyObject*)self_in;
+	VectObject* v;
+	QuatObject* q;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!hierarchy_index(self, i))
+		return NULL;
+	if (nWidth == 4)
+	{
+		q = PyObject_New(QuatObject, &QuatObjectType);
+		if (q)
+			hierarchy_read(self, i, nField, 4, q->elements);
+		return (PyObject*)q;
+	}
+	v = PyObject_New(VectObject, &VectObjectType);
+	if (v)
+		hierarchy_read(self, i, nField, 3, v->elements);
+	return (PyObject*)v;
+}
+
+/* shared body of the set_* methods; marks the node dirty */
+PyObject* hierarchy_set(PyObject* self_in, PyObject* args, int nField, int nWidth)
+{
+	HierarchyObject* self = (HierarchyObject*)self_in;
+	PyObject* other;
+	double v[4];
+	long i;
+	int bOk;
+
+    if (!PyArg_ParseTuple(args, "lO", &i, &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!hierarchy_index(self, i))
+		return NULL;
+	if (nField == HIERARCHY_SX)
+		bOk = hierarchy_read_scale(other, v);
+	else
+		bOk = bodies_read_arg(other, nWidth == 4, v);
+	if (!bOk)
+		return NULL;
+	hierarchy_write(self, i, nField, nWidth, v);
+	self->pDirty[i] = 1;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* recomputes the world matrix of every dirty node and of everything */
+/* below one.  Parents come first, so a node is due exactly when it or */
+/* its parent is dirty, and marking it dirty in turn carries the change */
+/* down the subtree in the same pass.  Returns the nodes recomputed. */
+long hierarchy_update(HierarchyObject* self)
+{
+	double local[16], t[3], q[4], s[3];
+	long i, p, nDone = 0;
+
+	for (i = 0; i < self->nCount; i++)
+	{
+		p = self->pParent[i];
+		if (!self->pDirty[i] && (p < 0 || !self->pDirty[p]))
+			continue;
+		self->pDirty[i] = 1;
+		hierarchy_read(self, i, HIERARCHY_PX, 3, t);
+		hierarchy_read(self, i, HIERARCHY_QX, 4, q);
+		hierarchy_read(self, i, HIERARCHY_SX, 3, s);
+		if (p < 0)
+			mat4_trs_internal(t, q, s, &self->pWorld[i * 16]);
+		else
+		{
+			mat4_trs_internal(t, q, s, local);
+			mat4_multiply_internal(&self->pWorld[p * 16], local, &self->pWorld[i * 16]);
+		}
+		mat4_to_float(&self->pWorld[i * 16], &self->pWorldF[i * 16]);
+		nDone++;
+	}
+	if (nDone)
+		memset(self->pDirty, 0, self->nCount * sizeof(char));
+	return nDone;
+}
+
+
+int Hierarchy_init(HierarchyObject *self, PyObject *args, PyObject *kwds)
+{
+	long nAlloc = 16;
+
+    if (!PyArg_ParseTuple(args, "|l", &nAlloc))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (self->nExports > 0)
+	{
+		PyErr_SetString(PyExc_BufferError, "world matrices are exported to a buffer");
+		return -1;
+	}
+	hierarchy_clear(self);
+	return hierarchy_reserve(self, nAlloc > 0 ? nAlloc : 1) ? 0 : -1;
+}
+
+void Hierarchy_dealloc(PyObject* self_in)
+{
+	hierarchy_clear((HierarchyObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Hierarchy_repr(PyObject *self_in)
+{
+	HierarchyObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Hierarchy_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (HierarchyObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->nCount);
+	fmtstring = PyString_FromString("<hierarchy of %d nodes>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Hierarchy_len(PyObject *self_in)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+
+	return self->nCount;
+}
+
+/* add(parent[, pos[, rot[, scale]]]) returns the new node's index. */
+/* parent is -1 or None for a root, otherwise an existing node. */
+PyObject* Hierarchy_add(PyObject *self_in, PyObject *args)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+	PyObject *pParent, *pPos = NULL, *pRot = NULL, *pScale = NULL;
+	double v[HIERARCHY_FIELDS];
+	long i, nParent = -1;
+
+    if (!PyArg_ParseTuple(args, "O|OOO", &pParent, &pPos, &pRot, &pScale))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (pParent != Py_None)
+	{
+		nParent = PyInt_AsLong(pParent);
+		if (nParent == -1 && PyErr_Occurred())
+			return NULL;
+		if (nParent < -1 || nParent >= self->nCount)
+		{
+			PyErr_SetString(PyExc_IndexError, "parent index out of range");
+			return NULL;
+		}
+	}
+	memset(v, 0, sizeof(v));
+	v[HIERARCHY_QX + 3] = 1.0;
+	v[HIERARCHY_SX] = v[HIERARCHY_SX + 1] = v[HIERARCHY_SX + 2] = 1.0;
+	if ((pPos && pPos != Py_None && !bodies_read_arg(pPos, 0, &v[HIERARCHY_PX])) ||
+		(pRot && pRot != Py_None && !bodies_read_arg(pRot, 1, &v[HIERARCHY_QX])) ||
+		(pScale && pScale != Py_None && !hierarchy_read_scale(pScale, &v[HIERARCHY_SX])))
+		return NULL;
+
+	if (self->nCount == self->nAlloc && !hierarchy_reserve(self, self->nAlloc * 2))
+		return NULL;
+	i = self->nCount++;
+	hierarchy_write(self, i, 0, HIERARCHY_FIELDS, v);
+	self->pParent[i] = nParent;
+	self->pDirty[i] = 1;
+	mat4_identity(&self->pWorld[i * 16]);
+	mat4_to_float(&self->pWorld[i * 16], &self->pWorldF[i * 16]);
+	return PyInt_FromLong(i);
+}
+
+PyObject* Hierarchy_get_parent(PyObject *self_in, PyObject *args)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!hierarchy_index(self, i))
+		return NULL;
+	return PyInt_FromLong(self->pParent[i]);
+}
+
+PyObject* Hierarchy_get_pos(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_get(self_in, args, HIERARCHY_PX, 3);
+}
+
+PyObject* Hierarchy_set_pos(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_set(self_in, args, HIERARCHY_PX, 3);
+}
+
+PyObject* Hierarchy_get_rot(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_get(self_in, args, HIERARCHY_QX, 4);
+}
+
+PyObject* Hierarchy_set_rot(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_set(self_in, args, HIERARCHY_QX, 4);
+}
+
+PyObject* Hierarchy_get_scale(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_get(self_in, args, HIERARCHY_SX, 3);
+}
+
+PyObject* Hierarchy_set_scale(PyObject *self_in, PyObject *args)
+{
+	return hierarchy_set(self_in, args, HIERARCHY_SX, 3);
+}
+
+PyObject* Hierarchy_update(PyObject *self_in, PyObject *args)
+{
+	return PyInt_FromLong(hierarchy_update((HierarchyObject*)self_in));
+}
+
+/* the world matrix of a node as of the last update */
+PyObject* Hierarchy_get_world(PyObject *self_in, PyObject *args)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!hierarchy_index(self, i))
+		return NULL;
+	return (PyObject*)mat4_new(&self->pWorld[i * 16]);
+}
+
+/* the old style buffer interface: one read-only segment of 16 floats */
+/* per node.  Adding nodes while it is held in a memoryview is refused, */
+/* but a plain buffer object must be taken again after adding. */
+Py_ssize_t Hierarchy_getreadbuffer(PyObject *self_in, Py_ssize_t nSegment, void **ppData)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+
+	if (nSegment != 0)
+	{
+		PyErr_SetString(PyExc_SystemError, "accessing non-existent hierarchy segment");
+		return -1;
+	}
+	*ppData = self->pWorldF;
+	return self->nCount * 16 * sizeof(float);
+}
+
+Py_ssize_t Hierarchy_getsegcount(PyObject *self_in, Py_ssize_t *pnLen)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+
+	if (pnLen)
+		*pnLen = self->nCount * 16 * sizeof(float);
+	return 1;
+}
+
+/* the new style buffer interface, for memoryview */
+int Hierarchy_getbuffer(PyObject *self_in, Py_buffer *view, int flags)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+
+	if (!self->pWorldF)
+	{
+		PyErr_SetString(PyExc_BufferError, "hierarchy not initialized");
+		return -1;
+	}
+	if (PyBuffer_FillInfo(view, self_in, self->pWorldF, self->nCount * 16 * sizeof(float), 1, flags) < 0)
+		return -1;
+	self->nExports++;
+	return 0;
+}
+
+void Hierarchy_releasebuffer(PyObject *self_in, Py_buffer *view)
+{
+	HierarchyObject *self = (HierarchyObject*)self_in;
+
+	self->nExports--;
+}
+
+
+
+PySequenceMethods Hierarchy_as_seq[] = {
+	Hierarchy_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyBufferProcs Hierarchy_as_buffer[] = {
+	(readbufferproc)Hierarchy_getreadbuffer,	/* bf_getreadbuffer */
+	0,					/* bf_getwritebuffer */
+	(segcountproc)Hierarchy_getsegcount,		/* bf_getsegcount */
+	(charbufferproc)Hierarchy_getreadbuffer,	/* bf_getcharbuffer */
+	(getbufferproc)Hierarchy_getbuffer,		/* bf_getbuffer */
+	(releasebufferproc)Hierarchy_releasebuffer,	/* bf_releasebuffer */
+};
+
+PyMethodDef Hierarchy_methods[] = {
+	{"add", (PyCFunction)Hierarchy_add, METH_VARARGS, "add a node (parent[, pos[, rot[, scale]]]) under parent or -1, returning its index"},
+	{"get_parent", (PyCFunction)Hierarchy_get_parent, METH_VARARGS, "parent index of a node, -1 for a root"},
+	{"get_pos", (PyCFunction)Hierarchy_get_pos, METH_VARARGS, "local position of a node"},
+	{"set_pos", (PyCFunction)Hierarchy_set_pos, METH_VARARGS, "set the local position of a node"},
+	{"get_rot", (PyCFunction)Hierarchy_get_rot, METH_VARARGS, "local rotation of a node"},
+	{"set_rot", (PyCFunction)Hierarchy_set_rot, METH_VARARGS, "set the local rotation of a node"},
+	{"get_scale", (PyCFunction)Hierarchy_get_scale, METH_VARARGS, "local scale of a node"},
+	{"set_scale", (PyCFunction)Hierarchy_set_scale, METH_VARARGS, "set the local scale of a node, a vect or one number"},
+	{"update", (PyCFunction)Hierarchy_update, METH_NOARGS, "recompute the world matrices below every changed node, returning how many were recomputed"},
+	{"get_world", (PyCFunction)Hierarchy_get_world, METH_VARARGS, "world matrix of a node as a mat4, as of the last update"},
+	{NULL}
+};
+
+struct PyMemberDef Hierarchy_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject HierarchyObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.hierarchy",		/* tp_name        */
+	sizeof(HierarchyObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Hierarchy_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Hierarchy_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Hierarchy_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	Hierarchy_as_buffer,	/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES|Py_TPFLAGS_HAVE_NEWBUFFER,		/* tp_flags       */
+	"Transform hierarchy; the buffer interface gives a column-major world matrix of 16 floats per node.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Hierarchy_methods,   /* tp_methods        */
+	Hierarchy_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Hierarchy_init,		/* tp_init           */
+};
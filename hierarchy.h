@@ -0,0 +1,73 @@
+#ifndef HIERARCHY_H_INCLUDED
+#define HIERARCHY_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+/* a transform hierarchy.  Nodes are numbered 0 .. nCount - 1 and a */
+/* node's parent always has a lower number, so walking the nodes in */
+/* order visits every parent before its children.  The local transforms */
+/* are kept one row per component like bodies; pWorld holds a column- */
+/* major world matrix per node (see mat4) and pWorldF the same as floats, */
+/* which the store exposes through the buffer interface. */
+typedef struct HierarchyObject {
+	PyObject_HEAD
+	double*			pData;
+	long*			pParent;	/* -1 for a root */
+	char*			pDirty;		/* local transform changed since update */
+	double*			pWorld;
+	float*			pWorldF;
+	long			nCount;
+	long			nAlloc;
+	long			nExports;	/* buffer views currently held */
+} HierarchyObject;
+
+#define HIERARCHY_PX		0		/* local position */
+#define HIERARCHY_QX		3		/* local rotation x, y, z, w */
+#define HIERARCHY_SX		7		/* local scale */
+#define HIERARCHY_FIELDS	10
+
+#define HIERARCHY_ROW(self, f) ((self)->pData + ((f) * (self)->nAlloc))
+
+#define Hierarchy_Check(op) PyObject_TypeCheck(op, &HierarchyObjectType)
+
+/* internal functions */
+void hierarchy_clear(HierarchyObject* self);
+int hierarchy_reserve(HierarchyObject* self, long nAlloc);
+int hierarchy_index(HierarchyObject* self, long i);
+int hierarchy_read_scale(PyObject* other, double* v);
+void hierarchy_read(HierarchyObject* self, long i, int nField, int nWidth, double* v);
+void hierarchy_write(HierarchyObject* self, long i, int nField, int nWidth, double* v);
+PyObject* hierarchy_get(PyObject* self_in, PyObject* args, int nField, int nWidth);
+PyObject* hierarchy_set(PyObject* self_in, PyObject* args, int nField, int nWidth);
+long hierarchy_update(HierarchyObject* self);
+
+/* exported API functions */
+int Hierarchy_init(HierarchyObject *self, PyObject *args, PyObject *kwds);
+void Hierarchy_dealloc(PyObject* self_in);
+PyObject* Hierarchy_repr(PyObject *self_in);
+Py_ssize_t Hierarchy_len(PyObject *self_in);
+PyObject* Hierarchy_add(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_get_parent(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_get_pos(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_set_pos(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_get_rot(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_set_rot(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_get_scale(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_set_scale(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_update(PyObject *self_in, PyObject *args);
+PyObject* Hierarchy_get_world(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Hierarchy_as_seq[];
+extern PyBufferProcs Hierarchy_as_buffer[];
+extern PyMethodDef Hierarchy_methods[];
+extern struct PyMemberDef Hierarchy_members[];
+extern PyTypeObject HierarchyObjectType;
+
+#endif
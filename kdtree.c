@@ -0,0 +1,856 @@
+#include "kdtree.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include "vect.h"
+#include <math.h>
+#include <string.h>
+
+void kdtree_clear(KdtreeObject* self)
+{
+	long i;
+
+	if (self->pObjects)
+	{
+		for (i = 0; i < self->nMembers; i++)
+			Py_XDECREF(self->pObjects[i]);
+		free(self->pObjects);
+	}
+	if (self->pPos)
+		free(self->pPos);
+	if (self->pIndex)
+		free(self->pIndex);
+	if (self->pSplit)
+		free(self->pSplit);
+	if (self->pAxis)
+		free(self->pAxis);
+	self->pObjects = NULL;
+	self->pPos = NULL;
+	self->pIndex = NULL;
+	self->pSplit = NULL;
+	self->pAxis = NULL;
+	self->nMembers = 0;
+	self->nNodes = 0;
+}
+
+/* reorders pOrder[lo .. hi] so the nth holds the member that belongs */
+/* there by coordinate nAxis, with none greater before it and none less */
+/* after it.  Positions are still in their original order while building. */
+void kdtree_select(KdtreeObject* self, long* pOrder, long lo, long hi, long nth, int nAxis)
+{
+	double* pPos = self->pPos;
+	double v;
+	long i, j, tmp;
+
+	hi--;
+	while (lo < hi)
+	{
+		v = pPos[(pOrder[(lo + hi) / 2] * 3) + nAxis];
+		i = lo;
+		j = hi;
+		while (i <= j)
+		{
+			while (pPos[(pOrder[i] * 3) + nAxis] < v)
+				i++;
+			while (pPos[(pOrder[j] * 3) + nAxis] > v)
+				j--;
+			if (i <= j)
+			{
+				tmp = pOrder[i]; pOrder[i] = pOrder[j]; pOrder[j] = tmp;
+				i++;
+				j--;
+			}
+		}
+		if (nth <= j)
+			hi = j;
+		else if (nth >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+/* median split on the axis of widest spread, O(n) per level */
+void kdtree_build(KdtreeObject* self, long* pOrder, long i, long lo, long hi)
+{
+	double min[3], max[3];
+	double* p;
+	long mid, j;
+	int k, nAxis;
+
+	if (hi - lo <= self->nLeafSize)
+		return;
+
+	p = &self->pPos[pOrder[lo] * 3];
+	memcpy(min, p, sizeof(min));
+	memcpy(max, p, sizeof(max));
+	for (j = lo + 1; j < hi; j++)
+	{
+		p = &self->pPos[pOrder[j] * 3];
+		for (k = 0; k < 3; k++)
+		{
+			if (p[k] < min[k])
+				min[k] = p[k];
+			if (p[k] > max[k])
+				max[k] = p[k];
+		}
+	}
+	nAxis = 0;
+	for (k = 1; k < 3; k++)
+	{
+		if (max[k] - min[k] > max[nAxis] - min[nAxis])
+			nAxis = k;
+	}
+
+	mid = (lo + hi) / 2;
+	kdtree_select(self, pOrder, lo, hi, mid, nAxis);
+	self->pAxis[i] = (unsigned char)nAxis;
+	self->pSplit[i] = self->pPos[(pOrder[mid] * 3) + nAxis];
+	kdtree_build(self, pOrder, (2 * i) + 1, lo, mid);
+	kdtree_build(self, pOrder, (2 * i) + 2, mid, hi);
+}
+
+/* restores the max heap order of the first n entries below entry c */
+void kdtree_heap_sift(KdtreeHeap* pHeap, long c, long n)
+{
+	double* pDist = pHeap->pDist;
+	long* pMember = pHeap->pMember;
+	double dt;
+	long best, nt;
+
+	for (;;)
+	{
+		best = c;
+		if ((2 * c) + 1 < n && pDist[(2 * c) + 1] > pDist[best])
+			best = (2 * c) + 1;
+		if ((2 * c) + 2 < n && pDist[(2 * c) + 2] > pDist[best])
+			best = (2 * c) + 2;
+		if (best == c)
+			break;
+		dt = pDist[c]; pDist[c] = pDist[best]; pDist[best] = dt;
+		nt = pMember[c]; pMember[c] = pMember[best]; pMember[best] = nt;
+		c = best;
+	}
+}
+
+void kdtree_heap_offer(KdtreeHeap* pHeap, double d, long j)
+{
+	double* pDist = pHeap->pDist;
+	long* pMember = pHeap->pMember;
+	double dt;
+	long n, c, nt;
+
+	if (pHeap->nSize < pHeap->nK)
+	{
+		n = pHeap->nSize++;
+		pDist[n] = d;
+		pMember[n] = j;
+		while (n > 0 && pDist[(n - 1) / 2] < pDist[n])
+		{
+			c = (n - 1) / 2;
+			dt = pDist[c]; pDist[c] = pDist[n]; pDist[n] = dt;
+			nt = pMember[c]; pMember[c] = pMember[n]; pMember[n] = nt;
+			n = c;
+		}
+		return;
+	}
+	if (d >= pDist[0])
+		return;
+
+	pDist[0] = d;
+	pMember[0] = j;
+	kdtree_heap_sift(pHeap, 0, pHeap->nSize);
+}
+
+/* sorts the heap entries in place into ascending order; the heap order */
+/* is lost, so it must be emptied before reuse */
+void kdtree_heap_sort(KdtreeHeap* pHeap)
+{
+	double dt;
+	long n, nt;
+
+	for (n = pHeap->nSize - 1; n > 0; n--)
+	{
+		dt = pHeap->pDist[0]; pHeap->pDist[0] = pHeap->pDist[n]; pHeap->pDist[n] = dt;
+		nt = pHeap->pMember[0]; pHeap->pMember[0] = pHeap->pMember[n]; pHeap->pMember[n] = nt;
+		kdtree_heap_sift(pHeap, 0, n);
+	}
+}
+
+/* k nearest by squared distance, nearer side first */
+void kdtree_knn(KdtreeObject* self, long i, long lo, long hi, double* q, KdtreeHeap* pHeap)
+{
+	double* p;
+	double diff;
+	long mid, j;
+
+	if (hi - lo <= self->nLeafSize)
+	{
+		for (j = lo; j < hi; j++)
+		{
+			p = &self->pPos[j * 3];
+			kdtree_heap_offer(pHeap, SQR(p[0] - q[0]) + SQR(p[1] - q[1]) + SQR(p[2] - q[2]), j);
+		}
+		return;
+	}
+
+	mid = (lo + hi) / 2;
+	diff = q[self->pAxis[i]] - self->pSplit[i];
+	if (diff < 0.0)
+	{
+		kdtree_knn(self, (2 * i) + 1, lo, mid, q, pHeap);
+		if (pHeap->nSize < pHeap->nK || SQR(diff) < pHeap->pDist[0])
+			kdtree_knn(self, (2 * i) + 2, mid, hi, q, pHeap);
+	}
+	else
+	{
+		kdtree_knn(self, (2 * i) + 2, mid, hi, q, pHeap);
+		if (pHeap->nSize < pHeap->nK || SQR(diff) < pHeap->pDist[0])
+			kdtree_knn(self, (2 * i) + 1, lo, mid, q, pHeap);
+	}
+}
+
+int kdtree_list_add(KdtreeList* pList, long j)
+{
+	void* tmp;
+	long n;
+
+	if (pList->nSize == pList->nAlloc)
+	{
+		n = pList->nAlloc ? pList->nAlloc * 2 : 64;
+		tmp = realloc(pList->pData, n * sizeof(long));
+		if (!tmp)
+			return 0;
+		pList->pData = (long*)tmp;
+		pList->nAlloc = n;
+	}
+	pList->pData[pList->nSize++] = j;
+	return 1;
+}
+
+int kdtree_radius(KdtreeObject* self, long i, long lo, long hi, double* q, double dRadius2, KdtreeList* pList)
+{
+	double* p;
+	double diff;
+	long mid, j;
+
+	if (hi - lo <= self->nLeafSize)
+	{
+		for (j = lo; j < hi; j++)
+		{
+			p = &self->pPos[j * 3];
+			if (SQR(p[0] - q[0]) + SQR(p[1] - q[1]) + SQR(p[2] - q[2]) <= dRadius2 && !kdtree_list_add(pList, j))
+				return 0;
+		}
+		return 1;
+	}
+
+	mid = (lo + hi) / 2;
+	diff = q[self->pAxis[i]] - self->pSplit[i];
+	if (diff <= 0.0 || SQR(diff) <= dRadius2)
+	{
+		if (!kdtree_radius(self, (2 * i) + 1, lo, mid, q, dRadius2, pList))
+			return 0;
+	}
+	if (diff >= 0.0 || SQR(diff) <= dRadius2)
+	{
+		if (!kdtree_radius(self, (2 * i) + 2, mid, hi, q, dRadius2, pList))
+			return 0;
+	}
+	return 1;
+}
+
+/* new reference to member j: its object, or its index without objects */
+PyObject* kdtree_result(KdtreeObject* self, long j)
+{
+	if (self->pObjects)
+	{
+		Py_INCREF(self->pObjects[j]);
+		return self->pObjects[j];
+	}
+	return PyInt_FromLong(self->pIndex[j]);
+}
+
+/* copies a sequence of vects or positioned objects to a new xyz array */
+double* kdtree_read_points(PyObject* points, long* pnCount)
+{
+	PyObject* pFast;
+	double* pPos;
+	long n, i;
+
+	pFast = PySequence_Fast(points, "points must be a sequence of vects");
+	if (!pFast)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	pPos = (double*)malloc((n ? n : 1) * 3 * sizeof(double));
+	if (!pPos)
+	{
+		Py_DECREF(pFast);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFast, i), &pPos[i * 3]))
+		{
+			free(pPos);
+			Py_DECREF(pFast);
+			return NULL;
+		}
+	}
+	Py_DECREF(pFast);
+	*pnCount = n;
+	return pPos;
+}
+
+/* thread body of nearest_many */
+void kdtree_knn_batch(void* pArg, long nStart, long nEnd, int nThread)
+{
+	KdtreeBatch* pBatch = (KdtreeBatch*)pArg;
+	KdtreeObject* self = pBatch->self;
+	KdtreeHeap heap;
+	long nK = pBatch->nK;
+	long i, r;
+
+	heap.nK = nK;
+	heap.pDist = (double*)malloc(nK * sizeof(double));
+	heap.pMember = (long*)malloc(nK * sizeof(long));
+	if (!heap.pDist || !heap.pMember)
+	{
+		pBatch->bFailed = 1;
+		nEnd = nStart;
+	}
+
+	for (i = nStart; i < nEnd; i++)
+	{
+		heap.nSize = 0;
+		if (self->nMembers)
+			kdtree_knn(self, 0, 0, self->nMembers, &pBatch->pQueries[i * 3], &heap);
+		for (r = nK - 1; r >= heap.nSize; r--)
+		{
+			pBatch->pMember[(i * nK) + r] = -1;
+			pBatch->pDist[(i * nK) + r] = 0.0;
+		}
+		kdtree_heap_sort(&heap);
+		for (r = 0; r < heap.nSize; r++)
+		{
+			pBatch->pMember[(i * nK) + r] = heap.pMember[r];
+			pBatch->pDist[(i * nK) + r] = sqrt(heap.pDist[r]);
+		}
+	}
+
+	if (heap.pDist)
+		free(heap.pDist);
+	if (heap.pMember)
+		free(heap.pMember);
+}
+
+/* thread body of radius_many */
+void kdtree_radius_batch(void* pArg, long nStart, long nEnd, int nThread)
+{
+	KdtreeBatch* pBatch = (KdtreeBatch*)pArg;
+	KdtreeObject* self = pBatch->self;
+	KdtreeList* pList = &pBatch->lists[nThread];
+	long i;
+
+	for (i = nStart; i < nEnd; i++)
+	{
+		pBatch->pThread[i] = nThread;
+		pBatch->pStart[i] = pList->nSize;
+		if (self->nMembers && !kdtree_radius(self, 0, 0, self->nMembers, &pBatch->pQueries[i * 3], pBatch->dRadius2, pList))
+		{
+			pBatch->bFailed = 1;
+			pBatch->pCount[i] = 0;
+			continue;
+		}
+		pBatch->pCount[i] = pList->nSize - pBatch->pStart[i];
+	}
+}
+
+
+int Kdtree_init(KdtreeObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *points, *objects = Py_None;
+	PyObject *pFastO = NULL;
+	double *pPos = NULL;
+	long *pOrder = NULL;
+	long nLeafSize = 8, n, nNodes, i;
+
+    if (!PyArg_ParseTuple(args, "O|Ol", &points, &objects, &nLeafSize))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (nLeafSize < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "leaf size must be positive");
+		return -1;
+	}
+	if (self->nBusy)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "kdtree is in use by a batch query");
+		return -1;
+	}
+
+	kdtree_clear(self);
+	self->nLeafSize = nLeafSize;
+	self->pPos = kdtree_read_points(points, &n);
+	if (!self->pPos)
+		return -1;
+	if (objects != Py_None)
+	{
+		pFastO = PySequence_Fast(objects, "objects must be a sequence");
+		if (!pFastO)
+			goto error;
+		if (PySequence_Fast_GET_SIZE(pFastO) != n)
+		{
+			PyErr_SetString(PyExc_ValueError, "points and objects differ in length");
+			goto error;
+		}
+	}
+
+	/* deep enough that every node at the last level is a leaf */
+	nNodes = 1;
+	for (i = n; i > nLeafSize; i = (i + 1) / 2)
+		nNodes = (nNodes * 2) + 1;
+
+	pOrder = (long*)malloc((n ? n : 1) * sizeof(long));
+	pPos = (double*)malloc((n ? n : 1) * 3 * sizeof(double));
+	self->pIndex = (long*)malloc((n ? n : 1) * sizeof(long));
+	self->pSplit = (double*)malloc(nNodes * sizeof(double));
+	self->pAxis = (unsigned char*)calloc(nNodes, sizeof(unsigned char));
+	if (pFastO)
+		self->pObjects = (PyObject**)calloc(n ? n : 1, sizeof(PyObject*));
+	if (!pOrder || !pPos || !self->pIndex || !self->pSplit || !self->pAxis || (pFastO && !self->pObjects))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	self->nNodes = nNodes;
+
+	for (i = 0; i < n; i++)
+		pOrder[i] = i;
+	kdtree_build(self, pOrder, 0, 0, n);
+
+	/* store the members in tree order so leaves are contiguous */
+	for (i = 0; i < n; i++)
+	{
+		memcpy(&pPos[i * 3], &self->pPos[pOrder[i] * 3], 3 * sizeof(double));
+		self->pIndex[i] = pOrder[i];
+		if (pFastO)
+		{
+			self->pObjects[i] = PySequence_Fast_GET_ITEM(pFastO, pOrder[i]);
+			Py_INCREF(self->pObjects[i]);
+		}
+	}
+	free(self->pPos);
+	self->pPos = pPos;
+	self->nMembers = n;
+
+	free(pOrder);
+	Py_XDECREF(pFastO);
+	return 0;
+
+error:
+	if (pOrder)
+		free(pOrder);
+	if (pPos)
+		free(pPos);
+	kdtree_clear(self);
+	Py_XDECREF(pFastO);
+	return -1;
+}
+
+void Kdtree_dealloc(PyObject* self_in)
+{
+	kdtree_clear((KdtreeObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Kdtree_repr(PyObject *self_in)
+{
+	KdtreeObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Kdtree_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (KdtreeObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->nMembers);
+	fmtstring = PyString_FromString("<kdtree of %d points>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Kdtree_len(PyObject *self_in)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+
+	return self->nMembers;
+}
+
+/* the nearest member to an object or vect as (member, distance), or None */
+PyObject* Kdtree_nearest(PyObject *self_in, PyObject *args)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+	PyObject *other;
+	KdtreeHeap heap;
+	double q[3], d;
+	long j;
+
+    if (!PyArg_ParseTuple(args, "O", &other))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(other, q))
+		return NULL;
+	if (!self->nMembers)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	heap.pDist = &d;
+	heap.pMember = &j;
+	heap.nSize = 0;
+	heap.nK = 1;
+	kdtree_knn(self, 0, 0, self->nMembers, q, &heap);
+	return Py_BuildValue("(Nd)", kdtree_result(self, j), sqrt(d));
+}
+
+/* the k nearest members as a list of (member, distance), nearest first */
+PyObject* Kdtree_knearest(PyObject *self_in, PyObject *args)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+	PyObject *other, *rv;
+	KdtreeBatch batch;
+	double q[3];
+	long nK, i;
+
+    if (!PyArg_ParseTuple(args, "Ol", &other, &nK))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (nK < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "k must be positive");
+		return NULL;
+	}
+	if (!cgrid_read_pos(other, q))
+		return NULL;
+
+	batch.self = self;
+	batch.pQueries = q;
+	batch.nK = nK;
+	batch.bFailed = 0;
+	batch.pMember = (long*)malloc(nK * sizeof(long));
+	batch.pDist = (double*)malloc(nK * sizeof(double));
+	if (batch.pMember && batch.pDist)
+		kdtree_knn_batch(&batch, 0, 1, 0);
+	if (!batch.pMember || !batch.pDist || batch.bFailed)
+	{
+		if (batch.pMember)
+			free(batch.pMember);
+		if (batch.pDist)
+			free(batch.pDist);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+
+	for (i = 0; i < nK && batch.pMember[i] >= 0; i++)
+		;
+	rv = PyList_New(i);
+	for (i = 0; rv && i < PyList_GET_SIZE(rv); i++)
+		PyList_SET_ITEM(rv, i, Py_BuildValue("(Nd)", kdtree_result(self, batch.pMember[i]), batch.pDist[i]));
+	free(batch.pMember);
+	free(batch.pDist);
+	return rv;
+}
+
+PyObject* Kdtree_get_radius(PyObject *self_in, PyObject *args)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+	PyObject *other, *pItem;
+	ObarrObject *rv;
+	KdtreeList list;
+	double q[3], dRadius;
+	long i;
+	int bOk;
+
+    if (!PyArg_ParseTuple(args, "Od", &other, &dRadius))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(other, q))
+		return NULL;
+
+	list.pData = NULL;
+	list.nSize = 0;
+	list.nAlloc = 0;
+	bOk = !self->nMembers || dRadius < 0.0 || kdtree_radius(self, 0, 0, self->nMembers, q, SQR(dRadius), &list);
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	for (i = 0; bOk && i < list.nSize; i++)
+	{
+		pItem = kdtree_result(self, list.pData[i]);
+		bOk = pItem && obarr_append(rv, pItem);
+		Py_XDECREF(pItem);
+	}
+	if (list.pData)
+		free(list.pData);
+	if (!bOk)
+	{
+		Py_DECREF(rv);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+/* k nearest (default 1) of each query point, searched on several threads */
+/* (default one per processor) with the GIL released.  Returns flat arrays */
+/* (members, distances) of k entries per query, nearest first, padded */
+/* with None and 0.0 where the tree has fewer than k members. */
+PyObject* Kdtree_nearest_many(PyObject *self_in, PyObject *args)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+	PyObject *points, *pItem, *pD;
+	ObarrObject *pMembers = NULL, *pDists = NULL;
+	KdtreeBatch batch;
+	long nK = 1, n, i;
+	int nThreads = 0;
+	int bOk = 1;
+
+    if (!PyArg_ParseTuple(args, "O|li", &points, &nK, &nThreads))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (nK < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "k must be positive");
+		return NULL;
+	}
+
+	memset(&batch, 0, sizeof(batch));
+	batch.self = self;
+	batch.nK = nK;
+	batch.pQueries = kdtree_read_points(points, &n);
+	if (!batch.pQueries)
+		return NULL;
+	batch.pMember = (long*)malloc((n ? n : 1) * nK * sizeof(long));
+	batch.pDist = (double*)malloc((n ? n : 1) * nK * sizeof(double));
+	if (!batch.pMember || !batch.pDist)
+	{
+		bOk = 0;
+		goto done;
+	}
+
+	nThreads = threads_pick(nThreads, n, KDTREE_MIN_BATCH);
+	self->nBusy++;
+	Py_BEGIN_ALLOW_THREADS
+	threads_run(kdtree_knn_batch, &batch, n, nThreads);
+	Py_END_ALLOW_THREADS
+	self->nBusy--;
+	if (batch.bFailed)
+	{
+		bOk = 0;
+		goto done;
+	}
+
+	pMembers = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pMembers, NULL, NULL);
+	pDists = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pDists, NULL, NULL);
+	for (i = 0; bOk && i < n * nK; i++)
+	{
+		if (batch.pMember[i] >= 0)
+			pItem = kdtree_result(self, batch.pMember[i]);
+		else
+		{
+			Py_INCREF(Py_None);
+			pItem = Py_None;
+		}
+		pD = PyFloat_FromDouble(batch.pDist[i]);
+		bOk = pItem && pD && obarr_append(pMembers, pItem) && obarr_append(pDists, pD);
+		Py_XDECREF(pItem);
+		Py_XDECREF(pD);
+	}
+
+done:
+	free(batch.pQueries);
+	if (batch.pMember)
+		free(batch.pMember);
+	if (batch.pDist)
+		free(batch.pDist);
+	if (!bOk)
+	{
+		Py_XDECREF(pMembers);
+		Py_XDECREF(pDists);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", pMembers, pDists);
+}
+
+/* members within a radius of each query point, searched on several */
+/* threads with the GIL released.  Returns a list of arrays, one per query. */
+PyObject* Kdtree_radius_many(PyObject *self_in, PyObject *args)
+{
+	KdtreeObject *self = (KdtreeObject*)self_in;
+	PyObject *points, *pItem;
+	PyObject *rv = NULL;
+	ObarrObject *pOut;
+	KdtreeBatch batch;
+	KdtreeList *pList;
+	double dRadius;
+	long n, i, j;
+	int nThreads = 0;
+	int bOk = 1;
+
+    if (!PyArg_ParseTuple(args, "Od|i", &points, &dRadius, &nThreads))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+
+	memset(&batch, 0, sizeof(batch));
+	batch.self = self;
+	batch.dRadius2 = dRadius < 0.0 ? -1.0 : SQR(dRadius);
+	batch.pQueries = kdtree_read_points(points, &n);
+	if (!batch.pQueries)
+		return NULL;
+	batch.pThread = (int*)malloc((n ? n : 1) * sizeof(int));
+	batch.pStart = (long*)malloc((n ? n : 1) * sizeof(long));
+	batch.pCount = (long*)malloc((n ? n : 1) * sizeof(long));
+	if (!batch.pThread || !batch.pStart || !batch.pCount)
+	{
+		bOk = 0;
+		goto done;
+	}
+
+	nThreads = threads_pick(nThreads, n, KDTREE_MIN_BATCH);
+	self->nBusy++;
+	Py_BEGIN_ALLOW_THREADS
+	threads_run(kdtree_radius_batch, &batch, n, nThreads);
+	Py_END_ALLOW_THREADS
+	self->nBusy--;
+	if (batch.bFailed)
+	{
+		bOk = 0;
+		goto done;
+	}
+
+	rv = PyList_New(n);
+	if (!rv)
+		goto done;
+	for (i = 0; bOk && i < n; i++)
+	{
+		pOut = PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init(pOut, NULL, NULL);
+		PyList_SET_ITEM(rv, i, (PyObject*)pOut);
+		pList = &batch.lists[batch.pThread[i]];
+		for (j = batch.pStart[i]; bOk && j < batch.pStart[i] + batch.pCount[i]; j++)
+		{
+			pItem = kdtree_result(self, pList->pData[j]);
+			bOk = pItem && obarr_append(pOut, pItem);
+			Py_XDECREF(pItem);
+		}
+	}
+
+done:
+	free(batch.pQueries);
+	if (batch.pThread)
+		free(batch.pThread);
+	if (batch.pStart)
+		free(batch.pStart);
+	if (batch.pCount)
+		free(batch.pCount);
+	for (i = 0; i < THREADS_MAX; i++)
+	{
+		if (batch.lists[i].pData)
+			free(batch.lists[i].pData);
+	}
+	if (!bOk)
+	{
+		Py_XDECREF(rv);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return rv;
+}
+
+
+
+PySequenceMethods Kdtree_as_seq[] = {
+	Kdtree_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Kdtree_methods[] = {
+	{"nearest", (PyCFunction)Kdtree_nearest, METH_VARARGS, "find the nearest point to an object or vect as (member, distance)"},
+	{"knearest", (PyCFunction)Kdtree_knearest, METH_VARARGS, "find the k nearest points as (member, distance) tuples, nearest first"},
+	{"get_radius", (PyCFunction)Kdtree_get_radius, METH_VARARGS, "find the points within a radius of an object or vect"},
+	{"nearest_many", (PyCFunction)Kdtree_nearest_many, METH_VARARGS, "k nearest points of many queries on several threads, as flat (members, distances) arrays"},
+	{"radius_many", (PyCFunction)Kdtree_radius_many, METH_VARARGS, "points within a radius of many queries on several threads, as a list of arrays"},
+	{NULL}
+};
+
+struct PyMemberDef Kdtree_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject KdtreeObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.kdtree",		/* tp_name        */
+	sizeof(KdtreeObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Kdtree_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Kdtree_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Kdtree_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Static k-d tree over points with threaded batch queries.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Kdtree_methods,   /* tp_methods        */
+	Kdtree_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Kdtree_init,		/* tp_init           */
+};
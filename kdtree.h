@@ -0,0 +1,99 @@
+#ifndef KDTREE_H_INCLUDED
+#define KDTREE_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+#include "threads.h"
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+/* the tree is implicit: node i covers members lo .. hi, its children are */
+/* 2i + 1 over lo .. mid and 2i + 2 over mid .. hi with mid = (lo + hi) / 2, */
+/* and it is a leaf when it holds nLeafSize members or fewer.  Only the */
+/* split axis and value of each node are stored. */
+typedef struct KdtreeObject {
+	PyObject_HEAD
+	long			nMembers;
+	double*			pPos;		/* xyz of each member in tree order */
+	long*			pIndex;		/* original index of each member */
+	PyObject**		pObjects;	/* NULL if built without objects */
+	double*			pSplit;
+	unsigned char*	pAxis;
+	long			nNodes;
+	long			nLeafSize;
+	long			nBusy;		/* batch queries running without the GIL */
+} KdtreeObject;
+
+/* a max heap of the k best candidates of a query, by squared distance */
+typedef struct KdtreeHeap {
+	double*			pDist;
+	long*			pMember;
+	long			nSize;
+	long			nK;
+} KdtreeHeap;
+
+/* growable list of member numbers */
+typedef struct KdtreeList {
+	long*			pData;
+	long			nSize;
+	long			nAlloc;
+} KdtreeList;
+
+/* shared state of a batch query split over threads.  Nearest results are */
+/* rows of nK in pMember and pDist; radius results go to the list of the */
+/* thread that ran the query, at pStart for pCount members. */
+typedef struct KdtreeBatch {
+	KdtreeObject*	self;
+	double*			pQueries;
+	long			nK;
+	double			dRadius2;
+	long*			pMember;
+	double*			pDist;
+	KdtreeList		lists[THREADS_MAX];
+	int*			pThread;
+	long*			pStart;
+	long*			pCount;
+	int				bFailed;
+} KdtreeBatch;
+
+#define Kdtree_Check(op) PyObject_TypeCheck(op, &KdtreeObjectType)
+#define KDTREE_MIN_BATCH 256	/* fewest queries worth a thread */
+
+/* internal functions */
+void kdtree_clear(KdtreeObject* self);
+void kdtree_select(KdtreeObject* self, long* pOrder, long lo, long hi, long nth, int nAxis);
+void kdtree_build(KdtreeObject* self, long* pOrder, long i, long lo, long hi);
+void kdtree_heap_sift(KdtreeHeap* pHeap, long c, long n);
+void kdtree_heap_offer(KdtreeHeap* pHeap, double d, long j);
+void kdtree_heap_sort(KdtreeHeap* pHeap);
+void kdtree_knn(KdtreeObject* self, long i, long lo, long hi, double* q, KdtreeHeap* pHeap);
+int kdtree_list_add(KdtreeList* pList, long j);
+int kdtree_radius(KdtreeObject* self, long i, long lo, long hi, double* q, double dRadius2, KdtreeList* pList);
+PyObject* kdtree_result(KdtreeObject* self, long j);
+double* kdtree_read_points(PyObject* points, long* pnCount);
+void kdtree_knn_batch(void* pArg, long nStart, long nEnd, int nThread);
+void kdtree_radius_batch(void* pArg, long nStart, long nEnd, int nThread);
+
+/* exported API functions */
+int Kdtree_init(KdtreeObject *self, PyObject *args, PyObject *kwds);
+void Kdtree_dealloc(PyObject* self_in);
+PyObject* Kdtree_repr(PyObject *self_in);
+Py_ssize_t Kdtree_len(PyObject *self_in);
+PyObject* Kdtree_nearest(PyObject *self_in, PyObject *args);
+PyObject* Kdtree_knearest(PyObject *self_in, PyObject *args);
+PyObject* Kdtree_get_radius(PyObject *self_in, PyObject *args);
+PyObject* Kdtree_nearest_many(PyObject *self_in, PyObject *args);
+PyObject* Kdtree_radius_many(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Kdtree_as_seq[];
+extern PyMethodDef Kdtree_methods[];
+extern struct PyMemberDef Kdtree_members[];
+extern PyTypeObject KdtreeObjectType;
+
+#endif
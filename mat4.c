@@ -0,0 +1,550 @@
+#include "mat4.h"
+#include "quat.h"
+#include "vect.h"
+#include "obarr.h"
+#include "bodies.h"
+#include <math.h>
+#include <string.h>
+
+#define M(i, j) m[((j) * 4) + (i)]
+#define R(i, j) r[((j) * 4) + (i)]
+
+void mat4_identity(double* m)
+{
+	memset(m, 0, 16 * sizeof(double));
+	m[0] = m[5] = m[10] = m[15] = 1.0;
+}
+
+/* r = a * b, r not aliasing either.  Each column of r is a sum of the */
+/* columns of a scaled by one column of b; the inner loop runs down a */
+/* column so the compiler can keep it in vector registers. */
+void mat4_multiply_internal(const double* a, const double* b, double* r)
+{
+	int i, j;
+
+	for (j = 0; j < 4; j++)
+	{
+		for (i = 0; i < 4; i++)
+			r[(j * 4) + i] = (a[i] * b[j * 4]) + (a[4 + i] * b[(j * 4) + 1]) +
+				(a[8 + i] * b[(j * 4) + 2]) + (a[12 + i] * b[(j * 4) + 3]);
+	}
+}
+
+/* translate(t) * rotate(q) * scale(s) */
+void mat4_trs_internal(const double* t, const double* q, const double* s, double* m)
+{
+	double rot[9];
+	int i, j;
+
+	quat_matrix3_internal(q, rot);
+	for (j = 0; j < 3; j++)
+	{
+		for (i = 0; i < 3; i++)
+			M(i, j) = rot[(i * 3) + j] * s[j];
+		M(3, j) = 0.0;
+		M(j, 3) = t[j];
+	}
+	M(3, 3) = 1.0;
+}
+
+void mat4_transpose_internal(const double* m, double* r)
+{
+	int i, j;
+
+	for (j = 0; j < 4; j++)
+		for (i = 0; i < 4; i++)
+			R(i, j) = M(j, i);
+}
+
+/* the inverse by cofactors, sharing the 2x2 minors of the top and */
+/* bottom row pairs.  Returns 0 for a singular matrix. */
+int mat4_inverse_internal(const double* m, double* r)
+{
+	double a0, a1, a2, a3, a4, a5, b0, b1, b2, b3, b4, b5;
+	double det, inv;
+	int i;
+
+	a0 = M(0, 0) * M(1, 1) - M(0, 1) * M(1, 0);
+	a1 = M(0, 0) * M(1, 2) - M(0, 2) * M(1, 0);
+	a2 = M(0, 0) * M(1, 3) - M(0, 3) * M(1, 0);
+	a3 = M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1);
+	a4 = M(0, 1) * M(1, 3) - M(0, 3) * M(1, 1);
+	a5 = M(0, 2) * M(1, 3) - M(0, 3) * M(1, 2);
+	b0 = M(2, 0) * M(3, 1) - M(2, 1) * M(3, 0);
+	b1 = M(2, 0) * M(3, 2) - M(2, 2) * M(3, 0);
+	b2 = M(2, 0) * M(3, 3) - M(2, 3) * M(3, 0);
+	b3 = M(2, 1) * M(3, 2) - M(2, 2) * M(3, 1);
+	b4 = M(2, 1) * M(3, 3) - M(2, 3) * M(3, 1);
+	b5 = M(2, 2) * M(3, 3) - M(2, 3) * M(3, 2);
+	det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+	if (det == 0.0 || det != det)
+		return 0;
+
+	R(0, 0) = M(1, 1) * b5 - M(1, 2) * b4 + M(1, 3) * b3;
+	R(1, 0) = -M(1, 0) * b5 + M(1, 2) * b2 - M(1, 3) * b1;
+	R(2, 0) = M(1, 0) * b4 - M(1, 1) * b2 + M(1, 3) * b0;
+	R(3, 0) = -M(1, 0) * b3 + M(1, 1) * b1 - M(1, 2) * b0;
+	R(0, 1) = -M(0, 1) * b5 + M(0, 2) * b4 - M(0, 3) * b3;
+	R(1, 1) = M(0, 0) * b5 - M(0, 2) * b2 + M(0, 3) * b1;
+	R(2, 1) = -M(0, 0) * b4 + M(0, 1) * b2 - M(0, 3) * b0;
+	R(3, 1) = M(0, 0) * b3 - M(0, 1) * b1 + M(0, 2) * b0;
+	R(0, 2) = M(3, 1) * a5 - M(3, 2) * a4 + M(3, 3) * a3;
+	R(1, 2) = -M(3, 0) * a5 + M(3, 2) * a2 - M(3, 3) * a1;
+	R(2, 2) = M(3, 0) * a4 - M(3, 1) * a2 + M(3, 3) * a0;
+	R(3, 2) = -M(3, 0) * a3 + M(3, 1) * a1 - M(3, 2) * a0;
+	R(0, 3) = -M(2, 1) * a5 + M(2, 2) * a4 - M(2, 3) * a3;
+	R(1, 3) = M(2, 0) * a5 - M(2, 2) * a2 + M(2, 3) * a1;
+	R(2, 3) = -M(2, 0) * a4 + M(2, 1) * a2 - M(2, 3) * a0;
+	R(3, 3) = M(2, 0) * a3 - M(2, 1) * a1 + M(2, 2) * a0;
+
+	inv = 1.0 / det;
+	for (i = 0; i < 16; i++)
+		r[i] *= inv;
+	return 1;
+}
+
+/* the inverse of a matrix whose bottom row is 0, 0, 0, 1: the upper */
+/* 3x3 is inverted alone and the translation taken back through it. */
+/* Returns 0 for a singular 3x3. */
+int mat4_inverse_affine_internal(const double* m, double* r)
+{
+	double c0, c1, c2, det, inv;
+	int i, j;
+
+	c0 = M(1, 1) * M(2, 2) - M(1, 2) * M(2, 1);
+	c1 = M(1, 2) * M(2, 0) - M(1, 0) * M(2, 2);
+	c2 = M(1, 0) * M(2, 1) - M(1, 1) * M(2, 0);
+	det = M(0, 0) * c0 + M(0, 1) * c1 + M(0, 2) * c2;
+	if (det == 0.0 || det != det)
+		return 0;
+	inv = 1.0 / det;
+
+	R(0, 0) = c0 * inv;
+	R(1, 0) = c1 * inv;
+	R(2, 0) = c2 * inv;
+	R(0, 1) = (M(0, 2) * M(2, 1) - M(0, 1) * M(2, 2)) * inv;
+	R(1, 1) = (M(0, 0) * M(2, 2) - M(0, 2) * M(2, 0)) * inv;
+	R(2, 1) = (M(0, 1) * M(2, 0) - M(0, 0) * M(2, 1)) * inv;
+	R(0, 2) = (M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1)) * inv;
+	R(1, 2) = (M(0, 2) * M(1, 0) - M(0, 0) * M(1, 2)) * inv;
+	R(2, 2) = (M(0, 0) * M(1, 1) - M(0, 1) * M(1, 0)) * inv;
+
+	for (i = 0; i < 3; i++)
+	{
+		R(i, 3) = 0.0;
+		for (j = 0; j < 3; j++)
+			R(i, 3) -= R(i, j) * M(j, 3);
+		R(3, i) = 0.0;
+	}
+	R(3, 3) = 1.0;
+	return 1;
+}
+
+/* m times (v, 1) for a point, divided through by w when the matrix is */
+/* projective, or m times (v, 0) for a direction */
+void mat4_transform_internal(const double* m, const double* v, int bPoint, double* r)
+{
+	double w;
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		r[i] = (M(i, 0) * v[0]) + (M(i, 1) * v[1]) + (M(i, 2) * v[2]);
+		if (bPoint)
+			r[i] += M(i, 3);
+	}
+	if (!bPoint)
+		return;
+	w = (M(3, 0) * v[0]) + (M(3, 1) * v[1]) + (M(3, 2) * v[2]) + M(3, 3);
+	if (w != 1.0 && w != 0.0)
+	{
+		for (i = 0; i < 3; i++)
+			r[i] /= w;
+	}
+}
+
+void mat4_to_float(const double* m, float* f)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		f[i] = (float)m[i];
+}
+
+Mat4Object* mat4_new(const double* m)
+{
+	Mat4Object* rv = PyObject_New(Mat4Object, &Mat4ObjectType);
+
+	if (!rv)
+		return NULL;
+	memcpy(rv->m, m, 16 * sizeof(double));
+	mat4_to_float(rv->m, rv->f);
+	return rv;
+}
+
+
+/* mat4() is the identity, mat4(values) takes 16 numbers in column-major */
+/* order and mat4(pos, rot[, scale]) builds translate * rotate * scale */
+/* with scale a vect or one number. */
+int Mat4_init(Mat4Object *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *pA = NULL, *pB = NULL, *pC = NULL, *pFast;
+	double t[3], q[4], s[3] = {1.0, 1.0, 1.0};
+	long i;
+
+    if (!PyArg_ParseTuple(args, "|OOO", &pA, &pB, &pC))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+
+	if (!pA)
+		mat4_identity(self->m);
+	else if (!pB)
+	{
+		if (!(pFast = PySequence_Fast(pA, "expected a sequence of 16 numbers")))
+			return -1;
+		if (PySequence_Fast_GET_SIZE(pFast) != 16)
+		{
+			PyErr_SetString(PyExc_ValueError, "expected a sequence of 16 numbers");
+			Py_DECREF(pFast);
+			return -1;
+		}
+		for (i = 0; i < 16; i++)
+		{
+			self->m[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pFast, i));
+			if (PyErr_Occurred())
+			{
+				Py_DECREF(pFast);
+				return -1;
+			}
+		}
+		Py_DECREF(pFast);
+	}
+	else
+	{
+		if (!bodies_read_arg(pA, 0, t) || !bodies_read_arg(pB, 1, q))
+			return -1;
+		if (pC && PyNumber_Check(pC) && !Vect_Check(pC))
+		{
+			s[0] = s[1] = s[2] = PyFloat_AsDouble(pC);
+			if (PyErr_Occurred())
+				return -1;
+		}
+		else if (pC && !bodies_read_arg(pC, 0, s))
+			return -1;
+		mat4_trs_internal(t, q, s, self->m);
+	}
+	mat4_to_float(self->m, self->f);
+	return 0;
+}
+
+PyObject* Mat4_repr(PyObject *self_in)
+{
+	Mat4Object *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+	double *m;
+
+	if (!Mat4_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (Mat4Object*)self_in;
+	m = self->m;
+	tuple = Py_BuildValue("(dddddddddddddddd)", m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7],
+		m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]);
+	fmtstring = PyString_FromString("mat4(%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f)");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+/* mat4 * mat4 composes, mat4 * vect transforms a point */
+PyObject* Mat4_mul(PyObject *self_in, PyObject *other_in)
+{
+	Mat4Object *self;
+	VectObject *rv;
+	double m[16];
+
+	if (!Mat4_Check(self_in))
+	{
+		PyErr_SetString(PyExc_TypeError, "incorrect object type received");
+		return NULL;
+	}
+	self = (Mat4Object*)self_in;
+
+	if (Mat4_Check(other_in))
+	{
+		mat4_multiply_internal(self->m, ((Mat4Object*)other_in)->m, m);
+		return (PyObject*)mat4_new(m);
+	}
+	else if (Vect_Check(other_in))
+	{
+		rv = PyObject_New(VectObject, &VectObjectType);
+		if (!rv)
+			return NULL;
+		mat4_transform_internal(self->m, ((VectObject*)other_in)->elements, 1, rv->elements);
+		return (PyObject*)rv;
+	}
+	PyErr_SetString(PyExc_TypeError, "mat4 can only be multiplied by a mat4 or vector");
+	return NULL;
+}
+
+Py_ssize_t Mat4_len(PyObject *self_in)
+{
+	return 16;
+}
+
+PyObject* Mat4_item(PyObject *self_in, Py_ssize_t index)
+{
+	if (index < 0 || index >= 16)
+	{
+		PyErr_SetString(PyExc_IndexError, "index not in range");
+		return NULL;
+	}
+	return PyFloat_FromDouble(((Mat4Object*)self_in)->m[index]);
+}
+
+PyObject* Mat4_inverse(PyObject *self_in, PyObject *unused)
+{
+	double m[16];
+
+	if (!mat4_inverse_internal(((Mat4Object*)self_in)->m, m))
+	{
+		PyErr_SetString(PyExc_ValueError, "matrix is singular");
+		return NULL;
+	}
+	return (PyObject*)mat4_new(m);
+}
+
+PyObject* Mat4_inverse_affine(PyObject *self_in, PyObject *unused)
+{
+	Mat4Object *self = (Mat4Object*)self_in;
+	double m[16];
+
+	if (self->m[3] != 0.0 || self->m[7] != 0.0 || self->m[11] != 0.0 || self->m[15] != 1.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "matrix is not affine");
+		return NULL;
+	}
+	if (!mat4_inverse_affine_internal(self->m, m))
+	{
+		PyErr_SetString(PyExc_ValueError, "matrix is singular");
+		return NULL;
+	}
+	return (PyObject*)mat4_new(m);
+}
+
+PyObject* Mat4_transpose(PyObject *self_in, PyObject *unused)
+{
+	double m[16];
+
+	mat4_transpose_internal(((Mat4Object*)self_in)->m, m);
+	return (PyObject*)mat4_new(m);
+}
+
+/* one vect gives one vect back, a sequence of them an obarr */
+PyObject* mat4_transform(PyObject *self_in, PyObject *args, int bPoint)
+{
+	Mat4Object *self = (Mat4Object*)self_in;
+	PyObject *pIn, *pFast;
+	ObarrObject *rv;
+	VectObject *pVect;
+	double v[3];
+	long n, i;
+
+    if (!PyArg_ParseTuple(args, "O", &pIn))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (Vect_Check(pIn))
+	{
+		pVect = PyObject_New(VectObject, &VectObjectType);
+		if (pVect)
+			mat4_transform_internal(self->m, ((VectObject*)pIn)->elements, bPoint, pVect->elements);
+		return (PyObject*)pVect;
+	}
+
+	if (!(pFast = PySequence_Fast(pIn, "expected a vect or a sequence of vects")))
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, n))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (!bodies_read_arg(PySequence_Fast_GET_ITEM(pFast, i), 0, v))
+			goto error;
+		pVect = PyObject_New(VectObject, &VectObjectType);
+		if (!pVect)
+			goto error;
+		mat4_transform_internal(self->m, v, bPoint, pVect->elements);
+		obarr_set_element(rv, i, (PyObject*)pVect);
+		Py_DECREF(pVect);
+	}
+	Py_DECREF(pFast);
+	return (PyObject*)rv;
+
+error:
+	Py_DECREF(pFast);
+	Py_DECREF(rv);
+	return NULL;
+}
+
+PyObject* Mat4_transform_point(PyObject *self_in, PyObject *args)
+{
+	return mat4_transform(self_in, args, 1);
+}
+
+PyObject* Mat4_transform_dir(PyObject *self_in, PyObject *args)
+{
+	return mat4_transform(self_in, args, 0);
+}
+
+/* the old style buffer interface: one read-only segment of 16 floats */
+Py_ssize_t Mat4_getreadbuffer(PyObject *self_in, Py_ssize_t nSegment, void **ppData)
+{
+	if (nSegment != 0)
+	{
+		PyErr_SetString(PyExc_SystemError, "accessing non-existent mat4 segment");
+		return -1;
+	}
+	*ppData = ((Mat4Object*)self_in)->f;
+	return 16 * sizeof(float);
+}
+
+Py_ssize_t Mat4_getsegcount(PyObject *self_in, Py_ssize_t *pnLen)
+{
+	if (pnLen)
+		*pnLen = 16 * sizeof(float);
+	return 1;
+}
+
+/* the new style buffer interface, for memoryview */
+int Mat4_getbuffer(PyObject *self_in, Py_buffer *view, int flags)
+{
+	return PyBuffer_FillInfo(view, self_in, ((Mat4Object*)self_in)->f, 16 * sizeof(float), 1, flags);
+}
+
+
+
+PyNumberMethods Mat4_as_number[] = {
+    0,                  /* nb_add */
+    0,                  /* nb_subtract */
+    Mat4_mul,           /* nb_multiply */
+    0,                  /* nb_divide */
+    0,                  /* nb_remainder */
+    0,                  /* nb_divmod */
+    0,                  /* nb_power */
+    0,                  /* nb_negative */
+    0,                  /* nb_positive */
+    0,                  /* nb_absolute */
+    0,                  /* nb_nonzero */
+    0,                  /* nb_invert */
+    0,                  /* nb_lshift */
+    0,                  /* nb_rshift */
+    0,                  /* nb_and */
+    0,                  /* nb_xor */
+    0,                  /* nb_or */
+    0,                  /* nb_coerce */
+    0,                  /* nb_int */
+    0,                  /* nb_long */
+    0,                  /* nb_float */
+    0,                  /* nb_oct */
+    0,                  /* nb_hex */
+    0,                  /* nb_inplace_add */
+    0,                  /* nb_inplace_subtract */
+    0,                  /* nb_inplace_multiply */
+    0,                  /* nb_inplace_divide */
+    0,                  /* nb_inplace_remainder */
+    0,                  /* nb_inplace_power */
+    0,                  /* nb_inplace_lshift */
+    0,                  /* nb_inplace_rshift */
+    0,                  /* nb_inplace_and */
+    0,                  /* nb_inplace_xor */
+    0,                  /* nb_inplace_or */
+    0,                  /* nb_floordiv */
+    0,                  /* nb_truediv */
+    0,                  /* nb_inplace_floordiv */
+    0,                  /* nb_inplace_truediv */
+
+};
+
+PySequenceMethods Mat4_as_seq[] = {
+	Mat4_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	Mat4_item,			/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyBufferProcs Mat4_as_buffer[] = {
+	(readbufferproc)Mat4_getreadbuffer,	/* bf_getreadbuffer */
+	0,					/* bf_getwritebuffer */
+	(segcountproc)Mat4_getsegcount,		/* bf_getsegcount */
+	(charbufferproc)Mat4_getreadbuffer,	/* bf_getcharbuffer */
+	(getbufferproc)Mat4_getbuffer,		/* bf_getbuffer */
+	0,					/* bf_releasebuffer */
+};
+
+PyMethodDef Mat4_methods[] = {
+	{"inverse", (PyCFunction)Mat4_inverse, METH_NOARGS, "general inverse of the matrix"},
+	{"inverse_affine", (PyCFunction)Mat4_inverse_affine, METH_NOARGS, "inverse of an affine matrix, cheaper than inverse"},
+	{"transpose", (PyCFunction)Mat4_transpose, METH_NOARGS, "transposed copy of the matrix"},
+	{"transform_point", (PyCFunction)Mat4_transform_point, METH_VARARGS, "transform a point, or a sequence of points into an obarr"},
+	{"transform_dir", (PyCFunction)Mat4_transform_dir, METH_VARARGS, "transform a direction without translating, or a sequence of them into an obarr"},
+	{NULL}
+};
+
+struct PyMemberDef Mat4_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject Mat4ObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.mat4",		/* tp_name        */
+	sizeof(Mat4Object),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	0,				/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Mat4_repr,	    /* tp_repr        */
+	Mat4_as_number,	/* tp_as_number   */
+	Mat4_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	Mat4_as_buffer,	/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES|Py_TPFLAGS_HAVE_NEWBUFFER,		/* tp_flags       */
+	"4x4 matrix in column-major order; the buffer interface gives its 16 floats.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Mat4_methods,   /* tp_methods        */
+	Mat4_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Mat4_init,		/* tp_init           */
+};
@@ -0,0 +1,56 @@
+#ifndef MAT4_H_INCLUDED
+#define MAT4_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+/* a 4x4 matrix in column-major order, as OpenGL takes it: element */
+/* (row, col) is m[col * 4 + row] and the translation is m[12 .. 14]. */
+/* A mat4 never changes after init; the float copy in f is what the */
+/* buffer interface hands out for uploading. */
+typedef struct Mat4Object {
+	PyObject_HEAD
+	double			m[16];
+	float			f[16];
+} Mat4Object;
+
+#define Mat4_Check(op) PyObject_TypeCheck(op, &Mat4ObjectType)
+
+/* internal functions */
+void mat4_identity(double* m);
+void mat4_multiply_internal(const double* a, const double* b, double* r);
+void mat4_trs_internal(const double* t, const double* q, const double* s, double* m);
+void mat4_transpose_internal(const double* m, double* r);
+int mat4_inverse_internal(const double* m, double* r);
+int mat4_inverse_affine_internal(const double* m, double* r);
+void mat4_transform_internal(const double* m, const double* v, int bPoint, double* r);
+void mat4_to_float(const double* m, float* f);
+Mat4Object* mat4_new(const double* m);
+PyObject* mat4_transform(PyObject *self_in, PyObject *args, int bPoint);
+
+/* exported API functions */
+int Mat4_init(Mat4Object *self, PyObject *args, PyObject *kwds);
+PyObject* Mat4_repr(PyObject *self_in);
+PyObject* Mat4_mul(PyObject *self_in, PyObject *other_in);
+Py_ssize_t Mat4_len(PyObject *self_in);
+PyObject* Mat4_item(PyObject *self_in, Py_ssize_t index);
+PyObject* Mat4_inverse(PyObject *self_in, PyObject *unused);
+PyObject* Mat4_inverse_affine(PyObject *self_in, PyObject *unused);
+PyObject* Mat4_transpose(PyObject *self_in, PyObject *unused);
+PyObject* Mat4_transform_point(PyObject *self_in, PyObject *args);
+PyObject* Mat4_transform_dir(PyObject *self_in, PyObject *args);
+
+extern PyNumberMethods Mat4_as_number[];
+extern PySequenceMethods Mat4_as_seq[];
+extern PyBufferProcs Mat4_as_buffer[];
+extern PyMethodDef Mat4_methods[];
+extern struct PyMemberDef Mat4_members[];
+extern PyTypeObject Mat4ObjectType;
+
+#endif
@@ -0,0 +1,1016 @@
+#include "mesh.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include "vect.h"
+#include "quat.h"
+#include <math.h>
+#include <string.h>
+
+#define MESH_MAX_BINS 64
+#define MESH_MAX_LEAF 16	/* larger leaves are split even at a loss */
+
+void mesh_clear(MeshObject* self)
+{
+	if (self->pVerts)
+		free(self->pVerts);
+	if (self->pTris)
+		free(self->pTris);
+	if (self->pOrder)
+		free(self->pOrder);
+	if (self->pNodes)
+		free(self->pNodes);
+	self->pVerts = NULL;
+	self->pTris = NULL;
+	self->pOrder = NULL;
+	self->pNodes = NULL;
+	self->nVerts = 0;
+	self->nTris = 0;
+	self->nNodes = 0;
+}
+
+static double mesh_area(double* min, double* max)
+{
+	double dx = max[0] - min[0];
+	double dy = max[1] - min[1];
+	double dz = max[2] - min[2];
+
+	return (dx * dy) + (dy * dz) + (dz * dx);
+}
+
+static void mesh_grow(double* min, double* max, double* bmin, double* bmax)
+{
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		if (bmin[k] < min[k])
+			min[k] = bmin[k];
+		if (bmax[k] > max[k])
+			max[k] = bmax[k];
+	}
+}
+
+void mesh_node_bounds(MeshObject* self, MeshBuild* pBuild, MeshNode* pNode)
+{
+	long j, t;
+
+	t = self->pOrder[pNode->nFirst];
+	memcpy(pNode->min, &pBuild->pMin[t * 3], sizeof(pNode->min));
+	memcpy(pNode->max, &pBuild->pMax[t * 3], sizeof(pNode->max));
+	for (j = pNode->nFirst + 1; j < pNode->nFirst + pNode->nCount; j++)
+	{
+		t = self->pOrder[j];
+		mesh_grow(pNode->min, pNode->max, &pBuild->pMin[t * 3], &pBuild->pMax[t * 3]);
+	}
+}
+
+/* splits nodes top down by the surface area heuristic, evaluated on */
+/* nBins equal bins of the centroid bounds along each axis.  pStack holds */
+/* (node, depth) pairs; depth is capped so queries fit MESH_STACK. */
+void mesh_build(MeshObject* self, MeshBuild* pBuild, long* pStack)
+{
+	MeshNode* pNode;
+	double binMin[MESH_MAX_BINS][3], binMax[MESH_MAX_BINS][3];
+	double leftArea[MESH_MAX_BINS];
+	long binCount[MESH_MAX_BINS];
+	double cmin[3], cmax[3], lmin[3], lmax[3], rmin[3], rmax[3];
+	double dExt, dCost, dBest, dLeaf;
+	double* c;
+	long nTop, nNode, nDepth, nLeftCount, nRight, nBest, nBestAxis, nLeft, i, j, t, tmp;
+	int nBins = (int)self->nBins;
+	int k, b;
+
+	nTop = 0;
+	pStack[nTop++] = 0;
+	pStack[nTop++] = 0;
+	while (nTop > 0)
+	{
+		nDepth = pStack[--nTop];
+		nNode = pStack[--nTop];
+		pNode = &self->pNodes[nNode];
+		mesh_node_bounds(self, pBuild, pNode);
+		if (pNode->nCount <= self->nLeafSize || nDepth >= MESH_STACK - 2)
+			continue;
+
+		c = &pBuild->pCent[self->pOrder[pNode->nFirst] * 3];
+		memcpy(cmin, c, sizeof(cmin));
+		memcpy(cmax, c, sizeof(cmax));
+		for (j = pNode->nFirst + 1; j < pNode->nFirst + pNode->nCount; j++)
+		{
+			c = &pBuild->pCent[self->pOrder[j] * 3];
+			mesh_grow(cmin, cmax, c, c);
+		}
+
+		dBest = -1.0;
+		nBest = 0;
+		nBestAxis = 0;
+		for (k = 0; k < 3; k++)
+		{
+			dExt = cmax[k] - cmin[k];
+			if (dExt <= 0.0)
+				continue;
+			for (b = 0; b < nBins; b++)
+				binCount[b] = 0;
+			for (j = pNode->nFirst; j < pNode->nFirst + pNode->nCount; j++)
+			{
+				t = self->pOrder[j];
+				b = (int)(((pBuild->pCent[(t * 3) + k] - cmin[k]) / dExt) * nBins);
+				if (b >= nBins)
+					b = nBins - 1;
+				if (!binCount[b]++)
+				{
+					memcpy(binMin[b], &pBuild->pMin[t * 3], sizeof(binMin[b]));
+					memcpy(binMax[b], &pBuild->pMax[t * 3], sizeof(binMax[b]));
+				}
+				else
+					mesh_grow(binMin[b], binMax[b], &pBuild->pMin[t * 3], &pBuild->pMax[t * 3]);
+			}
+
+			/* sweep from the left recording areas, then from the right */
+			nLeftCount = 0;
+			for (b = 0; b < nBins - 1; b++)
+			{
+				if (binCount[b])
+				{
+					if (!nLeftCount)
+					{
+						memcpy(lmin, binMin[b], sizeof(lmin));
+						memcpy(lmax, binMax[b], sizeof(lmax));
+					}
+					else
+						mesh_grow(lmin, lmax, binMin[b], binMax[b]);
+					nLeftCount += binCount[b];
+				}
+				leftArea[b] = nLeftCount ? mesh_area(lmin, lmax) * nLeftCount : 0.0;
+			}
+			nRight = 0;
+			for (b = nBins - 1; b > 0; b--)
+			{
+				if (binCount[b])
+				{
+					if (!nRight)
+					{
+						memcpy(rmin, binMin[b], sizeof(rmin));
+						memcpy(rmax, binMax[b], sizeof(rmax));
+					}
+					else
+						mesh_grow(rmin, rmax, binMin[b], binMax[b]);
+					nRight += binCount[b];
+				}
+				if (!nRight || nRight == pNode->nCount)
+					continue;
+				dCost = leftArea[b - 1] + (mesh_area(rmin, rmax) * nRight);
+				if (dBest < 0.0 || dCost < dBest)
+				{
+					dBest = dCost;
+					nBest = b;
+					nBestAxis = k;
+				}
+			}
+		}
+
+		/* a leaf costs area * count, a split one traversal plus its halves */
+		dLeaf = mesh_area(pNode->min, pNode->max) * pNode->nCount;
+		if (dBest < 0.0 || (dBest + mesh_area(pNode->min, pNode->max) >= dLeaf && pNode->nCount <= MESH_MAX_LEAF))
+			continue;
+
+		k = (int)nBestAxis;
+		dExt = cmax[k] - cmin[k];
+		i = pNode->nFirst;
+		j = pNode->nFirst + pNode->nCount - 1;
+		while (i <= j)
+		{
+			t = self->pOrder[i];
+			b = (int)(((pBuild->pCent[(t * 3) + k] - cmin[k]) / dExt) * nBins);
+			if (b >= nBins)
+				b = nBins - 1;
+			if (b < nBest)
+				i++;
+			else
+			{
+				tmp = self->pOrder[i]; self->pOrder[i] = self->pOrder[j]; self->pOrder[j] = tmp;
+				j--;
+			}
+		}
+		nLeft = i - pNode->nFirst;
+		if (nLeft == 0 || nLeft == pNode->nCount)
+			continue;
+
+		i = self->nNodes;
+		self->nNodes += 2;
+		self->pNodes[i].nFirst = pNode->nFirst;
+		self->pNodes[i].nCount = nLeft;
+		self->pNodes[i + 1].nFirst = pNode->nFirst + nLeft;
+		self->pNodes[i + 1].nCount = pNode->nCount - nLeft;
+		pNode->nFirst = i;
+		pNode->nCount = 0;
+		pStack[nTop++] = i;
+		pStack[nTop++] = nDepth + 1;
+		pStack[nTop++] = i + 1;
+		pStack[nTop++] = nDepth + 1;
+	}
+}
+
+/* reads an optional quat and vect placing the mesh; None is identity */
+int mesh_read_xform(PyObject* pRot, PyObject* pPos, MeshXform* pX)
+{
+	memset(pX, 0, sizeof(MeshXform));
+	pX->rot[0] = pX->rot[4] = pX->rot[8] = 1.0;
+	pX->bIdentity = 1;
+	if (pRot && pRot != Py_None)
+	{
+		if (!Quat_Check(pRot))
+		{
+			PyErr_SetString(PyExc_TypeError, "rotation must be a quat");
+			return 0;
+		}
+		quat_matrix3_internal(((QuatObject*)pRot)->elements, pX->rot);
+		pX->bIdentity = 0;
+	}
+	if (pPos && pPos != Py_None)
+	{
+		if (!cgrid_read_pos(pPos, pX->pos))
+			return 0;
+		pX->bIdentity = 0;
+	}
+	return 1;
+}
+
+/* world to mesh space; directions skip the translation */
+void mesh_to_local(MeshXform* pX, double* w, double* l, int bPoint)
+{
+	double v[3];
+	int k;
+
+	for (k = 0; k < 3; k++)
+		v[k] = bPoint ? w[k] - pX->pos[k] : w[k];
+	for (k = 0; k < 3; k++)
+		l[k] = (pX->rot[k] * v[0]) + (pX->rot[3 + k] * v[1]) + (pX->rot[6 + k] * v[2]);
+}
+
+void mesh_to_world(MeshXform* pX, double* l, double* w, int bPoint)
+{
+	double v[3];
+	int k;
+
+	for (k = 0; k < 3; k++)
+		v[k] = (pX->rot[k * 3] * l[0]) + (pX->rot[(k * 3) + 1] * l[1]) + (pX->rot[(k * 3) + 2] * l[2]);
+	for (k = 0; k < 3; k++)
+		w[k] = bPoint ? v[k] + pX->pos[k] : v[k];
+}
+
+/* entry fraction of the segment o + t * d, 0 <= t <= tmax, into a node */
+int mesh_ray_box(MeshNode* pNode, double* o, double* d, double tmax, double* pT)
+{
+	double t0 = 0.0, t1 = tmax;
+
+	if (!cgrid_clip_slab(o[0], d[0], pNode->min[0], pNode->max[0], &t0, &t1) ||
+		!cgrid_clip_slab(o[1], d[1], pNode->min[1], pNode->max[1], &t0, &t1) ||
+		!cgrid_clip_slab(o[2], d[2], pNode->min[2], pNode->max[2], &t0, &t1))
+		return 0;
+	*pT = t0;
+	return 1;
+}
+
+/* Moller-Trumbore, both sides, hits only closer than tmax */
+int mesh_ray_tri(MeshObject* self, long nTri, double* o, double* d, double tmax, double* pT)
+{
+	double *v0, *v1, *v2;
+	double e1[3], e2[3], p[3], s[3], q[3];
+	double det, inv, u, v, t;
+	int k;
+
+	v0 = &self->pVerts[self->pTris[nTri * 3] * 3];
+	v1 = &self->pVerts[self->pTris[(nTri * 3) + 1] * 3];
+	v2 = &self->pVerts[self->pTris[(nTri * 3) + 2] * 3];
+	for (k = 0; k < 3; k++)
+	{
+		e1[k] = v1[k] - v0[k];
+		e2[k] = v2[k] - v0[k];
+		s[k] = o[k] - v0[k];
+	}
+	p[0] = (d[1] * e2[2]) - (d[2] * e2[1]);
+	p[1] = (d[2] * e2[0]) - (d[0] * e2[2]);
+	p[2] = (d[0] * e2[1]) - (d[1] * e2[0]);
+	det = (e1[0] * p[0]) + (e1[1] * p[1]) + (e1[2] * p[2]);
+	if (fabs(det) < 1e-300)
+		return 0;
+	inv = 1.0 / det;
+	u = ((s[0] * p[0]) + (s[1] * p[1]) + (s[2] * p[2])) * inv;
+	if (u < 0.0 || u > 1.0)
+		return 0;
+	q[0] = (s[1] * e1[2]) - (s[2] * e1[1]);
+	q[1] = (s[2] * e1[0]) - (s[0] * e1[2]);
+	q[2] = (s[0] * e1[1]) - (s[1] * e1[0]);
+	v = ((d[0] * q[0]) + (d[1] * q[1]) + (d[2] * q[2])) * inv;
+	if (v < 0.0 || u + v > 1.0)
+		return 0;
+	t = ((e2[0] * q[0]) + (e2[1] * q[1]) + (e2[2] * q[2])) * inv;
+	if (t < 0.0 || t > tmax)
+		return 0;
+	*pT = t;
+	return 1;
+}
+
+/* unit normal by the right hand rule over the vertex order */
+void mesh_tri_normal(MeshObject* self, long nTri, double* n)
+{
+	double *v0, *v1, *v2;
+	double e1[3], e2[3], len;
+	int k;
+
+	v0 = &self->pVerts[self->pTris[nTri * 3] * 3];
+	v1 = &self->pVerts[self->pTris[(nTri * 3) + 1] * 3];
+	v2 = &self->pVerts[self->pTris[(nTri * 3) + 2] * 3];
+	for (k = 0; k < 3; k++)
+	{
+		e1[k] = v1[k] - v0[k];
+		e2[k] = v2[k] - v0[k];
+	}
+	n[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+	n[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+	n[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+	len = sqrt(SQR(n[0]) + SQR(n[1]) + SQR(n[2]));
+	if (len > 0.0)
+	{
+		for (k = 0; k < 3; k++)
+			n[k] /= len;
+	}
+}
+
+/* closest point on a triangle, after Ericson 5.1.5 */
+void mesh_closest_on_tri(MeshObject* self, long nTri, double* p, double* rv)
+{
+	double *a, *b, *c;
+	double ab[3], ac[3], ap[3], bp[3], cp[3];
+	double d1, d2, d3, d4, d5, d6, va, vb, vc, v, w, denom;
+	int k;
+
+	a = &self->pVerts[self->pTris[nTri * 3] * 3];
+	b = &self->pVerts[self->pTris[(nTri * 3) + 1] * 3];
+	c = &self->pVerts[self->pTris[(nTri * 3) + 2] * 3];
+	for (k = 0; k < 3; k++)
+	{
+		ab[k] = b[k] - a[k];
+		ac[k] = c[k] - a[k];
+		ap[k] = p[k] - a[k];
+		bp[k] = p[k] - b[k];
+		cp[k] = p[k] - c[k];
+	}
+
+	d1 = (ab[0] * ap[0]) + (ab[1] * ap[1]) + (ab[2] * ap[2]);
+	d2 = (ac[0] * ap[0]) + (ac[1] * ap[1]) + (ac[2] * ap[2]);
+	if (d1 <= 0.0 && d2 <= 0.0)
+	{
+		memcpy(rv, a, 3 * sizeof(double));
+		return;
+	}
+	d3 = (ab[0] * bp[0]) + (ab[1] * bp[1]) + (ab[2] * bp[2]);
+	d4 = (ac[0] * bp[0]) + (ac[1] * bp[1]) + (ac[2] * bp[2]);
+	if (d3 >= 0.0 && d4 <= d3)
+	{
+		memcpy(rv, b, 3 * sizeof(double));
+		return;
+	}
+	vc = (d1 * d4) - (d3 * d2);
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+	{
+		v = d1 / (d1 - d3);
+		for (k = 0; k < 3; k++)
+			rv[k] = a[k] + (ab[k] * v);
+		return;
+	}
+	d5 = (ab[0] * cp[0]) + (ab[1] * cp[1]) + (ab[2] * cp[2]);
+	d6 = (ac[0] * cp[0]) + (ac[1] * cp[1]) + (ac[2] * cp[2]);
+	if (d6 >= 0.0 && d5 <= d6)
+	{
+		memcpy(rv, c, 3 * sizeof(double));
+		return;
+	}
+	vb = (d5 * d2) - (d1 * d6);
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+	{
+		w = d2 / (d2 - d6);
+		for (k = 0; k < 3; k++)
+			rv[k] = a[k] + (ac[k] * w);
+		return;
+	}
+	va = (d3 * d6) - (d5 * d4);
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+	{
+		w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for (k = 0; k < 3; k++)
+			rv[k] = b[k] + ((c[k] - b[k]) * w);
+		return;
+	}
+	denom = va + vb + vc;
+	if (denom == 0.0)
+	{
+		memcpy(rv, a, 3 * sizeof(double));
+		return;
+	}
+	v = vb / denom;
+	w = vc / denom;
+	for (k = 0; k < 3; k++)
+		rv[k] = a[k] + (ab[k] * v) + (ac[k] * w);
+}
+
+/* nearest triangle hit by o + t * d within *pT, which is updated; -1 if none */
+long mesh_raycast(MeshObject* self, double* o, double* d, double* pT)
+{
+	long pStack[MESH_STACK];
+	MeshNode* pNode;
+	double t, tl, tr;
+	long nTop, nHit, i, j;
+	int bl, br;
+
+	nHit = -1;
+	nTop = 0;
+	if (self->nNodes && mesh_ray_box(&self->pNodes[0], o, d, *pT, &t))
+		pStack[nTop++] = 0;
+	while (nTop > 0)
+	{
+		pNode = &self->pNodes[pStack[--nTop]];
+		if (pNode->nCount)
+		{
+			for (j = pNode->nFirst; j < pNode->nFirst + pNode->nCount; j++)
+			{
+				i = self->pOrder[j];
+				if (mesh_ray_tri(self, i, o, d, *pT, &t))
+				{
+					*pT = t;
+					nHit = i;
+				}
+			}
+			continue;
+		}
+		/* push the farther child first so the nearer is searched first */
+		bl = mesh_ray_box(&self->pNodes[pNode->nFirst], o, d, *pT, &tl);
+		br = mesh_ray_box(&self->pNodes[pNode->nFirst + 1], o, d, *pT, &tr);
+		if (bl && br && tl < tr)
+		{
+			pStack[nTop++] = pNode->nFirst + 1;
+			pStack[nTop++] = pNode->nFirst;
+		}
+		else
+		{
+			if (bl)
+				pStack[nTop++] = pNode->nFirst;
+			if (br)
+				pStack[nTop++] = pNode->nFirst + 1;
+		}
+	}
+	return nHit;
+}
+
+/* traces up to MESH_PACKET rays together: a node is opened once for every */
+/* ray of the packet that reaches it, sharing the traversal and the loads */
+/* of its triangles.  pT holds each ray's limit and gets its hit fraction. */
+void mesh_raycast_packet(MeshObject* self, int nRays, double (*o)[3], double (*d)[3], double* pT, long* pTri)
+{
+	long pStack[MESH_STACK];
+	MeshNode* pNode;
+	double t;
+	long nTop, i, j;
+	int bAny, r;
+
+	for (r = 0; r < nRays; r++)
+		pTri[r] = -1;
+	nTop = 0;
+	if (self->nNodes)
+		pStack[nTop++] = 0;
+	while (nTop > 0)
+	{
+		pNode = &self->pNodes[pStack[--nTop]];
+		bAny = 0;
+		for (r = 0; r < nRays && !bAny; r++)
+			bAny = mesh_ray_box(pNode, o[r], d[r], pT[r], &t);
+		if (!bAny)
+			continue;
+		if (!pNode->nCount)
+		{
+			pStack[nTop++] = pNode->nFirst + 1;
+			pStack[nTop++] = pNode->nFirst;
+			continue;
+		}
+		for (j = pNode->nFirst; j < pNode->nFirst + pNode->nCount; j++)
+		{
+			i = self->pOrder[j];
+			for (r = 0; r < nRays; r++)
+			{
+				if (mesh_ray_tri(self, i, o[r], d[r], pT[r], &t))
+				{
+					pT[r] = t;
+					pTri[r] = i;
+				}
+			}
+		}
+	}
+}
+
+/* nearest point of the mesh to p closer than sqrt(dMax2); -1 if none */
+long mesh_closest(MeshObject* self, double* p, double dMax2, double* pt, double* pD2)
+{
+	long pStack[MESH_STACK];
+	MeshNode* pNode;
+	double q[3], d2, dl, dr;
+	long nTop, nBest, i, j, l;
+
+	nBest = -1;
+	*pD2 = dMax2;
+	nTop = 0;
+	if (self->nNodes)
+		pStack[nTop++] = 0;
+	while (nTop > 0)
+	{
+		pNode = &self->pNodes[pStack[--nTop]];
+		if (pNode->nCount)
+		{
+			for (j = pNode->nFirst; j < pNode->nFirst + pNode->nCount; j++)
+			{
+				i = self->pOrder[j];
+				mesh_closest_on_tri(self, i, p, q);
+				d2 = SQR(q[0] - p[0]) + SQR(q[1] - p[1]) + SQR(q[2] - p[2]);
+				if (d2 <= *pD2)
+				{
+					*pD2 = d2;
+					nBest = i;
+					memcpy(pt, q, sizeof(q));
+				}
+			}
+			continue;
+		}
+		l = pNode->nFirst;
+		dl = 0.0;
+		dr = 0.0;
+		for (i = 0; i < 3; i++)
+		{
+			if (p[i] < self->pNodes[l].min[i])
+				dl += SQR(self->pNodes[l].min[i] - p[i]);
+			else if (p[i] > self->pNodes[l].max[i])
+				dl += SQR(p[i] - self->pNodes[l].max[i]);
+			if (p[i] < self->pNodes[l + 1].min[i])
+				dr += SQR(self->pNodes[l + 1].min[i] - p[i]);
+			else if (p[i] > self->pNodes[l + 1].max[i])
+				dr += SQR(p[i] - self->pNodes[l + 1].max[i]);
+		}
+		if (dl <= dr)
+		{
+			if (dr <= *pD2)
+				pStack[nTop++] = l + 1;
+			if (dl <= *pD2)
+				pStack[nTop++] = l;
+		}
+		else
+		{
+			if (dl <= *pD2)
+				pStack[nTop++] = l;
+			if (dr <= *pD2)
+				pStack[nTop++] = l + 1;
+		}
+	}
+	return nBest;
+}
+
+PyObject* mesh_vect(double* v)
+{
+	VectObject* rv;
+
+	rv = PyObject_New(VectObject, &VectObjectType);
+	if (rv)
+		memcpy(rv->elements, v, 3 * sizeof(double));
+	return (PyObject*)rv;
+}
+
+
+int Mesh_init(MeshObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *verts, *indices;
+	PyObject *pFastV = NULL, *pFastI = NULL;
+	MeshBuild build;
+	long *pStack = NULL;
+	long nLeafSize = 4, nBins = 12, n, i, j, t;
+	double *v;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "OO|ll", &verts, &indices, &nLeafSize, &nBins))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (nLeafSize < 1 || nBins < 2 || nBins > MESH_MAX_BINS)
+	{
+		PyErr_SetString(PyExc_ValueError, "leaf size must be positive and bins from 2 to 64");
+		return -1;
+	}
+
+	mesh_clear(self);
+	memset(&build, 0, sizeof(build));
+	self->nLeafSize = nLeafSize;
+	self->nBins = nBins;
+	if (!(pFastV = PySequence_Fast(verts, "vertices must be a sequence of vects")) ||
+		!(pFastI = PySequence_Fast(indices, "indices must be a flat sequence of ints")))
+		goto error;
+	if (PySequence_Fast_GET_SIZE(pFastI) % 3)
+	{
+		PyErr_SetString(PyExc_ValueError, "index count is not a multiple of 3");
+		goto error;
+	}
+	self->nVerts = PySequence_Fast_GET_SIZE(pFastV);
+	self->nTris = PySequence_Fast_GET_SIZE(pFastI) / 3;
+	n = self->nTris ? self->nTris : 1;
+
+	self->pVerts = (double*)malloc((self->nVerts ? self->nVerts : 1) * 3 * sizeof(double));
+	self->pTris = (long*)malloc(n * 3 * sizeof(long));
+	self->pOrder = (long*)malloc(n * sizeof(long));
+	self->pNodes = (MeshNode*)malloc(((2 * n) - 1) * sizeof(MeshNode));
+	pStack = (long*)malloc(4 * n * sizeof(long));
+	build.pMin = (double*)malloc(n * 3 * sizeof(double));
+	build.pMax = (double*)malloc(n * 3 * sizeof(double));
+	build.pCent = (double*)malloc(n * 3 * sizeof(double));
+	if (!self->pVerts || !self->pTris || !self->pOrder || !self->pNodes || !pStack ||
+		!build.pMin || !build.pMax || !build.pCent)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+
+	for (i = 0; i < self->nVerts; i++)
+	{
+		if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastV, i), &self->pVerts[i * 3]))
+			goto error;
+	}
+	for (i = 0; i < self->nTris * 3; i++)
+	{
+		j = PyInt_AsLong(PySequence_Fast_GET_ITEM(pFastI, i));
+		if (j == -1 && PyErr_Occurred())
+			goto error;
+		if (j < 0 || j >= self->nVerts)
+		{
+			PyErr_SetString(PyExc_IndexError, "vertex index out of range");
+			goto error;
+		}
+		self->pTris[i] = j;
+	}
+
+	for (t = 0; t < self->nTris; t++)
+	{
+		self->pOrder[t] = t;
+		for (k = 0; k < 3; k++)
+		{
+			v = &self->pVerts[(self->pTris[(t * 3) + k] * 3)];
+			if (k == 0)
+			{
+				memcpy(&build.pMin[t * 3], v, 3 * sizeof(double));
+				memcpy(&build.pMax[t * 3], v, 3 * sizeof(double));
+			}
+			else
+				mesh_grow(&build.pMin[t * 3], &build.pMax[t * 3], v, v);
+		}
+		for (k = 0; k < 3; k++)
+			build.pCent[(t * 3) + k] = (build.pMin[(t * 3) + k] + build.pMax[(t * 3) + k]) * 0.5;
+	}
+
+	if (self->nTris)
+	{
+		self->nNodes = 1;
+		self->pNodes[0].nFirst = 0;
+		self->pNodes[0].nCount = self->nTris;
+		mesh_build(self, &build, pStack);
+	}
+
+	free(pStack);
+	free(build.pMin);
+	free(build.pMax);
+	free(build.pCent);
+	Py_DECREF(pFastV);
+	Py_DECREF(pFastI);
+	return 0;
+
+error:
+	if (pStack)
+		free(pStack);
+	if (build.pMin)
+		free(build.pMin);
+	if (build.pMax)
+		free(build.pMax);
+	if (build.pCent)
+		free(build.pCent);
+	mesh_clear(self);
+	Py_XDECREF(pFastV);
+	Py_XDECREF(pFastI);
+	return -1;
+}
+
+void Mesh_dealloc(PyObject* self_in)
+{
+	mesh_clear((MeshObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Mesh_repr(PyObject *self_in)
+{
+	MeshObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Mesh_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (MeshObject*)self_in;
+	tuple = Py_BuildValue("(lll)", self->nTris, self->nVerts, self->nNodes);
+	fmtstring = PyString_FromString("<mesh of %d triangles, %d vertices, %d nodes>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Mesh_len(PyObject *self_in)
+{
+	MeshObject *self = (MeshObject*)self_in;
+
+	return self->nTris;
+}
+
+/* first hit of the segment start-end on the mesh placed by rot and pos, */
+/* as (triangle, t, point, normal) in world space, or None */
+PyObject* Mesh_raycast(PyObject *self_in, PyObject *args)
+{
+	MeshObject *self = (MeshObject*)self_in;
+	PyObject *pStart, *pEnd, *pRot = NULL, *pPos = NULL;
+	MeshXform x;
+	double start[3], end[3], o[3], d[3], n[3], pt[3], t = 1.0;
+	long nTri;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "OO|OO", &pStart, &pEnd, &pRot, &pPos))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pStart, start) || !cgrid_read_pos(pEnd, end) || !mesh_read_xform(pRot, pPos, &x))
+		return NULL;
+
+	for (k = 0; k < 3; k++)
+		end[k] -= start[k];
+	mesh_to_local(&x, start, o, 1);
+	mesh_to_local(&x, end, d, 0);
+	nTri = mesh_raycast(self, o, d, &t);
+	if (nTri < 0)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	for (k = 0; k < 3; k++)
+		pt[k] = start[k] + (end[k] * t);
+	mesh_tri_normal(self, nTri, d);
+	mesh_to_world(&x, d, n, 0);
+	return Py_BuildValue("(ldNN)", nTri, t, mesh_vect(pt), mesh_vect(n));
+}
+
+/* many segments against the mesh in packets of MESH_PACKET, returning */
+/* flat arrays (triangles, fractions) with None for a miss */
+PyObject* Mesh_raycast_many(PyObject *self_in, PyObject *args)
+{
+	MeshObject *self = (MeshObject*)self_in;
+	PyObject *pStarts, *pEnds, *pRot = NULL, *pPos = NULL;
+	PyObject *pFastS = NULL, *pFastE = NULL, *pA, *pB;
+	ObarrObject *pTris = NULL, *pTs = NULL;
+	MeshXform x;
+	double o[MESH_PACKET][3], d[MESH_PACKET][3], t[MESH_PACKET];
+	double start[3], end[3];
+	long tri[MESH_PACKET];
+	long n, i;
+	int nRays, r, k, bOk = 1;
+
+    if (!PyArg_ParseTuple(args, "OO|OO", &pStarts, &pEnds, &pRot, &pPos))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!mesh_read_xform(pRot, pPos, &x))
+		return NULL;
+	if (!(pFastS = PySequence_Fast(pStarts, "starts must be a sequence of vects")) ||
+		!(pFastE = PySequence_Fast(pEnds, "ends must be a sequence of vects")))
+		goto error;
+	n = PySequence_Fast_GET_SIZE(pFastS);
+	if (PySequence_Fast_GET_SIZE(pFastE) != n)
+	{
+		PyErr_SetString(PyExc_ValueError, "starts and ends differ in length");
+		goto error;
+	}
+
+	pTris = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pTris, NULL, NULL);
+	pTs = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pTs, NULL, NULL);
+	for (i = 0; bOk && i < n; i += nRays)
+	{
+		nRays = (n - i < MESH_PACKET) ? (int)(n - i) : MESH_PACKET;
+		for (r = 0; r < nRays; r++)
+		{
+			if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastS, i + r), start) ||
+				!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastE, i + r), end))
+				goto error;
+			for (k = 0; k < 3; k++)
+				end[k] -= start[k];
+			mesh_to_local(&x, start, o[r], 1);
+			mesh_to_local(&x, end, d[r], 0);
+			t[r] = 1.0;
+		}
+		mesh_raycast_packet(self, nRays, o, d, t, tri);
+		for (r = 0; bOk && r < nRays; r++)
+		{
+			if (tri[r] < 0)
+			{
+				bOk = obarr_append(pTris, Py_None) && obarr_append(pTs, Py_None);
+				continue;
+			}
+			pA = PyInt_FromLong(tri[r]);
+			pB = PyFloat_FromDouble(t[r]);
+			bOk = pA && pB && obarr_append(pTris, pA) && obarr_append(pTs, pB);
+			Py_XDECREF(pA);
+			Py_XDECREF(pB);
+		}
+	}
+	if (!bOk)
+	{
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+
+	Py_DECREF(pFastS);
+	Py_DECREF(pFastE);
+	return Py_BuildValue("(NN)", pTris, pTs);
+
+error:
+	Py_XDECREF(pFastS);
+	Py_XDECREF(pFastE);
+	Py_XDECREF(pTris);
+	Py_XDECREF(pTs);
+	return NULL;
+}
+
+/* triangles touching a sphere, as an array of triangle numbers */
+PyObject* Mesh_sphere_overlap(PyObject *self_in, PyObject *args)
+{
+	MeshObject *self = (MeshObject*)self_in;
+	PyObject *pCenter, *pRot = NULL, *pPos = NULL, *pItem;
+	ObarrObject *rv;
+	MeshXform x;
+	MeshNode *pNode;
+	long pStack[MESH_STACK];
+	double w[3], p[3], q[3], dRadius, d2;
+	long nTop, i, j;
+	int k, bOk = 1;
+
+    if (!PyArg_ParseTuple(args, "Od|OO", &pCenter, &dRadius, &pRot, &pPos))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pCenter, w) || !mesh_read_xform(pRot, pPos, &x))
+		return NULL;
+	mesh_to_local(&x, w, p, 1);
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	nTop = 0;
+	if (self->nNodes && dRadius >= 0.0)
+		pStack[nTop++] = 0;
+	while (bOk && nTop > 0)
+	{
+		pNode = &self->pNodes[pStack[--nTop]];
+		d2 = 0.0;
+		for (k = 0; k < 3; k++)
+		{
+			if (p[k] < pNode->min[k])
+				d2 += SQR(pNode->min[k] - p[k]);
+			else if (p[k] > pNode->max[k])
+				d2 += SQR(p[k] - pNode->max[k]);
+		}
+		if (d2 > SQR(dRadius))
+			continue;
+		if (!pNode->nCount)
+		{
+			pStack[nTop++] = pNode->nFirst + 1;
+			pStack[nTop++] = pNode->nFirst;
+			continue;
+		}
+		for (j = pNode->nFirst; bOk && j < pNode->nFirst + pNode->nCount; j++)
+		{
+			i = self->pOrder[j];
+			mesh_closest_on_tri(self, i, p, q);
+			if (SQR(q[0] - p[0]) + SQR(q[1] - p[1]) + SQR(q[2] - p[2]) > SQR(dRadius))
+				continue;
+			pItem = PyInt_FromLong(i);
+			bOk = pItem && obarr_append(rv, pItem);
+			Py_XDECREF(pItem);
+		}
+	}
+	if (!bOk)
+	{
+		Py_DECREF(rv);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+/* nearest point of the mesh to a point, as (triangle, point, distance) */
+/* in world space, or None for an empty mesh */
+PyObject* Mesh_closest_point(PyObject *self_in, PyObject *args)
+{
+	MeshObject *self = (MeshObject*)self_in;
+	PyObject *pPoint, *pRot = NULL, *pPos = NULL;
+	MeshXform x;
+	double w[3], p[3], q[3], d2;
+	long nTri;
+
+    if (!PyArg_ParseTuple(args, "O|OO", &pPoint, &pRot, &pPos))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pPoint, w) || !mesh_read_xform(pRot, pPos, &x))
+		return NULL;
+	mesh_to_local(&x, w, p, 1);
+
+	nTri = mesh_closest(self, p, HUGE_VAL, q, &d2);
+	if (nTri < 0)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	mesh_to_world(&x, q, w, 1);
+	return Py_BuildValue("(lNd)", nTri, mesh_vect(w), sqrt(d2));
+}
+
+
+
+PySequenceMethods Mesh_as_seq[] = {
+	Mesh_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Mesh_methods[] = {
+	{"raycast", (PyCFunction)Mesh_raycast, METH_VARARGS, "first hit of a segment (start, end) as (triangle, t, point, normal), with an optional rot and pos placing the mesh"},
+	{"raycast_many", (PyCFunction)Mesh_raycast_many, METH_VARARGS, "trace many segments in packets, returning flat (triangles, fractions) arrays"},
+	{"sphere_overlap", (PyCFunction)Mesh_sphere_overlap, METH_VARARGS, "find the triangles touching a sphere (center, radius)"},
+	{"closest_point", (PyCFunction)Mesh_closest_point, METH_VARARGS, "nearest point of the mesh as (triangle, point, distance)"},
+	{NULL}
+};
+
+struct PyMemberDef Mesh_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject MeshObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.mesh",		/* tp_name        */
+	sizeof(MeshObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Mesh_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Mesh_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Mesh_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Triangle mesh with a bounding volume hierarchy for ray and sphere queries.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Mesh_methods,   /* tp_methods        */
+	Mesh_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Mesh_init,		/* tp_init           */
+};
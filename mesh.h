@@ -0,0 +1,87 @@
+#ifndef MESH_H_INCLUDED
+#define MESH_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+/* bounding volume hierarchy node.  A leaf holds nCount triangles from */
+/* pOrder[nFirst]; an internal node has nCount 0 and its two children at */
+/* nFirst and nFirst + 1. */
+typedef struct MeshNode {
+	double			min[3];
+	double			max[3];
+	long			nFirst;
+	long			nCount;
+} MeshNode;
+
+typedef struct MeshObject {
+	PyObject_HEAD
+	double*			pVerts;		/* xyz per vertex */
+	long			nVerts;
+	long*			pTris;		/* three vertex indices per triangle */
+	long			nTris;
+	long*			pOrder;		/* triangles in leaf order */
+	MeshNode*		pNodes;
+	long			nNodes;
+	long			nLeafSize;
+	long			nBins;
+} MeshObject;
+
+/* placement of the mesh in the world, world = rot * local + pos */
+typedef struct MeshXform {
+	double			rot[9];
+	double			pos[3];
+	int				bIdentity;
+} MeshXform;
+
+/* scratch for building: per-triangle bounds and centroids */
+typedef struct MeshBuild {
+	double*			pMin;
+	double*			pMax;
+	double*			pCent;
+} MeshBuild;
+
+#define Mesh_Check(op) PyObject_TypeCheck(op, &MeshObjectType)
+#define MESH_PACKET 8		/* rays traced together by raycast_many */
+#define MESH_STACK 128
+
+/* internal functions */
+void mesh_clear(MeshObject* self);
+void mesh_node_bounds(MeshObject* self, MeshBuild* pBuild, MeshNode* pNode);
+void mesh_build(MeshObject* self, MeshBuild* pBuild, long* pStack);
+int mesh_read_xform(PyObject* pRot, PyObject* pPos, MeshXform* pX);
+void mesh_to_local(MeshXform* pX, double* w, double* l, int bPoint);
+void mesh_to_world(MeshXform* pX, double* l, double* w, int bPoint);
+int mesh_ray_box(MeshNode* pNode, double* o, double* d, double tmax, double* pT);
+int mesh_ray_tri(MeshObject* self, long nTri, double* o, double* d, double tmax, double* pT);
+void mesh_tri_normal(MeshObject* self, long nTri, double* n);
+void mesh_closest_on_tri(MeshObject* self, long nTri, double* p, double* rv);
+long mesh_raycast(MeshObject* self, double* o, double* d, double* pT);
+void mesh_raycast_packet(MeshObject* self, int nRays, double (*o)[3], double (*d)[3], double* pT, long* pTri);
+long mesh_closest(MeshObject* self, double* p, double dMax2, double* pt, double* pD2);
+PyObject* mesh_vect(double* v);
+
+/* exported API functions */
+int Mesh_init(MeshObject *self, PyObject *args, PyObject *kwds);
+void Mesh_dealloc(PyObject* self_in);
+PyObject* Mesh_repr(PyObject *self_in);
+Py_ssize_t Mesh_len(PyObject *self_in);
+PyObject* Mesh_raycast(PyObject *self_in, PyObject *args);
+PyObject* Mesh_raycast_many(PyObject *self_in, PyObject *args);
+PyObject* Mesh_sphere_overlap(PyObject *self_in, PyObject *args);
+PyObject* Mesh_closest_point(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Mesh_as_seq[];
+extern PyMethodDef Mesh_methods[];
+extern struct PyMemberDef Mesh_members[];
+extern PyTypeObject MeshObjectType;
+
+#endif
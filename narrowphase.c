@@ -0,0 +1,809 @@
+#include "narrowphase.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include "quat.h"
+#include <math.h>
+#include <string.h>
+
+#define NP_SPHERE_SPHERE	0
+#define NP_SPHERE_CAPSULE	1
+#define NP_CAPSULE_CAPSULE	2
+#define NP_OBB_OBB			3
+
+/* reads the 'rot' quat of an object as a matrix, the identity if missing */
+int narrowphase_read_rot(PyObject* other, double* m)
+{
+	PyObject* pAttr;
+
+	pAttr = PyObject_GetAttrString(other, "rot");
+	if (!pAttr)
+	{
+		PyErr_Clear();
+		memset(m, 0, 9 * sizeof(double));
+		m[0] = m[4] = m[8] = 1.0;
+		return 1;
+	}
+	if (!Quat_Check(pAttr))
+	{
+		Py_DECREF(pAttr);
+		PyErr_SetString(PyExc_TypeError, "invalid 'rot' attribute of object");
+		return 0;
+	}
+	quat_matrix3_internal(((QuatObject*)pAttr)->elements, m);
+	Py_DECREF(pAttr);
+	return 1;
+}
+
+int narrowphase_read_shape(PyObject* other, NarrowphaseShape* pShape, int bCapsule, int bBox)
+{
+	CgridEntry e;
+	PyObject* pAttr;
+
+	/* spheres have no rotation of their own, but the sweep in toi treats */
+	/* every shape as a segment through rot */
+	memset(pShape->rot, 0, sizeof(pShape->rot));
+	pShape->rot[0] = pShape->rot[4] = pShape->rot[8] = 1.0;
+	if (!cgrid_read_entry(other, &e))
+		return 0;
+	memcpy(pShape->pos, e.pos, sizeof(e.pos));
+	pShape->dRadius = e.dRadius;
+	pShape->dHalfLength = 0.0;
+	if (!bCapsule && !bBox)
+		return 1;
+	if (!narrowphase_read_rot(other, pShape->rot))
+		return 0;
+
+	if (bCapsule)
+	{
+		pAttr = PyObject_GetAttrString(other, "half_length");
+		if (!pAttr || (!PyFloat_Check(pAttr) && !PyInt_Check(pAttr)))
+		{
+			Py_XDECREF(pAttr);
+			PyErr_SetString(PyExc_TypeError, "missing or invalid 'half_length' attribute of object");
+			return 0;
+		}
+		pShape->dHalfLength = PyFloat_AsDouble(pAttr);
+		Py_DECREF(pAttr);
+	}
+	if (bBox)
+	{
+		pAttr = PyObject_GetAttrString(other, "half_extents");
+		if (!pAttr || !Vect_Check(pAttr))
+		{
+			Py_XDECREF(pAttr);
+			PyErr_SetString(PyExc_TypeError, "missing or invalid 'half_extents' attribute of object");
+			return 0;
+		}
+		memcpy(pShape->ext, ((VectObject*)pAttr)->elements, 3 * sizeof(double));
+		Py_DECREF(pAttr);
+	}
+	return 1;
+}
+
+/* end points of a capsule's segment */
+void narrowphase_segment(NarrowphaseShape* pShape, double* p, double* q)
+{
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		p[k] = pShape->pos[k] - (pShape->rot[(k * 3) + 1] * pShape->dHalfLength);
+		q[k] = pShape->pos[k] + (pShape->rot[(k * 3) + 1] * pShape->dHalfLength);
+	}
+}
+
+void narrowphase_closest_on_segment(double* p, double* q, double* c, double* rv)
+{
+	double d[3], w[3];
+	double t, dd;
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		d[k] = q[k] - p[k];
+		w[k] = c[k] - p[k];
+	}
+	dd = NP_DOT(d, d);
+	t = (dd > 0.0) ? NP_DOT(w, d) / dd : 0.0;
+	if (t < 0.0)
+		t = 0.0;
+	else if (t > 1.0)
+		t = 1.0;
+	for (k = 0; k < 3; k++)
+		rv[k] = p[k] + (d[k] * t);
+}
+
+/* closest points c1 on p1-q1 and c2 on p2-q2, after Ericson 5.1.9 */
+void narrowphase_closest_segments(double* p1, double* q1, double* p2, double* q2, double* c1, double* c2)
+{
+	double d1[3], d2[3], r[3];
+	double a, e, f, b, c, denom, s, t;
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		d1[k] = q1[k] - p1[k];
+		d2[k] = q2[k] - p2[k];
+		r[k] = p1[k] - p2[k];
+	}
+	a = NP_DOT(d1, d1);
+	e = NP_DOT(d2, d2);
+	f = NP_DOT(d2, r);
+
+	if (a <= 1e-12 && e <= 1e-12)
+	{
+		s = 0.0;
+		t = 0.0;
+	}
+	else if (a <= 1e-12)
+	{
+		s = 0.0;
+		t = f / e;
+		t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+	}
+	else
+	{
+		c = NP_DOT(d1, r);
+		if (e <= 1e-12)
+		{
+			t = 0.0;
+			s = -c / a;
+			s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+		}
+		else
+		{
+			b = NP_DOT(d1, d2);
+			denom = (a * e) - (b * b);
+			s = (denom > 0.0) ? ((b * f) - (c * e)) / denom : 0.0;
+			s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+			t = ((b * s) + f) / e;
+			if (t < 0.0)
+			{
+				t = 0.0;
+				s = -c / a;
+				s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+			}
+			else if (t > 1.0)
+			{
+				t = 1.0;
+				s = (b - c) / a;
+				s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+			}
+		}
+	}
+	for (k = 0; k < 3; k++)
+	{
+		c1[k] = p1[k] + (d1[k] * s);
+		c2[k] = p2[k] + (d2[k] * t);
+	}
+}
+
+/* contact of two spheres.  The point lies halfway through the overlap. */
+int narrowphase_spheres(double* ca, double ra, double* cb, double rb, double* n, double* pDepth, double* pt)
+{
+	double d[3];
+	double dist2, dist;
+	int k;
+
+	for (k = 0; k < 3; k++)
+		d[k] = cb[k] - ca[k];
+	dist2 = NP_DOT(d, d);
+	if (dist2 > SQR(ra + rb))
+		return 0;
+	dist = sqrt(dist2);
+	if (dist > 0.0)
+	{
+		for (k = 0; k < 3; k++)
+			n[k] = d[k] / dist;
+	}
+	else
+	{
+		n[0] = 0.0; n[1] = 1.0; n[2] = 0.0;
+	}
+	*pDepth = ra + rb - dist;
+	for (k = 0; k < 3; k++)
+		pt[k] = ca[k] + (n[k] * (ra - (*pDepth * 0.5)));
+	return 1;
+}
+
+/* corner of a box furthest along n * dSign */
+void narrowphase_obb_support(NarrowphaseShape* pBox, double ax[3][3], double* n, double dSign, double* rv)
+{
+	double d;
+	int i, k;
+
+	memcpy(rv, pBox->pos, 3 * sizeof(double));
+	for (i = 0; i < 3; i++)
+	{
+		d = (NP_DOT(ax[i], n) * dSign) < 0.0 ? -pBox->ext[i] : pBox->ext[i];
+		for (k = 0; k < 3; k++)
+			rv[k] += ax[i][k] * d;
+	}
+}
+
+/* moves a point onto the nearest point of a box if it lies outside */
+void narrowphase_obb_clamp(NarrowphaseShape* pBox, double ax[3][3], double* pt)
+{
+	double w[3];
+	double d;
+	int i, k;
+
+	for (k = 0; k < 3; k++)
+		w[k] = pt[k] - pBox->pos[k];
+	for (i = 0; i < 3; i++)
+	{
+		d = NP_DOT(w, ax[i]);
+		if (d > pBox->ext[i])
+			d -= pBox->ext[i];
+		else if (d < -pBox->ext[i])
+			d += pBox->ext[i];
+		else
+			continue;
+		for (k = 0; k < 3; k++)
+			pt[k] -= ax[i][k] * d;
+	}
+}
+
+/* separating axis test over the 3 + 3 face axes and 9 edge cross axes.  */
+/* The normal is the axis of least overlap; edge axes must beat face axes */
+/* clearly to be chosen.  The point is a single representative, not a */
+/* manifold: the midpoint of the supporting edges for an edge axis, else */
+/* the deepest corner of the other box moved halfway back through the */
+/* overlap and kept over the reference face. */
+int narrowphase_obb_obb(NarrowphaseShape* a, NarrowphaseShape* b, double* n, double* pDepth, double* pt)
+{
+	double axA[3][3], axB[3][3];
+	double t[3], L[3], pa[3], qa[3], pb[3], qb[3], ca[3], cb[3];
+	double dLen, ra, rb, dProj, dOverlap;
+	double dBest = -1.0;
+	int nBest = -1;
+	int i, j, k, nAxis;
+
+	for (i = 0; i < 3; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			axA[i][k] = a->rot[(k * 3) + i];
+			axB[i][k] = b->rot[(k * 3) + i];
+		}
+	}
+	for (k = 0; k < 3; k++)
+		t[k] = b->pos[k] - a->pos[k];
+
+	for (nAxis = 0; nAxis < 15; nAxis++)
+	{
+		if (nAxis < 3)
+			memcpy(L, axA[nAxis], sizeof(L));
+		else if (nAxis < 6)
+			memcpy(L, axB[nAxis - 3], sizeof(L));
+		else
+		{
+			i = (nAxis - 6) / 3;
+			j = (nAxis - 6) % 3;
+			L[0] = (axA[i][1] * axB[j][2]) - (axA[i][2] * axB[j][1]);
+			L[1] = (axA[i][2] * axB[j][0]) - (axA[i][0] * axB[j][2]);
+			L[2] = (axA[i][0] * axB[j][1]) - (axA[i][1] * axB[j][0]);
+		}
+		dLen = sqrt(NP_DOT(L, L));
+		if (dLen < 1e-6)
+			continue;	/* parallel edges, covered by the face axes */
+		for (k = 0; k < 3; k++)
+			L[k] /= dLen;
+
+		ra = 0.0;
+		rb = 0.0;
+		for (k = 0; k < 3; k++)
+		{
+			ra += a->ext[k] * fabs(NP_DOT(axA[k], L));
+			rb += b->ext[k] * fabs(NP_DOT(axB[k], L));
+		}
+		dProj = NP_DOT(t, L);
+		dOverlap = ra + rb - fabs(dProj);
+		if (dOverlap < 0.0)
+			return 0;
+		if (nBest < 0 || (nAxis < 6 ? dOverlap < dBest : dOverlap < dBest * 0.95))
+		{
+			dBest = dOverlap;
+			nBest = nAxis;
+			for (k = 0; k < 3; k++)
+				n[k] = dProj < 0.0 ? -L[k] : L[k];
+		}
+	}
+
+	*pDepth = dBest;
+	narrowphase_obb_support(a, axA, n, 1.0, pa);
+	narrowphase_obb_support(b, axB, n, -1.0, pb);
+	if (nBest >= 6)
+	{
+		/* the two supporting edges, each running back from its corner */
+		i = (nBest - 6) / 3;
+		j = (nBest - 6) % 3;
+		dProj = NP_DOT(axA[i], n) < 0.0 ? 2.0 * a->ext[i] : -2.0 * a->ext[i];
+		for (k = 0; k < 3; k++)
+			qa[k] = pa[k] + (axA[i][k] * dProj);
+		dProj = NP_DOT(axB[j], n) > 0.0 ? 2.0 * b->ext[j] : -2.0 * b->ext[j];
+		for (k = 0; k < 3; k++)
+			qb[k] = pb[k] + (axB[j][k] * dProj);
+		narrowphase_closest_segments(pa, qa, pb, qb, ca, cb);
+		for (k = 0; k < 3; k++)
+			pt[k] = (ca[k] + cb[k]) * 0.5;
+	}
+	else if (nBest >= 3)
+	{
+		/* a face of b: a's deepest corner, kept over that face */
+		for (k = 0; k < 3; k++)
+			pt[k] = pa[k] - (n[k] * (dBest * 0.5));
+		narrowphase_obb_clamp(b, axB, pt);
+	}
+	else
+	{
+		for (k = 0; k < 3; k++)
+			pt[k] = pb[k] + (n[k] * (dBest * 0.5));
+		narrowphase_obb_clamp(a, axA, pt);
+	}
+	return 1;
+}
+
+/* slab test of the segment start-end in the box frame.  *pT is the entry */
+/* fraction and n the world normal of the face entered; a segment starting */
+/* inside reports 0 and the reversed direction. */
+int narrowphase_ray_obb(double* start, double* end, NarrowphaseShape* b, double* n, double* pT, double* pt)
+{
+	double s[3], d[3], w[3], dw[3];
+	double t0 = 0.0, t1 = 1.0;
+	double ta, tb, tmp, sign, dLen;
+	int nAxis = -1;
+	int i, k;
+
+	for (k = 0; k < 3; k++)
+	{
+		w[k] = start[k] - b->pos[k];
+		dw[k] = end[k] - start[k];
+	}
+	for (i = 0; i < 3; i++)
+	{
+		s[i] = (b->rot[i] * w[0]) + (b->rot[3 + i] * w[1]) + (b->rot[6 + i] * w[2]);
+		d[i] = (b->rot[i] * dw[0]) + (b->rot[3 + i] * dw[1]) + (b->rot[6 + i] * dw[2]);
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		if (d[i] == 0.0)
+		{
+			if (s[i] < -b->ext[i] || s[i] > b->ext[i])
+				return 0;
+			continue;
+		}
+		ta = (-b->ext[i] - s[i]) / d[i];
+		tb = (b->ext[i] - s[i]) / d[i];
+		sign = -1.0;
+		if (ta > tb)
+		{
+			tmp = ta; ta = tb; tb = tmp;
+			sign = 1.0;
+		}
+		if (ta > t0)
+		{
+			t0 = ta;
+			nAxis = i;
+			for (k = 0; k < 3; k++)
+				n[k] = b->rot[(k * 3) + i] * sign;
+		}
+		if (tb < t1)
+			t1 = tb;
+		if (t0 > t1)
+			return 0;
+	}
+
+	if (nAxis < 0)
+	{
+		dLen = sqrt(NP_DOT(dw, dw));
+		for (k = 0; k < 3; k++)
+			n[k] = dLen > 0.0 ? -dw[k] / dLen : 0.0;
+	}
+	*pT = t0;
+	for (k = 0; k < 3; k++)
+		pt[k] = start[k] + (dw[k] * t0);
+	return 1;
+}
+
+/* reads start and end positions and, if given, start and end quats */
+int narrowphase_read_motion(PyObject* pStart, PyObject* pEnd, PyObject* pRot0, PyObject* pRot1, NarrowphaseMotion* pMotion)
+{
+	if (!cgrid_read_pos(pStart, pMotion->p0) || !cgrid_read_pos(pEnd, pMotion->p1))
+		return 0;
+	pMotion->bRot = 0;
+	pMotion->dAngle = 0.0;
+	if (!pRot0)
+		return 1;
+	if (!Quat_Check(pRot0) || !Quat_Check(pRot1))
+	{
+		PyErr_SetString(PyExc_TypeError, "rotations must be quats");
+		return 0;
+	}
+	memcpy(pMotion->q0, ((QuatObject*)pRot0)->elements, 4 * sizeof(double));
+	memcpy(pMotion->q1, ((QuatObject*)pRot1)->elements, 4 * sizeof(double));
+	pMotion->bRot = 1;
+	pMotion->dAngle = quat_slerp_internal(pMotion->q0, pMotion->q1, 0.0, pMotion->q0);
+	return 1;
+}
+
+/* places a shape at fraction t of its motion */
+void narrowphase_motion_at(NarrowphaseShape* pShape, NarrowphaseMotion* pMotion, double t)
+{
+	double q[4];
+	int k;
+
+	for (k = 0; k < 3; k++)
+		pShape->pos[k] = pMotion->p0[k] + ((pMotion->p1[k] - pMotion->p0[k]) * t);
+	if (pMotion->bRot)
+	{
+		quat_slerp_internal(pMotion->q0, pMotion->q1, t, q);
+		quat_matrix3_internal(q, pShape->rot);
+	}
+}
+
+/* conservative advancement: step by the distance over a bound on the */
+/* closing speed, which for a turning capsule adds the speed of its segment */
+/* ends.  The step never passes the first contact, so the time found is */
+/* the earliest one within dTol.  A pair touching at the start reports 0. */
+int narrowphase_toi_pair(NarrowphaseShape* a, NarrowphaseMotion* ma, NarrowphaseShape* b, NarrowphaseMotion* mb, double dTol, double* pT, double* n, double* pt)
+{
+	double pa[3], qa[3], pb[3], qb[3], ca[3], cb[3], v[3];
+	double t = 0.0, dDist, dLen, dBound;
+	int nIter, k;
+
+	for (k = 0; k < 3; k++)
+		v[k] = (ma->p1[k] - ma->p0[k]) - (mb->p1[k] - mb->p0[k]);
+
+	for (nIter = 0; nIter < NP_TOI_ITERATIONS; nIter++)
+	{
+		narrowphase_motion_at(a, ma, t);
+		narrowphase_motion_at(b, mb, t);
+		narrowphase_segment(a, pa, qa);
+		narrowphase_segment(b, pb, qb);
+		narrowphase_closest_segments(pa, qa, pb, qb, ca, cb);
+		for (k = 0; k < 3; k++)
+			n[k] = cb[k] - ca[k];
+		dLen = sqrt(NP_DOT(n, n));
+		if (dLen > 0.0)
+		{
+			for (k = 0; k < 3; k++)
+				n[k] /= dLen;
+		}
+		else
+		{
+			n[0] = 0.0; n[1] = 1.0; n[2] = 0.0;
+		}
+		dDist = dLen - a->dRadius - b->dRadius;
+		if (dDist <= dTol)
+			break;
+
+		dBound = NP_DOT(v, n) + (ma->dAngle * a->dHalfLength) + (mb->dAngle * b->dHalfLength);
+		if (dBound <= 0.0)
+			return 0;
+		t += dDist / dBound;
+		if (t > 1.0)
+			return 0;
+	}
+	/* a near miss can creep along without ever closing to dTol */
+	if (nIter == NP_TOI_ITERATIONS)
+		return 0;
+
+	*pT = t;
+	for (k = 0; k < 3; k++)
+		pt[k] = ca[k] + (n[k] * a->dRadius);
+	return 1;
+}
+
+int narrowphase_out_init(NarrowphaseOut* pOut)
+{
+	pOut->pHits = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pOut->pHits, NULL, NULL);
+	pOut->pNormals = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pOut->pNormals, NULL, NULL);
+	pOut->pDepths = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pOut->pDepths, NULL, NULL);
+	pOut->pPoints = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pOut->pPoints, NULL, NULL);
+	return 1;
+}
+
+void narrowphase_out_free(NarrowphaseOut* pOut)
+{
+	Py_XDECREF(pOut->pHits);
+	Py_XDECREF(pOut->pNormals);
+	Py_XDECREF(pOut->pDepths);
+	Py_XDECREF(pOut->pPoints);
+}
+
+/* appends one result; b is NULL when a is a ray index */
+int narrowphase_out_add(NarrowphaseOut* pOut, PyObject* a, PyObject* b, double* n, double dDepth, double* pt)
+{
+	VectObject *pN, *pP;
+	PyObject *pD;
+	int rv;
+
+	pN = PyObject_New(VectObject, &VectObjectType);
+	pP = PyObject_New(VectObject, &VectObjectType);
+	pD = PyFloat_FromDouble(dDepth);
+	if (!pN || !pP || !pD)
+	{
+		Py_XDECREF(pN);
+		Py_XDECREF(pP);
+		Py_XDECREF(pD);
+		return 0;
+	}
+	memcpy(pN->elements, n, 3 * sizeof(double));
+	memcpy(pP->elements, pt, 3 * sizeof(double));
+	rv = obarr_append(pOut->pHits, a) && (!b || obarr_append(pOut->pHits, b)) &&
+		obarr_append(pOut->pNormals, (PyObject*)pN) &&
+		obarr_append(pOut->pDepths, pD) &&
+		obarr_append(pOut->pPoints, (PyObject*)pP);
+	Py_DECREF(pN);
+	Py_DECREF(pP);
+	Py_DECREF(pD);
+	if (!rv)
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+	return rv;
+}
+
+PyObject* narrowphase_out_build(NarrowphaseOut* pOut)
+{
+	return Py_BuildValue("(NNNN)", pOut->pHits, pOut->pNormals, pOut->pDepths, pOut->pPoints);
+}
+
+/* runs one pair test over a flat pair sequence (a0, b0, a1, b1, ...) */
+PyObject* narrowphase_pairs(PyObject* args, int nKind)
+{
+	PyObject *seq, *pFast, *a, *b;
+	NarrowphaseShape sa, sb;
+	NarrowphaseOut out;
+	double pa[3], qa[3], pb[3], qb[3], ca[3], cb[3];
+	double normal[3], pt[3], dDepth;
+	long n, i;
+	int bHit;
+
+    if (!PyArg_ParseTuple(args, "O", &seq))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	pFast = PySequence_Fast(seq, "a flat sequence of pairs is required");
+	if (!pFast)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	if (n % 2)
+	{
+		Py_DECREF(pFast);
+		PyErr_SetString(PyExc_ValueError, "pair sequence has an odd length");
+		return NULL;
+	}
+
+	narrowphase_out_init(&out);
+	for (i = 0; i < n; i += 2)
+	{
+		a = PySequence_Fast_GET_ITEM(pFast, i);
+		b = PySequence_Fast_GET_ITEM(pFast, i + 1);
+		if (!narrowphase_read_shape(a, &sa, nKind == NP_CAPSULE_CAPSULE, nKind == NP_OBB_OBB) ||
+			!narrowphase_read_shape(b, &sb, nKind == NP_SPHERE_CAPSULE || nKind == NP_CAPSULE_CAPSULE, nKind == NP_OBB_OBB))
+			goto fail;
+
+		switch (nKind)
+		{
+		case NP_SPHERE_SPHERE:
+			bHit = narrowphase_spheres(sa.pos, sa.dRadius, sb.pos, sb.dRadius, normal, &dDepth, pt);
+			break;
+		case NP_SPHERE_CAPSULE:
+			narrowphase_segment(&sb, pb, qb);
+			narrowphase_closest_on_segment(pb, qb, sa.pos, cb);
+			bHit = narrowphase_spheres(sa.pos, sa.dRadius, cb, sb.dRadius, normal, &dDepth, pt);
+			break;
+		case NP_CAPSULE_CAPSULE:
+			narrowphase_segment(&sa, pa, qa);
+			narrowphase_segment(&sb, pb, qb);
+			narrowphase_closest_segments(pa, qa, pb, qb, ca, cb);
+			bHit = narrowphase_spheres(ca, sa.dRadius, cb, sb.dRadius, normal, &dDepth, pt);
+			break;
+		default:
+			bHit = narrowphase_obb_obb(&sa, &sb, normal, &dDepth, pt);
+			break;
+		}
+		if (bHit && !narrowphase_out_add(&out, a, b, normal, dDepth, pt))
+			goto fail;
+	}
+
+	Py_DECREF(pFast);
+	return narrowphase_out_build(&out);
+
+fail:
+	Py_DECREF(pFast);
+	narrowphase_out_free(&out);
+	return NULL;
+}
+
+PyObject* Narrowphase_sphere_sphere(PyObject *self_in, PyObject *args)
+{
+	return narrowphase_pairs(args, NP_SPHERE_SPHERE);
+}
+
+PyObject* Narrowphase_sphere_capsule(PyObject *self_in, PyObject *args)
+{
+	return narrowphase_pairs(args, NP_SPHERE_CAPSULE);
+}
+
+PyObject* Narrowphase_capsule_capsule(PyObject *self_in, PyObject *args)
+{
+	return narrowphase_pairs(args, NP_CAPSULE_CAPSULE);
+}
+
+PyObject* Narrowphase_obb_obb(PyObject *self_in, PyObject *args)
+{
+	return narrowphase_pairs(args, NP_OBB_OBB);
+}
+
+/* casts segment i from starts[i] to ends[i] against boxes[i].  A single */
+/* vect for starts or ends is used for every box.  Returns (indices, */
+/* normals, fractions, points) of the segments that hit. */
+PyObject* Narrowphase_ray_obb(PyObject *self_in, PyObject *args)
+{
+	PyObject *pStarts, *pEnds, *pBoxes;
+	PyObject *pFastS = NULL, *pFastE = NULL, *pFastB = NULL;
+	PyObject *pIndex;
+	NarrowphaseShape sb;
+	NarrowphaseOut out;
+	double start[3], end[3], normal[3], pt[3], t;
+	long n, i;
+
+    if (!PyArg_ParseTuple(args, "OOO", &pStarts, &pEnds, &pBoxes))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	pFastB = PySequence_Fast(pBoxes, "a sequence of boxes is required");
+	if (!pFastB)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFastB);
+	if (Vect_Check(pStarts))
+		memcpy(start, ((VectObject*)pStarts)->elements, sizeof(start));
+	else if (!(pFastS = PySequence_Fast(pStarts, "starts must be a vect or a sequence of vects")))
+		goto error;
+	if (Vect_Check(pEnds))
+		memcpy(end, ((VectObject*)pEnds)->elements, sizeof(end));
+	else if (!(pFastE = PySequence_Fast(pEnds, "ends must be a vect or a sequence of vects")))
+		goto error;
+	if ((pFastS && PySequence_Fast_GET_SIZE(pFastS) != n) || (pFastE && PySequence_Fast_GET_SIZE(pFastE) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "starts, ends and boxes differ in length");
+		goto error;
+	}
+
+	narrowphase_out_init(&out);
+	for (i = 0; i < n; i++)
+	{
+		if ((pFastS && !cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastS, i), start)) ||
+			(pFastE && !cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastE, i), end)) ||
+			!narrowphase_read_shape(PySequence_Fast_GET_ITEM(pFastB, i), &sb, 0, 1))
+			goto fail;
+		if (!narrowphase_ray_obb(start, end, &sb, normal, &t, pt))
+			continue;
+		pIndex = PyInt_FromLong(i);
+		if (!pIndex || !narrowphase_out_add(&out, pIndex, NULL, normal, t, pt))
+		{
+			Py_XDECREF(pIndex);
+			goto fail;
+		}
+		Py_DECREF(pIndex);
+	}
+
+	Py_XDECREF(pFastS);
+	Py_XDECREF(pFastE);
+	Py_DECREF(pFastB);
+	return narrowphase_out_build(&out);
+
+fail:
+	narrowphase_out_free(&out);
+error:
+	Py_XDECREF(pFastS);
+	Py_XDECREF(pFastE);
+	Py_DECREF(pFastB);
+	return NULL;
+}
+
+/* earliest time of impact, as a fraction of the step, of each pair of */
+/* spheres or capsules in a flat pair sequence.  starts and ends run */
+/* parallel to the pairs, giving each object's position over the step; */
+/* rot_starts and rot_ends, if given, are slerped for the orientation, */
+/* else an object's own rot is kept.  Objects with a half_length are */
+/* capsules.  Returns (pairs, normals, times, points) for the pairs that */
+/* meet, the normal and point taken at the time of impact. */
+PyObject* Narrowphase_toi(PyObject *self_in, PyObject *args)
+{
+	PyObject *seq, *pStarts, *pEnds, *pRots0 = Py_None, *pRots1 = Py_None;
+	PyObject *pFast = NULL, *pFastS = NULL, *pFastE = NULL, *pFastR0 = NULL, *pFastR1 = NULL;
+	PyObject *a, *b, *pAttr;
+	NarrowphaseShape sa, sb;
+	NarrowphaseMotion ma, mb;
+	NarrowphaseOut out;
+	double normal[3], pt[3], t, dTol = 1e-6;
+	long n, i;
+	int bCapsule;
+
+    if (!PyArg_ParseTuple(args, "OOO|OOd", &seq, &pStarts, &pEnds, &pRots0, &pRots1, &dTol))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if ((pRots0 == Py_None) != (pRots1 == Py_None))
+	{
+		PyErr_SetString(PyExc_TypeError, "rot_starts and rot_ends must be given together");
+		return NULL;
+	}
+	if (!(pFast = PySequence_Fast(seq, "a flat sequence of pairs is required")) ||
+		!(pFastS = PySequence_Fast(pStarts, "starts must be a sequence of vects")) ||
+		!(pFastE = PySequence_Fast(pEnds, "ends must be a sequence of vects")))
+		goto error;
+	if (pRots0 != Py_None &&
+		(!(pFastR0 = PySequence_Fast(pRots0, "rot_starts must be a sequence of quats")) ||
+		!(pFastR1 = PySequence_Fast(pRots1, "rot_ends must be a sequence of quats"))))
+		goto error;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	if (n % 2)
+	{
+		PyErr_SetString(PyExc_ValueError, "pair sequence has an odd length");
+		goto error;
+	}
+	if (PySequence_Fast_GET_SIZE(pFastS) != n || PySequence_Fast_GET_SIZE(pFastE) != n ||
+		(pFastR0 && (PySequence_Fast_GET_SIZE(pFastR0) != n || PySequence_Fast_GET_SIZE(pFastR1) != n)))
+	{
+		PyErr_SetString(PyExc_ValueError, "motion arrays must be as long as the pair sequence");
+		goto error;
+	}
+
+	narrowphase_out_init(&out);
+	for (i = 0; i < n; i += 2)
+	{
+		a = PySequence_Fast_GET_ITEM(pFast, i);
+		b = PySequence_Fast_GET_ITEM(pFast, i + 1);
+
+		pAttr = PyObject_GetAttrString(a, "half_length");
+		bCapsule = pAttr != NULL;
+		Py_XDECREF(pAttr);
+		PyErr_Clear();
+		if (!narrowphase_read_shape(a, &sa, bCapsule, 0))
+			goto fail;
+		pAttr = PyObject_GetAttrString(b, "half_length");
+		bCapsule = pAttr != NULL;
+		Py_XDECREF(pAttr);
+		PyErr_Clear();
+		if (!narrowphase_read_shape(b, &sb, bCapsule, 0))
+			goto fail;
+
+		if (!narrowphase_read_motion(PySequence_Fast_GET_ITEM(pFastS, i), PySequence_Fast_GET_ITEM(pFastE, i),
+				pFastR0 ? PySequence_Fast_GET_ITEM(pFastR0, i) : NULL, pFastR1 ? PySequence_Fast_GET_ITEM(pFastR1, i) : NULL, &ma) ||
+			!narrowphase_read_motion(PySequence_Fast_GET_ITEM(pFastS, i + 1), PySequence_Fast_GET_ITEM(pFastE, i + 1),
+				pFastR0 ? PySequence_Fast_GET_ITEM(pFastR0, i + 1) : NULL, pFastR1 ? PySequence_Fast_GET_ITEM(pFastR1, i + 1) : NULL, &mb))
+			goto fail;
+
+		if (narrowphase_toi_pair(&sa, &ma, &sb, &mb, dTol, &t, normal, pt) &&
+			!narrowphase_out_add(&out, a, b, normal, t, pt))
+			goto fail;
+	}
+
+	Py_DECREF(pFast);
+	Py_DECREF(pFastS);
+	Py_DECREF(pFastE);
+	Py_XDECREF(pFastR0);
+	Py_XDECREF(pFastR1);
+	return narrowphase_out_build(&out);
+
+fail:
+	narrowphase_out_free(&out);
+error:
+	Py_XDECREF(pFast);
+	Py_XDECREF(pFastS);
+	Py_XDECREF(pFastE);
+	Py_XDECREF(pFastR0);
+	Py_XDECREF(pFastR1);
+	return NULL;
+}
@@ -0,0 +1,74 @@
+#ifndef NARROWPHASE_H_INCLUDED
+#define NARROWPHASE_H_INCLUDED
+
+#include <Python.h>
+
+typedef struct ObarrObject ObarrObject;
+
+/* shapes are read from object attributes:                               */
+/*   sphere   pos, radius                                                */
+/*   capsule  pos, radius, half_length, rot: the segment runs half_length */
+/*            either way of pos along the rotated y axis                 */
+/*   obb      pos, half_extents (a vect), rot                            */
+/* a missing rot is the identity, a missing radius is zero. */
+typedef struct NarrowphaseShape {
+	double pos[3];
+	double dRadius;
+	double dHalfLength;
+	double ext[3];
+	double rot[9];		/* row-major; the columns are the local axes */
+} NarrowphaseShape;
+
+/* results of a batch: the colliding pairs (or ray indices) with a normal */
+/* from a to b, a penetration depth (or ray fraction) and a contact point */
+typedef struct NarrowphaseOut {
+	ObarrObject*	pHits;
+	ObarrObject*	pNormals;
+	ObarrObject*	pDepths;
+	ObarrObject*	pPoints;
+} NarrowphaseOut;
+
+/* linear motion of a shape over the step, with an optional slerp of its */
+/* orientation; dAngle is the angle turned over the whole step */
+typedef struct NarrowphaseMotion {
+	double p0[3];
+	double p1[3];
+	double q0[4];
+	double q1[4];
+	int bRot;
+	double dAngle;
+} NarrowphaseMotion;
+
+#define NP_TOI_ITERATIONS 256
+
+#define NP_DOT(a, b) (((a)[0] * (b)[0]) + ((a)[1] * (b)[1]) + ((a)[2] * (b)[2]))
+
+/* internal functions */
+int narrowphase_read_rot(PyObject* other, double* m);
+int narrowphase_read_shape(PyObject* other, NarrowphaseShape* pShape, int bCapsule, int bBox);
+void narrowphase_segment(NarrowphaseShape* pShape, double* p, double* q);
+void narrowphase_closest_on_segment(double* p, double* q, double* c, double* rv);
+void narrowphase_closest_segments(double* p1, double* q1, double* p2, double* q2, double* c1, double* c2);
+int narrowphase_spheres(double* ca, double ra, double* cb, double rb, double* n, double* pDepth, double* pt);
+void narrowphase_obb_support(NarrowphaseShape* pBox, double ax[3][3], double* n, double dSign, double* rv);
+void narrowphase_obb_clamp(NarrowphaseShape* pBox, double ax[3][3], double* pt);
+int narrowphase_obb_obb(NarrowphaseShape* a, NarrowphaseShape* b, double* n, double* pDepth, double* pt);
+int narrowphase_ray_obb(double* start, double* end, NarrowphaseShape* b, double* n, double* pT, double* pt);
+int narrowphase_read_motion(PyObject* pStart, PyObject* pEnd, PyObject* pRot0, PyObject* pRot1, NarrowphaseMotion* pMotion);
+void narrowphase_motion_at(NarrowphaseShape* pShape, NarrowphaseMotion* pMotion, double t);
+int narrowphase_toi_pair(NarrowphaseShape* a, NarrowphaseMotion* ma, NarrowphaseShape* b, NarrowphaseMotion* mb, double dTol, double* pT, double* n, double* pt);
+int narrowphase_out_init(NarrowphaseOut* pOut);
+void narrowphase_out_free(NarrowphaseOut* pOut);
+int narrowphase_out_add(NarrowphaseOut* pOut, PyObject* a, PyObject* b, double* n, double dDepth, double* pt);
+PyObject* narrowphase_out_build(NarrowphaseOut* pOut);
+PyObject* narrowphase_pairs(PyObject* args, int nKind);
+
+/* exported API functions */
+PyObject* Narrowphase_sphere_sphere(PyObject *self_in, PyObject *args);
+PyObject* Narrowphase_sphere_capsule(PyObject *self_in, PyObject *args);
+PyObject* Narrowphase_capsule_capsule(PyObject *self_in, PyObject *args);
+PyObject* Narrowphase_obb_obb(PyObject *self_in, PyObject *args);
+PyObject* Narrowphase_ray_obb(PyObject *self_in, PyObject *args);
+PyObject* Narrowphase_toi(PyObject *self_in, PyObject *args);
+
+#endif
@@ -7,7 +7,7 @@ PyObject* obarr_get_element(ObarrObject* self, long index)
 	return self->pData[index];	
 }
 
-int obarr_find(ObarrObject* self, PyObject* other_in)
+long obarr_find(ObarrObject* self, PyObject* other_in)
 {
 	long i;
 	for (i = 0; i < self->nSize; i++)
@@ -0,0 +1,793 @@
+#include "octree.h"
+#include "obarr.h"
+#include "vect.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+/* spreads the low 21 bits of n three apart */
+unsigned PY_LONG_LONG octree_spread(unsigned long n)
+{
+	unsigned PY_LONG_LONG x = n & 0x1FFFFF;
+
+	x = (x | (x << 32)) & 0x1F00000000FFFFULL;
+	x = (x | (x << 16)) & 0x1F0000FF0000FFULL;
+	x = (x | (x << 8)) & 0x100F00F00F00F00FULL;
+	x = (x | (x << 4)) & 0x10C30C30C30C30C3ULL;
+	x = (x | (x << 2)) & 0x1249249249249249ULL;
+	return x;
+}
+
+unsigned PY_LONG_LONG octree_morton(OctreeObject* self, double* pos)
+{
+	unsigned PY_LONG_LONG code = 0;
+	double d;
+	long nMax = (1L << OCTREE_BITS) - 1;
+	long q;
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		d = ((pos[k] - self->origin[k]) / self->dSize) * (double)(1L << OCTREE_BITS);
+		q = (d < 0.0) ? 0 : (d > nMax ? nMax : (long)d);
+		code |= octree_spread(q) << k;
+	}
+	return code;
+}
+
+int compare_codes(const void* a, const void* b)
+{
+	const OctreeCode* ca = (const OctreeCode*)a;
+	const OctreeCode* cb = (const OctreeCode*)b;
+
+	if (ca->code != cb->code)
+		return ca->code < cb->code ? -1 : 1;
+	return (ca->i > cb->i) - (ca->i < cb->i);
+}
+
+void octree_clear(OctreeObject* self)
+{
+	long i;
+
+	if (self->pObjects)
+	{
+		for (i = 0; i < self->nMembers; i++)
+			Py_XDECREF(self->pObjects[i]);
+		free(self->pObjects);
+	}
+	if (self->pEntries)
+		free(self->pEntries);
+	if (self->pIndex)
+		free(self->pIndex);
+	if (self->pNodes)
+		free(self->pNodes);
+	self->pObjects = NULL;
+	self->pEntries = NULL;
+	self->pIndex = NULL;
+	self->pNodes = NULL;
+	self->nMembers = 0;
+	self->nNodes = 0;
+	self->nNodeAlloc = 0;
+}
+
+/* appends the node for members nStart .. nStart + nCount and, below it, */
+/* its children.  Levels where every member falls in the same octant are */
+/* passed through without a node.  Returns the node index or -1. */
+long octree_build_node(OctreeObject* self, OctreeCode* pCodes, long nStart, long nCount, long nLevel)
+{
+	OctreeNode* pNode;
+	CgridEntry* pE;
+	void* tmp;
+	unsigned PY_LONG_LONG c;
+	long nSplit, nShift, nEnd, i, j, k;
+	int a;
+
+	if (self->nNodes == self->nNodeAlloc)
+	{
+		k = self->nNodeAlloc ? self->nNodeAlloc * 2 : 64;
+		tmp = realloc(self->pNodes, k * sizeof(OctreeNode));
+		if (!tmp)
+			return -1;
+		self->pNodes = (OctreeNode*)tmp;
+		self->nNodeAlloc = k;
+	}
+	i = self->nNodes++;
+	pNode = &self->pNodes[i];
+	pNode->nStart = nStart;
+	pNode->nCount = nCount;
+	pNode->nLevel = nLevel;
+	nEnd = nStart + nCount;
+
+	nSplit = nLevel;
+	if (nCount > self->nMaxLeaf)
+	{
+		while (nSplit < self->nMaxDepth &&
+			(pCodes[nStart].code >> (3 * (OCTREE_BITS - nSplit - 1))) == (pCodes[nEnd - 1].code >> (3 * (OCTREE_BITS - nSplit - 1))))
+			nSplit++;
+	}
+
+	if (nCount <= self->nMaxLeaf || nSplit >= self->nMaxDepth)
+	{
+		for (a = 0; a < 3; a++)
+		{
+			pNode->min[a] = self->pEntries[nStart].pos[a] - self->pEntries[nStart].dRadius;
+			pNode->max[a] = self->pEntries[nStart].pos[a] + self->pEntries[nStart].dRadius;
+		}
+		for (j = nStart + 1; j < nEnd; j++)
+		{
+			pE = &self->pEntries[j];
+			for (a = 0; a < 3; a++)
+			{
+				if (pE->pos[a] - pE->dRadius < pNode->min[a])
+					pNode->min[a] = pE->pos[a] - pE->dRadius;
+				if (pE->pos[a] + pE->dRadius > pNode->max[a])
+					pNode->max[a] = pE->pos[a] + pE->dRadius;
+			}
+		}
+		pNode->nSkip = i + 1;
+		return i;
+	}
+
+	nShift = 3 * (OCTREE_BITS - nSplit - 1);
+	for (j = nStart; j < nEnd; j = k)
+	{
+		c = pCodes[j].code >> nShift;
+		for (k = j + 1; k < nEnd && (pCodes[k].code >> nShift) == c; k++)
+			;
+		if (octree_build_node(self, pCodes, j, k - j, nSplit + 1) < 0)
+			return -1;
+	}
+
+	/* the pool may have moved while the children were added */
+	pNode = &self->pNodes[i];
+	pNode->nSkip = self->nNodes;
+	memcpy(pNode->min, self->pNodes[i + 1].min, sizeof(pNode->min));
+	memcpy(pNode->max, self->pNodes[i + 1].max, sizeof(pNode->max));
+	for (j = self->pNodes[i + 1].nSkip; j < pNode->nSkip; j = self->pNodes[j].nSkip)
+	{
+		for (a = 0; a < 3; a++)
+		{
+			if (self->pNodes[j].min[a] < pNode->min[a])
+				pNode->min[a] = self->pNodes[j].min[a];
+			if (self->pNodes[j].max[a] > pNode->max[a])
+				pNode->max[a] = self->pNodes[j].max[a];
+		}
+	}
+	return i;
+}
+
+/* squared distance from a point to a box, 0 inside */
+double octree_box_dist2(double* min, double* max, double* pos)
+{
+	double d = 0.0;
+	int a;
+
+	for (a = 0; a < 3; a++)
+	{
+		if (pos[a] < min[a])
+			d += SQR(min[a] - pos[a]);
+		else if (pos[a] > max[a])
+			d += SQR(pos[a] - max[a]);
+	}
+	return d;
+}
+
+/* new reference to member j: its object, or its index without objects */
+PyObject* octree_result(OctreeObject* self, long j)
+{
+	if (self->pObjects)
+	{
+		Py_INCREF(self->pObjects[j]);
+		return self->pObjects[j];
+	}
+	return PyInt_FromLong(self->pIndex[j]);
+}
+
+int octree_heap_push(OctreeHeapItem** ppHeap, long* pnSize, long* pnAlloc, double d, long i, int bMax)
+{
+	OctreeHeapItem* pHeap;
+	OctreeHeapItem tmp;
+	void* p;
+	long n, parent;
+
+	if (*pnSize == *pnAlloc)
+	{
+		n = *pnAlloc ? *pnAlloc * 2 : 64;
+		p = realloc(*ppHeap, n * sizeof(OctreeHeapItem));
+		if (!p)
+			return 0;
+		*ppHeap = (OctreeHeapItem*)p;
+		*pnAlloc = n;
+	}
+	pHeap = *ppHeap;
+	n = (*pnSize)++;
+	pHeap[n].d = d;
+	pHeap[n].i = i;
+	while (n > 0)
+	{
+		parent = (n - 1) / 2;
+		if (bMax ? pHeap[parent].d >= pHeap[n].d : pHeap[parent].d <= pHeap[n].d)
+			break;
+		tmp = pHeap[parent]; pHeap[parent] = pHeap[n]; pHeap[n] = tmp;
+		n = parent;
+	}
+	return 1;
+}
+
+/* removes the top of a min heap, or of a max heap if bMax */
+void octree_heap_pop(OctreeHeapItem* pHeap, long* pnSize, int bMax)
+{
+	OctreeHeapItem tmp;
+	long n, c, best;
+
+	n = --(*pnSize);
+	pHeap[0] = pHeap[n];
+	c = 0;
+	for (;;)
+	{
+		best = c;
+		if ((2 * c) + 1 < n && (bMax ? pHeap[(2 * c) + 1].d > pHeap[best].d : pHeap[(2 * c) + 1].d < pHeap[best].d))
+			best = (2 * c) + 1;
+		if ((2 * c) + 2 < n && (bMax ? pHeap[(2 * c) + 2].d > pHeap[best].d : pHeap[(2 * c) + 2].d < pHeap[best].d))
+			best = (2 * c) + 2;
+		if (best == c)
+			break;
+		tmp = pHeap[c]; pHeap[c] = pHeap[best]; pHeap[best] = tmp;
+		c = best;
+	}
+}
+
+/* members whose spheres touch the sphere (pos, dRadius) */
+int octree_query_sphere(OctreeObject* self, double* pos, double dRadius, ObarrObject* pOut)
+{
+	OctreeNode* pNode;
+	CgridEntry* pE;
+	PyObject* pItem;
+	long i, j;
+	int rv;
+
+	i = 0;
+	while (i < self->nNodes)
+	{
+		pNode = &self->pNodes[i];
+		if (octree_box_dist2(pNode->min, pNode->max, pos) > SQR(dRadius))
+		{
+			i = pNode->nSkip;
+			continue;
+		}
+		if (OCTREE_IS_LEAF(self, i))
+		{
+			for (j = pNode->nStart; j < pNode->nStart + pNode->nCount; j++)
+			{
+				pE = &self->pEntries[j];
+				if (SQR(pE->pos[0] - pos[0]) + SQR(pE->pos[1] - pos[1]) + SQR(pE->pos[2] - pos[2]) > SQR(dRadius + pE->dRadius))
+					continue;
+				pItem = octree_result(self, j);
+				rv = pItem && obarr_append(pOut, pItem);
+				Py_XDECREF(pItem);
+				if (!rv)
+					return 0;
+			}
+		}
+		i++;
+	}
+	return 1;
+}
+
+/* members whose spheres touch the box (min, max) */
+int octree_query_box(OctreeObject* self, double* min, double* max, ObarrObject* pOut)
+{
+	OctreeNode* pNode;
+	CgridEntry* pE;
+	PyObject* pItem;
+	long i, j;
+	int rv;
+
+	i = 0;
+	while (i < self->nNodes)
+	{
+		pNode = &self->pNodes[i];
+		if (pNode->min[0] > max[0] || pNode->max[0] < min[0] ||
+			pNode->min[1] > max[1] || pNode->max[1] < min[1] ||
+			pNode->min[2] > max[2] || pNode->max[2] < min[2])
+		{
+			i = pNode->nSkip;
+			continue;
+		}
+		if (OCTREE_IS_LEAF(self, i))
+		{
+			for (j = pNode->nStart; j < pNode->nStart + pNode->nCount; j++)
+			{
+				pE = &self->pEntries[j];
+				if (octree_box_dist2(min, max, pE->pos) > SQR(pE->dRadius))
+					continue;
+				pItem = octree_result(self, j);
+				rv = pItem && obarr_append(pOut, pItem);
+				Py_XDECREF(pItem);
+				if (!rv)
+					return 0;
+			}
+		}
+		i++;
+	}
+	return 1;
+}
+
+
+int Octree_init(OctreeObject *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *points, *radii, *objects = Py_None;
+	PyObject *pFastP = NULL, *pFastR = NULL, *pFastO = NULL;
+	CgridEntry *pTmp = NULL;
+	OctreeCode *pCodes = NULL;
+	double min[3], max[3], dRadius = 0.0;
+	long nMaxLeaf = 8, nMaxDepth = OCTREE_BITS;
+	long n, i;
+	clock_t tStart;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "OO|Oll", &points, &radii, &objects, &nMaxLeaf, &nMaxDepth))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (nMaxLeaf < 1 || nMaxDepth < 0 || nMaxDepth > OCTREE_BITS)
+	{
+		PyErr_SetString(PyExc_ValueError, "max_leaf must be positive and max_depth from 0 to 21");
+		return -1;
+	}
+
+	tStart = clock();
+	octree_clear(self);
+	self->nMaxLeaf = nMaxLeaf;
+	self->nMaxDepth = nMaxDepth;
+
+	pFastP = PySequence_Fast(points, "points must be a sequence of vects");
+	if (!pFastP)
+		return -1;
+	n = PySequence_Fast_GET_SIZE(pFastP);
+	if (PyFloat_Check(radii) || PyInt_Check(radii))
+		dRadius = PyFloat_AsDouble(radii);
+	else if (!(pFastR = PySequence_Fast(radii, "radii must be a number or a sequence of numbers")))
+		goto error;
+	if (objects != Py_None && !(pFastO = PySequence_Fast(objects, "objects must be a sequence")))
+		goto error;
+	if ((pFastR && PySequence_Fast_GET_SIZE(pFastR) != n) || (pFastO && PySequence_Fast_GET_SIZE(pFastO) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "points, radii and objects differ in length");
+		goto error;
+	}
+
+	pTmp = (CgridEntry*)malloc((n ? n : 1) * sizeof(CgridEntry));
+	pCodes = (OctreeCode*)malloc((n ? n : 1) * sizeof(OctreeCode));
+	self->pEntries = (CgridEntry*)malloc((n ? n : 1) * sizeof(CgridEntry));
+	self->pIndex = (long*)malloc((n ? n : 1) * sizeof(long));
+	if (pFastO)
+		self->pObjects = (PyObject**)calloc(n ? n : 1, sizeof(PyObject*));
+	if (!pTmp || !pCodes || !self->pEntries || !self->pIndex || (pFastO && !self->pObjects))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastP, i), pTmp[i].pos))
+			goto error;
+		pTmp[i].dRadius = pFastR ? PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pFastR, i)) : dRadius;
+		if (PyErr_Occurred())
+			goto error;
+		pTmp[i].nNbr = 0;
+		pTmp[i].nCategory = CGRID_ALL_LAYERS;
+		pTmp[i].nMask = CGRID_ALL_LAYERS;
+		for (k = 0; k < 3; k++)
+		{
+			if (i == 0 || pTmp[i].pos[k] < min[k])
+				min[k] = pTmp[i].pos[k];
+			if (i == 0 || pTmp[i].pos[k] > max[k])
+				max[k] = pTmp[i].pos[k];
+		}
+	}
+
+	/* the root cube spans the centres */
+	self->dSize = 0.0;
+	for (k = 0; k < 3; k++)
+	{
+		self->origin[k] = n ? min[k] : 0.0;
+		if (n && max[k] - min[k] > self->dSize)
+			self->dSize = max[k] - min[k];
+	}
+	if (self->dSize <= 0.0)
+		self->dSize = 1.0;
+
+	for (i = 0; i < n; i++)
+	{
+		pCodes[i].code = octree_morton(self, pTmp[i].pos);
+		pCodes[i].i = i;
+	}
+	qsort(pCodes, n, sizeof(OctreeCode), compare_codes);
+	for (i = 0; i < n; i++)
+	{
+		self->pEntries[i] = pTmp[pCodes[i].i];
+		self->pIndex[i] = pCodes[i].i;
+		if (pFastO)
+		{
+			self->pObjects[i] = PySequence_Fast_GET_ITEM(pFastO, pCodes[i].i);
+			Py_INCREF(self->pObjects[i]);
+		}
+	}
+	self->nMembers = n;
+
+	if (n && octree_build_node(self, pCodes, 0, n, 0) < 0)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	self->dBuildTime = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+
+	free(pTmp);
+	free(pCodes);
+	Py_DECREF(pFastP);
+	Py_XDECREF(pFastR);
+	Py_XDECREF(pFastO);
+	return 0;
+
+error:
+	if (pTmp)
+		free(pTmp);
+	if (pCodes)
+		free(pCodes);
+	octree_clear(self);
+	Py_DECREF(pFastP);
+	Py_XDECREF(pFastR);
+	Py_XDECREF(pFastO);
+	return -1;
+}
+
+void Octree_dealloc(PyObject* self_in)
+{
+	octree_clear((OctreeObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Octree_repr(PyObject *self_in)
+{
+	OctreeObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Octree_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (OctreeObject*)self_in;
+	tuple = Py_BuildValue("(ll)", self->nMembers, self->nNodes);
+	fmtstring = PyString_FromString("<octree of %d members in %d nodes>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Octree_len(PyObject *self_in)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+
+	return self->nMembers;
+}
+
+/* members within a radius of an object or vect */
+PyObject* Octree_get_radius(PyObject *self_in, PyObject *args)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+	PyObject *other;
+	ObarrObject *rv;
+	double pos[3], dRadius;
+
+    if (!PyArg_ParseTuple(args, "Od", &other, &dRadius))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(other, pos))
+		return NULL;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!octree_query_sphere(self, pos, dRadius, rv))
+	{
+		Py_DECREF(rv);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+PyObject* Octree_query_box(PyObject *self_in, PyObject *args)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+	PyObject *pMin, *pMax;
+	ObarrObject *rv;
+	double min[3], max[3];
+
+    if (!PyArg_ParseTuple(args, "OO", &pMin, &pMax))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pMin, min) || !cgrid_read_pos(pMax, max))
+		return NULL;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!octree_query_box(self, min, max, rv))
+	{
+		Py_DECREF(rv);
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)rv;
+}
+
+/* sweeps a sphere of the given radius (default 0, a ray) from start to */
+/* end and returns a list of (member, t) tuples in order of impact */
+PyObject* Octree_raycast(PyObject *self_in, PyObject *args)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+	PyObject *pStart, *pEnd, *pItem;
+	PyObject *rv = NULL;
+	OctreeNode *pNode;
+	sortkey *pKeys = NULL;
+	double start[3], end[3], delta[3];
+	double dRadius = 0.0, t0, t1, t;
+	long nKeys = 0, nKeyAlloc = 0, i, j;
+	void *tmp;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "OO|d", &pStart, &pEnd, &dRadius))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!cgrid_read_pos(pStart, start) || !cgrid_read_pos(pEnd, end))
+		return NULL;
+	for (k = 0; k < 3; k++)
+		delta[k] = end[k] - start[k];
+
+	i = 0;
+	while (i < self->nNodes)
+	{
+		pNode = &self->pNodes[i];
+		t0 = 0.0;
+		t1 = 1.0;
+		if (!cgrid_clip_slab(start[0], delta[0], pNode->min[0] - dRadius, pNode->max[0] + dRadius, &t0, &t1) ||
+			!cgrid_clip_slab(start[1], delta[1], pNode->min[1] - dRadius, pNode->max[1] + dRadius, &t0, &t1) ||
+			!cgrid_clip_slab(start[2], delta[2], pNode->min[2] - dRadius, pNode->max[2] + dRadius, &t0, &t1))
+		{
+			i = pNode->nSkip;
+			continue;
+		}
+		if (OCTREE_IS_LEAF(self, i))
+		{
+			for (j = pNode->nStart; j < pNode->nStart + pNode->nCount; j++)
+			{
+				t = cgrid_sweep_entry(start, delta, dRadius, &self->pEntries[j]);
+				if (t < 0.0)
+					continue;
+				if (nKeys == nKeyAlloc)
+				{
+					tmp = realloc(pKeys, (nKeyAlloc + 64) * sizeof(sortkey));
+					if (!tmp)
+						goto nomem;
+					pKeys = (sortkey*)tmp;
+					nKeyAlloc += 64;
+				}
+				pKeys[nKeys].d = t;
+				pKeys[nKeys].i = j;
+				nKeys++;
+			}
+		}
+		i++;
+	}
+
+	qsort(pKeys, nKeys, sizeof(sortkey), compare_doubles);
+	rv = PyList_New(nKeys);
+	if (!rv)
+		goto done;
+	for (i = 0; i < nKeys; i++)
+	{
+		pItem = octree_result(self, pKeys[i].i);
+		PyList_SET_ITEM(rv, i, Py_BuildValue("(Nd)", pItem, pKeys[i].d));
+	}
+	goto done;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+done:
+	if (pKeys)
+		free(pKeys);
+	return rv;
+}
+
+/* the k (default 1) members nearest a point, measured to their surface, */
+/* as a list of (member, distance) tuples nearest first.  Octants are */
+/* opened best first and the search stops once none can hold a closer one. */
+PyObject* Octree_nearest(PyObject *self_in, PyObject *args)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+	PyObject *other, *pItem;
+	PyObject *rv = NULL;
+	OctreeNode *pNode;
+	CgridEntry *pE;
+	OctreeHeapItem *pOpen = NULL, *pBest = NULL;
+	double pos[3], d;
+	long nOpen = 0, nOpenAlloc = 0, nBest = 0, nBestAlloc = 0;
+	long nK = 1, i, j, c;
+
+    if (!PyArg_ParseTuple(args, "O|l", &other, &nK))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (nK < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "k must be positive");
+		return NULL;
+	}
+	if (!cgrid_read_pos(other, pos))
+		return NULL;
+
+	if (self->nNodes && !octree_heap_push(&pOpen, &nOpen, &nOpenAlloc, sqrt(octree_box_dist2(self->pNodes[0].min, self->pNodes[0].max, pos)), 0, 0))
+		goto nomem;
+	while (nOpen > 0)
+	{
+		d = pOpen[0].d;
+		i = pOpen[0].i;
+		if (nBest == nK && d > pBest[0].d)
+			break;
+		octree_heap_pop(pOpen, &nOpen, 0);
+		pNode = &self->pNodes[i];
+		if (OCTREE_IS_LEAF(self, i))
+		{
+			for (j = pNode->nStart; j < pNode->nStart + pNode->nCount; j++)
+			{
+				pE = &self->pEntries[j];
+				d = sqrt(SQR(pE->pos[0] - pos[0]) + SQR(pE->pos[1] - pos[1]) + SQR(pE->pos[2] - pos[2])) - pE->dRadius;
+				if (d < 0.0)
+					d = 0.0;
+				if (nBest == nK)
+				{
+					if (d >= pBest[0].d)
+						continue;
+					octree_heap_pop(pBest, &nBest, 1);
+				}
+				if (!octree_heap_push(&pBest, &nBest, &nBestAlloc, d, j, 1))
+					goto nomem;
+			}
+			continue;
+		}
+		for (c = i + 1; c < pNode->nSkip; c = self->pNodes[c].nSkip)
+		{
+			d = sqrt(octree_box_dist2(self->pNodes[c].min, self->pNodes[c].max, pos));
+			if (nBest == nK && d > pBest[0].d)
+				continue;
+			if (!octree_heap_push(&pOpen, &nOpen, &nOpenAlloc, d, c, 0))
+				goto nomem;
+		}
+	}
+
+	rv = PyList_New(nBest);
+	if (!rv)
+		goto done;
+	while (nBest > 0)
+	{
+		pItem = octree_result(self, pBest[0].i);
+		PyList_SET_ITEM(rv, nBest - 1, Py_BuildValue("(Nd)", pItem, pBest[0].d));
+		octree_heap_pop(pBest, &nBest, 1);
+	}
+	goto done;
+
+nomem:
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+done:
+	if (pOpen)
+		free(pOpen);
+	if (pBest)
+		free(pBest);
+	return rv;
+}
+
+/* size, shape, memory use and build time, for comparison with the */
+/* static layer figures of cgrid.stats() */
+PyObject* Octree_stats(PyObject *self_in, PyObject *unused)
+{
+	OctreeObject *self = (OctreeObject*)self_in;
+	long nLeaves = 0, nDepth = 0, nBytes, i;
+
+	for (i = 0; i < self->nNodes; i++)
+	{
+		if (!OCTREE_IS_LEAF(self, i))
+			continue;
+		nLeaves++;
+		if (self->pNodes[i].nLevel > nDepth)
+			nDepth = self->pNodes[i].nLevel;
+	}
+	nBytes = (self->nNodes * sizeof(OctreeNode)) +
+		(self->nMembers * (sizeof(CgridEntry) + sizeof(long) + (self->pObjects ? sizeof(PyObject*) : 0)));
+
+	return Py_BuildValue("{s:l,s:l,s:l,s:l,s:d,s:l,s:d}",
+		"members", self->nMembers,
+		"nodes", self->nNodes,
+		"leaves", nLeaves,
+		"max_depth", nDepth,
+		"mean_per_leaf", nLeaves ? (double)self->nMembers / nLeaves : 0.0,
+		"bytes", nBytes,
+		"build_time", self->dBuildTime);
+}
+
+
+
+PySequenceMethods Octree_as_seq[] = {
+	Octree_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Octree_methods[] = {
+	{"get_radius", (PyCFunction)Octree_get_radius, METH_VARARGS, "find the members touching a sphere around an object or vect"},
+	{"query_box", (PyCFunction)Octree_query_box, METH_VARARGS, "find the members touching a box (min, max)"},
+	{"raycast", (PyCFunction)Octree_raycast, METH_VARARGS, "cast a segment (start, end), optionally with a radius, returning (member, t) hits in order"},
+	{"nearest", (PyCFunction)Octree_nearest, METH_VARARGS, "find the k nearest members to an object or vect as (member, distance) tuples"},
+	{"stats", (PyCFunction)Octree_stats, METH_NOARGS, "get node counts, memory use and build time as a dict"},
+	{NULL}
+};
+
+struct PyMemberDef Octree_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject OctreeObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.octree",		/* tp_name        */
+	sizeof(OctreeObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Octree_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Octree_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Octree_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Linear octree over static spheres, keyed by Morton code.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Octree_methods,   /* tp_methods        */
+	Octree_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Octree_init,		/* tp_init           */
+};
@@ -0,0 +1,93 @@
+#ifndef OCTREE_H_INCLUDED
+#define OCTREE_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+#include "cgrid.h"
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+#define OCTREE_BITS 21		/* per axis, so a code fits in 63 bits */
+
+/* an octant, stored in depth-first Morton order with no child pointers: */
+/* the children of node i start at i + 1 and each one's nSkip leads to the */
+/* next, up to node i's own nSkip.  A leaf has nSkip == i + 1.  The box */
+/* bounds the member spheres, not the octant. */
+typedef struct OctreeNode {
+	double			min[3];
+	double			max[3];
+	long			nStart;		/* first member in Morton order */
+	long			nCount;
+	long			nSkip;
+	long			nLevel;
+} OctreeNode;
+
+typedef struct OctreeCode {
+	unsigned PY_LONG_LONG	code;
+	long					i;
+} OctreeCode;
+
+/* entry of the binary heaps used by nearest() */
+typedef struct OctreeHeapItem {
+	double			d;
+	long			i;
+} OctreeHeapItem;
+
+/* a linear octree built once over spheres.  Members are sorted by the */
+/* Morton code of their centre in the root cube, so an octant's members */
+/* are contiguous and empty space costs nothing. */
+typedef struct OctreeObject {
+	PyObject_HEAD
+	long			nMembers;
+	CgridEntry*		pEntries;
+	long*			pIndex;		/* original index of each member */
+	PyObject**		pObjects;	/* NULL if built without objects */
+	OctreeNode*		pNodes;
+	long			nNodes;
+	long			nNodeAlloc;
+	double			origin[3];
+	double			dSize;
+	long			nMaxLeaf;
+	long			nMaxDepth;
+	double			dBuildTime;
+} OctreeObject;
+
+#define Octree_Check(op) PyObject_TypeCheck(op, &OctreeObjectType)
+#define OCTREE_IS_LEAF(self, i) ((self)->pNodes[i].nSkip == (i) + 1)
+
+/* internal functions */
+unsigned PY_LONG_LONG octree_spread(unsigned long n);
+unsigned PY_LONG_LONG octree_morton(OctreeObject* self, double* pos);
+int compare_codes(const void* a, const void* b);
+void octree_clear(OctreeObject* self);
+long octree_build_node(OctreeObject* self, OctreeCode* pCodes, long nStart, long nCount, long nLevel);
+double octree_box_dist2(double* min, double* max, double* pos);
+PyObject* octree_result(OctreeObject* self, long j);
+int octree_heap_push(OctreeHeapItem** ppHeap, long* pnSize, long* pnAlloc, double d, long i, int bMax);
+void octree_heap_pop(OctreeHeapItem* pHeap, long* pnSize, int bMax);
+int octree_query_sphere(OctreeObject* self, double* pos, double dRadius, ObarrObject* pOut);
+int octree_query_box(OctreeObject* self, double* min, double* max, ObarrObject* pOut);
+
+/* exported API functions */
+int Octree_init(OctreeObject *self, PyObject *args, PyObject *kwds);
+void Octree_dealloc(PyObject* self_in);
+PyObject* Octree_repr(PyObject *self_in);
+Py_ssize_t Octree_len(PyObject *self_in);
+PyObject* Octree_get_radius(PyObject *self_in, PyObject *args);
+PyObject* Octree_query_box(PyObject *self_in, PyObject *args);
+PyObject* Octree_raycast(PyObject *self_in, PyObject *args);
+PyObject* Octree_nearest(PyObject *self_in, PyObject *args);
+PyObject* Octree_stats(PyObject *self_in, PyObject *unused);
+
+extern PySequenceMethods Octree_as_seq[];
+extern PyMethodDef Octree_methods[];
+extern struct PyMemberDef Octree_members[];
+extern PyTypeObject OctreeObjectType;
+
+#endif
@@ -0,0 +1,242 @@
+#include "paircache.h"
+#include "obarr.h"
+
+int paircache_append(ObarrObject* pOut, PyObject* a, PyObject* b)
+{
+	return obarr_append(pOut, a) && obarr_append(pOut, b);
+}
+
+/* moves every pair not reported this tick to pEnded and drops it */
+int paircache_expire(PaircacheObject* self, ObarrObject* pEnded)
+{
+	PtrmapSlot* pSlot;
+	long n, i;
+
+	n = pEnded->nSize;
+	for (i = 0; i < self->pairs.nAllocSize; i++)
+	{
+		pSlot = &self->pairs.pSlots[i];
+		if (PTRMAP_EMPTY(&self->pairs, i) || pSlot->value == self->nTick)
+			continue;
+		if (!paircache_append(pEnded, (PyObject*)pSlot->a, (PyObject*)pSlot->b))
+			return 0;
+	}
+
+	/* delete by key afterwards, deleting reorders the slots */
+	for (i = n; i < pEnded->nSize; i += 2)
+	{
+		ptrmap_del(&self->pairs, pEnded->pData[i], pEnded->pData[i + 1]);
+		Py_DECREF(pEnded->pData[i]);
+		Py_DECREF(pEnded->pData[i + 1]);
+	}
+	return 1;
+}
+
+int Paircache_init(PaircacheObject *self, PyObject *args, PyObject *kwds)
+{
+    if (!PyArg_ParseTuple(args, ""))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+
+	ptrmap_init(&self->pairs);
+	self->nTick = 0;
+	return 0;
+}
+
+void Paircache_dealloc(PyObject* self_in)
+{
+	PaircacheObject* self = (PaircacheObject*)self_in;
+	long i;
+
+	for (i = 0; i < self->pairs.nAllocSize; i++)
+	{
+		if (PTRMAP_EMPTY(&self->pairs, i))
+			continue;
+		Py_DECREF((PyObject*)self->pairs.pSlots[i].a);
+		Py_DECREF((PyObject*)self->pairs.pSlots[i].b);
+	}
+	ptrmap_free(&self->pairs);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Paircache_repr(PyObject *self_in)
+{
+	PaircacheObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Paircache_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (PaircacheObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->pairs.nSize);
+	fmtstring = PyString_FromString("<paircache of %d pairs>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Paircache_len(PyObject *self_in)
+{
+	PaircacheObject *self = (PaircacheObject*)self_in;
+
+	return self->pairs.nSize;
+}
+
+/* takes this tick's pairs as a flat sequence (a0, b0, a1, b1, ...), from */
+/* any broadphase, and returns (new, persisting, ended) as flat arrays. */
+/* Order within a pair does not matter and duplicates are ignored. */
+PyObject* Paircache_update(PyObject *self_in, PyObject *args)
+{
+	PaircacheObject *self = (PaircacheObject*)self_in;
+	PyObject *seq, *pFast, *a, *b, *tmp;
+	ObarrObject *pNew, *pStay, *pEnded;
+	long n, i, j;
+
+    if (!PyArg_ParseTuple(args, "O", &seq))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	pFast = PySequence_Fast(seq, "update() requires a flat sequence of pairs");
+	if (!pFast)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(pFast);
+	if (n % 2)
+	{
+		Py_DECREF(pFast);
+		PyErr_SetString(PyExc_ValueError, "pair sequence has an odd length");
+		return NULL;
+	}
+
+	pNew = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pNew, NULL, NULL);
+	pStay = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pStay, NULL, NULL);
+	pEnded = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pEnded, NULL, NULL);
+
+	self->nTick++;
+	for (i = 0; i < n; i += 2)
+	{
+		a = PySequence_Fast_GET_ITEM(pFast, i);
+		b = PySequence_Fast_GET_ITEM(pFast, i + 1);
+		if (b < a)
+		{
+			tmp = a; a = b; b = tmp;
+		}
+		j = ptrmap_find(&self->pairs, a, b);
+		if (j >= 0)
+		{
+			if (self->pairs.pSlots[j].value == self->nTick)
+				continue;
+			self->pairs.pSlots[j].value = self->nTick;
+			if (!paircache_append(pStay, a, b))
+				goto nomem;
+			continue;
+		}
+		if (ptrmap_set(&self->pairs, a, b, self->nTick) < 0)
+			goto nomem;
+		Py_INCREF(a);
+		Py_INCREF(b);
+		if (!paircache_append(pNew, a, b))
+			goto nomem;
+	}
+	if (!paircache_expire(self, pEnded))
+		goto nomem;
+
+	Py_DECREF(pFast);
+	return Py_BuildValue("(NNN)", pNew, pStay, pEnded);
+
+nomem:
+	Py_DECREF(pFast);
+	Py_DECREF(pNew);
+	Py_DECREF(pStay);
+	Py_DECREF(pEnded);
+	PyErr_SetString(PyExc_MemoryError, "out of memory");
+	return NULL;
+}
+
+/* forgets every pair, returning them as a flat array of ended pairs */
+PyObject* Paircache_clear(PyObject *self_in, PyObject *unused)
+{
+	PaircacheObject *self = (PaircacheObject*)self_in;
+	ObarrObject *pEnded;
+
+	pEnded = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(pEnded, NULL, NULL);
+	self->nTick++;
+	if (!paircache_expire(self, pEnded))
+	{
+		Py_DECREF(pEnded);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return NULL;
+	}
+	return (PyObject*)pEnded;
+}
+
+
+
+PySequenceMethods Paircache_as_seq[] = {
+	Paircache_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Paircache_methods[] = {
+	{"update", (PyCFunction)Paircache_update, METH_VARARGS, "feed this tick's flat pair array, returning (new, persisting, ended) flat arrays"},
+	{"clear", (PyCFunction)Paircache_clear, METH_NOARGS, "forget every pair, returning them as ended"},
+	{NULL}
+};
+
+struct PyMemberDef Paircache_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject PaircacheObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.paircache",		/* tp_name        */
+	sizeof(PaircacheObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Paircache_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Paircache_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Paircache_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Cache of broadphase pairs reporting which began, persisted and ended.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Paircache_methods,   /* tp_methods        */
+	Paircache_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Paircache_init,		/* tp_init           */
+};
@@ -0,0 +1,44 @@
+#ifndef PAIRCACHE_H_INCLUDED
+#define PAIRCACHE_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+#include "ptrmap.h"
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+typedef struct ObarrObject ObarrObject;
+
+/* the pairs seen last tick, keyed by their two objects (lower address */
+/* first) and holding a reference to both.  The value is the last tick the */
+/* pair was reported on. */
+typedef struct PaircacheObject {
+	PyObject_HEAD
+	Ptrmap			pairs;
+	long			nTick;
+} PaircacheObject;
+
+#define Paircache_Check(op) PyObject_TypeCheck(op, &PaircacheObjectType)
+
+/* internal functions */
+int paircache_append(ObarrObject* pOut, PyObject* a, PyObject* b);
+int paircache_expire(PaircacheObject* self, ObarrObject* pEnded);
+
+/* exported API functions */
+int Paircache_init(PaircacheObject *self, PyObject *args, PyObject *kwds);
+void Paircache_dealloc(PyObject* self_in);
+PyObject* Paircache_repr(PyObject *self_in);
+Py_ssize_t Paircache_len(PyObject *self_in);
+PyObject* Paircache_update(PyObject *self_in, PyObject *args);
+PyObject* Paircache_clear(PyObject *self_in, PyObject *unused);
+
+extern PySequenceMethods Paircache_as_seq[];
+extern PyMethodDef Paircache_methods[];
+extern struct PyMemberDef Paircache_members[];
+extern PyTypeObject PaircacheObjectType;
+
+#endif
@@ -0,0 +1,474 @@
+#include "particles.h"
+#include "bodies.h"
+#include "vect.h"
+#include <math.h>
+#include <string.h>
+
+void particles_clear(ParticlesObject* self)
+{
+	if (self->pData)
+		free(self->pData);
+	if (self->pVertex)
+		free(self->pVertex);
+	self->pData = NULL;
+	self->pVertex = NULL;
+	self->nCount = 0;
+	self->nAlloc = 0;
+}
+
+/* xorshift64*, uniform in [0, 1) */
+double particles_random(ParticlesObject* self)
+{
+	unsigned PY_LONG_LONG x = self->nSeed;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	self->nSeed = x;
+	return (double)((x * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* uniform in the unit ball */
+void particles_in_ball(ParticlesObject* self, double* v)
+{
+	do
+	{
+		v[0] = (particles_random(self) * 2.0) - 1.0;
+		v[1] = (particles_random(self) * 2.0) - 1.0;
+		v[2] = (particles_random(self) * 2.0) - 1.0;
+	} while ((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]) > 1.0);
+}
+
+/* refreshes the exported vertices of particles nStart onwards */
+void particles_write_vertices(ParticlesObject* self, long nStart)
+{
+	float* v = self->pVertex + (nStart * PARTICLES_VERTEX);
+	long i;
+	int k;
+
+	for (i = nStart; i < self->nCount; i++)
+	{
+		for (k = 0; k < 3; k++)
+			*v++ = (float)PARTICLES_ROW(self, PARTICLES_PX + k)[i];
+		for (k = 0; k < 4; k++)
+			*v++ = (float)PARTICLES_ROW(self, PARTICLES_RGBA + k)[i];
+	}
+}
+
+/* adds up to n particles at a point, in a sphere of radius ext[0] moving */
+/* out at dSpread, or in a box of half extents ext.  Point and box */
+/* particles move at vel plus up to dSpread in any direction.  Returns */
+/* how many fitted in the pool. */
+long particles_emit(ParticlesObject* self, int nShape, long n, double* pos, double* ext, double* vel, double dSpread, double dLife, double* rgba)
+{
+	double p[3], v[3], u[3], len;
+	long i, j, nStart = self->nCount;
+	int k;
+
+	if (n > self->nAlloc - self->nCount)
+		n = self->nAlloc - self->nCount;
+	for (j = 0; j < n; j++)
+	{
+		i = self->nCount++;
+		particles_in_ball(self, u);
+		for (k = 0; k < 3; k++)
+		{
+			p[k] = pos[k];
+			v[k] = vel[k] + (u[k] * dSpread);
+		}
+		if (nShape == PARTICLES_SPHERE)
+		{
+			len = sqrt((u[0] * u[0]) + (u[1] * u[1]) + (u[2] * u[2]));
+			for (k = 0; k < 3; k++)
+			{
+				p[k] = pos[k] + (u[k] * ext[0]);
+				v[k] = (len > 0.0) ? (u[k] / len) * dSpread : 0.0;
+			}
+		}
+		else if (nShape == PARTICLES_BOX)
+		{
+			for (k = 0; k < 3; k++)
+				p[k] = pos[k] + (((particles_random(self) * 2.0) - 1.0) * ext[k]);
+		}
+		for (k = 0; k < 3; k++)
+		{
+			PARTICLES_ROW(self, PARTICLES_PX + k)[i] = p[k];
+			PARTICLES_ROW(self, PARTICLES_VX + k)[i] = v[k];
+		}
+		for (k = 0; k < 4; k++)
+			PARTICLES_ROW(self, PARTICLES_RGBA + k)[i] = rgba[k];
+		PARTICLES_ROW(self, PARTICLES_AGE)[i] = 0.0;
+		PARTICLES_ROW(self, PARTICLES_LIFE)[i] = dLife;
+	}
+	particles_write_vertices(self, nStart);
+	return n;
+}
+
+/* shared body of the emit_* methods */
+PyObject* particles_emit_args(PyObject* self_in, PyObject* args, int nShape)
+{
+	ParticlesObject* self = (ParticlesObject*)self_in;
+	PyObject *pPos, *pExt = NULL, *pVel = NULL, *pColour = NULL;
+	double pos[3], ext[3] = {0.0, 0.0, 0.0}, vel[3] = {0.0, 0.0, 0.0};
+	double rgba[4] = {1.0, 1.0, 1.0, 1.0};
+	double dSpread = 0.0, dLife = 1.0;
+	long n;
+	int bOk;
+
+	if (nShape == PARTICLES_POINT)
+		bOk = PyArg_ParseTuple(args, "lOO|ddO", &n, &pPos, &pVel, &dSpread, &dLife, &pColour);
+	else if (nShape == PARTICLES_SPHERE)
+		bOk = PyArg_ParseTuple(args, "lOdd|dO", &n, &pPos, &ext[0], &dSpread, &dLife, &pColour);
+	else
+		bOk = PyArg_ParseTuple(args, "lOOO|ddO", &n, &pPos, &pExt, &pVel, &dSpread, &dLife, &pColour);
+	if (!bOk)
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_read_arg(pPos, 0, pos) ||
+		(pExt && !bodies_read_arg(pExt, 0, ext)) ||
+		(pVel && !bodies_read_arg(pVel, 0, vel)))
+		return NULL;
+	if (pColour && pColour != Py_None && !PyArg_Parse(pColour, "(dddd)", &rgba[0], &rgba[1], &rgba[2], &rgba[3]))
+	{
+		PyErr_SetString(PyExc_TypeError, "colour must be an (r, g, b, a) tuple");
+		return NULL;
+	}
+	if (n < 0)
+		n = 0;
+	return PyInt_FromLong(particles_emit(self, nShape, n, pos, ext, vel, dSpread, dLife, rgba));
+}
+
+/* ages and moves every particle, then drops the expired ones by moving */
+/* the last live particle into each gap.  The motion is semi-implicit */
+/* Euler down the rows, with drag scaling velocity by 1 / (1 + dt * drag). */
+/* Each component gets its own loop over two rows so gcc can vectorize */
+/* it; the expiry test is a branch-free count, a double because gcc will */
+/* not vectorize one held in a long, and the compaction only runs when */
+/* something expired. */
+void particles_update(ParticlesObject* self, double dt, double* g, double dDrag)
+{
+	double *p, *v, *age, *life;
+	double drag = 1.0 / (1.0 + (dt * dDrag)), dv, dDead = 0.0;
+	long n = self->nCount, i;
+	int f, k;
+
+	for (k = 0; k < 3; k++)
+	{
+		p = PARTICLES_ROW(self, PARTICLES_PX + k);
+		v = PARTICLES_ROW(self, PARTICLES_VX + k);
+		dv = g[k] * dt;
+		for (i = 0; i < n; i++)
+		{
+			v[i] = (v[i] + dv) * drag;
+			p[i] += v[i] * dt;
+		}
+	}
+
+	age = PARTICLES_ROW(self, PARTICLES_AGE);
+	life = PARTICLES_ROW(self, PARTICLES_LIFE);
+	for (i = 0; i < n; i++)
+	{
+		age[i] += dt;
+		dDead += (age[i] < life[i]) ? 0.0 : 1.0;
+	}
+
+	i = 0;
+	while (dDead > 0.0 && i < n)
+	{
+		if (age[i] < life[i])
+		{
+			i++;
+			continue;
+		}
+		n--;
+		for (f = 0; f < PARTICLES_FIELDS; f++)
+			PARTICLES_ROW(self, f)[i] = PARTICLES_ROW(self, f)[n];
+	}
+	self->nCount = n;
+	particles_write_vertices(self, 0);
+}
+
+
+int Particles_init(ParticlesObject *self, PyObject *args, PyObject *kwds)
+{
+	long nAlloc, nSeed = 1;
+
+    if (!PyArg_ParseTuple(args, "l|l", &nAlloc, &nSeed))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	if (self->nExports > 0)
+	{
+		PyErr_SetString(PyExc_BufferError, "particles are exported to a buffer");
+		return -1;
+	}
+	if (nAlloc < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "capacity must be positive");
+		return -1;
+	}
+	particles_clear(self);
+	self->pData = (double*)malloc(nAlloc * PARTICLES_FIELDS * sizeof(double));
+	self->pVertex = (float*)malloc(nAlloc * PARTICLES_VERTEX * sizeof(float));
+	if (!self->pData || !self->pVertex)
+	{
+		particles_clear(self);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return -1;
+	}
+	self->nAlloc = nAlloc;
+	self->nSeed = (unsigned PY_LONG_LONG)nSeed * 0x9E3779B97F4A7C15ULL;
+	if (!self->nSeed)
+		self->nSeed = 0x9E3779B97F4A7C15ULL;
+	return 0;
+}
+
+void Particles_dealloc(PyObject* self_in)
+{
+	particles_clear((ParticlesObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Particles_repr(PyObject *self_in)
+{
+	ParticlesObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Particles_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (ParticlesObject*)self_in;
+	tuple = Py_BuildValue("(ll)", self->nCount, self->nAlloc);
+	fmtstring = PyString_FromString("<particles %d of %d>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Particles_len(PyObject *self_in)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	return self->nCount;
+}
+
+PyObject* Particles_emit_point(PyObject *self_in, PyObject *args)
+{
+	return particles_emit_args(self_in, args, PARTICLES_POINT);
+}
+
+PyObject* Particles_emit_sphere(PyObject *self_in, PyObject *args)
+{
+	return particles_emit_args(self_in, args, PARTICLES_SPHERE);
+}
+
+PyObject* Particles_emit_box(PyObject *self_in, PyObject *args)
+{
+	return particles_emit_args(self_in, args, PARTICLES_BOX);
+}
+
+/* update(dt[, gravity[, drag]]) returns the particles left alive */
+PyObject* Particles_update(PyObject *self_in, PyObject *args)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+	PyObject *pGravity = NULL;
+	double dt, g[3] = {0.0, 0.0, 0.0};
+	double dDrag = 0.0;
+
+    if (!PyArg_ParseTuple(args, "d|Od", &dt, &pGravity, &dDrag))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (pGravity && pGravity != Py_None && !bodies_read_arg(pGravity, 0, g))
+		return NULL;
+	if (dDrag < 0.0)
+	{
+		PyErr_SetString(PyExc_ValueError, "drag must not be negative");
+		return NULL;
+	}
+	particles_update(self, dt, g, dDrag);
+	return PyInt_FromLong(self->nCount);
+}
+
+PyObject* Particles_kill_all(PyObject *self_in, PyObject *args)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	self->nCount = 0;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Particles_get_pos(PyObject *self_in, PyObject *args)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+	VectObject *rv;
+	long i;
+	int k;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (i < 0 || i >= self->nCount)
+	{
+		PyErr_SetString(PyExc_IndexError, "particle index out of range");
+		return NULL;
+	}
+	rv = PyObject_New(VectObject, &VectObjectType);
+	if (rv)
+	{
+		for (k = 0; k < 3; k++)
+			rv->elements[k] = PARTICLES_ROW(self, PARTICLES_PX + k)[i];
+	}
+	return (PyObject*)rv;
+}
+
+PyObject* Particles_get_age(PyObject *self_in, PyObject *args)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+	long i;
+
+    if (!PyArg_ParseTuple(args, "l", &i))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (i < 0 || i >= self->nCount)
+	{
+		PyErr_SetString(PyExc_IndexError, "particle index out of range");
+		return NULL;
+	}
+	return PyFloat_FromDouble(PARTICLES_ROW(self, PARTICLES_AGE)[i]);
+}
+
+/* the old style buffer interface: one read-only segment of the live */
+/* vertices.  The pool never reallocates after init, so the pointer holds. */
+Py_ssize_t Particles_getreadbuffer(PyObject *self_in, Py_ssize_t nSegment, void **ppData)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	if (nSegment != 0)
+	{
+		PyErr_SetString(PyExc_SystemError, "accessing non-existent particles segment");
+		return -1;
+	}
+	*ppData = self->pVertex;
+	return self->nCount * PARTICLES_VERTEX * sizeof(float);
+}
+
+Py_ssize_t Particles_getsegcount(PyObject *self_in, Py_ssize_t *pnLen)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	if (pnLen)
+		*pnLen = self->nCount * PARTICLES_VERTEX * sizeof(float);
+	return 1;
+}
+
+/* the new style buffer interface, for memoryview */
+int Particles_getbuffer(PyObject *self_in, Py_buffer *view, int flags)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	if (!self->pVertex)
+	{
+		PyErr_SetString(PyExc_BufferError, "particles not initialized");
+		return -1;
+	}
+	if (PyBuffer_FillInfo(view, self_in, self->pVertex, self->nCount * PARTICLES_VERTEX * sizeof(float), 1, flags) < 0)
+		return -1;
+	self->nExports++;
+	return 0;
+}
+
+void Particles_releasebuffer(PyObject *self_in, Py_buffer *view)
+{
+	ParticlesObject *self = (ParticlesObject*)self_in;
+
+	self->nExports--;
+}
+
+
+
+PySequenceMethods Particles_as_seq[] = {
+	Particles_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyBufferProcs Particles_as_buffer[] = {
+	(readbufferproc)Particles_getreadbuffer,	/* bf_getreadbuffer */
+	0,					/* bf_getwritebuffer */
+	(segcountproc)Particles_getsegcount,		/* bf_getsegcount */
+	(charbufferproc)Particles_getreadbuffer,	/* bf_getcharbuffer */
+	(getbufferproc)Particles_getbuffer,		/* bf_getbuffer */
+	(releasebufferproc)Particles_releasebuffer,	/* bf_releasebuffer */
+};
+
+PyMethodDef Particles_methods[] = {
+	{"emit_point", (PyCFunction)Particles_emit_point, METH_VARARGS, "emit (n, pos, vel[, spread[, life[, colour]]]) from a point, returning how many fitted"},
+	{"emit_sphere", (PyCFunction)Particles_emit_sphere, METH_VARARGS, "emit (n, center, radius, speed[, life[, colour]]) inside a sphere, moving outward"},
+	{"emit_box", (PyCFunction)Particles_emit_box, METH_VARARGS, "emit (n, center, half_extents, vel[, spread[, life[, colour]]]) inside a box"},
+	{"update", (PyCFunction)Particles_update, METH_VARARGS, "advance every particle by dt with optional gravity and drag, removing the expired; returns the live count"},
+	{"kill_all", (PyCFunction)Particles_kill_all, METH_NOARGS, "remove every particle"},
+	{"get_pos", (PyCFunction)Particles_get_pos, METH_VARARGS, "position of a live particle"},
+	{"get_age", (PyCFunction)Particles_get_age, METH_VARARGS, "age of a live particle"},
+	{NULL}
+};
+
+struct PyMemberDef Particles_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject ParticlesObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.particles",		/* tp_name        */
+	sizeof(ParticlesObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Particles_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Particles_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Particles_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	Particles_as_buffer,	/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES|Py_TPFLAGS_HAVE_NEWBUFFER,		/* tp_flags       */
+	"Particle pool; the buffer interface gives x, y, z, r, g, b, a floats per live particle.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Particles_methods,   /* tp_methods        */
+	Particles_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Particles_init,		/* tp_init           */
+};
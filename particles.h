@@ -0,0 +1,77 @@
+#ifndef PARTICLES_H_INCLUDED
+#define PARTICLES_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+/* a fixed size particle pool.  The simulation state is kept one row of */
+/* doubles per component, like bodies; live particles are always */
+/* 0 .. nCount - 1, dead ones being replaced by the last live one.  After */
+/* every change the live particles are also written to pVertex as */
+/* x, y, z, r, g, b, a floats, which the pool exposes through the buffer */
+/* interface for handing straight to a vertex buffer. */
+typedef struct ParticlesObject {
+	PyObject_HEAD
+	double*			pData;
+	float*			pVertex;
+	long			nCount;
+	long			nAlloc;
+	unsigned PY_LONG_LONG	nSeed;
+	long			nExports;	/* buffer views currently held */
+} ParticlesObject;
+
+#define PARTICLES_PX		0		/* position */
+#define PARTICLES_VX		3		/* velocity */
+#define PARTICLES_AGE		6
+#define PARTICLES_LIFE		7
+#define PARTICLES_RGBA		8		/* colour */
+#define PARTICLES_FIELDS	12
+#define PARTICLES_VERTEX	7		/* floats per particle in pVertex */
+
+#define PARTICLES_ROW(self, f) ((self)->pData + ((f) * (self)->nAlloc))
+
+#define PARTICLES_POINT		0
+#define PARTICLES_SPHERE	1
+#define PARTICLES_BOX		2
+
+#define Particles_Check(op) PyObject_TypeCheck(op, &ParticlesObjectType)
+
+/* internal functions */
+void particles_clear(ParticlesObject* self);
+double particles_random(ParticlesObject* self);
+void particles_in_ball(ParticlesObject* self, double* v);
+void particles_write_vertices(ParticlesObject* self, long nStart);
+long particles_emit(ParticlesObject* self, int nShape, long n, double* pos, double* ext, double* vel, double dSpread, double dLife, double* rgba);
+PyObject* particles_emit_args(PyObject* self_in, PyObject* args, int nShape);
+void particles_update(ParticlesObject* self, double dt, double* g, double dDrag);
+
+/* exported API functions */
+int Particles_init(ParticlesObject *self, PyObject *args, PyObject *kwds);
+void Particles_dealloc(PyObject* self_in);
+PyObject* Particles_repr(PyObject *self_in);
+Py_ssize_t Particles_len(PyObject *self_in);
+PyObject* Particles_emit_point(PyObject *self_in, PyObject *args);
+PyObject* Particles_emit_sphere(PyObject *self_in, PyObject *args);
+PyObject* Particles_emit_box(PyObject *self_in, PyObject *args);
+PyObject* Particles_update(PyObject *self_in, PyObject *args);
+PyObject* Particles_kill_all(PyObject *self_in, PyObject *args);
+PyObject* Particles_get_pos(PyObject *self_in, PyObject *args);
+PyObject* Particles_get_age(PyObject *self_in, PyObject *args);
+Py_ssize_t Particles_getreadbuffer(PyObject *self_in, Py_ssize_t nSegment, void **ppData);
+Py_ssize_t Particles_getsegcount(PyObject *self_in, Py_ssize_t *pnLen);
+int Particles_getbuffer(PyObject *self_in, Py_buffer *view, int flags);
+void Particles_releasebuffer(PyObject *self_in, Py_buffer *view);
+
+extern PySequenceMethods Particles_as_seq[];
+extern PyBufferProcs Particles_as_buffer[];
+extern PyMethodDef Particles_methods[];
+extern struct PyMemberDef Particles_members[];
+extern PyTypeObject ParticlesObjectType;
+
+#endif
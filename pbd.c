@@ -0,0 +1,577 @@
+#include "pbd.h"
+#include "bodies.h"
+#include "particles.h"
+#include "threads.h"
+#include "cgrid.h"
+#include <math.h>
+#include <string.h>
+
+#define PBD_W(v, i) ((v)->pInvMass ? (v)->pInvMass[i] : 1.0)
+
+void pbd_clear(PbdObject* self)
+{
+	if (self->pCons)
+		free(self->pCons);
+	if (self->pOrder)
+		free(self->pOrder);
+	self->pCons = NULL;
+	self->pOrder = NULL;
+	self->nCons = 0;
+	self->nAlloc = 0;
+	self->nMaxIndex = -1;
+	self->bDirty = 1;
+}
+
+/* appends a constraint, returning its number or -1 */
+long pbd_add(PbdObject* self, PbdConstraint* pCon)
+{
+	PbdConstraint* pCons;
+	long nAlloc;
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		if (pCon->i[k] < -1 || (k == 0 && pCon->i[k] < 0))
+		{
+			PyErr_SetString(PyExc_IndexError, "point index out of range");
+			return -1;
+		}
+	}
+	if (self->nCons == self->nAlloc)
+	{
+		nAlloc = self->nAlloc ? self->nAlloc * 2 : 64;
+		pCons = (PbdConstraint*)realloc(self->pCons, nAlloc * sizeof(PbdConstraint));
+		if (!pCons)
+		{
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return -1;
+		}
+		self->pCons = pCons;
+		self->nAlloc = nAlloc;
+	}
+	if (pCon->dStiffness < 0.0)
+		pCon->dStiffness = 0.0;
+	if (pCon->dStiffness > 1.0)
+		pCon->dStiffness = 1.0;
+	for (k = 0; k < 3; k++)
+	{
+		if (pCon->i[k] > self->nMaxIndex)
+			self->nMaxIndex = pCon->i[k];
+	}
+	self->pCons[self->nCons] = *pCon;
+	self->bDirty = 1;
+	return self->nCons++;
+}
+
+/* greedy colouring: each constraint takes the lowest colour none of its */
+/* points has yet, tracked as a bit mask per point.  Constraints finding */
+/* all PBD_MAX_COLOURS taken go to the overflow colour. */
+int pbd_colour(PbdObject* self)
+{
+	unsigned PY_LONG_LONG* pMask;
+	unsigned PY_LONG_LONG nUsed;
+	long* pFill;
+	long* pOrder;
+	long nCount[PBD_MAX_COLOURS + 1];
+	long c, j;
+	int k, b;
+
+	pMask = (unsigned PY_LONG_LONG*)calloc(self->nMaxIndex + 2, sizeof(unsigned PY_LONG_LONG));
+	pFill = (long*)malloc((self->nCons + 1) * sizeof(long));
+	pOrder = (long*)malloc((self->nCons + 1) * sizeof(long));
+	if (!pMask || !pFill || !pOrder)
+	{
+		free(pMask);
+		free(pFill);
+		free(pOrder);
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		return 0;
+	}
+
+	memset(nCount, 0, sizeof(nCount));
+	for (c = 0; c < self->nCons; c++)
+	{
+		nUsed = 0;
+		for (k = 0; k < 3; k++)
+		{
+			if (self->pCons[c].i[k] >= 0)
+				nUsed |= pMask[self->pCons[c].i[k]];
+		}
+		for (b = 0; b < PBD_MAX_COLOURS && (nUsed & ((unsigned PY_LONG_LONG)1 << b)); b++)
+			;
+		if (b < PBD_MAX_COLOURS)
+		{
+			for (k = 0; k < 3; k++)
+			{
+				if (self->pCons[c].i[k] >= 0)
+					pMask[self->pCons[c].i[k]] |= (unsigned PY_LONG_LONG)1 << b;
+			}
+		}
+		pFill[c] = b;
+		nCount[b]++;
+	}
+
+	self->pColour[0] = 0;
+	for (b = 0; b <= PBD_MAX_COLOURS; b++)
+		self->pColour[b + 1] = self->pColour[b] + nCount[b];
+	memset(nCount, 0, sizeof(nCount));
+	for (c = 0; c < self->nCons; c++)
+	{
+		j = self->pColour[pFill[c]] + nCount[pFill[c]]++;
+		pOrder[j] = c;
+	}
+
+	free(pMask);
+	free(pFill);
+	if (self->pOrder)
+		free(self->pOrder);
+	self->pOrder = pOrder;
+	self->bDirty = 0;
+	return 1;
+}
+
+/* the position, velocity and inverse mass rows of a bodies store, or of */
+/* a particles pool whose particles all weigh the same */
+int pbd_read_view(PyObject* store, PbdView* pView)
+{
+	BodiesObject* pBodies;
+	ParticlesObject* pParticles;
+
+	if (Bodies_Check(store))
+	{
+		pBodies = (BodiesObject*)store;
+		pView->px = BODIES_ROW(pBodies, BODIES_PX);
+		pView->py = BODIES_ROW(pBodies, BODIES_PX + 1);
+		pView->pz = BODIES_ROW(pBodies, BODIES_PX + 2);
+		pView->vx = BODIES_ROW(pBodies, BODIES_VX);
+		pView->vy = BODIES_ROW(pBodies, BODIES_VX + 1);
+		pView->vz = BODIES_ROW(pBodies, BODIES_VX + 2);
+		pView->pInvMass = BODIES_ROW(pBodies, BODIES_IM);
+		pView->nCount = pBodies->nCount;
+		return 1;
+	}
+	if (Particles_Check(store))
+	{
+		pParticles = (ParticlesObject*)store;
+		if (!pParticles->pData)
+		{
+			PyErr_SetString(PyExc_ValueError, "particles not initialized");
+			return 0;
+		}
+		pView->px = PARTICLES_ROW(pParticles, PARTICLES_PX);
+		pView->py = PARTICLES_ROW(pParticles, PARTICLES_PX + 1);
+		pView->pz = PARTICLES_ROW(pParticles, PARTICLES_PX + 2);
+		pView->vx = PARTICLES_ROW(pParticles, PARTICLES_VX);
+		pView->vy = PARTICLES_ROW(pParticles, PARTICLES_VX + 1);
+		pView->vz = PARTICLES_ROW(pParticles, PARTICLES_VX + 2);
+		pView->pInvMass = NULL;
+		pView->nCount = pParticles->nCount;
+		return 1;
+	}
+	PyErr_SetString(PyExc_TypeError, "store must be a bodies or particles object");
+	return 0;
+}
+
+/* moves the points of one constraint along its gradient, each in */
+/* proportion to its inverse mass, by dK of the way to satisfying it */
+void pbd_project(PbdConstraint* pCon, PbdView* v)
+{
+	double d[3], e[3], u[3], w[3], gi[3], gk[3];
+	double len, le, lw, wi, wj, wk, s, cs, sn, ang;
+	long i = pCon->i[0], j = pCon->i[1], k = pCon->i[2];
+	int a;
+
+	if (pCon->nType == PBD_PIN)
+	{
+		if (PBD_W(v, i) == 0.0)
+			return;
+		v->px[i] += (pCon->p[0] - v->px[i]) * pCon->dK;
+		v->py[i] += (pCon->p[1] - v->py[i]) * pCon->dK;
+		v->pz[i] += (pCon->p[2] - v->pz[i]) * pCon->dK;
+		return;
+	}
+
+	if (pCon->nType == PBD_DISTANCE)
+	{
+		wi = PBD_W(v, i);
+		wj = PBD_W(v, j);
+		if (wi + wj == 0.0)
+			return;
+		d[0] = v->px[j] - v->px[i];
+		d[1] = v->py[j] - v->py[i];
+		d[2] = v->pz[j] - v->pz[i];
+		len = sqrt((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2]));
+		if (len < 1e-12)
+			return;
+		s = pCon->dK * (len - pCon->dRest) / ((wi + wj) * len);
+		v->px[i] += d[0] * s * wi; v->py[i] += d[1] * s * wi; v->pz[i] += d[2] * s * wi;
+		v->px[j] -= d[0] * s * wj; v->py[j] -= d[1] * s * wj; v->pz[j] -= d[2] * s * wj;
+		return;
+	}
+
+	/* angle at j: with u, w the unit arms, d(theta)/d(x[i]) is */
+	/* -(w - cos(theta) u) / (sin(theta) |e_i|), likewise for x[k], and */
+	/* x[j] takes minus their sum */
+	wi = PBD_W(v, i);
+	wj = PBD_W(v, j);
+	wk = PBD_W(v, k);
+	e[0] = v->px[i] - v->px[j]; e[1] = v->py[i] - v->py[j]; e[2] = v->pz[i] - v->pz[j];
+	d[0] = v->px[k] - v->px[j]; d[1] = v->py[k] - v->py[j]; d[2] = v->pz[k] - v->pz[j];
+	le = sqrt((e[0] * e[0]) + (e[1] * e[1]) + (e[2] * e[2]));
+	lw = sqrt((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2]));
+	if (le < 1e-12 || lw < 1e-12)
+		return;
+	for (a = 0; a < 3; a++)
+	{
+		u[a] = e[a] / le;
+		w[a] = d[a] / lw;
+	}
+	cs = (u[0] * w[0]) + (u[1] * w[1]) + (u[2] * w[2]);
+	cs = (cs > 1.0) ? 1.0 : ((cs < -1.0) ? -1.0 : cs);
+	sn = sqrt(1.0 - (cs * cs));
+	if (sn < 1e-6)
+		return;
+	ang = acos(cs);
+	for (a = 0; a < 3; a++)
+	{
+		gi[a] = -(w[a] - (cs * u[a])) / (sn * le);
+		gk[a] = -(u[a] - (cs * w[a])) / (sn * lw);
+	}
+	s = (wi * ((gi[0] * gi[0]) + (gi[1] * gi[1]) + (gi[2] * gi[2]))) +
+		(wk * ((gk[0] * gk[0]) + (gk[1] * gk[1]) + (gk[2] * gk[2]))) +
+		(wj * (SQR(gi[0] + gk[0]) + SQR(gi[1] + gk[1]) + SQR(gi[2] + gk[2])));
+	if (s == 0.0)
+		return;
+	s = -pCon->dK * (ang - pCon->dRest) / s;
+	v->px[i] += s * wi * gi[0]; v->py[i] += s * wi * gi[1]; v->pz[i] += s * wi * gi[2];
+	v->px[k] += s * wk * gk[0]; v->py[k] += s * wk * gk[1]; v->pz[k] += s * wk * gk[2];
+	v->px[j] -= s * wj * (gi[0] + gk[0]);
+	v->py[j] -= s * wj * (gi[1] + gk[1]);
+	v->pz[j] -= s * wj * (gi[2] + gk[2]);
+}
+
+/* thread body of solve, over part of one colour */
+void pbd_batch(void* pArg, long nStart, long nEnd, int nThread)
+{
+	PbdBatch* pBatch = (PbdBatch*)pArg;
+	PbdObject* self = pBatch->self;
+	long j;
+
+	for (j = nStart; j < nEnd; j++)
+		pbd_project(&self->pCons[self->pOrder[pBatch->nFirst + j]], pBatch->pView);
+}
+
+
+int Pbd_init(PbdObject *self, PyObject *args, PyObject *kwds)
+{
+    if (!PyArg_ParseTuple(args, ""))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return -1;
+	}
+	pbd_clear(self);
+	return 0;
+}
+
+void Pbd_dealloc(PyObject* self_in)
+{
+	pbd_clear((PbdObject*)self_in);
+	self_in->ob_type->tp_free(self_in);
+}
+
+PyObject* Pbd_repr(PyObject *self_in)
+{
+	PbdObject *self;
+	PyObject *tuple, *fmtstring, *reprstring;
+
+	if (!Pbd_Check(self_in))
+		return PyString_FromString("<unknown object type>");
+
+	self = (PbdObject*)self_in;
+	tuple = Py_BuildValue("(l)", self->nCons);
+	fmtstring = PyString_FromString("<pbd of %d constraints>");
+	reprstring = PyString_Format(fmtstring, tuple);
+	Py_DECREF(tuple);
+	Py_DECREF(fmtstring);
+	return reprstring;
+}
+
+Py_ssize_t Pbd_len(PyObject *self_in)
+{
+	PbdObject *self = (PbdObject*)self_in;
+
+	return self->nCons;
+}
+
+/* add_distance(i, j, rest[, stiffness]) */
+PyObject* Pbd_add_distance(PyObject *self_in, PyObject *args)
+{
+	PbdConstraint con;
+	long n;
+
+	memset(&con, 0, sizeof(con));
+	con.dStiffness = 1.0;
+    if (!PyArg_ParseTuple(args, "lld|d", &con.i[0], &con.i[1], &con.dRest, &con.dStiffness))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	con.nType = PBD_DISTANCE;
+	con.i[2] = -1;
+	if (con.i[1] < 0 || con.i[0] == con.i[1])
+	{
+		PyErr_SetString(PyExc_IndexError, "point index out of range");
+		return NULL;
+	}
+	n = pbd_add((PbdObject*)self_in, &con);
+	return (n < 0) ? NULL : PyInt_FromLong(n);
+}
+
+/* add_pin(i, point[, stiffness]) */
+PyObject* Pbd_add_pin(PyObject *self_in, PyObject *args)
+{
+	PbdConstraint con;
+	PyObject *pPoint;
+	long n;
+
+	memset(&con, 0, sizeof(con));
+	con.dStiffness = 1.0;
+    if (!PyArg_ParseTuple(args, "lO|d", &con.i[0], &pPoint, &con.dStiffness))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!bodies_read_arg(pPoint, 0, con.p))
+		return NULL;
+	con.nType = PBD_PIN;
+	con.i[1] = con.i[2] = -1;
+	n = pbd_add((PbdObject*)self_in, &con);
+	return (n < 0) ? NULL : PyInt_FromLong(n);
+}
+
+/* add_angle(i, j, k, angle[, stiffness]), the angle at j in radians */
+PyObject* Pbd_add_angle(PyObject *self_in, PyObject *args)
+{
+	PbdConstraint con;
+	long n;
+
+	memset(&con, 0, sizeof(con));
+	con.dStiffness = 1.0;
+    if (!PyArg_ParseTuple(args, "llld|d", &con.i[0], &con.i[1], &con.i[2], &con.dRest, &con.dStiffness))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	con.nType = PBD_ANGLE;
+	if (con.i[1] < 0 || con.i[2] < 0 || con.i[0] == con.i[1] || con.i[1] == con.i[2] || con.i[0] == con.i[2])
+	{
+		PyErr_SetString(PyExc_IndexError, "point index out of range");
+		return NULL;
+	}
+	n = pbd_add((PbdObject*)self_in, &con);
+	return (n < 0) ? NULL : PyInt_FromLong(n);
+}
+
+/* set_pin(constraint, point) moves the anchor of a pin */
+PyObject* Pbd_set_pin(PyObject *self_in, PyObject *args)
+{
+	PbdObject *self = (PbdObject*)self_in;
+	PyObject *pPoint;
+	double p[3];
+	long c;
+
+    if (!PyArg_ParseTuple(args, "lO", &c, &pPoint))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (c < 0 || c >= self->nCons || self->pCons[c].nType != PBD_PIN)
+	{
+		PyErr_SetString(PyExc_IndexError, "not a pin constraint");
+		return NULL;
+	}
+	if (!bodies_read_arg(pPoint, 0, p))
+		return NULL;
+	memcpy(self->pCons[c].p, p, sizeof(p));
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* Pbd_clear(PyObject *self_in, PyObject *args)
+{
+	pbd_clear((PbdObject*)self_in);
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* the number of colours in use, colouring first if needed */
+PyObject* Pbd_colours(PyObject *self_in, PyObject *args)
+{
+	PbdObject *self = (PbdObject*)self_in;
+	long n = 0;
+	int b;
+
+	if (self->bDirty && !pbd_colour(self))
+		return NULL;
+	for (b = 0; b <= PBD_MAX_COLOURS; b++)
+	{
+		if (self->pColour[b + 1] > self->pColour[b])
+			n++;
+	}
+	return PyInt_FromLong(n);
+}
+
+/* solve(store, iterations[, dt[, threads]]) projects every constraint */
+/* iterations times, a colour at a time.  The constraints of a colour */
+/* touch disjoint points, so large colours are split over threads.  With */
+/* dt the store's velocities take the position change divided by dt. */
+/* The GIL stays held so the store cannot be resized meanwhile. */
+PyObject* Pbd_solve(PyObject *self_in, PyObject *args)
+{
+	PbdObject *self = (PbdObject*)self_in;
+	PyObject *store;
+	PbdView view;
+	PbdBatch batch;
+	double *pOld = NULL;
+	double dt = 0.0, inv;
+	long nIter, n, it, i;
+	int nThreads = 0, b;
+
+    if (!PyArg_ParseTuple(args, "Ol|di", &store, &nIter, &dt, &nThreads))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!pbd_read_view(store, &view))
+		return NULL;
+	if (self->nMaxIndex >= view.nCount)
+	{
+		PyErr_SetString(PyExc_IndexError, "constraint refers to a point past the end of the store");
+		return NULL;
+	}
+	if (nIter < 1)
+	{
+		PyErr_SetString(PyExc_ValueError, "iterations must be positive");
+		return NULL;
+	}
+	if (self->bDirty && !pbd_colour(self))
+		return NULL;
+
+	n = view.nCount;
+	if (dt > 0.0)
+	{
+		pOld = (double*)malloc((n + 1) * 3 * sizeof(double));
+		if (!pOld)
+		{
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			return NULL;
+		}
+		memcpy(pOld, view.px, n * sizeof(double));
+		memcpy(pOld + n, view.py, n * sizeof(double));
+		memcpy(pOld + (2 * n), view.pz, n * sizeof(double));
+	}
+
+	/* Mueller's correction so the result does not depend on iterations */
+	for (i = 0; i < self->nCons; i++)
+		self->pCons[i].dK = 1.0 - pow(1.0 - self->pCons[i].dStiffness, 1.0 / nIter);
+
+	batch.self = self;
+	batch.pView = &view;
+	for (it = 0; it < nIter; it++)
+	{
+		for (b = 0; b <= PBD_MAX_COLOURS; b++)
+		{
+			batch.nFirst = self->pColour[b];
+			i = self->pColour[b + 1] - self->pColour[b];
+			if (i == 0)
+				continue;
+			if (b == PBD_MAX_COLOURS)
+				pbd_batch(&batch, 0, i, 0);
+			else
+				threads_run(pbd_batch, &batch, i, threads_pick(nThreads, i, PBD_MIN_BATCH));
+		}
+	}
+
+	if (pOld)
+	{
+		inv = 1.0 / dt;
+		for (i = 0; i < n; i++)
+		{
+			view.vx[i] += (view.px[i] - pOld[i]) * inv;
+			view.vy[i] += (view.py[i] - pOld[n + i]) * inv;
+			view.vz[i] += (view.pz[i] - pOld[(2 * n) + i]) * inv;
+		}
+		free(pOld);
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+
+
+PySequenceMethods Pbd_as_seq[] = {
+	Pbd_len,			/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+};
+
+PyMethodDef Pbd_methods[] = {
+	{"add_distance", (PyCFunction)Pbd_add_distance, METH_VARARGS, "keep points i and j at distance rest, returning the constraint number"},
+	{"add_pin", (PyCFunction)Pbd_add_pin, METH_VARARGS, "hold point i at a world point, returning the constraint number"},
+	{"add_angle", (PyCFunction)Pbd_add_angle, METH_VARARGS, "keep the angle i-j-k at j in radians, returning the constraint number"},
+	{"set_pin", (PyCFunction)Pbd_set_pin, METH_VARARGS, "move the anchor of a pin constraint"},
+	{"clear", (PyCFunction)Pbd_clear, METH_NOARGS, "remove every constraint"},
+	{"colours", (PyCFunction)Pbd_colours, METH_NOARGS, "number of colours the constraints are solved in"},
+	{"solve", (PyCFunction)Pbd_solve, METH_VARARGS, "project the constraints on a bodies or particles store (store, iterations[, dt[, threads]])"},
+	{NULL}
+};
+
+struct PyMemberDef Pbd_members[] = {
+	{NULL}  /* Sentinel */
+};
+
+
+PyTypeObject PbdObjectType = {
+	PyObject_HEAD_INIT(NULL)
+	0,				/* ob_size        */
+	"py3dutil.pbd",		/* tp_name        */
+	sizeof(PbdObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	Pbd_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	Pbd_repr,	    /* tp_repr        */
+	0,	/* tp_as_number   */
+	Pbd_as_seq,    /* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_CHECKTYPES,		/* tp_flags       */
+	"Position based constraint solver over a bodies or particles store.",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	Pbd_methods,   /* tp_methods        */
+	Pbd_members,   /* tp_members        */
+	0,    /* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)Pbd_init,		/* tp_init           */
+};
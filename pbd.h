@@ -0,0 +1,89 @@
+#ifndef PBD_H_INCLUDED
+#define PBD_H_INCLUDED
+
+#include <Python.h>
+#include <structmember.h>
+
+#if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
+typedef int Py_ssize_t;
+#define PY_SSIZE_T_MAX INT_MAX
+#define PY_SSIZE_T_MIN INT_MIN
+#endif
+
+#define PBD_DISTANCE	0		/* |x[i] - x[j]| = dRest */
+#define PBD_PIN			1		/* x[i] = p */
+#define PBD_ANGLE		2		/* angle between x[i] - x[j] and x[k] - x[j] = dRest */
+#define PBD_MAX_COLOURS	64		/* one bit each in a point's colour mask */
+
+typedef struct PbdConstraint {
+	int				nType;
+	long			i[3];
+	double			dRest;
+	double			dStiffness;
+	double			p[3];
+	double			dK;			/* stiffness per iteration, set by solve */
+} PbdConstraint;
+
+/* constraints are kept in insertion order in pCons.  Colouring puts */
+/* them in pOrder so that colour c runs from pColour[c] up to */
+/* pColour[c + 1] and no two constraints of a colour share a point; the */
+/* last colour is the overflow, solved in sequence on one thread. */
+typedef struct PbdObject {
+	PyObject_HEAD
+	PbdConstraint*	pCons;
+	long			nCons;
+	long			nAlloc;
+	long			nMaxIndex;
+	long*			pOrder;
+	long			pColour[PBD_MAX_COLOURS + 2];
+	int				bDirty;
+} PbdObject;
+
+/* the positions being solved: rows of a bodies or particles store */
+typedef struct PbdView {
+	double*			px;
+	double*			py;
+	double*			pz;
+	double*			vx;
+	double*			vy;
+	double*			vz;
+	double*			pInvMass;	/* NULL for all 1 */
+	long			nCount;
+} PbdView;
+
+typedef struct PbdBatch {
+	PbdObject*		self;
+	PbdView*		pView;
+	long			nFirst;		/* offset into pOrder of the colour */
+} PbdBatch;
+
+#define Pbd_Check(op) PyObject_TypeCheck(op, &PbdObjectType)
+#define PBD_MIN_BATCH 256	/* fewest constraints of a colour worth a thread */
+
+/* internal functions */
+void pbd_clear(PbdObject* self);
+long pbd_add(PbdObject* self, PbdConstraint* pCon);
+int pbd_colour(PbdObject* self);
+int pbd_read_view(PyObject* store, PbdView* pView);
+void pbd_project(PbdConstraint* pCon, PbdView* pView);
+void pbd_batch(void* pArg, long nStart, long nEnd, int nThread);
+
+/* exported API functions */
+int Pbd_init(PbdObject *self, PyObject *args, PyObject *kwds);
+void Pbd_dealloc(PyObject* self_in);
+PyObject* Pbd_repr(PyObject *self_in);
+Py_ssize_t Pbd_len(PyObject *self_in);
+PyObject* Pbd_add_distance(PyObject *self_in, PyObject *args);
+PyObject* Pbd_add_pin(PyObject *self_in, PyObject *args);
+PyObject* Pbd_add_angle(PyObject *self_in, PyObject *args);
+PyObject* Pbd_set_pin(PyObject *self_in, PyObject *args);
+PyObject* Pbd_clear(PyObject *self_in, PyObject *args);
+PyObject* Pbd_colours(PyObject *self_in, PyObject *args);
+PyObject* Pbd_solve(PyObject *self_in, PyObject *args);
+
+extern PySequenceMethods Pbd_as_seq[];
+extern PyMethodDef Pbd_methods[];
+extern struct PyMemberDef Pbd_members[];
+extern PyTypeObject PbdObjectType;
+
+#endif
@@ -0,0 +1,140 @@
+#include "ptrmap.h"
+#include <string.h>
+
+size_t ptrmap_hash(void* a, void* b)
+{
+	size_t h = ((size_t)a * (size_t)0x9E3779B1u) ^ ((size_t)b * (size_t)0x85EBCA6Bu);
+
+	/* objects are aligned, so fold the high bits into the low ones we mask */
+	h ^= h >> 15;
+	h *= (size_t)0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+void ptrmap_init(Ptrmap* pMap)
+{
+	pMap->pSlots = NULL;
+	pMap->nSize = 0;
+	pMap->nAllocSize = 0;
+}
+
+void ptrmap_free(Ptrmap* pMap)
+{
+	if (pMap->pSlots)
+		free(pMap->pSlots);
+	ptrmap_init(pMap);
+}
+
+void ptrmap_clear(Ptrmap* pMap)
+{
+	if (pMap->pSlots)
+		memset(pMap->pSlots, 0, pMap->nAllocSize * sizeof(PtrmapSlot));
+	pMap->nSize = 0;
+}
+
+long ptrmap_find(Ptrmap* pMap, void* a, void* b)
+{
+	long mask, i;
+
+	if (pMap->nSize == 0)
+		return -1;
+	mask = pMap->nAllocSize - 1;
+	i = (long)(ptrmap_hash(a, b) & mask);
+	while (!PTRMAP_EMPTY(pMap, i))
+	{
+		if (pMap->pSlots[i].a == a && pMap->pSlots[i].b == b)
+			return i;
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+/* doubles the table, keeping it at most half full */
+int ptrmap_grow(Ptrmap* pMap)
+{
+	PtrmapSlot* pOld = pMap->pSlots;
+	long nOld = pMap->nAllocSize;
+	long nNew = nOld ? nOld * 2 : 16;
+	long mask = nNew - 1;
+	long i, j;
+
+	pMap->pSlots = (PtrmapSlot*)calloc(nNew, sizeof(PtrmapSlot));
+	if (!pMap->pSlots)
+	{
+		pMap->pSlots = pOld;
+		return 0;
+	}
+	pMap->nAllocSize = nNew;
+	for (i = 0; i < nOld; i++)
+	{
+		if (pOld[i].a == NULL && pOld[i].b == NULL)
+			continue;
+		j = (long)(ptrmap_hash(pOld[i].a, pOld[i].b) & mask);
+		while (!PTRMAP_EMPTY(pMap, j))
+			j = (j + 1) & mask;
+		pMap->pSlots[j] = pOld[i];
+	}
+	if (pOld)
+		free(pOld);
+	return 1;
+}
+
+/* inserts or overwrites a key, returns its slot or -1 if out of memory */
+long ptrmap_set(Ptrmap* pMap, void* a, void* b, long value)
+{
+	long mask, i;
+
+	if ((pMap->nSize + 1) * 2 > pMap->nAllocSize && !ptrmap_grow(pMap))
+		return -1;
+	mask = pMap->nAllocSize - 1;
+	i = (long)(ptrmap_hash(a, b) & mask);
+	while (!PTRMAP_EMPTY(pMap, i))
+	{
+		if (pMap->pSlots[i].a == a && pMap->pSlots[i].b == b)
+		{
+			pMap->pSlots[i].value = value;
+			return i;
+		}
+		i = (i + 1) & mask;
+	}
+	pMap->pSlots[i].a = a;
+	pMap->pSlots[i].b = b;
+	pMap->pSlots[i].value = value;
+	pMap->nSize++;
+	return i;
+}
+
+/* empties a slot and shifts the rest of its probe run back to close the gap */
+void ptrmap_del_slot(Ptrmap* pMap, long i)
+{
+	long mask = pMap->nAllocSize - 1;
+	long j, h;
+
+	j = i;
+	for (;;)
+	{
+		j = (j + 1) & mask;
+		if (PTRMAP_EMPTY(pMap, j))
+			break;
+		h = (long)(ptrmap_hash(pMap->pSlots[j].a, pMap->pSlots[j].b) & mask);
+		/* leave the entry alone if its home slot lies cyclically in (i, j] */
+		if ((i <= j) ? (i < h && h <= j) : (i < h || h <= j))
+			continue;
+		pMap->pSlots[i] = pMap->pSlots[j];
+		i = j;
+	}
+	pMap->pSlots[i].a = NULL;
+	pMap->pSlots[i].b = NULL;
+	pMap->nSize--;
+}
+
+int ptrmap_del(Ptrmap* pMap, void* a, void* b)
+{
+	long i = ptrmap_find(pMap, a, b);
+
+	if (i < 0)
+		return 0;
+	ptrmap_del_slot(pMap, i);
+	return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef PTRMAP_H_INCLUDED
+#define PTRMAP_H_INCLUDED
+
+#include <stdlib.h>
+
+/* open addressing hash map from a pair of pointers to a long.  Maps keyed */
+/* by a single object use NULL as the second pointer.  Lookups return the */
+/* slot index, which stays valid until the next ptrmap_set or ptrmap_del. */
+typedef struct PtrmapSlot {
+	void* a;
+	void* b;
+	long value;
+} PtrmapSlot;
+
+typedef struct Ptrmap {
+	PtrmapSlot* pSlots;
+	long nSize;
+	long nAllocSize;
+} Ptrmap;
+
+#define PTRMAP_EMPTY(pMap, i) ((pMap)->pSlots[i].a == NULL && (pMap)->pSlots[i].b == NULL)
+
+size_t ptrmap_hash(void* a, void* b);
+int ptrmap_grow(Ptrmap* pMap);
+void ptrmap_init(Ptrmap* pMap);
+void ptrmap_free(Ptrmap* pMap);
+void ptrmap_clear(Ptrmap* pMap);
+long ptrmap_find(Ptrmap* pMap, void* a, void* b);
+long ptrmap_set(Ptrmap* pMap, void* a, void* b, long value);
+void ptrmap_del_slot(Ptrmap* pMap, long i);
+int ptrmap_del(Ptrmap* pMap, void* a, void* b);
+
+#endif
@@ -1,10 +1,42 @@
 #include "obarr.h"
-/*#include "cgrid.h"*/
+#include "cgrid.h"
+#include "aoi.h"
+#include "collision.h"
+#include "aabbtree.h"
+#include "paircache.h"
+#include "narrowphase.h"
+#include "octree.h"
+#include "kdtree.h"
+#include "mesh.h"
+#include "bounds.h"
+#include "bodies.h"
+#include "particles.h"
+#include "steer.h"
+#include "pbd.h"
+#include "clip.h"
+#include "mat4.h"
+#include "hierarchy.h"
+#include "dualquat.h"
+#include "threads.h"
 #include "vect.h"
 #include "quat.h"
 
 
 static PyMethodDef ModMethods[] = {
+	{"sphere_sphere", (PyCFunction)Narrowphase_sphere_sphere, METH_VARARGS, "contacts of a flat sequence of sphere pairs, returning (pairs, normals, depths, points)"},
+	{"sphere_capsule", (PyCFunction)Narrowphase_sphere_capsule, METH_VARARGS, "contacts of a flat sequence of (sphere, capsule) pairs, returning (pairs, normals, depths, points)"},
+	{"capsule_capsule", (PyCFunction)Narrowphase_capsule_capsule, METH_VARARGS, "contacts of a flat sequence of capsule pairs, returning (pairs, normals, depths, points)"},
+	{"obb_obb", (PyCFunction)Narrowphase_obb_obb, METH_VARARGS, "separating axis contacts of a flat sequence of oriented box pairs, returning (pairs, normals, depths, points)"},
+	{"toi", (PyCFunction)Narrowphase_toi, METH_VARARGS, "earliest time of impact of moving sphere and capsule pairs, returning (pairs, normals, times, points)"},
+	{"ray_obb", (PyCFunction)Narrowphase_ray_obb, METH_VARARGS, "cast segments starts[i]-ends[i] against boxes[i], returning (indices, normals, fractions, points)"},
+	{"bounds_aabb", (PyCFunction)Bounds_aabb, METH_VARARGS, "axis aligned bounds of a sequence of vects as (min, max)"},
+	{"bounds_ritter", (PyCFunction)Bounds_ritter, METH_VARARGS, "Ritter bounding sphere of a sequence of vects as (center, radius)"},
+	{"bounds_epos", (PyCFunction)Bounds_epos, METH_VARARGS, "EPOS-k bounding sphere (k 6, 14 or 26, default 14) of a sequence of vects as (center, radius)"},
+	{"bounds_pca_obb", (PyCFunction)Bounds_pca_obb, METH_VARARGS, "oriented box on the principal axes of a sequence of vects as (center, rot, half_extents)"},
+	{"steer", (PyCFunction)Steer_steer, METH_VARARGS, "separation, alignment, cohesion, seek and arrive forces for agents in a cgrid, from its neighbour lists"},
+	{"skin", (PyCFunction)Dualquat_skin, METH_VARARGS, "dual quaternion skinning of vertices by up to four weighted bones each, returning positions or (positions, normals)"},
+	{"slerp_many", (PyCFunction)Quat_slerp_many, METH_VARARGS, "slerp (a, b, t[, out]) over sequences of quats along the shorter arc, t one number or one per pair, into out or a new obarr"},
+	{"nlerp_many", (PyCFunction)Quat_nlerp_many, METH_VARARGS, "as slerp_many, approximated by a corrected nlerp"},
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -16,9 +48,51 @@ initpy3dutil(void)
 	ObarrObjectType.tp_new = PyType_GenericNew;
 	if (PyType_Ready(&ObarrObjectType) < 0)
 		return;
-	/*CgridObjectType.tp_new = PyType_GenericNew;
+	CgridObjectType.tp_new = PyType_GenericNew;
 	if (PyType_Ready(&CgridObjectType) < 0)
-		return;*/
+		return;
+	AoiObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&AoiObjectType) < 0)
+		return;
+	ColliderObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&ColliderObjectType) < 0)
+		return;
+	AabbtreeObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&AabbtreeObjectType) < 0)
+		return;
+	PaircacheObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&PaircacheObjectType) < 0)
+		return;
+	OctreeObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&OctreeObjectType) < 0)
+		return;
+	KdtreeObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&KdtreeObjectType) < 0)
+		return;
+	MeshObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&MeshObjectType) < 0)
+		return;
+	BodiesObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&BodiesObjectType) < 0)
+		return;
+	ParticlesObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&ParticlesObjectType) < 0)
+		return;
+	PbdObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&PbdObjectType) < 0)
+		return;
+	ClipObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&ClipObjectType) < 0)
+		return;
+	Mat4ObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&Mat4ObjectType) < 0)
+		return;
+	HierarchyObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&HierarchyObjectType) < 0)
+		return;
+	DualquatObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&DualquatObjectType) < 0)
+		return;
 	VectObjectType.tp_new = PyType_GenericNew;
 	if (PyType_Ready(&VectObjectType) < 0)
 		return;
@@ -31,11 +105,40 @@ initpy3dutil(void)
 			   "Various 3d utilities to accelerate 3d games");
 	if (m == NULL)
 		return;
+	threads_init();
 
 	Py_INCREF(&ObarrObjectType);
 	PyModule_AddObject(m, "obarr", (PyObject *)&ObarrObjectType);
-	/*Py_INCREF(&CgridObjectType);
-	PyModule_AddObject(m, "cgrid", (PyObject *)&CgridObjectType);*/
+	Py_INCREF(&CgridObjectType);
+	PyModule_AddObject(m, "cgrid", (PyObject *)&CgridObjectType);
+	Py_INCREF(&AoiObjectType);
+	PyModule_AddObject(m, "aoi", (PyObject *)&AoiObjectType);
+	Py_INCREF(&ColliderObjectType);
+	PyModule_AddObject(m, "Collider", (PyObject *)&ColliderObjectType);
+	Py_INCREF(&AabbtreeObjectType);
+	PyModule_AddObject(m, "aabbtree", (PyObject *)&AabbtreeObjectType);
+	Py_INCREF(&PaircacheObjectType);
+	PyModule_AddObject(m, "paircache", (PyObject *)&PaircacheObjectType);
+	Py_INCREF(&OctreeObjectType);
+	PyModule_AddObject(m, "octree", (PyObject *)&OctreeObjectType);
+	Py_INCREF(&KdtreeObjectType);
+	PyModule_AddObject(m, "kdtree", (PyObject *)&KdtreeObjectType);
+	Py_INCREF(&MeshObjectType);
+	PyModule_AddObject(m, "mesh", (PyObject *)&MeshObjectType);
+	Py_INCREF(&BodiesObjectType);
+	PyModule_AddObject(m, "bodies", (PyObject *)&BodiesObjectType);
+	Py_INCREF(&ParticlesObjectType);
+	PyModule_AddObject(m, "particles", (PyObject *)&ParticlesObjectType);
+	Py_INCREF(&PbdObjectType);
+	PyModule_AddObject(m, "pbd", (PyObject *)&PbdObjectType);
+	Py_INCREF(&ClipObjectType);
+	PyModule_AddObject(m, "clip", (PyObject *)&ClipObjectType);
+	Py_INCREF(&Mat4ObjectType);
+	PyModule_AddObject(m, "mat4", (PyObject *)&Mat4ObjectType);
+	Py_INCREF(&HierarchyObjectType);
+	PyModule_AddObject(m, "hierarchy", (PyObject *)&HierarchyObjectType);
+	Py_INCREF(&DualquatObjectType);
+	PyModule_AddObject(m, "dualquat", (PyObject *)&DualquatObjectType);
 	Py_INCREF(&VectObjectType);
 	PyModule_AddObject(m, "vect", (PyObject *)&VectObjectType);
 	Py_INCREF(&QuatObjectType);
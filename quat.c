@@ -1,6 +1,11 @@
 #include "quat.h"
 #include "vect.h"
+#include "obarr.h"
 #include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef _MSC_VER
 #define isnan(x) ((x) != (x))
@@ -194,6 +199,101 @@ void quat_multiply_vect_internal(QuatObject *self, VectObject *v, VectObject *rv
 	Py_DECREF(rq);
 }
 
+/* row-major 3x3 rotation matrix of the quat elements q (x, y, z, w), */
+/* which need not be normalized */
+void quat_matrix3_internal(const double* q, double* m)
+{
+	double x = q[0], y = q[1], z = q[2], w = q[3];
+	double s = (x * x) + (y * y) + (z * z) + (w * w);
+
+	s = (s > 0.0) ? 2.0 / s : 0.0;
+	m[0] = 1.0 - (s * ((y * y) + (z * z)));
+	m[1] = s * ((x * y) - (z * w));
+	m[2] = s * ((x * z) + (y * w));
+	m[3] = s * ((x * y) + (z * w));
+	m[4] = 1.0 - (s * ((x * x) + (z * z)));
+	m[5] = s * ((y * z) - (x * w));
+	m[6] = s * ((x * z) - (y * w));
+	m[7] = s * ((y * z) + (x * w));
+	m[8] = 1.0 - (s * ((x * x) + (y * y)));
+}
+
+/* inverse of quat_matrix3_internal for a rotation matrix, after Shepperd: */
+/* works from the largest of w, x, y, z to keep the division well away */
+/* from zero */
+void quat_from_matrix3_internal(const double* m, double* q)
+{
+	double tr = m[0] + m[4] + m[8];
+	double s;
+
+	if (tr > 0.0)
+	{
+		s = sqrt(tr + 1.0) * 2.0;
+		q[3] = 0.25 * s;
+		q[0] = (m[7] - m[5]) / s;
+		q[1] = (m[2] - m[6]) / s;
+		q[2] = (m[3] - m[1]) / s;
+	}
+	else if (m[0] > m[4] && m[0] > m[8])
+	{
+		s = sqrt(1.0 + m[0] - m[4] - m[8]) * 2.0;
+		q[3] = (m[7] - m[5]) / s;
+		q[0] = 0.25 * s;
+		q[1] = (m[1] + m[3]) / s;
+		q[2] = (m[2] + m[6]) / s;
+	}
+	else if (m[4] > m[8])
+	{
+		s = sqrt(1.0 + m[4] - m[0] - m[8]) * 2.0;
+		q[3] = (m[2] - m[6]) / s;
+		q[0] = (m[1] + m[3]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (m[5] + m[7]) / s;
+	}
+	else
+	{
+		s = sqrt(1.0 + m[8] - m[0] - m[4]) * 2.0;
+		q[3] = (m[3] - m[1]) / s;
+		q[0] = (m[2] + m[6]) / s;
+		q[1] = (m[5] + m[7]) / s;
+		q[2] = 0.25 * s;
+	}
+}
+
+/* slerp of the elements q1 to q2 by amt along the shorter arc; returns */
+/* the angle turned over the whole arc */
+double quat_slerp_internal(const double* q1, const double* q2, double amt, double* rv)
+{
+	double cv = 0.0, sign = 1.0;
+	double ang, as, ss, ts;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		cv += q1[i] * q2[i];
+	if (cv < 0.0)
+	{
+		cv = -cv;
+		sign = -1.0;
+	}
+	if (cv > 1.0)
+		cv = 1.0;
+	ang = acos(cv);
+	if (1.0 - cv > 1e-7)
+	{
+		as = sin(ang);
+		ss = sin((1.0 - amt) * ang) / as;
+		ts = sin(amt * ang) / as;
+	}
+	else
+	{
+		ss = 1.0 - amt;
+		ts = amt;
+	}
+	for (i = 0; i < 4; i++)
+		rv[i] = (q1[i] * ss) + (q2[i] * ts * sign);
+	return ang * 2.0;
+}
+
 PyObject* Quat_mul(PyObject *self_in, PyObject *other_in)
 {
 	int i;
@@ -576,7 +676,7 @@ PyObject* Quat_mag2(PyObject *self_in, PyObject *unused)
 	return PyFloat_FromDouble(quat_mag_internal(self));
 }
 
-int Quat_len(PyObject *self_in)
+Py_ssize_t Quat_len(PyObject *self_in)
 {
 	if (!Quat_Check(self_in))	
 	{
@@ -587,7 +687,7 @@ int Quat_len(PyObject *self_in)
 }
 
 
-PyObject* Quat_item(PyObject *self_in, int index)
+PyObject* Quat_item(PyObject *self_in, Py_ssize_t index)
 {
 	if (!Quat_Check(self_in))	
 	{
@@ -663,6 +763,238 @@ int quat_validate(QuatObject* input)
 	return bValid;
 }
 
+/* nlerp with the interpolation parameter bent by a cubic in t whose */
+/* coefficients are polynomials in the cosine of the angle, fitted so */
+/* the result stays within about 1e-3 radians of slerp (after Kapoulkine). */
+void quat_nlerp_one(const double* a, const double* b, double u, double* rv)
+{
+	double d, ad, s, k, ot, m;
+	int j;
+
+	d = (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3]);
+	s = (d < 0.0) ? -1.0 : 1.0;
+	ad = d * s;
+	k = (1.0904 + ad * (-3.2452 + ad * (3.55645 - ad * 1.43519))) * (u - 0.5) * (u - 0.5) +
+		(0.848013 + ad * (-1.06021 + ad * 0.215638));
+	ot = u + (u * (u - 0.5) * (u - 1.0) * k);
+	for (j = 0; j < 4; j++)
+		rv[j] = (a[j] * (1.0 - ot)) + (b[j] * s * ot);
+	m = (rv[0] * rv[0]) + (rv[1] * rv[1]) + (rv[2] * rv[2]) + (rv[3] * rv[3]);
+	m = (m > 0.0) ? 1.0 / sqrt(m) : 0.0;
+	for (j = 0; j < 4; j++)
+		rv[j] *= m;
+}
+
+#ifdef __SSE2__
+/* quat_nlerp_one on the pairs i and i + 1 at once, one pair per lane. */
+/* gcc will not vectorize the scalar loop itself (the quats are stored */
+/* x, y, z, w and sqrt keeps errno), so the lanes are transposed by hand. */
+/* The operations run in the same order as the scalar version, so both */
+/* give the same bits. */
+void quat_nlerp_two(const double* a, const double* b, const double* t, double* rv)
+{
+	__m128d q[4], r[4], lo, hi, d, s, ad, u, h, k, ot, m;
+	const __m128d one = _mm_set1_pd(1.0), zero = _mm_setzero_pd();
+	int j;
+
+	for (j = 0; j < 4; j += 2)
+	{
+		lo = _mm_loadu_pd(&a[j]); hi = _mm_loadu_pd(&a[j + 4]);
+		q[j] = _mm_unpacklo_pd(lo, hi); q[j + 1] = _mm_unpackhi_pd(lo, hi);
+		lo = _mm_loadu_pd(&b[j]); hi = _mm_loadu_pd(&b[j + 4]);
+		r[j] = _mm_unpacklo_pd(lo, hi); r[j + 1] = _mm_unpackhi_pd(lo, hi);
+	}
+	d = _mm_mul_pd(q[0], r[0]);
+	for (j = 1; j < 4; j++)
+		d = _mm_add_pd(d, _mm_mul_pd(q[j], r[j]));
+	s = _mm_or_pd(one, _mm_and_pd(_mm_cmplt_pd(d, zero), _mm_set1_pd(-0.0)));
+	ad = _mm_mul_pd(d, s);
+
+	u = _mm_loadu_pd(t);
+	h = _mm_sub_pd(u, _mm_set1_pd(0.5));
+	k = _mm_sub_pd(_mm_set1_pd(3.55645), _mm_mul_pd(ad, _mm_set1_pd(1.43519)));
+	k = _mm_add_pd(_mm_set1_pd(-3.2452), _mm_mul_pd(ad, k));
+	k = _mm_add_pd(_mm_set1_pd(1.0904), _mm_mul_pd(ad, k));
+	k = _mm_mul_pd(_mm_mul_pd(k, h), h);
+	lo = _mm_add_pd(_mm_set1_pd(-1.06021), _mm_mul_pd(ad, _mm_set1_pd(0.215638)));
+	k = _mm_add_pd(k, _mm_add_pd(_mm_set1_pd(0.848013), _mm_mul_pd(ad, lo)));
+	ot = _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(u, h), _mm_sub_pd(u, one)), k);
+	ot = _mm_add_pd(u, ot);
+
+	lo = _mm_sub_pd(one, ot);
+	for (j = 0; j < 4; j++)
+		q[j] = _mm_add_pd(_mm_mul_pd(q[j], lo), _mm_mul_pd(_mm_mul_pd(r[j], s), ot));
+	m = _mm_mul_pd(q[0], q[0]);
+	for (j = 1; j < 4; j++)
+		m = _mm_add_pd(m, _mm_mul_pd(q[j], q[j]));
+	m = _mm_and_pd(_mm_div_pd(one, _mm_sqrt_pd(m)), _mm_cmpgt_pd(m, zero));
+
+	for (j = 0; j < 4; j += 2)
+	{
+		lo = _mm_mul_pd(q[j], m); hi = _mm_mul_pd(q[j + 1], m);
+		_mm_storeu_pd(&rv[j], _mm_unpacklo_pd(lo, hi));
+		_mm_storeu_pd(&rv[j + 4], _mm_unpackhi_pd(lo, hi));
+	}
+}
+#endif
+
+/* nlerp_many over n pairs with one t each */
+void quat_nlerp_many_internal(const double* a, const double* b, const double* t, double* rv, long n)
+{
+	long i = 0;
+
+#ifdef __SSE2__
+	for (; i + 1 < n; i += 2)
+		quat_nlerp_two(&a[i * 4], &b[i * 4], &t[i], &rv[i * 4]);
+#endif
+	for (; i < n; i++)
+		quat_nlerp_one(&a[i * 4], &b[i * 4], t[i], &rv[i * 4]);
+}
+
+/* reads n quats from a sequence into q, 4 doubles each */
+int quat_read_many(PyObject* pFast, double* q, long n)
+{
+	PyObject* pItem;
+	long i;
+
+	for (i = 0; i < n; i++)
+	{
+		pItem = PySequence_Fast_GET_ITEM(pFast, i);
+		if (!Quat_Check(pItem))
+		{
+			PyErr_SetString(PyExc_TypeError, "expected a sequence of quats");
+			return 0;
+		}
+		memcpy(&q[i * 4], ((QuatObject*)pItem)->elements, 4 * sizeof(double));
+	}
+	return 1;
+}
+
+/* shared body of slerp_many and nlerp_many: (a, b, t[, out]).  a and b */
+/* are equal length sequences of quats, t one amount or one per pair. */
+/* The results are written into the quats of out when it is given, */
+/* which is returned, otherwise into a new obarr. */
+PyObject* quat_lerp_many(PyObject* args, int bSlerp)
+{
+	PyObject *pA, *pB, *pT, *pOut = Py_None, *pItem;
+	PyObject *pFastA = NULL, *pFastB = NULL, *pFastT = NULL, *pFastO = NULL, *rv = NULL;
+	double *pData = NULL, *a, *b, *t, *r;
+	long n, i;
+	int bScalarT;
+
+    if (!PyArg_ParseTuple(args, "OOO|O", &pA, &pB, &pT, &pOut))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	if (!(pFastA = PySequence_Fast(pA, "expected a sequence of quats")) ||
+		!(pFastB = PySequence_Fast(pB, "expected a sequence of quats")))
+		goto error;
+	n = PySequence_Fast_GET_SIZE(pFastA);
+	bScalarT = PyNumber_Check(pT);
+	if (!bScalarT && !(pFastT = PySequence_Fast(pT, "t must be a number or a sequence of numbers")))
+		goto error;
+	if (pOut != Py_None && !(pFastO = PySequence_Fast(pOut, "out must be a sequence of quats")))
+		goto error;
+	if (PySequence_Fast_GET_SIZE(pFastB) != n || (pFastT && PySequence_Fast_GET_SIZE(pFastT) != n) ||
+		(pFastO && PySequence_Fast_GET_SIZE(pFastO) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "a, b, t and out differ in length");
+		goto error;
+	}
+
+	pData = (double*)malloc(((n * 13) + 1) * sizeof(double));
+	if (!pData)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	a = pData;
+	b = a + (n * 4);
+	r = b + (n * 4);
+	t = r + (n * 4);
+	if (!quat_read_many(pFastA, a, n) || !quat_read_many(pFastB, b, n))
+		goto error;
+	if (bScalarT)
+	{
+		t[0] = PyFloat_AsDouble(pT);
+		for (i = 1; i < n; i++)
+			t[i] = t[0];
+	}
+	else
+	{
+		for (i = 0; i < n; i++)
+			t[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pFastT, i));
+	}
+	if (PyErr_Occurred())
+		goto error;
+	if (pFastO && !quat_read_many(pFastO, r, n))
+		goto error;
+
+	if (bSlerp)
+	{
+		for (i = 0; i < n; i++)
+			quat_slerp_internal(&a[i * 4], &b[i * 4], t[i], &r[i * 4]);
+	}
+	else
+		quat_nlerp_many_internal(a, b, t, r, n);
+
+	if (pFastO)
+	{
+		for (i = 0; i < n; i++)
+			memcpy(((QuatObject*)PySequence_Fast_GET_ITEM(pFastO, i))->elements, &r[i * 4], 4 * sizeof(double));
+		Py_INCREF(pOut);
+		rv = pOut;
+	}
+	else
+	{
+		rv = (PyObject*)PyObject_New(ObarrObject, &ObarrObjectType);
+		Obarr_init((ObarrObject*)rv, NULL, NULL);
+		if (!obarr_set_size((ObarrObject*)rv, n))
+		{
+			PyErr_SetString(PyExc_MemoryError, "out of memory");
+			goto error;
+		}
+		for (i = 0; i < n; i++)
+		{
+			pItem = (PyObject*)PyObject_New(QuatObject, &QuatObjectType);
+			if (!pItem)
+				goto error;
+			memcpy(((QuatObject*)pItem)->elements, &r[i * 4], 4 * sizeof(double));
+			obarr_set_element((ObarrObject*)rv, i, pItem);
+			Py_DECREF(pItem);
+		}
+	}
+
+	free(pData);
+	Py_DECREF(pFastA);
+	Py_DECREF(pFastB);
+	Py_XDECREF(pFastT);
+	Py_XDECREF(pFastO);
+	return rv;
+
+error:
+	free(pData);
+	Py_XDECREF(pFastA);
+	Py_XDECREF(pFastB);
+	Py_XDECREF(pFastT);
+	Py_XDECREF(pFastO);
+	Py_XDECREF(rv);
+	return NULL;
+}
+
+/* slerp_many(a, b, t[, out]), each pair along its shorter arc */
+PyObject* Quat_slerp_many(PyObject *self_in, PyObject *args)
+{
+	return quat_lerp_many(args, 1);
+}
+
+/* nlerp_many(a, b, t[, out]), approximating slerp_many more cheaply */
+PyObject* Quat_nlerp_many(PyObject *self_in, PyObject *args)
+{
+	return quat_lerp_many(args, 0);
+}
+
 
 
 PyNumberMethods Quat_as_number[] = {
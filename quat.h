@@ -20,11 +20,21 @@ typedef struct QuatObject {
 PyObject* quat_get_element(PyObject* self_in, long index);
 void quat_multiply_internal(QuatObject* q1, QuatObject* q2, QuatObject* qr);
 void quat_multiply_vect_internal(QuatObject* self, VectObject* v, VectObject* rv);
+void quat_matrix3_internal(const double* q, double* m);
+void quat_from_matrix3_internal(const double* m, double* q);
+double quat_slerp_internal(const double* q1, const double* q2, double amt, double* rv);
 double quat_mag_internal(QuatObject* self);
 double quat_mag2_internal(QuatObject* self);
 void quat_normalize_internal(QuatObject* self);
 void quat_get_conjugate_internal(QuatObject* self, QuatObject* rv);
 int quat_validate(QuatObject* input);
+void quat_nlerp_one(const double* a, const double* b, double u, double* rv);
+#ifdef __SSE2__
+void quat_nlerp_two(const double* a, const double* b, const double* t, double* rv);
+#endif
+void quat_nlerp_many_internal(const double* a, const double* b, const double* t, double* rv, long n);
+int quat_read_many(PyObject* pFast, double* q, long n);
+PyObject* quat_lerp_many(PyObject* args, int bSlerp);
 
 // Python API functions
 int Quat_init(QuatObject *self, PyObject *args, PyObject *kwds);
@@ -46,6 +56,8 @@ PyObject* Quat_ip_negate(PyObject *self_in);
 PyObject* Quat_get_matrix(PyObject *self_in, PyObject *unused);
 PyObject* Quat_slerp(PyObject *self_in, PyObject *args);
 PyObject* Quat_slerp_turn(PyObject *self_in, PyObject *args);
+PyObject* Quat_slerp_many(PyObject *self_in, PyObject *args);
+PyObject* Quat_nlerp_many(PyObject *self_in, PyObject *args);
 Py_ssize_t Quat_len(PyObject *self_in);
 PyObject* Quat_item(PyObject *self_in, Py_ssize_t index);
 PyObject* Quat_richcompare(PyObject* a, PyObject* b, int op);
@@ -2,7 +2,8 @@ from distutils.core import setup, Extension
 from cPickle import load, dump
 import os
 
-module1 = Extension('py3dutil', sources = ['py3dutil.c', 'obarr.c', 'red_black_tree.c', 'misc.c', 'vect.c', 'quat.c'])
+module1 = Extension('py3dutil', sources = ['py3dutil.c', 'obarr.c', 'red_black_tree.c', 'misc.c', 'vect.c', 'quat.c', 'cgrid.c', 'ptrmap.c', 'aoi.c', 'snapshot.c', 'collision.c', 'aabbtree.c', 'paircache.c', 'narrowphase.c', 'octree.c', 'kdtree.c', 'threads.c', 'mesh.c', 'bounds.c', 'bodies.c', 'particles.c', 'steer.c', 'pbd.c', 'clip.c', 'mat4.c', 'hierarchy.c', 'dualquat.c'],
+	libraries = (os.name != 'nt') and ['pthread'] or [])
 
 buildno = 0
 if os.path.exists('buildno'):
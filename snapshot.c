@@ -0,0 +1,154 @@
+#include "snapshot.h"
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* whether nCount items of nItemSize bytes at nOffset lie inside a file */
+/* of nSize bytes, with the offset 8-byte aligned.  Divides rather than */
+/* multiplies so that a corrupt count cannot overflow. */
+int snapshot_section_ok(long nOffset, long nCount, long nItemSize, long nSize)
+{
+	if (nOffset < 0 || (nOffset & 7) != 0 || nOffset > nSize || nCount < 0)
+		return 0;
+	return nCount <= (nSize - nOffset) / nItemSize;
+}
+
+/* writes nBytes at nOffset, zero-padding from the current position *pnPos */
+int snapshot_write_at(FILE* f, long* pnPos, long nOffset, const void* pData, long nBytes)
+{
+	static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+	while (*pnPos < nOffset)
+	{
+		long n = nOffset - *pnPos;
+
+		if (n > 8)
+			n = 8;
+		if (fwrite(zeros, 1, n, f) != (size_t)n)
+			return 0;
+		*pnPos += n;
+	}
+	if (nBytes > 0 && fwrite(pData, 1, nBytes, f) != (size_t)nBytes)
+		return 0;
+	*pnPos += nBytes;
+	return 1;
+}
+
+#ifdef _WIN32
+/* sets errno from the last Windows error, for the caller's IOError */
+void snapshot_set_errno(void)
+{
+	switch (GetLastError())
+	{
+	case ERROR_FILE_NOT_FOUND:
+	case ERROR_PATH_NOT_FOUND:
+		errno = ENOENT;
+		break;
+	case ERROR_ACCESS_DENIED:
+	case ERROR_SHARING_VIOLATION:
+		errno = EACCES;
+		break;
+	case ERROR_NOT_ENOUGH_MEMORY:
+	case ERROR_OUTOFMEMORY:
+		errno = ENOMEM;
+		break;
+	default:
+		errno = EIO;
+		break;
+	}
+}
+#endif
+
+/* maps a whole file read-only.  The pages are shared with every other */
+/* process mapping the same file. */
+void* snapshot_map(const char* path, long* pnSize)
+{
+#ifdef _WIN32
+	HANDLE hFile, hMapping;
+	DWORD nLow, nHigh;
+	void* pMap;
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		snapshot_set_errno();
+		return NULL;
+	}
+	nLow = GetFileSize(hFile, &nHigh);
+	if (nLow == INVALID_FILE_SIZE && GetLastError() != NO_ERROR)
+	{
+		snapshot_set_errno();
+		CloseHandle(hFile);
+		return NULL;
+	}
+	/* a view of an empty file cannot be made, and sizes are kept in longs */
+	if (nHigh != 0 || nLow == 0 || nLow > 0x7FFFFFFFu)
+	{
+		CloseHandle(hFile);
+		errno = (nLow == 0 && nHigh == 0) ? EINVAL : EFBIG;
+		return NULL;
+	}
+	hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMapping)
+	{
+		snapshot_set_errno();
+		CloseHandle(hFile);
+		return NULL;
+	}
+	pMap = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!pMap)
+		snapshot_set_errno();
+	/* the view keeps the mapping and the file open until it is unmapped */
+	CloseHandle(hMapping);
+	CloseHandle(hFile);
+	if (!pMap)
+		return NULL;
+	*pnSize = (long)nLow;
+	return pMap;
+#else
+	struct stat st;
+	void* pMap;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size == 0)
+	{
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	pMap = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pMap == MAP_FAILED)
+		return NULL;
+	*pnSize = (long)st.st_size;
+	return pMap;
+#endif
+}
+
+void snapshot_unmap(void* pMap, long nSize)
+{
+	if (!pMap)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(pMap);
+#else
+	munmap(pMap, (size_t)nSize);
+#endif
+}
@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SNAPSHOT_MAGIC "P3DSNAP"
+#define SNAPSHOT_FORMAT 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+/* on-disk snapshot of a cgrid static layer and any number of vector arrays. */
+/* The header is followed by the sections it points to, each 8-byte aligned. */
+/* All but the entries are laid out as in memory and used in place:       */
+/*   offKeys     CgridKey[nCells]                                          */
+/*   offStart    long[nCells + 1]                                          */
+/*   offEntries  SnapshotEntry[nMembers], copied into CgridEntry on load  */
+/*   offOrder    long[nMembers], index of each member in the frozen seq   */
+/*   offArrays   long[nArrays * 2], (count, offset of double[count * 3])  */
+/* The fields before dCellSize have the same size everywhere, and a file */
+/* whose byte order or long size differs from ours is refused. */
+typedef struct SnapshotHeader {
+	char			magic[8];
+	unsigned int	nFormat;
+	unsigned int	nByteOrder;
+	unsigned int	nLongSize;
+	unsigned int	nEntrySize;
+	double			dCellSize;
+	double			dMaxRadius;
+	long			nCells;
+	long			nMembers;
+	long			nArrays;
+	long			offKeys;
+	long			offStart;
+	long			offEntries;
+	long			offOrder;
+	long			offArrays;
+	long			nFileSize;
+} SnapshotHeader;
+
+/* a static member as stored: only the fields that describe the member, */
+/* none of the grid's runtime bookkeeping, and no padding */
+typedef struct SnapshotEntry {
+	double			pos[3];
+	double			dRadius;
+	unsigned int	nCategory;
+	unsigned int	nMask;
+} SnapshotEntry;
+
+#define SNAPSHOT_ALIGN(n) (((n) + 7) & ~7L)
+
+int snapshot_section_ok(long nOffset, long nCount, long nItemSize, long nSize);
+int snapshot_write_at(FILE* f, long* pnPos, long nOffset, const void* pData, long nBytes);
+#ifdef _WIN32
+void snapshot_set_errno(void);
+#endif
+void* snapshot_map(const char* path, long* pnSize);
+void snapshot_unmap(void* pMap, long nSize);
+
+#endif
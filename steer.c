@@ -0,0 +1,260 @@
+#include "steer.h"
+#include "cgrid.h"
+#include "obarr.h"
+#include "vect.h"
+#include "threads.h"
+#include "red_black_tree.h"
+#include <math.h>
+#include <string.h>
+
+/* Reynolds' behaviours for one agent, weighted and summed:         */
+/*   separation  sum of (p - q) / |p - q|^2 over members within the */
+/*               separation radius                                  */
+/*   alignment   mean velocity of neighbouring agents, less v       */
+/*   cohesion    centroid of the neighbours, less p                 */
+/*   seek        max_speed toward the target, less v                */
+/*   arrive      as seek, slowing linearly inside the slowing radius */
+/* Neighbours are the members within the list cutoff; members that  */
+/* are not agents count for separation and cohesion only. */
+void steer_agent(SteerBatch* pBatch, long a)
+{
+	CgridNeighbors* pNbrs = pBatch->pNbrs;
+	double sep[3] = {0.0, 0.0, 0.0}, ali[3] = {0.0, 0.0, 0.0}, coh[3] = {0.0, 0.0, 0.0};
+	double d[3], f[3] = {0.0, 0.0, 0.0};
+	double *p, *v, *q, *t;
+	double d2, dist, s;
+	double dRadius2 = SQR(pBatch->dRadius), dSep2 = SQR(pBatch->dSepRadius);
+	long m = pBatch->pMember[a], nNbrs = 0, nAgents = 0, j, o;
+	int k;
+
+	p = &pBatch->pPos[m * 3];
+	v = &pBatch->pVel[m * 3];
+	for (j = pNbrs->pStart[m]; j < pNbrs->pStart[m + 1]; j++)
+	{
+		o = pNbrs->pIndex[j];
+		q = &pBatch->pPos[o * 3];
+		for (k = 0; k < 3; k++)
+			d[k] = p[k] - q[k];
+		d2 = SQR(d[0]) + SQR(d[1]) + SQR(d[2]);
+		if (d2 > dRadius2)
+			continue;
+		nNbrs++;
+		for (k = 0; k < 3; k++)
+			coh[k] += q[k];
+		if (d2 > 0.0 && d2 <= dSep2)
+		{
+			for (k = 0; k < 3; k++)
+				sep[k] += d[k] / d2;
+		}
+		if (pBatch->pAgentOf[o] >= 0)
+		{
+			nAgents++;
+			for (k = 0; k < 3; k++)
+				ali[k] += pBatch->pVel[(o * 3) + k];
+		}
+	}
+
+	for (k = 0; k < 3; k++)
+	{
+		f[k] = pBatch->w[0] * sep[k];
+		if (nAgents)
+			f[k] += pBatch->w[1] * ((ali[k] / nAgents) - v[k]);
+		if (nNbrs)
+			f[k] += pBatch->w[2] * ((coh[k] / nNbrs) - p[k]);
+	}
+
+	if (pBatch->pHasTarget[a])
+	{
+		t = &pBatch->pTarget[a * 3];
+		for (k = 0; k < 3; k++)
+			d[k] = t[k] - p[k];
+		dist = sqrt(SQR(d[0]) + SQR(d[1]) + SQR(d[2]));
+		s = (dist > 0.0) ? pBatch->dMaxSpeed / dist : 0.0;
+		for (k = 0; k < 3; k++)
+			f[k] += pBatch->w[3] * ((d[k] * s) - v[k]);
+		if (pBatch->dSlowRadius > 0.0 && dist < pBatch->dSlowRadius)
+			s *= dist / pBatch->dSlowRadius;
+		for (k = 0; k < 3; k++)
+			f[k] += pBatch->w[4] * ((d[k] * s) - v[k]);
+	}
+
+	memcpy(&pBatch->pForce[a * 3], f, sizeof(f));
+}
+
+/* thread body of steer */
+void steer_batch(void* pArg, long nStart, long nEnd, int nThread)
+{
+	SteerBatch* pBatch = (SteerBatch*)pArg;
+	long a;
+
+	for (a = nStart; a < nEnd; a++)
+		steer_agent(pBatch, a);
+}
+
+
+/* steer(grid, agents, velocities, targets, weights[, separation_radius */
+/*       [, max_speed[, slowing_radius[, threads]]]])                  */
+/* agents are dynamic members of grid and velocities their velocities. */
+/* targets is None or a vect (or None) per agent, and weights holds the */
+/* (separation, alignment, cohesion, seek, arrive) factors.  The grid's */
+/* neighbour lists must be current: their cutoff is the radius agents */
+/* see each other at.  Returns an obarr of one steering force per agent. */
+PyObject* Steer_steer(PyObject *self_in, PyObject *args)
+{
+	PyObject *pGrid, *pAgents, *pVels, *pTargets, *pWeights, *pItem;
+	PyObject *pFastA = NULL, *pFastV = NULL, *pFastT = NULL;
+	CgridObject *grid;
+	CgridNeighbors *pNbrs;
+	CgridInfo *pV;
+	rb_red_blk_node *pNode;
+	ObarrObject *rv = NULL;
+	VectObject *pVect;
+	SteerBatch batch;
+	double dSepRadius = -1.0, dMaxSpeed = 1.0, dSlowRadius = -1.0;
+	long n, i, a, m;
+	int nThreads = 0;
+
+    if (!PyArg_ParseTuple(args, "OOOOO|dddi", &pGrid, &pAgents, &pVels, &pTargets, &pWeights, &dSepRadius, &dMaxSpeed, &dSlowRadius, &nThreads))
+	{
+		PyErr_SetString(PyExc_TypeError, "wrong arguments");
+		return NULL;
+	}
+	memset(&batch, 0, sizeof(batch));
+	if (!Cgrid_Check(pGrid))
+	{
+		PyErr_SetString(PyExc_TypeError, "grid must be a cgrid");
+		return NULL;
+	}
+	if (!PyArg_Parse(pWeights, "(ddddd)", &batch.w[0], &batch.w[1], &batch.w[2], &batch.w[3], &batch.w[4]))
+	{
+		PyErr_SetString(PyExc_TypeError, "weights must be (separation, alignment, cohesion, seek, arrive)");
+		return NULL;
+	}
+	grid = (CgridObject*)pGrid;
+	pNbrs = grid->pNbrs;
+	if (!pNbrs)
+	{
+		PyErr_SetString(PyExc_ValueError, "neighbour lists have not been built");
+		return NULL;
+	}
+	if (cgrid_neighbors_stale(grid, pNbrs->dCutoff, pNbrs->dSkin))
+	{
+		PyErr_SetString(PyExc_ValueError, "neighbour lists are stale, call build_neighbor_lists first");
+		return NULL;
+	}
+
+	if (!(pFastA = PySequence_Fast(pAgents, "agents must be a sequence")) ||
+		!(pFastV = PySequence_Fast(pVels, "velocities must be a sequence of vects")) ||
+		(pTargets != Py_None && !(pFastT = PySequence_Fast(pTargets, "targets must be None or a sequence"))))
+		goto error;
+	n = PySequence_Fast_GET_SIZE(pFastA);
+	if (PySequence_Fast_GET_SIZE(pFastV) != n || (pFastT && PySequence_Fast_GET_SIZE(pFastT) != n))
+	{
+		PyErr_SetString(PyExc_ValueError, "agents, velocities and targets differ in length");
+		goto error;
+	}
+
+	m = pNbrs->nMembers;
+	batch.pNbrs = pNbrs;
+	batch.dRadius = pNbrs->dCutoff;
+	batch.dSepRadius = (dSepRadius >= 0.0) ? dSepRadius : pNbrs->dCutoff * 0.5;
+	batch.dMaxSpeed = dMaxSpeed;
+	batch.dSlowRadius = (dSlowRadius >= 0.0) ? dSlowRadius : pNbrs->dCutoff;
+	batch.pPos = (double*)malloc((m + 1) * 3 * sizeof(double));
+	batch.pVel = (double*)calloc((m + 1) * 3, sizeof(double));
+	batch.pAgentOf = (long*)malloc((m + 1) * sizeof(long));
+	batch.pMember = (long*)malloc((n + 1) * sizeof(long));
+	batch.pTarget = (double*)malloc((n + 1) * 3 * sizeof(double));
+	batch.pHasTarget = (char*)calloc(n + 1, sizeof(char));
+	batch.pForce = (double*)malloc((n + 1) * 3 * sizeof(double));
+	if (!batch.pPos || !batch.pVel || !batch.pAgentOf || !batch.pMember ||
+		!batch.pTarget || !batch.pHasTarget || !batch.pForce)
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+
+	/* the lists hold build time positions; take the cached current ones */
+	memcpy(batch.pPos, pNbrs->pPos, m * 3 * sizeof(double));
+	for (pNode = cgrid_first_node(grid); pNode != grid->pTree->nil; pNode = TreeSuccessor(grid->pTree, pNode))
+	{
+		pV = (CgridInfo*)pNode->info;
+		for (i = 0; i < pV->pContents->nSize; i++)
+			memcpy(&batch.pPos[pV->pEntries[i].nNbr * 3], pV->pEntries[i].pos, 3 * sizeof(double));
+	}
+	for (i = 0; i < m; i++)
+		batch.pAgentOf[i] = -1;
+
+	for (a = 0; a < n; a++)
+	{
+		pV = cgrid_find_member(grid, PySequence_Fast_GET_ITEM(pFastA, a), NULL, &i);
+		if (!pV)
+			goto error;
+		i = pV->pEntries[i].nNbr;
+		batch.pMember[a] = i;
+		batch.pAgentOf[i] = a;
+		if (!cgrid_read_pos(PySequence_Fast_GET_ITEM(pFastV, a), &batch.pVel[i * 3]))
+			goto error;
+		pItem = pFastT ? PySequence_Fast_GET_ITEM(pFastT, a) : Py_None;
+		if (pItem == Py_None)
+			continue;
+		if (!cgrid_read_pos(pItem, &batch.pTarget[a * 3]))
+			goto error;
+		batch.pHasTarget[a] = 1;
+	}
+
+	/* the grid gives up its lists while the threads read them, so a */
+	/* rebuild from another Python thread makes new ones instead */
+	grid->pNbrs = NULL;
+	nThreads = threads_pick(nThreads, n, STEER_MIN_BATCH);
+	Py_BEGIN_ALLOW_THREADS
+	threads_run(steer_batch, &batch, n, nThreads);
+	Py_END_ALLOW_THREADS
+	if (grid->pNbrs)
+		cgrid_neighbors_free(pNbrs);
+	else
+		grid->pNbrs = pNbrs;
+
+	rv = PyObject_New(ObarrObject, &ObarrObjectType);
+	Obarr_init(rv, NULL, NULL);
+	if (!obarr_set_size(rv, n))
+	{
+		PyErr_SetString(PyExc_MemoryError, "out of memory");
+		goto error;
+	}
+	for (a = 0; a < n; a++)
+	{
+		pVect = PyObject_New(VectObject, &VectObjectType);
+		if (!pVect)
+			goto error;
+		memcpy(pVect->elements, &batch.pForce[a * 3], 3 * sizeof(double));
+		obarr_set_element(rv, a, (PyObject*)pVect);
+		Py_DECREF(pVect);
+	}
+
+	free(batch.pPos);
+	free(batch.pVel);
+	free(batch.pAgentOf);
+	free(batch.pMember);
+	free(batch.pTarget);
+	free(batch.pHasTarget);
+	free(batch.pForce);
+	Py_DECREF(pFastA);
+	Py_DECREF(pFastV);
+	Py_XDECREF(pFastT);
+	return (PyObject*)rv;
+
+error:
+	free(batch.pPos);
+	free(batch.pVel);
+	free(batch.pAgentOf);
+	free(batch.pMember);
+	free(batch.pTarget);
+	free(batch.pHasTarget);
+	free(batch.pForce);
+	Py_XDECREF(pFastA);
+	Py_XDECREF(pFastV);
+	Py_XDECREF(pFastT);
+	Py_XDECREF(rv);
+	return NULL;
+}
@@ -0,0 +1,37 @@
+#ifndef STEER_H_INCLUDED
+#define STEER_H_INCLUDED
+
+#include <Python.h>
+
+typedef struct CgridNeighbors CgridNeighbors;
+
+/* one steer() call, shared by its threads.  Members are numbered as in */
+/* the grid's neighbour lists; pPos holds their current positions, pVel */
+/* the velocity of those that are agents (pAgentOf >= 0).  Per agent: its */
+/* member number, optional target and the resulting force. */
+typedef struct SteerBatch {
+	CgridNeighbors*	pNbrs;
+	double*			pPos;
+	double*			pVel;
+	long*			pAgentOf;
+	long*			pMember;
+	double*			pTarget;
+	char*			pHasTarget;
+	double*			pForce;
+	double			w[5];		/* separation, alignment, cohesion, seek, arrive */
+	double			dRadius;
+	double			dSepRadius;
+	double			dMaxSpeed;
+	double			dSlowRadius;
+} SteerBatch;
+
+#define STEER_MIN_BATCH 128		/* fewest agents worth a thread */
+
+/* internal functions */
+void steer_agent(SteerBatch* pBatch, long a);
+void steer_batch(void* pArg, long nStart, long nEnd, int nThread);
+
+/* exported API functions */
+PyObject* Steer_steer(PyObject *self_in, PyObject *args);
+
+#endif
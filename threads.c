@@ -0,0 +1,239 @@
+#include "threads.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct ThreadsJob {
+	ThreadsFunc		fn;
+	void*			pArg;
+	long			nStart;
+	long			nEnd;
+	int				nThread;
+	int				bPosted;	/* set by threads_run, cleared by the worker */
+} ThreadsJob;
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION ThreadsLock;
+typedef CONDITION_VARIABLE ThreadsCond;
+#define THREADS_LOCK(l) EnterCriticalSection(&(l))
+#define THREADS_UNLOCK(l) LeaveCriticalSection(&(l))
+#define THREADS_WAIT(c, l) SleepConditionVariableCS(&(c), &(l), INFINITE)
+#define THREADS_WAKE_ALL(c) WakeAllConditionVariable(&(c))
+#else
+typedef pthread_mutex_t ThreadsLock;
+typedef pthread_cond_t ThreadsCond;
+#define THREADS_LOCK(l) pthread_mutex_lock(&(l))
+#define THREADS_UNLOCK(l) pthread_mutex_unlock(&(l))
+#define THREADS_WAIT(c, l) pthread_cond_wait(&(c), &(l))
+#define THREADS_WAKE_ALL(c) pthread_cond_broadcast(&(c))
+#endif
+
+/* the pool.  Worker k runs jobs[k] whenever it is posted; jobs[0] is */
+/* always the calling thread's.  lock guards everything here, run is held */
+/* by whichever threads_run owns the workers. */
+typedef struct ThreadsPool {
+	ThreadsJob		jobs[THREADS_MAX];
+	int				nWorkers;	/* workers started, as jobs 1 .. nWorkers */
+	int				nPending;	/* posted jobs not yet finished */
+	ThreadsLock		lock;
+	ThreadsLock		run;
+	ThreadsCond		wake;
+	ThreadsCond		done;
+} ThreadsPool;
+
+static ThreadsPool threads_pool;
+
+static void threads_work(ThreadsJob* pJob)
+{
+	pJob->fn(pJob->pArg, pJob->nStart, pJob->nEnd, pJob->nThread);
+}
+
+/* a worker: waits for its job to be posted, runs it, and says when the */
+/* last one of a round is done */
+static void threads_worker(int k)
+{
+	ThreadsPool* p = &threads_pool;
+	ThreadsJob job;
+
+	for (;;)
+	{
+		THREADS_LOCK(p->lock);
+		while (!p->jobs[k].bPosted)
+			THREADS_WAIT(p->wake, p->lock);
+		p->jobs[k].bPosted = 0;
+		job = p->jobs[k];
+		THREADS_UNLOCK(p->lock);
+
+		threads_work(&job);
+
+		THREADS_LOCK(p->lock);
+		if (--p->nPending == 0)
+			THREADS_WAKE_ALL(p->done);
+		THREADS_UNLOCK(p->lock);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI threads_main(LPVOID p)
+{
+	threads_worker((int)(INT_PTR)p);
+	return 0;
+}
+
+static int threads_start(int k)
+{
+	HANDLE h = CreateThread(NULL, 0, threads_main, (LPVOID)(INT_PTR)k, 0, NULL);
+
+	if (h == NULL)
+		return 0;
+	CloseHandle(h);
+	return 1;
+}
+#else
+static void* threads_main(void* p)
+{
+	threads_worker((int)(long)p);
+	return NULL;
+}
+
+static int threads_start(int k)
+{
+	pthread_t h;
+	pthread_attr_t attr;
+	int bOk;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	bOk = pthread_create(&h, &attr, threads_main, (void*)(long)k) == 0;
+	pthread_attr_destroy(&attr);
+	return bOk;
+}
+
+/* a forked child has none of the workers, and may have copied the */
+/* locks mid-use */
+static void threads_after_fork(void)
+{
+	threads_init();
+}
+#endif
+
+/* sets up the pool with no workers; they are started on first use */
+void threads_init(void)
+{
+	ThreadsPool* p = &threads_pool;
+#ifndef _WIN32
+	static int bAtFork = 0;
+#endif
+
+	memset(p->jobs, 0, sizeof(p->jobs));
+	p->nWorkers = 0;
+	p->nPending = 0;
+#ifdef _WIN32
+	InitializeCriticalSection(&p->lock);
+	InitializeCriticalSection(&p->run);
+	InitializeConditionVariable(&p->wake);
+	InitializeConditionVariable(&p->done);
+#else
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_mutex_init(&p->run, NULL);
+	pthread_cond_init(&p->wake, NULL);
+	pthread_cond_init(&p->done, NULL);
+	if (!bAtFork)
+	{
+		pthread_atfork(NULL, NULL, threads_after_fork);
+		bAtFork = 1;
+	}
+#endif
+}
+
+/* number of processors online, at least 1 */
+int threads_count(void)
+{
+	long n;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	n = (long)info.dwNumberOfProcessors;
+#else
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (n < 1)
+		n = 1;
+	if (n > THREADS_MAX)
+		n = THREADS_MAX;
+	return (int)n;
+}
+
+/* the thread count to use for nItems: nThreads, or every processor if 0, */
+/* but leaving each thread at least nMinPerThread items */
+int threads_pick(int nThreads, long nItems, long nMinPerThread)
+{
+	if (nThreads <= 0)
+		nThreads = threads_count();
+	if (nThreads > THREADS_MAX)
+		nThreads = THREADS_MAX;
+	if (nMinPerThread > 0 && nItems / nMinPerThread < nThreads)
+		nThreads = (int)(nItems / nMinPerThread);
+	return nThreads < 1 ? 1 : nThreads;
+}
+
+/* splits nItems into nThreads contiguous runs, runs the first on the */
+/* calling thread and the rest on pool workers, and waits for them.  The */
+/* workers are started the first time they are needed and then kept, so */
+/* a call only costs a wake and a wait.  Calls from several threads take */
+/* turns.  A run whose worker cannot be started is done on the calling */
+/* thread instead. */
+void threads_run(ThreadsFunc fn, void* pArg, long nItems, int nThreads)
+{
+	ThreadsPool* p = &threads_pool;
+	ThreadsJob jobs[THREADS_MAX];
+	int i, nPosted;
+
+	if (nThreads < 1)
+		nThreads = 1;
+	if (nThreads > THREADS_MAX)
+		nThreads = THREADS_MAX;
+
+	for (i = 0; i < nThreads; i++)
+	{
+		jobs[i].fn = fn;
+		jobs[i].pArg = pArg;
+		jobs[i].nStart = (long)(((double)nItems * i) / nThreads);
+		jobs[i].nEnd = (long)(((double)nItems * (i + 1)) / nThreads);
+		jobs[i].nThread = i;
+		jobs[i].bPosted = 1;
+	}
+	if (nThreads == 1)
+	{
+		threads_work(&jobs[0]);
+		return;
+	}
+
+	THREADS_LOCK(p->run);
+	while (p->nWorkers < nThreads - 1 && threads_start(p->nWorkers + 1))
+		p->nWorkers++;
+	nPosted = (p->nWorkers < nThreads - 1) ? p->nWorkers : nThreads - 1;
+	THREADS_LOCK(p->lock);
+	for (i = 1; i <= nPosted; i++)
+		p->jobs[i] = jobs[i];
+	p->nPending = nPosted;
+	THREADS_WAKE_ALL(p->wake);
+	THREADS_UNLOCK(p->lock);
+
+	threads_work(&jobs[0]);
+	for (i = nPosted + 1; i < nThreads; i++)
+		threads_work(&jobs[i]);
+
+	THREADS_LOCK(p->lock);
+	while (p->nPending > 0)
+		THREADS_WAIT(p->done, p->lock);
+	THREADS_UNLOCK(p->lock);
+	THREADS_UNLOCK(p->run);
+}
@@ -0,0 +1,17 @@
+#ifndef THREADS_H_INCLUDED
+#define THREADS_H_INCLUDED
+
+/* a persistent worker pool for batch work, usually run with the GIL */
+/* released.  The work function must not touch any Python object. */
+
+#define THREADS_MAX 64
+
+/* processes items nStart up to nEnd; nThread is 0 .. nThreads - 1 */
+typedef void (*ThreadsFunc)(void* pArg, long nStart, long nEnd, int nThread);
+
+void threads_init(void);
+int threads_count(void);
+int threads_pick(int nThreads, long nItems, long nMinPerThread);
+void threads_run(ThreadsFunc fn, void* pArg, long nItems, int nThreads);
+
+#endif